@@ -894,6 +894,9 @@ class CYCLES_RENDER_PT_performance_final_render(CyclesButtonsPanel, Panel):
         col = layout.column()
 
         col.prop(rd, "use_persistent_data", text="Persistent Data")
+        sub = col.column()
+        sub.active = not rd.use_persistent_data
+        sub.prop(rd, "use_pipelined_evaluation", text="Pipelined Evaluation")
 
 
 class CYCLES_RENDER_PT_performance_viewport(CyclesButtonsPanel, Panel):
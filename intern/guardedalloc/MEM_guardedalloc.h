@@ -264,6 +264,46 @@ void MEM_use_lockfree_allocator(void);
  */
 void MEM_use_guarded_allocator(void);
 
+/**
+ * Switch allocator to fast mode for small allocations.
+ *
+ * Like the lock-free allocator, but small blocks are taken from size-class slabs through
+ * per-thread caches, which avoids most calls to the system allocator in allocation heavy code.
+ * Memory of freed small blocks is kept for reuse instead of being returned to the system.
+ *
+ * \note The switch between allocator types can only happen before any allocation did happen.
+ */
+void MEM_use_slab_allocator(void);
+
+/** Memory usage of all blocks allocated with the same name, see #MEM_enable_memory_tags. */
+typedef struct MEM_TagUsage {
+  const char *name;
+  size_t mem_in_use;
+  size_t blocks_num;
+  /** Approximate, the peaks of the individual names are only updated once in a while. */
+  size_t mem_peak;
+} MEM_TagUsage;
+
+/**
+ * Track the memory usage per allocation name with the lock-free and slab allocators, similar to
+ * the statistics of the fully guarded allocator but cheap enough to use in production.
+ *
+ * Blocks allocated before this is called are not tracked per name. Should be called at startup,
+ * before other threads allocate memory.
+ */
+void MEM_enable_memory_tags(void);
+bool MEM_memory_tags_enabled(void);
+
+/**
+ * Call \a callback with the usage of every allocation name, when memory tags are enabled.
+ * The callback is allowed to allocate memory.
+ */
+void MEM_foreach_memory_tag(void (*callback)(const MEM_TagUsage *usage, void *user_data),
+                            void *user_data);
+
+/** Print the allocation names with the highest peak memory usage, when memory tags are enabled. */
+void MEM_print_memory_tags_report(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
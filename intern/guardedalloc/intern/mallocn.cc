@@ -201,3 +201,38 @@ void MEM_use_guarded_allocator()
   MEM_name_ptr_set = MEM_guarded_name_ptr_set;
 #endif
 }
+
+void MEM_use_slab_allocator()
+{
+  assert_for_allocator_change();
+
+  MEM_allocN_len = MEM_slab_allocN_len;
+  mem_freeN_ex = MEM_slab_freeN;
+  MEM_dupallocN = MEM_slab_dupallocN;
+  MEM_reallocN_id = MEM_slab_reallocN_id;
+  MEM_recallocN_id = MEM_slab_recallocN_id;
+  MEM_callocN = MEM_slab_callocN;
+  MEM_calloc_arrayN = MEM_slab_calloc_arrayN;
+  MEM_mallocN = MEM_slab_mallocN;
+  MEM_malloc_arrayN = MEM_slab_malloc_arrayN;
+  mem_mallocN_aligned_ex = MEM_slab_mallocN_aligned;
+  MEM_calloc_arrayN_aligned = MEM_slab_calloc_arrayN_aligned;
+  MEM_printmemlist_pydict = MEM_slab_printmemlist_pydict;
+  MEM_printmemlist = MEM_slab_printmemlist;
+  MEM_callbackmemlist = MEM_slab_callbackmemlist;
+  MEM_printmemlist_stats = MEM_slab_printmemlist_stats;
+  MEM_set_error_callback = MEM_slab_set_error_callback;
+  MEM_consistency_check = MEM_slab_consistency_check;
+  MEM_set_memory_debug = MEM_slab_set_memory_debug;
+  MEM_get_memory_in_use = MEM_slab_get_memory_in_use;
+  MEM_get_memory_blocks_in_use = MEM_slab_get_memory_blocks_in_use;
+  MEM_reset_peak_memory = MEM_slab_reset_peak_memory;
+  MEM_get_peak_memory = MEM_slab_get_peak_memory;
+
+  mem_clearmemlist = mem_slab_clearmemlist;
+
+#ifndef NDEBUG
+  MEM_name_ptr = MEM_slab_name_ptr;
+  MEM_name_ptr_set = MEM_slab_name_ptr_set;
+#endif
+}
@@ -88,9 +88,28 @@ void aligned_free(void *ptr);
 extern bool leak_detector_has_run;
 extern char free_after_leak_detection_message[];
 
+/**
+ * Memory tags identify the allocation name of blocks for the per-name statistics, see
+ * #MEM_enable_memory_tags. They are stored in the upper bits of the length in the block header,
+ * zero means the block is not tagged.
+ */
+#define MEMHEAD_TAG_SHIFT 52
+#define MEMHEAD_TAG_MASK (~(size_t)0 << MEMHEAD_TAG_SHIFT)
+#define MEM_TAGS_NUM (1u << (64 - MEMHEAD_TAG_SHIFT))
+
+extern bool memory_tags_enabled;
+
+/** Get the tag for allocations with the given name, creating it if necessary. */
+unsigned int memory_usage_tag_ensure(const char *name);
+
+MEM_INLINE unsigned int memory_usage_tag_from_name(const char *name)
+{
+  return UNLIKELY(memory_tags_enabled) ? memory_usage_tag_ensure(name) : 0;
+}
+
 void memory_usage_init(void);
-void memory_usage_block_alloc(size_t size);
-void memory_usage_block_free(size_t size);
+void memory_usage_block_alloc(size_t size, unsigned int tag);
+void memory_usage_block_free(size_t size, unsigned int tag);
 size_t memory_usage_block_num(void);
 size_t memory_usage_current(void);
 size_t memory_usage_peak(void);
@@ -159,6 +178,48 @@ const char *MEM_lockfree_name_ptr(void *vmemh);
 void MEM_lockfree_name_ptr_set(void *vmemh, const char *str);
 #endif
 
+/* Prototypes for slab allocator functions */
+size_t MEM_slab_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
+void MEM_slab_freeN(void *vmemh, mem_guarded::internal::AllocationType allocation_type);
+void *MEM_slab_dupallocN(const void *vmemh) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void *MEM_slab_reallocN_id(void *vmemh, size_t len, const char *str) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(2);
+void *MEM_slab_recallocN_id(void *vmemh, size_t len, const char *str) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(2);
+void *MEM_slab_callocN(size_t len, const char *str) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_slab_calloc_arrayN(size_t len, size_t size, const char *str) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *MEM_slab_mallocN(size_t len, const char *str) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT
+    ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_slab_malloc_arrayN(size_t len, size_t size, const char *str) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(3);
+void *MEM_slab_mallocN_aligned(size_t len,
+                               size_t alignment,
+                               const char *str,
+                               mem_guarded::internal::AllocationType allocation_type) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(3);
+void *MEM_slab_calloc_arrayN_aligned(size_t len, size_t size, size_t alignment, const char *str)
+    ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1, 2) ATTR_NONNULL(4);
+void MEM_slab_printmemlist_pydict(void);
+void MEM_slab_printmemlist(void);
+void MEM_slab_callbackmemlist(void (*func)(void *));
+void MEM_slab_printmemlist_stats(void);
+void MEM_slab_set_error_callback(void (*func)(const char *));
+bool MEM_slab_consistency_check(void);
+void MEM_slab_set_memory_debug(void);
+size_t MEM_slab_get_memory_in_use(void);
+unsigned int MEM_slab_get_memory_blocks_in_use(void);
+void MEM_slab_reset_peak_memory(void);
+size_t MEM_slab_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
+
+void mem_slab_clearmemlist(void);
+
+#ifndef NDEBUG
+const char *MEM_slab_name_ptr(void *vmemh);
+void MEM_slab_name_ptr_set(void *vmemh, const char *str);
+#endif
+
 /* Prototypes for fully guarded allocator functions */
 size_t MEM_guarded_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_guarded_freeN(void *vmemh, mem_guarded::internal::AllocationType allocation_type);
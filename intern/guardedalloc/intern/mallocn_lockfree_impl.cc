@@ -72,7 +72,9 @@ enum {
 #define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & size_t(MEMHEAD_FLAG_ALIGN))
 #define MEMHEAD_IS_FROM_CPP_NEW(memhead) ((memhead)->len & size_t(MEMHEAD_FLAG_FROM_CPP_NEW))
-#define MEMHEAD_LEN(memhead) ((memhead)->len & ~size_t(MEMHEAD_FLAG_MASK))
+#define MEMHEAD_LEN(memhead) ((memhead)->len & ~(size_t(MEMHEAD_FLAG_MASK) | MEMHEAD_TAG_MASK))
+#define MEMHEAD_TAG(memhead) uint((memhead)->len >> MEMHEAD_TAG_SHIFT)
+#define MEMHEAD_TAG_BITS(tag) (size_t(tag) << MEMHEAD_TAG_SHIFT)
 
 #ifdef __GNUC__
 __attribute__((format(printf, 1, 0)))
@@ -131,6 +133,30 @@ report_error_on_address(const void *vmemh, const char *message, ...)
   MEM_trigger_error_on_memory_block(address, size);
 }
 
+/**
+ * Account a block that is a copy of another one to the same memory tag, instead of the tag of the
+ * generic name used to allocate the copy.
+ */
+#ifdef __GNUC__
+/* Not inlined, GCC reports a false positive array bounds warning for the header access of a
+ * pointer it just saw being allocated. */
+__attribute__((noinline))
+#endif
+static void
+memhead_tag_copy(void *vmemh_dst, const void *vmemh_src)
+{
+  MemHead *memh_dst = MEMHEAD_FROM_PTR(vmemh_dst);
+  const uint tag_dst = MEMHEAD_TAG(memh_dst);
+  const uint tag_src = MEMHEAD_TAG(MEMHEAD_FROM_PTR(vmemh_src));
+  if (LIKELY(tag_dst == tag_src)) {
+    return;
+  }
+  const size_t len = MEMHEAD_LEN(memh_dst);
+  memory_usage_block_free(len, tag_dst);
+  memory_usage_block_alloc(len, tag_src);
+  memh_dst->len = (memh_dst->len & ~MEMHEAD_TAG_MASK) | MEMHEAD_TAG_BITS(tag_src);
+}
+
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (LIKELY(vmemh)) {
@@ -160,7 +186,7 @@ void MEM_lockfree_freeN(void *vmemh, AllocationType allocation_type)
         "Attempt to use C-style MEM_freeN on a pointer created with CPP-style MEM_new or new\n");
   }
 
-  memory_usage_block_free(len);
+  memory_usage_block_free(len, MEMHEAD_TAG(memh));
 
   if (UNLIKELY(malloc_debug_memset && len)) {
     memset(memh + 1, 255, len);
@@ -196,6 +222,7 @@ void *MEM_lockfree_dupallocN(const void *vmemh)
       newp = MEM_lockfree_mallocN(prev_size, "dupli_malloc");
     }
     memcpy(newp, vmemh, prev_size);
+    memhead_tag_copy(newp, vmemh);
   }
   return newp;
 }
@@ -224,6 +251,7 @@ void *MEM_lockfree_reallocN_id(void *vmemh, size_t len, const char *str)
     }
 
     if (newp) {
+      memhead_tag_copy(newp, vmemh);
       if (len < old_len) {
         /* shrink */
         memcpy(newp, vmemh, len);
@@ -267,6 +295,7 @@ void *MEM_lockfree_recallocN_id(void *vmemh, size_t len, const char *str)
     }
 
     if (newp) {
+      memhead_tag_copy(newp, vmemh);
       if (len < old_len) {
         /* shrink */
         memcpy(newp, vmemh, len);
@@ -300,8 +329,9 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
   memh = (MemHead *)calloc(1, len + sizeof(MemHead));
 
   if (LIKELY(memh)) {
-    memh->len = len;
-    memory_usage_block_alloc(len);
+    const uint tag = memory_usage_tag_from_name(str);
+    memh->len = len | MEMHEAD_TAG_BITS(tag);
+    memory_usage_block_alloc(len, tag);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -357,8 +387,9 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 #endif /* WITH_MEM_VALGRIND */
     }
 
-    memh->len = len;
-    memory_usage_block_alloc(len);
+    const uint tag = memory_usage_tag_from_name(str);
+    memh->len = len | MEMHEAD_TAG_BITS(tag);
+    memory_usage_block_alloc(len, tag);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -441,11 +472,13 @@ void *MEM_lockfree_mallocN_aligned(size_t len,
 #endif /* WITH_MEM_VALGRIND */
     }
 
+    const uint tag = memory_usage_tag_from_name(str);
     memh->len = len | size_t(MEMHEAD_FLAG_ALIGN) |
                 size_t(allocation_type == AllocationType::NEW_DELETE ? MEMHEAD_FLAG_FROM_CPP_NEW :
-                                                                       0);
+                                                                       0) |
+                MEMHEAD_TAG_BITS(tag);
     memh->alignment = short(alignment);
-    memory_usage_block_alloc(len);
+    memory_usage_block_alloc(len, tag);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -502,6 +535,7 @@ void MEM_lockfree_printmemlist_stats()
 {
   printf("\ntotal memory len: %.3f MB\n", double(memory_usage_current()) / double(1024 * 1024));
   printf("peak memory len: %.3f MB\n", double(memory_usage_peak()) / double(1024 * 1024));
+  MEM_print_memory_tags_report();
   printf(
       "\nFor more detailed per-block statistics run Blender with memory debugging command line "
       "argument.\n");
@@ -0,0 +1,880 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup intern_mem
+ *
+ * Memory allocation which keeps track on allocated memory counters, like the lock-free allocator,
+ * but serves small blocks from size-class slabs with per-thread caches.
+ *
+ * Small blocks are taken from a thread-local free list of their size class, so the common case
+ * does not need any synchronization. Free lists move between the threads and a global pool in
+ * batches, which is the only place where a lock is needed. Memory of slabs is kept for reuse and
+ * not returned to the system. Blocks which don't fit a size class, and aligned blocks, use the
+ * system allocator directly.
+ */
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h> /* printf */
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <sys/types.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "mallocn_intern.hh"
+#include "mallocn_intern_function_pointers.hh"
+
+using namespace mem_guarded::internal;
+
+typedef struct MemHead {
+  /* Length of allocated memory block. */
+  size_t len;
+} MemHead;
+static_assert(MEM_MIN_CPP_ALIGNMENT <= alignof(MemHead), "Bad alignment of MemHead");
+static_assert(MEM_MIN_CPP_ALIGNMENT <= sizeof(MemHead), "Bad size of MemHead");
+
+typedef struct MemHeadAligned {
+  short alignment;
+  size_t len;
+} MemHeadAligned;
+static_assert(MEM_MIN_CPP_ALIGNMENT <= alignof(MemHeadAligned), "Bad alignment of MemHeadAligned");
+static_assert(MEM_MIN_CPP_ALIGNMENT <= sizeof(MemHeadAligned), "Bad size of MemHeadAligned");
+
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = nullptr;
+
+/** Same flags as the lock-free allocator, see #MEMHEAD_FLAG_MASK. */
+enum {
+  MEMHEAD_FLAG_ALIGN = 1 << 0,
+  MEMHEAD_FLAG_FROM_CPP_NEW = 1 << 1,
+
+  MEMHEAD_FLAG_MASK = (1 << 2) - 1
+};
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
+#define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & size_t(MEMHEAD_FLAG_ALIGN))
+#define MEMHEAD_IS_FROM_CPP_NEW(memhead) ((memhead)->len & size_t(MEMHEAD_FLAG_FROM_CPP_NEW))
+#define MEMHEAD_LEN(memhead) ((memhead)->len & ~(size_t(MEMHEAD_FLAG_MASK) | MEMHEAD_TAG_MASK))
+#define MEMHEAD_TAG(memhead) uint((memhead)->len >> MEMHEAD_TAG_SHIFT)
+#define MEMHEAD_TAG_BITS(tag) (size_t(tag) << MEMHEAD_TAG_SHIFT)
+
+/* -------------------------------------------------------------------- */
+/** \name Size Classes
+ *
+ * Block sizes include the #MemHead. Classes are spaced so that at most a quarter of a block is
+ * wasted by rounding up, beyond the smallest classes.
+ * \{ */
+
+static constexpr size_t slab_block_sizes[] = {
+    16,  32,  48,  64,  80,  96,   112,  128,  160,  192,  224,  256,
+    320, 384, 448, 512, 640, 768,  896,  1024, 1280, 1536, 1792, 2048,
+};
+static constexpr int SLAB_CLASSES_NUM = int(sizeof(slab_block_sizes) / sizeof(size_t));
+static constexpr size_t SLAB_BLOCK_SIZE_MAX = slab_block_sizes[SLAB_CLASSES_NUM - 1];
+/** Size of the memory chunks that are split into blocks of one size class. */
+static constexpr size_t SLAB_SIZE = 64 * 1024;
+/** Amount of memory moved between a thread cache and the global pool at once. */
+static constexpr size_t SLAB_BATCH_BYTES = 16 * 1024;
+
+struct SlabClassTable {
+  /** Size class for every block size, in steps of 16 bytes. */
+  unsigned char class_by_size[SLAB_BLOCK_SIZE_MAX / 16 + 1];
+
+  constexpr SlabClassTable() : class_by_size()
+  {
+    int class_index = 0;
+    for (size_t i = 0; i <= SLAB_BLOCK_SIZE_MAX / 16; i++) {
+      while (slab_block_sizes[class_index] < i * 16) {
+        class_index++;
+      }
+      class_by_size[i] = (unsigned char)class_index;
+    }
+  }
+};
+static constexpr SlabClassTable slab_class_table;
+
+/** Whether a block with a #MemHead of this (aligned to 4) length is stored in a slab. */
+MEM_INLINE bool slab_len_is_small(const size_t len)
+{
+  return len + sizeof(MemHead) <= SLAB_BLOCK_SIZE_MAX;
+}
+
+MEM_INLINE int slab_class_from_len(const size_t len)
+{
+  return slab_class_table.class_by_size[(len + sizeof(MemHead) + 15) >> 4];
+}
+
+/** Number of blocks moved between a thread cache and the global pool at once. */
+MEM_INLINE int slab_class_batch_num(const int class_index)
+{
+  const size_t num = SLAB_BATCH_BYTES / slab_block_sizes[class_index];
+  return int(num < 8 ? 8 : (num > 256 ? 256 : num));
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Free Lists
+ * \{ */
+
+/** Unused blocks store the free list in their own memory. */
+struct SlabFreeBlock {
+  SlabFreeBlock *next;
+  /** Only used by the first block of a batch in the global pool. */
+  SlabFreeBlock *next_batch;
+};
+static_assert(sizeof(SlabFreeBlock) <= 16, "Free block has to fit the smallest class");
+
+struct SlabFreeList {
+  SlabFreeBlock *head = nullptr;
+  int num = 0;
+};
+
+struct SlabGlobalClass {
+  std::mutex mutex;
+  /** Batches of free blocks, linked with #SlabFreeBlock::next_batch. */
+  SlabFreeBlock *batches = nullptr;
+};
+
+struct SlabGlobal {
+  SlabGlobalClass classes[SLAB_CLASSES_NUM];
+  /** Memory allocated from the system for slabs. */
+  std::atomic<size_t> reserved = 0;
+};
+
+/**
+ * The global pool is never destructed, blocks may still be freed during destruction of static
+ * variables at exit.
+ */
+static SlabGlobal &slab_global()
+{
+  static SlabGlobal *global = new SlabGlobal();
+  return *global;
+}
+
+static void slab_global_push(const int class_index, SlabFreeBlock *batch)
+{
+  SlabGlobalClass &global_class = slab_global().classes[class_index];
+  std::lock_guard lock{global_class.mutex};
+  batch->next_batch = global_class.batches;
+  global_class.batches = batch;
+}
+
+static SlabFreeBlock *slab_global_pop(const int class_index)
+{
+  SlabGlobalClass &global_class = slab_global().classes[class_index];
+  std::lock_guard lock{global_class.mutex};
+  SlabFreeBlock *batch = global_class.batches;
+  if (batch) {
+    global_class.batches = batch->next_batch;
+  }
+  return batch;
+}
+
+/**
+ * Split a new slab into batches of free blocks. The first batch is returned, the others are
+ * added to the global pool.
+ */
+static SlabFreeBlock *slab_new(const int class_index)
+{
+  char *slab = (char *)malloc(SLAB_SIZE);
+  if (UNLIKELY(slab == nullptr)) {
+    return nullptr;
+  }
+  slab_global().reserved.fetch_add(SLAB_SIZE, std::memory_order_relaxed);
+
+  const size_t block_size = slab_block_sizes[class_index];
+  const size_t blocks_num = SLAB_SIZE / block_size;
+  const size_t batch_num = size_t(slab_class_batch_num(class_index));
+
+  SlabFreeBlock *first_batch = nullptr;
+  for (size_t batch_start = 0; batch_start < blocks_num; batch_start += batch_num) {
+    const size_t batch_end = batch_start + batch_num < blocks_num ? batch_start + batch_num :
+                                                                   blocks_num;
+    for (size_t i = batch_start; i < batch_end; i++) {
+      SlabFreeBlock *block = (SlabFreeBlock *)(slab + i * block_size);
+      block->next = (i + 1 < batch_end) ? (SlabFreeBlock *)(slab + (i + 1) * block_size) :
+                                          nullptr;
+    }
+    SlabFreeBlock *batch = (SlabFreeBlock *)(slab + batch_start * block_size);
+    if (first_batch == nullptr) {
+      first_batch = batch;
+    }
+    else {
+      slab_global_push(class_index, batch);
+    }
+  }
+  return first_batch;
+}
+
+/** Get a batch of free blocks from the global pool, or from a new slab. */
+static SlabFreeBlock *slab_batch_acquire(const int class_index)
+{
+  if (SlabFreeBlock *batch = slab_global_pop(class_index)) {
+    return batch;
+  }
+  return slab_new(class_index);
+}
+
+/**
+ * Free lists of a thread. Blocks freed by a thread are added to its own cache, regardless of the
+ * thread that allocated them.
+ */
+struct SlabLocalCache {
+  SlabFreeList lists[SLAB_CLASSES_NUM];
+
+  ~SlabLocalCache();
+};
+
+/**
+ * Pointer to the cache of the current thread. This is trivially destructible, so it can still be
+ * checked after the cache itself has been destructed when the thread exits.
+ */
+static thread_local SlabLocalCache *local_cache_ptr = nullptr;
+static thread_local bool local_cache_destructed = false;
+
+SlabLocalCache::~SlabLocalCache()
+{
+  for (int class_index = 0; class_index < SLAB_CLASSES_NUM; class_index++) {
+    SlabFreeList &list = this->lists[class_index];
+    if (list.head) {
+      slab_global_push(class_index, list.head);
+      list = {};
+    }
+  }
+  /* Blocks that are freed later on this thread go to the global pool directly. */
+  local_cache_ptr = nullptr;
+  local_cache_destructed = true;
+}
+
+static SlabLocalCache *slab_local_cache()
+{
+  if (LIKELY(local_cache_ptr)) {
+    return local_cache_ptr;
+  }
+  if (local_cache_destructed) {
+    return nullptr;
+  }
+  static thread_local SlabLocalCache cache;
+  local_cache_ptr = &cache;
+  return &cache;
+}
+
+static int slab_batch_len(const SlabFreeBlock *batch)
+{
+  int num = 0;
+  for (; batch; batch = batch->next) {
+    num++;
+  }
+  return num;
+}
+
+static void *slab_block_alloc(const int class_index)
+{
+  SlabLocalCache *cache = slab_local_cache();
+  if (UNLIKELY(cache == nullptr)) {
+    /* Thread is exiting, take one block from the pool and return the rest. */
+    SlabFreeBlock *batch = slab_batch_acquire(class_index);
+    if (batch && batch->next) {
+      slab_global_push(class_index, batch->next);
+    }
+    return batch;
+  }
+
+  SlabFreeList &list = cache->lists[class_index];
+  if (UNLIKELY(list.head == nullptr)) {
+    list.head = slab_batch_acquire(class_index);
+    if (UNLIKELY(list.head == nullptr)) {
+      return nullptr;
+    }
+    list.num = slab_batch_len(list.head);
+  }
+  SlabFreeBlock *block = list.head;
+  list.head = block->next;
+  list.num--;
+  return block;
+}
+
+static void slab_block_free(void *ptr, const int class_index)
+{
+  SlabFreeBlock *block = (SlabFreeBlock *)ptr;
+  SlabLocalCache *cache = slab_local_cache();
+  if (UNLIKELY(cache == nullptr)) {
+    block->next = nullptr;
+    slab_global_push(class_index, block);
+    return;
+  }
+
+  SlabFreeList &list = cache->lists[class_index];
+  block->next = list.head;
+  list.head = block;
+  list.num++;
+
+  /* Keep the cache bounded, so memory freed by one thread can be reused by the others. */
+  const int batch_num = slab_class_batch_num(class_index);
+  if (UNLIKELY(list.num > batch_num * 2)) {
+    SlabFreeBlock *batch = list.head;
+    SlabFreeBlock *batch_last = batch;
+    for (int i = 1; i < batch_num; i++) {
+      batch_last = batch_last->next;
+    }
+    list.head = batch_last->next;
+    list.num -= batch_num;
+    batch_last->next = nullptr;
+    slab_global_push(class_index, batch);
+  }
+}
+
+/** \} */
+
+#ifdef __GNUC__
+__attribute__((format(printf, 1, 0)))
+#endif
+static void
+print_error(const char *message, va_list str_format_args)
+{
+  char buf[512];
+  vsnprintf(buf, sizeof(buf), message, str_format_args);
+  buf[sizeof(buf) - 1] = '\0';
+
+  if (error_callback) {
+    error_callback(buf);
+  }
+}
+
+#ifdef __GNUC__
+__attribute__((format(printf, 1, 2)))
+#endif
+static void
+print_error(const char *message, ...)
+{
+  va_list str_format_args;
+  va_start(str_format_args, message);
+  print_error(message, str_format_args);
+  va_end(str_format_args);
+}
+
+#ifdef __GNUC__
+__attribute__((format(printf, 2, 3)))
+#endif
+static void
+report_error_on_address(const void *vmemh, const char *message, ...)
+{
+  va_list str_format_args;
+
+  va_start(str_format_args, message);
+  print_error(message, str_format_args);
+  va_end(str_format_args);
+
+  if (vmemh == nullptr) {
+    MEM_trigger_error_on_memory_block(nullptr, 0);
+    return;
+  }
+
+  const MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  const size_t len = MEMHEAD_LEN(memh);
+
+  const void *address = memh;
+  size_t size = len + sizeof(*memh);
+  if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+    const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+    address = MEMHEAD_REAL_PTR(memh_aligned);
+    size = len + sizeof(*memh_aligned) + MEMHEAD_ALIGN_PADDING(memh_aligned->alignment);
+  }
+  MEM_trigger_error_on_memory_block(address, size);
+}
+
+/** Allocate a non-aligned block with a #MemHead, \a len has to be aligned to 4 already. */
+static MemHead *slab_memhead_alloc(const size_t len, const bool zero)
+{
+  if (LIKELY(slab_len_is_small(len))) {
+    MemHead *memh = (MemHead *)slab_block_alloc(slab_class_from_len(len));
+    if (zero && LIKELY(memh)) {
+      memset(memh + 1, 0, len);
+    }
+    return memh;
+  }
+  if (zero) {
+    return (MemHead *)calloc(1, len + sizeof(MemHead));
+  }
+  return (MemHead *)malloc(len + sizeof(MemHead));
+}
+
+/**
+ * Account a block that is a copy of another one to the same memory tag, instead of the tag of the
+ * generic name used to allocate the copy.
+ */
+#ifdef __GNUC__
+/* Not inlined, GCC reports a false positive array bounds warning for the header access of a
+ * pointer it just saw being allocated. */
+__attribute__((noinline))
+#endif
+static void
+memhead_tag_copy(void *vmemh_dst, const void *vmemh_src)
+{
+  MemHead *memh_dst = MEMHEAD_FROM_PTR(vmemh_dst);
+  const uint tag_dst = MEMHEAD_TAG(memh_dst);
+  const uint tag_src = MEMHEAD_TAG(MEMHEAD_FROM_PTR(vmemh_src));
+  if (LIKELY(tag_dst == tag_src)) {
+    return;
+  }
+  const size_t len = MEMHEAD_LEN(memh_dst);
+  memory_usage_block_free(len, tag_dst);
+  memory_usage_block_alloc(len, tag_src);
+  memh_dst->len = (memh_dst->len & ~MEMHEAD_TAG_MASK) | MEMHEAD_TAG_BITS(tag_src);
+}
+
+size_t MEM_slab_allocN_len(const void *vmemh)
+{
+  if (LIKELY(vmemh)) {
+    return MEMHEAD_LEN(MEMHEAD_FROM_PTR(vmemh));
+  }
+
+  return 0;
+}
+
+void MEM_slab_freeN(void *vmemh, AllocationType allocation_type)
+{
+  if (UNLIKELY(leak_detector_has_run)) {
+    print_error("%s\n", free_after_leak_detection_message);
+  }
+
+  if (UNLIKELY(vmemh == nullptr)) {
+    report_error_on_address(vmemh, "Attempt to free nullptr pointer\n");
+    return;
+  }
+
+  MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  size_t len = MEMHEAD_LEN(memh);
+
+  if (allocation_type != AllocationType::NEW_DELETE && MEMHEAD_IS_FROM_CPP_NEW(memh)) {
+    report_error_on_address(
+        vmemh,
+        "Attempt to use C-style MEM_freeN on a pointer created with CPP-style MEM_new or new\n");
+  }
+
+  memory_usage_block_free(len, MEMHEAD_TAG(memh));
+
+  if (UNLIKELY(malloc_debug_memset && len)) {
+    memset(memh + 1, 255, len);
+  }
+  if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+    MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+    aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+  }
+  else if (LIKELY(slab_len_is_small(len))) {
+    slab_block_free(memh, slab_class_from_len(len));
+  }
+  else {
+    free(memh);
+  }
+}
+
+void *MEM_slab_dupallocN(const void *vmemh)
+{
+  void *newp = nullptr;
+  if (vmemh) {
+    const MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    const size_t prev_size = MEM_slab_allocN_len(vmemh);
+
+    if (MEMHEAD_IS_FROM_CPP_NEW(memh)) {
+      report_error_on_address(vmemh,
+                              "Attempt to use C-style MEM_dupallocN on a pointer created with "
+                              "CPP-style MEM_new or new\n");
+    }
+
+    if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+      const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_slab_mallocN_aligned(
+          prev_size, size_t(memh_aligned->alignment), "dupli_malloc", AllocationType::ALLOC_FREE);
+    }
+    else {
+      newp = MEM_slab_mallocN(prev_size, "dupli_malloc");
+    }
+    memcpy(newp, vmemh, prev_size);
+    memhead_tag_copy(newp, vmemh);
+  }
+  return newp;
+}
+
+/**
+ * Resize the block in place when the new length stays in the same size class.
+ * \return True on success.
+ */
+static bool slab_resize_in_place(void *vmemh, const size_t len, const bool zero)
+{
+  MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  if (MEMHEAD_IS_ALIGNED(memh)) {
+    return false;
+  }
+  const size_t old_len = MEMHEAD_LEN(memh);
+  const size_t new_len = SIZET_ALIGN_4(len);
+  if (!slab_len_is_small(old_len) || !slab_len_is_small(new_len) ||
+      slab_class_from_len(old_len) != slab_class_from_len(new_len))
+  {
+    return false;
+  }
+  if (zero && new_len > old_len) {
+    memset((char *)vmemh + old_len, 0, new_len - old_len);
+  }
+  const uint tag = MEMHEAD_TAG(memh);
+  memory_usage_block_free(old_len, tag);
+  memory_usage_block_alloc(new_len, tag);
+  memh->len = new_len | (memh->len & (size_t(MEMHEAD_FLAG_MASK) | MEMHEAD_TAG_MASK));
+  return true;
+}
+
+void *MEM_slab_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = nullptr;
+
+  if (vmemh) {
+    const MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    const size_t old_len = MEM_slab_allocN_len(vmemh);
+
+    if (MEMHEAD_IS_FROM_CPP_NEW(memh)) {
+      report_error_on_address(vmemh,
+                              "Attempt to use C-style MEM_reallocN on a pointer created with "
+                              "CPP-style MEM_new or new\n");
+    }
+
+    if (slab_resize_in_place(vmemh, len, false)) {
+      return vmemh;
+    }
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_slab_mallocN(len, "realloc");
+    }
+    else {
+      const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_slab_mallocN_aligned(
+          len, size_t(memh_aligned->alignment), "realloc", AllocationType::ALLOC_FREE);
+    }
+
+    if (newp) {
+      memhead_tag_copy(newp, vmemh);
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        /* grow (or remain same size) */
+        memcpy(newp, vmemh, old_len);
+      }
+    }
+
+    MEM_slab_freeN(vmemh, AllocationType::ALLOC_FREE);
+  }
+  else {
+    newp = MEM_slab_mallocN(len, str);
+  }
+
+  return newp;
+}
+
+void *MEM_slab_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = nullptr;
+
+  if (vmemh) {
+    const MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    const size_t old_len = MEM_slab_allocN_len(vmemh);
+
+    if (MEMHEAD_IS_FROM_CPP_NEW(memh)) {
+      report_error_on_address(vmemh,
+                              "Attempt to use C-style MEM_recallocN on a pointer created with "
+                              "CPP-style MEM_new or new\n");
+    }
+
+    if (slab_resize_in_place(vmemh, len, true)) {
+      return vmemh;
+    }
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_slab_mallocN(len, "recalloc");
+    }
+    else {
+      const MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_slab_mallocN_aligned(
+          len, size_t(memh_aligned->alignment), "recalloc", AllocationType::ALLOC_FREE);
+    }
+
+    if (newp) {
+      memhead_tag_copy(newp, vmemh);
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        memcpy(newp, vmemh, old_len);
+
+        if (len > old_len) {
+          /* grow */
+          /* zero new bytes */
+          memset(((char *)newp) + old_len, 0, len - old_len);
+        }
+      }
+    }
+
+    MEM_slab_freeN(vmemh, AllocationType::ALLOC_FREE);
+  }
+  else {
+    newp = MEM_slab_callocN(len, str);
+  }
+
+  return newp;
+}
+
+void *MEM_slab_callocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_4(len);
+
+  memh = slab_memhead_alloc(len, true);
+
+  if (LIKELY(memh)) {
+    const uint tag = memory_usage_tag_from_name(str);
+    memh->len = len | MEMHEAD_TAG_BITS(tag);
+    memory_usage_block_alloc(len, tag);
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total " SIZET_FORMAT "\n",
+              SIZET_ARG(len),
+              str,
+              memory_usage_current());
+  return nullptr;
+}
+
+void *MEM_slab_calloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Calloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total " SIZET_FORMAT "\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        memory_usage_current());
+    abort();
+    return nullptr;
+  }
+
+  return MEM_slab_callocN(total_size, str);
+}
+
+void *MEM_slab_mallocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_4(len);
+
+  memh = slab_memhead_alloc(len, false);
+
+  if (LIKELY(memh)) {
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    const uint tag = memory_usage_tag_from_name(str);
+    memh->len = len | MEMHEAD_TAG_BITS(tag);
+    memory_usage_block_alloc(len, tag);
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total " SIZET_FORMAT "\n",
+              SIZET_ARG(len),
+              str,
+              memory_usage_current());
+  return nullptr;
+}
+
+void *MEM_slab_malloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Malloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total " SIZET_FORMAT "\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        memory_usage_current());
+    abort();
+    return nullptr;
+  }
+
+  return MEM_slab_mallocN(total_size, str);
+}
+
+void *MEM_slab_mallocN_aligned(size_t len,
+                               size_t alignment,
+                               const char *str,
+                               const AllocationType allocation_type)
+{
+  /* Huge alignment values doesn't make sense and they wouldn't fit into 'short' used in the
+   * MemHead. */
+  assert(alignment < 1024);
+
+  /* We only support alignments that are a power of two. */
+  assert(IS_POW2(alignment));
+
+  /* Some OS specific aligned allocators require a certain minimal alignment. */
+  if (alignment < ALIGNED_MALLOC_MINIMUM_ALIGNMENT) {
+    alignment = ALIGNED_MALLOC_MINIMUM_ALIGNMENT;
+  }
+
+  /* It's possible that MemHead's size is not properly aligned,
+   * do extra padding to deal with this. */
+  size_t extra_padding = MEMHEAD_ALIGN_PADDING(alignment);
+
+  len = SIZET_ALIGN_4(len);
+
+  MemHeadAligned *memh = (MemHeadAligned *)aligned_malloc(
+      len + extra_padding + sizeof(MemHeadAligned), alignment);
+
+  if (LIKELY(memh)) {
+    /* We keep padding in the beginning of MemHead,
+     * this way it's always possible to get MemHead
+     * from the data pointer.
+     */
+    memh = (MemHeadAligned *)((char *)memh + extra_padding);
+
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    const uint tag = memory_usage_tag_from_name(str);
+    memh->len = len | size_t(MEMHEAD_FLAG_ALIGN) |
+                size_t(allocation_type == AllocationType::NEW_DELETE ? MEMHEAD_FLAG_FROM_CPP_NEW :
+                                                                       0) |
+                MEMHEAD_TAG_BITS(tag);
+    memh->alignment = short(alignment);
+    memory_usage_block_alloc(len, tag);
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total " SIZET_FORMAT "\n",
+              SIZET_ARG(len),
+              str,
+              memory_usage_current());
+  return nullptr;
+}
+
+void *MEM_slab_calloc_arrayN_aligned(const size_t len,
+                                     const size_t size,
+                                     const size_t alignment,
+                                     const char *str)
+{
+  size_t bytes_num;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &bytes_num))) {
+    print_error(
+        "Calloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total " SIZET_FORMAT "\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        memory_usage_current());
+    abort();
+    return nullptr;
+  }
+  if (alignment <= MEM_MIN_CPP_ALIGNMENT) {
+    return MEM_callocN(bytes_num, str);
+  }
+  void *ptr = MEM_mallocN_aligned(bytes_num, alignment, str);
+  if (!ptr) {
+    return nullptr;
+  }
+  memset(ptr, 0, bytes_num);
+  return ptr;
+}
+
+void MEM_slab_printmemlist_pydict() {}
+
+void MEM_slab_printmemlist() {}
+
+void mem_slab_clearmemlist() {}
+
+/* unused */
+void MEM_slab_callbackmemlist(void (*func)(void *))
+{
+  (void)func; /* Ignored. */
+}
+
+void MEM_slab_printmemlist_stats()
+{
+  printf("\ntotal memory len: %.3f MB\n", double(memory_usage_current()) / double(1024 * 1024));
+  printf("peak memory len: %.3f MB\n", double(memory_usage_peak()) / double(1024 * 1024));
+  printf("slab memory reserved: %.3f MB\n",
+         double(slab_global().reserved.load(std::memory_order_relaxed)) / double(1024 * 1024));
+  MEM_print_memory_tags_report();
+  printf(
+      "\nFor more detailed per-block statistics run Blender with memory debugging command line "
+      "argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+  printf("System Statistics:\n");
+  malloc_stats();
+#endif
+}
+
+void MEM_slab_set_error_callback(void (*func)(const char *))
+{
+  error_callback = func;
+}
+
+bool MEM_slab_consistency_check()
+{
+  return true;
+}
+
+void MEM_slab_set_memory_debug()
+{
+  malloc_debug_memset = true;
+}
+
+size_t MEM_slab_get_memory_in_use()
+{
+  return memory_usage_current();
+}
+
+uint MEM_slab_get_memory_blocks_in_use()
+{
+  return uint(memory_usage_block_num());
+}
+
+void MEM_slab_reset_peak_memory()
+{
+  memory_usage_peak_reset();
+}
+
+size_t MEM_slab_get_peak_memory()
+{
+  return memory_usage_peak();
+}
+
+#ifndef NDEBUG
+const char *MEM_slab_name_ptr(void *vmemh)
+{
+  if (vmemh) {
+    return "unknown block name ptr";
+  }
+
+  return "MEM_slab_name_ptr(nullptr)";
+}
+
+void MEM_slab_name_ptr_set(void *UNUSED(vmemh), const char *UNUSED(str)) {}
+#endif /* !NDEBUG */
@@ -5,9 +5,13 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "MEM_guardedalloc.h"
@@ -15,11 +19,22 @@
 
 #include "../../source/blender/blenlib/BLI_strict_flags.h"
 
+static_assert(sizeof(size_t) == 8, "Memory tags are stored in the upper bits of the length");
+
 namespace {
 
 struct Local;
 struct Global;
 
+/**
+ * Usage of a single memory tag. These are stored per thread like the total counts, so they are
+ * atomic and can be negative for the same reasons.
+ */
+struct TagUsage {
+  std::atomic<int64_t> mem_in_use = 0;
+  std::atomic<int64_t> blocks_num = 0;
+};
+
 /**
  * This is stored per thread. Align to cache line size to avoid false sharing.
  */
@@ -54,6 +69,13 @@ struct alignas(128) Local {
    * accurate, but it's still good enough for practical purposes.
    */
   std::atomic<int64_t> mem_in_use_during_peak_update = 0;
+  /**
+   * Usage per memory tag, allocated when the thread does its first tagged allocation. Indexed by
+   * the tag, see #memory_usage_tag_ensure.
+   */
+  std::atomic<TagUsage *> tags = nullptr;
+  /** Tagged memory allocated by this thread since it last updated the peaks of the tags. */
+  int64_t tags_mem_since_peak_update = 0;
 
   Local();
   ~Local();
@@ -94,6 +116,23 @@ struct Global {
    * Peak memory usage since the last reset.
    */
   std::atomic<size_t> peak = 0;
+
+  /**
+   * Mutex that protects the tag names below.
+   */
+  std::mutex tags_mutex;
+  /**
+   * Copies of the allocation names used as tags, indexed by the tag. Tag 0 is not used, it marks
+   * blocks that are not tagged.
+   */
+  std::vector<const char *> tag_names = {nullptr};
+  /** Size of #tag_names, readable without locking the mutex. */
+  std::atomic<uint> tags_num = 1;
+  std::unordered_map<std::string_view, uint> tag_by_name;
+  /** Usage of tags that is not tracked by #Local, see #mem_in_use_outside_locals. */
+  std::unique_ptr<TagUsage[]> tags_outside_locals;
+  /** Approximate peak usage per tag, see #tag_peak_update_threshold. */
+  std::unique_ptr<std::atomic<int64_t>[]> tag_peaks;
 };
 
 }  // namespace
@@ -109,6 +148,13 @@ static std::atomic<bool> use_local_counters = true;
  * overhead with little benefit.
  */
 static constexpr int64_t peak_update_threshold = 1024 * 1024;
+/**
+ * Updating the peaks of all tags requires summing the usage of every tag over all threads, so it's
+ * done much less often than the update of the total peak.
+ */
+static constexpr int64_t tag_peak_update_threshold = 64 * 1024 * 1024;
+
+bool memory_tags_enabled = false;
 
 static std::shared_ptr<Global> &get_global_ptr()
 {
@@ -152,6 +198,14 @@ Local::~Local()
   /* Don't forget the memory counts stored locally. */
   this->global->blocks_num_outside_locals.fetch_add(this->blocks_num, std::memory_order_relaxed);
   this->global->mem_in_use_outside_locals.fetch_add(this->mem_in_use, std::memory_order_relaxed);
+  if (TagUsage *local_tags = this->tags.load(std::memory_order_relaxed)) {
+    for (uint tag = 0; tag < MEM_TAGS_NUM; tag++) {
+      TagUsage &usage = this->global->tags_outside_locals[tag];
+      usage.mem_in_use.fetch_add(local_tags[tag].mem_in_use, std::memory_order_relaxed);
+      usage.blocks_num.fetch_add(local_tags[tag].blocks_num, std::memory_order_relaxed);
+    }
+    delete[] local_tags;
+  }
 
   if (this->is_main) {
     /* The main thread started shutting down. Use global counters from now on to avoid accessing
@@ -179,13 +233,126 @@ static void update_global_peak()
   }
 }
 
+/**
+ * Get the usage of every tag summed over all threads, indexed by the tag.
+ * The mutex of the locals has to be locked.
+ */
+static void tags_usage_sum(Global &global,
+                           const uint tags_num,
+                           std::vector<int64_t> &r_mem_in_use,
+                           std::vector<int64_t> &r_blocks_num)
+{
+  r_mem_in_use.assign(tags_num, 0);
+  r_blocks_num.assign(tags_num, 0);
+  for (uint tag = 1; tag < tags_num; tag++) {
+    r_mem_in_use[tag] = global.tags_outside_locals[tag].mem_in_use;
+    r_blocks_num[tag] = global.tags_outside_locals[tag].blocks_num;
+  }
+  for (const Local *local : global.locals) {
+    const TagUsage *tags = local->tags.load(std::memory_order_acquire);
+    if (tags == nullptr) {
+      continue;
+    }
+    for (uint tag = 1; tag < tags_num; tag++) {
+      r_mem_in_use[tag] += tags[tag].mem_in_use;
+      r_blocks_num[tag] += tags[tag].blocks_num;
+    }
+  }
+}
+
+/**
+ * Update the peak usage of all tags. When \a reset is true, the peaks are set to the current
+ * usage instead.
+ */
+static void update_tag_peaks(const bool reset)
+{
+  Global &global = get_global();
+  const uint tags_num = global.tags_num.load(std::memory_order_acquire);
+  std::vector<int64_t> mem_in_use;
+  std::vector<int64_t> blocks_num;
+  {
+    std::lock_guard lock{global.locals_mutex};
+    tags_usage_sum(global, tags_num, mem_in_use, blocks_num);
+  }
+  for (uint tag = 1; tag < tags_num; tag++) {
+    std::atomic<int64_t> &peak = global.tag_peaks[tag];
+    if (reset) {
+      peak.store(mem_in_use[tag], std::memory_order_relaxed);
+      continue;
+    }
+    int64_t prev_peak = peak.load(std::memory_order_relaxed);
+    while (mem_in_use[tag] > prev_peak &&
+           !peak.compare_exchange_weak(prev_peak, mem_in_use[tag], std::memory_order_relaxed))
+    {
+    }
+  }
+}
+
+static TagUsage &local_tag_usage(Local &local, const uint tag)
+{
+  TagUsage *tags = local.tags.load(std::memory_order_relaxed);
+  if (UNLIKELY(tags == nullptr)) {
+    tags = new TagUsage[MEM_TAGS_NUM];
+    local.tags.store(tags, std::memory_order_release);
+  }
+  return tags[tag];
+}
+
+static uint tag_lookup_or_add(const char *name)
+{
+  Global &global = get_global();
+  std::lock_guard lock{global.tags_mutex};
+  const auto it = global.tag_by_name.find(name);
+  if (it != global.tag_by_name.end()) {
+    return it->second;
+  }
+  if (global.tag_names.size() >= MEM_TAGS_NUM) {
+    /* Out of tags, the block is accounted in the untagged usage. */
+    return 0;
+  }
+  /* Names are usually static strings, but copy them to be sure they stay valid. */
+  const size_t name_len = strlen(name);
+  char *name_copy = static_cast<char *>(malloc(name_len + 1));
+  memcpy(name_copy, name, name_len + 1);
+
+  const uint tag = uint(global.tag_names.size());
+  global.tag_names.push_back(name_copy);
+  global.tag_by_name.emplace(std::string_view(name_copy, name_len), tag);
+  global.tags_num.store(tag + 1, std::memory_order_release);
+  return tag;
+}
+
+uint memory_usage_tag_ensure(const char *name)
+{
+  if (UNLIKELY(name == nullptr)) {
+    return 0;
+  }
+  /* Allocations with the same name often happen in a row, or in loops, so a small cache of tags
+   * by name pointer avoids locking and hashing the name for almost all of them. A name pointer
+   * that gets reused with a different string can get a wrong tag, which only affects the
+   * reported statistics. */
+  struct TagCacheEntry {
+    const char *name;
+    uint tag;
+  };
+  static thread_local TagCacheEntry tag_cache[256] = {};
+  TagCacheEntry &entry = tag_cache[(uint64_t(uintptr_t(name)) * 0x9E3779B97F4A7C15ull) >> 56];
+  if (LIKELY(entry.name == name)) {
+    return entry.tag;
+  }
+  const uint tag = tag_lookup_or_add(name);
+  entry.name = name;
+  entry.tag = tag;
+  return tag;
+}
+
 void memory_usage_init()
 {
   /* Makes sure that the static and thread-local variables on the main thread are initialized. */
   get_local_data();
 }
 
-void memory_usage_block_alloc(const size_t size)
+void memory_usage_block_alloc(const size_t size, const uint tag)
 {
   if (LIKELY(use_local_counters.load(std::memory_order_relaxed))) {
     Local &local = get_local_data();
@@ -196,6 +363,18 @@ void memory_usage_block_alloc(const size_t size)
     local.blocks_num.fetch_add(1, std::memory_order_relaxed);
     local.mem_in_use.fetch_add(int64_t(size), std::memory_order_relaxed);
 
+    if (UNLIKELY(tag != 0)) {
+      TagUsage &usage = local_tag_usage(local, tag);
+      usage.blocks_num.fetch_add(1, std::memory_order_relaxed);
+      usage.mem_in_use.fetch_add(int64_t(size), std::memory_order_relaxed);
+
+      local.tags_mem_since_peak_update += int64_t(size);
+      if (local.tags_mem_since_peak_update > tag_peak_update_threshold) {
+        local.tags_mem_since_peak_update = 0;
+        update_tag_peaks(false);
+      }
+    }
+
     /* If a certain amount of new memory has been allocated, update the peak. */
     if (local.mem_in_use - local.mem_in_use_during_peak_update > peak_update_threshold) {
       update_global_peak();
@@ -206,10 +385,16 @@ void memory_usage_block_alloc(const size_t size)
     /* Increase global memory counts. */
     global.blocks_num_outside_locals.fetch_add(1, std::memory_order_relaxed);
     global.mem_in_use_outside_locals.fetch_add(int64_t(size), std::memory_order_relaxed);
+
+    if (UNLIKELY(tag != 0)) {
+      TagUsage &usage = global.tags_outside_locals[tag];
+      usage.blocks_num.fetch_add(1, std::memory_order_relaxed);
+      usage.mem_in_use.fetch_add(int64_t(size), std::memory_order_relaxed);
+    }
   }
 }
 
-void memory_usage_block_free(const size_t size)
+void memory_usage_block_free(const size_t size, const uint tag)
 {
   if (LIKELY(use_local_counters)) {
     /* Decrease local memory counts. See comment in #memory_usage_block_alloc for details regarding
@@ -217,12 +402,24 @@ void memory_usage_block_free(const size_t size)
     Local &local = get_local_data();
     local.mem_in_use.fetch_sub(int64_t(size), std::memory_order_relaxed);
     local.blocks_num.fetch_sub(1, std::memory_order_relaxed);
+
+    if (UNLIKELY(tag != 0)) {
+      TagUsage &usage = local_tag_usage(local, tag);
+      usage.mem_in_use.fetch_sub(int64_t(size), std::memory_order_relaxed);
+      usage.blocks_num.fetch_sub(1, std::memory_order_relaxed);
+    }
   }
   else {
     Global &global = get_global();
     /* Decrease global memory counts. */
     global.blocks_num_outside_locals.fetch_sub(1, std::memory_order_relaxed);
     global.mem_in_use_outside_locals.fetch_sub(int64_t(size), std::memory_order_relaxed);
+
+    if (UNLIKELY(tag != 0)) {
+      TagUsage &usage = global.tags_outside_locals[tag];
+      usage.mem_in_use.fetch_sub(int64_t(size), std::memory_order_relaxed);
+      usage.blocks_num.fetch_sub(1, std::memory_order_relaxed);
+    }
   }
 }
 
@@ -272,4 +469,102 @@ void memory_usage_peak_reset()
 {
   Global &global = get_global();
   global.peak = memory_usage_current();
+  if (memory_tags_enabled) {
+    update_tag_peaks(true);
+  }
+}
+
+void MEM_enable_memory_tags()
+{
+  Global &global = get_global();
+  std::lock_guard lock{global.tags_mutex};
+  if (memory_tags_enabled) {
+    return;
+  }
+  global.tags_outside_locals = std::make_unique<TagUsage[]>(MEM_TAGS_NUM);
+  global.tag_peaks = std::make_unique<std::atomic<int64_t>[]>(MEM_TAGS_NUM);
+  memory_tags_enabled = true;
+}
+
+bool MEM_memory_tags_enabled()
+{
+  return memory_tags_enabled;
+}
+
+void MEM_foreach_memory_tag(void (*callback)(const MEM_TagUsage *usage, void *user_data),
+                            void *user_data)
+{
+  if (!memory_tags_enabled) {
+    return;
+  }
+  /* Make sure the peaks are not lower than the current usage. */
+  update_tag_peaks(false);
+
+  Global &global = get_global();
+  const uint tags_num = global.tags_num.load(std::memory_order_acquire);
+  std::vector<int64_t> mem_in_use;
+  std::vector<int64_t> blocks_num;
+  {
+    std::lock_guard lock{global.locals_mutex};
+    tags_usage_sum(global, tags_num, mem_in_use, blocks_num);
+  }
+  std::vector<const char *> names;
+  {
+    std::lock_guard lock{global.tags_mutex};
+    names.assign(global.tag_names.begin(), global.tag_names.begin() + tags_num);
+  }
+
+  /* The callback is called without any lock, it may allocate memory. */
+  for (uint tag = 1; tag < tags_num; tag++) {
+    MEM_TagUsage usage;
+    usage.name = names[tag];
+    usage.mem_in_use = size_t(std::max<int64_t>(mem_in_use[tag], 0));
+    usage.blocks_num = size_t(std::max<int64_t>(blocks_num[tag], 0));
+    usage.mem_peak = size_t(std::max<int64_t>(global.tag_peaks[tag], 0));
+    callback(&usage, user_data);
+  }
+}
+
+void MEM_print_memory_tags_report()
+{
+  if (!memory_tags_enabled) {
+    return;
+  }
+  std::vector<MEM_TagUsage> usages;
+  MEM_foreach_memory_tag(
+      [](const MEM_TagUsage *usage, void *user_data) {
+        if (usage->mem_peak > 0) {
+          static_cast<std::vector<MEM_TagUsage> *>(user_data)->push_back(*usage);
+        }
+      },
+      &usages);
+  std::sort(usages.begin(), usages.end(), [](const MEM_TagUsage &a, const MEM_TagUsage &b) {
+    return a.mem_peak > b.mem_peak;
+  });
+
+  size_t tagged_mem_in_use = 0;
+  for (const MEM_TagUsage &usage : usages) {
+    tagged_mem_in_use += usage.mem_in_use;
+  }
+  const size_t mem_in_use = memory_usage_current();
+  constexpr double mb = 1024.0 * 1024.0;
+  constexpr size_t max_lines = 100;
+
+  printf("\nMemory usage by allocation name:\n");
+  printf("%12s %12s %12s  %s\n", "Peak MB", "In use MB", "Blocks", "Name");
+  for (size_t i = 0; i < std::min(usages.size(), max_lines); i++) {
+    const MEM_TagUsage &usage = usages[i];
+    printf("%12.3f %12.3f %12zu  %s\n",
+           double(usage.mem_peak) / mb,
+           double(usage.mem_in_use) / mb,
+           usage.blocks_num,
+           usage.name);
+  }
+  if (usages.size() > max_lines) {
+    printf("... %zu more names\n", usages.size() - max_lines);
+  }
+  printf("Total in use: %.3f MB, untagged: %.3f MB, peak: %.3f MB\n",
+         double(mem_in_use) / mb,
+         double(mem_in_use > tagged_mem_in_use ? mem_in_use - tagged_mem_in_use : 0) / mb,
+         double(memory_usage_peak()) / mb);
 }
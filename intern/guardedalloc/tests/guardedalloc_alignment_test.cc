@@ -58,3 +58,15 @@ TEST_F(GuardedAllocatorTest, MEM_mallocN_aligned)
   DoBasicAlignmentChecks(256);
   DoBasicAlignmentChecks(512);
 }
+
+TEST_F(SlabAllocatorTest, MEM_mallocN_aligned)
+{
+  DoBasicAlignmentChecks(1);
+  DoBasicAlignmentChecks(2);
+  DoBasicAlignmentChecks(4);
+  DoBasicAlignmentChecks(8);
+  DoBasicAlignmentChecks(16);
+  DoBasicAlignmentChecks(32);
+  DoBasicAlignmentChecks(256);
+  DoBasicAlignmentChecks(512);
+}
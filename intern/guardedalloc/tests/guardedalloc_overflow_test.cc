@@ -60,3 +60,16 @@ TEST_F(GuardedAllocatorTest, GuardedIntegerOverflow)
   EXPECT_EXIT(MallocArray(SIZE_MAX, 12345567), ABORT_PREDICATE, "");
   EXPECT_EXIT(CallocArray(SIZE_MAX, SIZE_MAX), ABORT_PREDICATE, "");
 }
+
+TEST_F(SlabAllocatorTest, SlabIntegerOverflow)
+{
+  MallocArray(1, SIZE_MAX);
+  CallocArray(SIZE_MAX, 1);
+  MallocArray(SIZE_MAX / 2, 2);
+  CallocArray(SIZE_MAX / 1234567, 1234567);
+
+  EXPECT_EXIT(MallocArray(SIZE_MAX, 2), ABORT_PREDICATE, "");
+  EXPECT_EXIT(CallocArray(7, SIZE_MAX), ABORT_PREDICATE, "");
+  EXPECT_EXIT(MallocArray(SIZE_MAX, 12345567), ABORT_PREDICATE, "");
+  EXPECT_EXIT(CallocArray(SIZE_MAX, SIZE_MAX), ABORT_PREDICATE, "");
+}
@@ -0,0 +1,84 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include <cstring>
+#include <vector>
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+#include "guardedalloc_test_base.h"
+
+namespace {
+
+MEM_TagUsage find_tag_usage(const char *name)
+{
+  struct Data {
+    const char *name;
+    MEM_TagUsage usage;
+  } data = {name, {nullptr, 0, 0, 0}};
+  MEM_foreach_memory_tag(
+      [](const MEM_TagUsage *usage, void *user_data) {
+        Data &data = *static_cast<Data *>(user_data);
+        if (strcmp(usage->name, data.name) == 0) {
+          data.usage = *usage;
+        }
+      },
+      &data);
+  return data.usage;
+}
+
+void DoBasicTagChecks()
+{
+  MEM_enable_memory_tags();
+  EXPECT_TRUE(MEM_memory_tags_enabled());
+
+  std::vector<void *> blocks;
+  for (int i = 0; i < 10; i++) {
+    blocks.push_back(MEM_mallocN(100, "tag_test_a"));
+  }
+  blocks.push_back(MEM_callocN(4000, "tag_test_b"));
+  blocks.push_back(MEM_mallocN_aligned(64, 64, "tag_test_b"));
+
+  MEM_TagUsage usage_a = find_tag_usage("tag_test_a");
+  EXPECT_EQ(usage_a.mem_in_use, 1000);
+  EXPECT_EQ(usage_a.blocks_num, 10);
+  EXPECT_GE(usage_a.mem_peak, 1000);
+  MEM_TagUsage usage_b = find_tag_usage("tag_test_b");
+  EXPECT_EQ(usage_b.mem_in_use, 4064);
+  EXPECT_EQ(usage_b.blocks_num, 2);
+
+  /* Reallocated and duplicated blocks keep the name of the original block. */
+  blocks[0] = MEM_reallocN(blocks[0], 200);
+  blocks[1] = MEM_recallocN(blocks[1], 8000);
+  blocks.push_back(MEM_dupallocN(blocks[2]));
+  usage_a = find_tag_usage("tag_test_a");
+  EXPECT_EQ(usage_a.mem_in_use, 8000 + 200 + 900);
+  EXPECT_EQ(usage_a.blocks_num, 11);
+
+  for (void *mem : blocks) {
+    MEM_freeN(mem);
+  }
+  usage_a = find_tag_usage("tag_test_a");
+  EXPECT_EQ(usage_a.mem_in_use, 0);
+  EXPECT_EQ(usage_a.blocks_num, 0);
+  EXPECT_GE(usage_a.mem_peak, 9100);
+  usage_b = find_tag_usage("tag_test_b");
+  EXPECT_EQ(usage_b.mem_in_use, 0);
+
+  MEM_reset_peak_memory();
+  EXPECT_EQ(find_tag_usage("tag_test_a").mem_peak, 0);
+}
+
+}  // namespace
+
+TEST_F(LockFreeAllocatorTest, MemoryTags)
+{
+  DoBasicTagChecks();
+}
+
+TEST_F(SlabAllocatorTest, MemoryTags)
+{
+  DoBasicTagChecks();
+}
@@ -25,4 +25,12 @@ class GuardedAllocatorTest : public ::testing::Test {
   }
 };
 
+class SlabAllocatorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp()
+  {
+    MEM_use_slab_allocator();
+  }
+};
+
 #endif  // __GUARDEDALLOC_TEST_UTIL_H__
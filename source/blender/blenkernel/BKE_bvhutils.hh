@@ -18,6 +18,7 @@
 #include "BLI_span.hh"
 
 struct BVHCache;
+struct BVHCacheReuse;
 struct BVHTree;
 struct MFace;
 struct Mesh;
@@ -185,3 +186,23 @@ BVHCache *bvhcache_init();
  * Frees a BVH-cache.
  */
 void bvhcache_free(BVHCache *bvh_cache);
+/**
+ * Tag the trees of the cache to be updated for new positions of the mesh when they are used
+ * next, instead of being built again. The topology of the mesh must not have changed.
+ */
+void bvhcache_tag_positions_changed(BVHCache *bvh_cache);
+
+/**
+ * Move the trees that only depend on the topology out of the BVH-cache of \a mesh before it is
+ * freed, so that they can be updated for a new mesh with the same topology rather than being
+ * built again. This is used for evaluated meshes that are deformed on every frame.
+ *
+ * \return Null when there is nothing to reuse.
+ */
+BVHCacheReuse *bvhcache_reuse_create(Mesh &mesh);
+/**
+ * Give the trees to \a mesh when it has the same topology as the mesh they were built for, and
+ * no BVH-cache yet. Frees \a reuse.
+ */
+void bvhcache_reuse_apply(BVHCacheReuse *reuse, Mesh &mesh);
+void bvhcache_reuse_free(BVHCacheReuse *reuse);
@@ -118,6 +118,9 @@ struct bCallbackFuncStore {
   void (*func)(Main *, PointerRNA **, int num_pointers, void *arg);
   void *arg;
   short alloc;
+  /** Optional, returns false when #func has nothing to run, e.g. when no Python handlers are
+   * registered for the event. */
+  bool (*poll)(void *arg) = nullptr;
 };
 
 void BKE_callback_exec(Main *bmain, PointerRNA **pointers, int num_pointers, eCbEvent evt);
@@ -126,6 +129,11 @@ void BKE_callback_exec_id(Main *bmain, ID *id, eCbEvent evt);
 void BKE_callback_exec_id_depsgraph(Main *bmain, ID *id, Depsgraph *depsgraph, eCbEvent evt);
 void BKE_callback_exec_string(Main *bmain, eCbEvent evt, const char *str);
 void BKE_callback_add(bCallbackFuncStore *funcstore, eCbEvent evt);
+/**
+ * Whether executing the event runs any handlers. Used to skip work which is only valid when no
+ * handlers can modify data, without having to run the handlers.
+ */
+bool BKE_callback_has_handlers(eCbEvent evt);
 void BKE_callback_remove(bCallbackFuncStore *funcstore, eCbEvent evt);
 
 void BKE_callback_global_init();
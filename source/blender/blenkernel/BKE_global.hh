@@ -210,6 +210,21 @@ enum {
   G_FLAG_SCRIPT_OVERRIDE_PREF = (1 << 14),
   G_FLAG_SCRIPT_AUTOEXEC_FAIL = (1 << 15),
   G_FLAG_SCRIPT_AUTOEXEC_FAIL_QUIET = (1 << 16),
+
+  /**
+   * Let large arrays of uncompressed blend-files reference the memory-mapped file directly
+   * instead of copying them, set via `--enable-file-mapping`.
+   *
+   * \note The file stays mapped as long as some of its data is used, on some platforms this
+   * prevents overwriting it.
+   */
+  G_FLAG_READ_FILE_MAPPED = (1 << 17),
+
+  /**
+   * Only read the active scene, the window-manager and the data-blocks they use when opening
+   * blend-files, set via `--open-partial`. See #BLO_READ_SKIP_INACTIVE_DATA.
+   */
+  G_FLAG_READ_PARTIAL = (1 << 18),
 };
 
 #define G_FLAG_INTERNET_OVERRIDE_PREF_ANY \
@@ -219,7 +234,8 @@ enum {
 #define G_FLAG_ALL_RUNTIME \
   (G_FLAG_SCRIPT_AUTOEXEC | G_FLAG_SCRIPT_OVERRIDE_PREF | G_FLAG_INTERNET_ALLOW | \
    G_FLAG_INTERNET_OVERRIDE_PREF_ONLINE | G_FLAG_INTERNET_OVERRIDE_PREF_OFFLINE | \
-   G_FLAG_EVENT_SIMULATE | G_FLAG_USERPREF_NO_SAVE_ON_EXIT | \
+   G_FLAG_EVENT_SIMULATE | G_FLAG_USERPREF_NO_SAVE_ON_EXIT | G_FLAG_READ_FILE_MAPPED | \
+   G_FLAG_READ_PARTIAL | \
 \
    /* #BPY_python_reset is responsible for resetting these flags on file load. */ \
    G_FLAG_SCRIPT_AUTOEXEC_FAIL | G_FLAG_SCRIPT_AUTOEXEC_FAIL_QUIET)
@@ -258,6 +274,8 @@ enum {
 
   G_DEBUG_GHOST = (1 << 23),  /* Debug GHOST module. */
   G_DEBUG_WINTAB = (1 << 24), /* Debug Wintab. */
+
+  G_DEBUG_DEPSGRAPH_PROFILE = (1 << 25), /* Record and report timing of every operation. */
 };
 
 #define G_DEBUG_ALL \
@@ -150,6 +150,13 @@ struct Main {
    */
   bool is_asset_edit_file;
 
+  /**
+   * Only the data-blocks used by the active scene and the window-manager were read from the file
+   * (see #BLO_READ_SKIP_INACTIVE_DATA). It must not be overwritten, since the other data-blocks
+   * would be lost.
+   */
+  bool is_read_partial;
+
   /** Commit timestamp from `buildinfo`. */
   uint64_t build_commit_timestamp;
   /** Commit Hash from `buildinfo`. */
@@ -13,6 +13,7 @@
 
 #include "DNA_customdata_types.h" /* #CustomData_MeshMasks. */
 
+struct BVHCacheReuse;
 struct bGPdata;
 struct Curve;
 struct CurveCache;
@@ -100,6 +101,12 @@ struct ObjectRuntime {
    */
   Mesh *editmesh_eval_cage = nullptr;
 
+  /**
+   * BVH trees of the previous evaluated mesh, kept from the start of the object's geometry
+   * evaluation until the new evaluated mesh is created. See #bvhcache_reuse_create.
+   */
+  BVHCacheReuse *bvh_cache_reuse = nullptr;
+
   /**
    * Original grease pencil bGPdata pointer, before object->data was changed to point
    * to gpd_eval.
@@ -192,6 +192,12 @@ void BKE_scene_graph_update_for_newframe(Depsgraph *depsgraph);
  * Applies changes right away, does all sets too.
  */
 void BKE_scene_graph_update_for_newframe_ex(Depsgraph *depsgraph, bool clear_recalc);
+/**
+ * Same as #BKE_scene_graph_update_for_newframe_ex, for a depsgraph which has already been
+ * evaluated at the current frame of its scene ahead of time. Frame change handlers are still
+ * called, but only the changes they tag are evaluated again.
+ */
+void BKE_scene_graph_update_for_prefetched_frame(Depsgraph *depsgraph, bool clear_recalc);
 
 /**
  * Ensures given scene/view_layer pair has a valid, up-to-date depsgraph.
@@ -60,6 +60,8 @@ bool BKE_memfile_undo_decode(MemFileUndoData *mfu,
   int success = 0, fileflags;
 
   STRNCPY(mainstr, BKE_main_blendfile_path(bmain)); /* temporal store */
+  /* Undo steps only contain the data-blocks that were read, keep protecting the original file. */
+  const bool is_read_partial = bmain->is_read_partial;
 
   fileflags = G.fileflags;
   G.fileflags |= G_FILE_NO_UI;
@@ -90,6 +92,7 @@ bool BKE_memfile_undo_decode(MemFileUndoData *mfu,
   /* Restore, bmain has been re-allocated. */
   bmain = CTX_data_main(C);
   STRNCPY(bmain->filepath, mainstr);
+  bmain->is_read_partial = is_read_partial;
   G.fileflags = fileflags;
 
   if (success) {
@@ -6,20 +6,27 @@
  * \ingroup bke
  */
 
+#include <array>
+
 #include "DNA_meshdata_types.h"
 #include "DNA_pointcloud_types.h"
 
+#include "BLI_implicit_sharing.hh"
 #include "BLI_math_geom.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 
 #include "BKE_attribute.hh"
 #include "BKE_bvhutils.hh"
+#include "BKE_customdata.hh"
 #include "BKE_editmesh.hh"
 #include "BKE_mesh.hh"
+#include "BKE_mesh_runtime.hh"
 
 using blender::BitSpan;
 using blender::BitVector;
 using blender::float3;
+using blender::ImplicitSharingInfo;
 using blender::IndexRange;
 using blender::int3;
 using blender::Span;
@@ -29,9 +36,22 @@ using blender::VArray;
 /** \name BVHCache
  * \{ */
 
+/**
+ * Cached trees are refit when the positions of the mesh change, which keeps the structure that
+ * was built for the initial positions. When the cost of queries estimated by
+ * #BLI_bvhtree_get_cost grew by more than this factor, the tree is built again instead.
+ */
+static constexpr float BVHCACHE_REFIT_COST_FACTOR_MAX = 1.5f;
+
 struct BVHCacheItem {
   bool is_filled;
+  /** The positions of the mesh changed since the bounds of the tree were computed. */
+  bool needs_refit;
   BVHTree *tree;
+  /** Size of the domain the elements of the tree come from, to detect topology changes. */
+  int elems_num;
+  /** #BLI_bvhtree_get_cost of the tree after it was built. */
+  float build_cost;
 };
 
 struct BVHCache {
@@ -70,7 +90,7 @@ static bool bvhcache_find(BVHCache **bvh_cache_p,
   }
   BVHCache *bvh_cache = *bvh_cache_p;
 
-  if (bvh_cache->items[type].is_filled) {
+  if (bvh_cache->items[type].is_filled && !bvh_cache->items[type].needs_refit) {
     *r_tree = bvh_cache->items[type].tree;
     return true;
   }
@@ -121,14 +141,29 @@ BVHCache *bvhcache_init()
  * A call to this assumes that there was no previous cached tree of the given type
  * \warning The #BVHTree can be nullptr.
  */
-static void bvhcache_insert(BVHCache *bvh_cache, BVHTree *tree, BVHCacheType type)
+static void bvhcache_insert(BVHCache *bvh_cache,
+                            BVHTree *tree,
+                            BVHCacheType type,
+                            const int elems_num)
 {
   BVHCacheItem *item = &bvh_cache->items[type];
   BLI_assert(!item->is_filled);
   item->tree = tree;
+  item->elems_num = elems_num;
+  item->build_cost = tree ? BLI_bvhtree_get_cost(tree) : 0.0f;
   item->is_filled = true;
 }
 
+void bvhcache_tag_positions_changed(BVHCache *bvh_cache)
+{
+  for (int index = 0; index < BVHTREE_MAX_ITEM; index++) {
+    BVHCacheItem *item = &bvh_cache->items[index];
+    if (item->is_filled) {
+      item->needs_refit = true;
+    }
+  }
+}
+
 void bvhcache_free(BVHCache *bvh_cache)
 {
   for (int index = 0; index < BVHTREE_MAX_ITEM; index++) {
@@ -896,6 +931,120 @@ static BitVector<> corner_tris_no_hidden_map_get(const blender::OffsetIndices<in
   return corner_tris_mask;
 }
 
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cached Tree Refit
+ * \{ */
+
+/** Size of the domain the elements of a tree of the given type are indices of. */
+static int bvhcache_type_elems_num(const Mesh &mesh, const BVHCacheType bvh_cache_type)
+{
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+    case BVHTREE_FROM_LOOSEVERTS:
+    case BVHTREE_FROM_LOOSEVERTS_NO_HIDDEN:
+      return mesh.verts_num;
+    case BVHTREE_FROM_EDGES:
+    case BVHTREE_FROM_LOOSEEDGES:
+    case BVHTREE_FROM_LOOSEEDGES_NO_HIDDEN:
+      return mesh.edges_num;
+    case BVHTREE_FROM_FACES:
+      return mesh.totface_legacy;
+    case BVHTREE_FROM_CORNER_TRIS:
+    case BVHTREE_FROM_CORNER_TRIS_NO_HIDDEN:
+      return BKE_mesh_runtime_corner_tris_len(&mesh);
+    case BVHTREE_MAX_ITEM:
+      BLI_assert_unreachable();
+      break;
+  }
+  return 0;
+}
+
+/**
+ * Update the bounds of every leaf of \a tree with \a update_fn, called with the leaf and the
+ * index of its element, then update the bounds of the branches.
+ */
+template<typename Fn> static void bvhtree_refit(BVHTree *tree, const Fn &update_fn)
+{
+  blender::threading::parallel_for(
+      IndexRange(BLI_bvhtree_get_len(tree)), 1024, [&](const IndexRange range) {
+        for (const int leaf : range) {
+          update_fn(leaf, BLI_bvhtree_get_leaf_index(tree, leaf));
+        }
+      });
+  BLI_bvhtree_update_tree(tree);
+}
+
+/**
+ * Update the bounds of a cached tree for the current positions of the mesh, keeping the
+ * structure of the tree. The tree still contains the right elements, since the cache is freed
+ * when the topology of the mesh changes.
+ *
+ * \return False when the tree became too inefficient for the new positions.
+ */
+static bool bvhcache_item_refit(const BVHCacheItem &item,
+                                const BVHCacheType bvh_cache_type,
+                                const BVHTreeFromMesh &data)
+{
+  BVHTree *tree = item.tree;
+  const Span<float3> positions = data.vert_positions;
+
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+    case BVHTREE_FROM_LOOSEVERTS:
+    case BVHTREE_FROM_LOOSEVERTS_NO_HIDDEN:
+      bvhtree_refit(tree, [&](const int leaf, const int vert) {
+        BLI_bvhtree_update_node(tree, leaf, positions[vert], nullptr, 1);
+      });
+      break;
+    case BVHTREE_FROM_EDGES:
+    case BVHTREE_FROM_LOOSEEDGES:
+    case BVHTREE_FROM_LOOSEEDGES_NO_HIDDEN:
+      bvhtree_refit(tree, [&](const int leaf, const int edge) {
+        float co[2][3];
+        copy_v3_v3(co[0], positions[data.edges[edge][0]]);
+        copy_v3_v3(co[1], positions[data.edges[edge][1]]);
+        BLI_bvhtree_update_node(tree, leaf, co[0], nullptr, 2);
+      });
+      break;
+    case BVHTREE_FROM_FACES:
+      bvhtree_refit(tree, [&](const int leaf, const int face_i) {
+        const MFace &face = data.face[face_i];
+        float co[4][3];
+        copy_v3_v3(co[0], positions[face.v1]);
+        copy_v3_v3(co[1], positions[face.v2]);
+        copy_v3_v3(co[2], positions[face.v3]);
+        if (face.v4) {
+          copy_v3_v3(co[3], positions[face.v4]);
+        }
+        BLI_bvhtree_update_node(tree, leaf, co[0], nullptr, face.v4 ? 4 : 3);
+      });
+      break;
+    case BVHTREE_FROM_CORNER_TRIS:
+    case BVHTREE_FROM_CORNER_TRIS_NO_HIDDEN:
+      bvhtree_refit(tree, [&](const int leaf, const int tri) {
+        float co[3][3];
+        copy_v3_v3(co[0], positions[data.corner_verts[data.corner_tris[tri][0]]]);
+        copy_v3_v3(co[1], positions[data.corner_verts[data.corner_tris[tri][1]]]);
+        copy_v3_v3(co[2], positions[data.corner_verts[data.corner_tris[tri][2]]]);
+        BLI_bvhtree_update_node(tree, leaf, co[0], nullptr, 3);
+      });
+      break;
+    case BVHTREE_MAX_ITEM:
+      BLI_assert_unreachable();
+      break;
+  }
+
+  return BLI_bvhtree_get_cost(tree) <= item.build_cost * BVHCACHE_REFIT_COST_FACTOR_MAX;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Mesh BVH Cache Access
+ * \{ */
+
 BVHTree *BKE_bvhtree_from_mesh_get(BVHTreeFromMesh *data,
                                    const Mesh *mesh,
                                    const BVHCacheType bvh_cache_type,
@@ -935,6 +1084,34 @@ BVHTree *BKE_bvhtree_from_mesh_get(BVHTreeFromMesh *data,
     return data->tree;
   }
 
+  BVHCacheItem &item = (*bvh_cache_p)->items[bvh_cache_type];
+  const int elems_num = bvhcache_type_elems_num(*mesh, bvh_cache_type);
+  if (item.is_filled) {
+    /* The positions changed since the tree was built. Updating its bounds is much faster than
+     * building a new tree, as long as the tree remains efficient. */
+    BLI_assert(item.needs_refit);
+    bool is_refit = false;
+    if (item.elems_num == elems_num) {
+      if (item.tree) {
+        /* Refit in isolation for the same reason as #bvhtree_balance_isolated. */
+        blender::threading::isolate_task(
+            [&]() { is_refit = bvhcache_item_refit(item, bvh_cache_type, *data); });
+      }
+      else {
+        is_refit = true;
+      }
+    }
+    if (is_refit) {
+      item.needs_refit = false;
+      data->tree = item.tree;
+      data->cached = true;
+      bvhcache_unlock(*bvh_cache_p, lock_started);
+      return data->tree;
+    }
+    BLI_bvhtree_free(item.tree);
+    item = {};
+  }
+
   /* Create BVHTree. */
 
   switch (bvh_cache_type) {
@@ -1014,7 +1191,7 @@ BVHTree *BKE_bvhtree_from_mesh_get(BVHTreeFromMesh *data,
   // printf("BVHTree built and saved on cache\n");
   BLI_assert(data->cached == false);
   data->cached = true;
-  bvhcache_insert(*bvh_cache_p, data->tree, bvh_cache_type);
+  bvhcache_insert(*bvh_cache_p, data->tree, bvh_cache_type, elems_num);
   bvhcache_unlock(*bvh_cache_p, lock_started);
 
 #ifndef NDEBUG
@@ -1153,6 +1330,141 @@ void BKE_bvhtree_from_mesh_verts_init(const Mesh &mesh,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BVH-Cache Reuse
+ * \{ */
+
+/**
+ * Weak reference to a topology array of a mesh. It doesn't keep the array alive, but allows
+ * checking whether another mesh references the same unchanged array.
+ */
+struct BVHCacheTopologyRef {
+  const ImplicitSharingInfo *sharing_info = nullptr;
+  int64_t version = 0;
+};
+
+struct BVHCacheReuse {
+  BVHCache *bvh_cache = nullptr;
+  int verts_num = 0;
+  int edges_num = 0;
+  int faces_num = 0;
+  int corners_num = 0;
+  std::array<BVHCacheTopologyRef, 4> topology;
+};
+
+/**
+ * The arrays that define which elements are stored in the trees kept by #bvhcache_reuse_create,
+ * in the same order as #BVHCacheReuse::topology.
+ */
+static std::array<const ImplicitSharingInfo *, 4> mesh_topology_sharing_infos(const Mesh &mesh)
+{
+  const auto layer_sharing_info = [](const CustomData &data, const blender::StringRef name) {
+    const int index = CustomData_get_named_layer_index_notype(&data, name);
+    return index == -1 ? nullptr : data.layers[index].sharing_info;
+  };
+  return {mesh.runtime->face_offsets_sharing_info,
+          layer_sharing_info(mesh.edge_data, ".edge_verts"),
+          layer_sharing_info(mesh.corner_data, ".corner_vert"),
+          layer_sharing_info(mesh.corner_data, ".corner_edge")};
+}
+
+BVHCacheReuse *bvhcache_reuse_create(Mesh &mesh)
+{
+  BVHCache *bvh_cache = std::exchange(mesh.runtime->bvh_cache, nullptr);
+  if (bvh_cache == nullptr) {
+    return nullptr;
+  }
+
+  /* Trees that also depend on the hidden state or legacy faces can't be reused. */
+  bool has_trees = false;
+  for (const int type : IndexRange(BVHTREE_MAX_ITEM)) {
+    BVHCacheItem &item = bvh_cache->items[type];
+    if (ELEM(type,
+             BVHTREE_FROM_FACES,
+             BVHTREE_FROM_CORNER_TRIS_NO_HIDDEN,
+             BVHTREE_FROM_LOOSEVERTS_NO_HIDDEN,
+             BVHTREE_FROM_LOOSEEDGES_NO_HIDDEN))
+    {
+      BLI_bvhtree_free(item.tree);
+      item = {};
+    }
+    has_trees |= item.tree != nullptr;
+  }
+
+  /* Without sharing info, there is no way to know that another mesh has the same topology. */
+  const std::array<const ImplicitSharingInfo *, 4> sharing_infos = mesh_topology_sharing_infos(
+      mesh);
+  const bool has_sharing_infos = (sharing_infos[0] || mesh.faces_num == 0) &&
+                                 (sharing_infos[1] || mesh.edges_num == 0) &&
+                                 (sharing_infos[2] || mesh.corners_num == 0) &&
+                                 (sharing_infos[3] || mesh.corners_num == 0);
+  if (!has_trees || !has_sharing_infos) {
+    bvhcache_free(bvh_cache);
+    return nullptr;
+  }
+
+  bvhcache_tag_positions_changed(bvh_cache);
+
+  BVHCacheReuse *reuse = MEM_new<BVHCacheReuse>(__func__);
+  reuse->bvh_cache = bvh_cache;
+  reuse->verts_num = mesh.verts_num;
+  reuse->edges_num = mesh.edges_num;
+  reuse->faces_num = mesh.faces_num;
+  reuse->corners_num = mesh.corners_num;
+  for (const int i : IndexRange(sharing_infos.size())) {
+    if (const ImplicitSharingInfo *sharing_info = sharing_infos[i]) {
+      sharing_info->add_weak_user();
+      reuse->topology[i] = {sharing_info, sharing_info->version()};
+    }
+  }
+  return reuse;
+}
+
+static bool bvhcache_reuse_matches(const BVHCacheReuse &reuse, const Mesh &mesh)
+{
+  if (mesh.verts_num != reuse.verts_num || mesh.edges_num != reuse.edges_num ||
+      mesh.faces_num != reuse.faces_num || mesh.corners_num != reuse.corners_num)
+  {
+    return false;
+  }
+  const std::array<const ImplicitSharingInfo *, 4> sharing_infos = mesh_topology_sharing_infos(
+      mesh);
+  for (const int i : IndexRange(sharing_infos.size())) {
+    const BVHCacheTopologyRef &ref = reuse.topology[i];
+    if (sharing_infos[i] != ref.sharing_info) {
+      return false;
+    }
+    /* The array is referenced by the mesh, so it can't be expired. */
+    if (ref.sharing_info && ref.sharing_info->version() != ref.version) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void bvhcache_reuse_apply(BVHCacheReuse *reuse, Mesh &mesh)
+{
+  if (mesh.runtime->bvh_cache == nullptr && bvhcache_reuse_matches(*reuse, mesh)) {
+    mesh.runtime->bvh_cache = std::exchange(reuse->bvh_cache, nullptr);
+  }
+  bvhcache_reuse_free(reuse);
+}
+
+void bvhcache_reuse_free(BVHCacheReuse *reuse)
+{
+  if (reuse->bvh_cache) {
+    bvhcache_free(reuse->bvh_cache);
+  }
+  for (const BVHCacheTopologyRef &ref : reuse->topology) {
+    if (ref.sharing_info) {
+      ref.sharing_info->remove_weak_user_and_delete_if_last();
+    }
+  }
+  MEM_delete(reuse);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Free Functions
  * \{ */
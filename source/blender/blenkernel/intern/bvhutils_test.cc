@@ -0,0 +1,267 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <cfloat>
+
+#include "CLG_log.h"
+
+#include "DNA_mesh_types.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector_types.hh"
+#include "BLI_offset_indices.hh"
+
+#include "BKE_bvhutils.hh"
+#include "BKE_idtype.hh"
+#include "BKE_lib_id.hh"
+#include "BKE_mesh.h"
+#include "BKE_mesh.hh"
+#include "BKE_mesh_types.hh"
+
+namespace blender::bke::tests {
+
+class BVHCacheTest : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    CLG_init();
+    BKE_idtype_init();
+  }
+  static void TearDownTestSuite()
+  {
+    CLG_exit();
+  }
+};
+
+/** A grid of \a size by \a size unit quads in the XY plane, starting at the origin. */
+static Mesh *create_grid(const int size)
+{
+  const int verts_x = size + 1;
+  Mesh *mesh = BKE_mesh_new_nomain(verts_x * verts_x, 0, size * size, size * size * 4);
+  MutableSpan<float3> positions = mesh->vert_positions_for_write();
+  for (const int y : IndexRange(verts_x)) {
+    for (const int x : IndexRange(verts_x)) {
+      positions[y * verts_x + x] = float3(x, y, 0.0f);
+    }
+  }
+  offset_indices::fill_constant_group_size(4, 0, mesh->face_offsets_for_write());
+  MutableSpan<int> corner_verts = mesh->corner_verts_for_write();
+  for (const int y : IndexRange(size)) {
+    for (const int x : IndexRange(size)) {
+      const int face = y * size + x;
+      const int vert = y * verts_x + x;
+      corner_verts.slice(face * 4, 4).copy_from(
+          {vert, vert + 1, vert + verts_x + 1, vert + verts_x});
+    }
+  }
+  mesh_calc_edges(*mesh, false, false);
+  return mesh;
+}
+
+static BVHTreeRayHit raycast_down(BVHTreeFromMesh &data, const float3 &co)
+{
+  BVHTreeRayHit hit;
+  hit.index = -1;
+  hit.dist = BVH_RAYCAST_DIST_MAX;
+  BLI_bvhtree_ray_cast(
+      data.tree, co, float3(0.0f, 0.0f, -1.0f), 0.0f, &hit, data.raycast_callback, &data);
+  return hit;
+}
+
+static BVHTreeNearest find_nearest(BVHTreeFromMesh &data, const float3 &co)
+{
+  BVHTreeNearest nearest;
+  nearest.index = -1;
+  nearest.dist_sq = FLT_MAX;
+  BLI_bvhtree_find_nearest(data.tree, co, &nearest, data.nearest_callback, &data);
+  return nearest;
+}
+
+/**
+ * Check that queries on the cached tree of \a mesh give the same results as on a tree that is
+ * built from scratch, over the whole area of a grid of \a size.
+ */
+static void expect_queries_match_new_tree(const Mesh *mesh, const int size)
+{
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(*mesh);
+  BVHTreeFromMesh data;
+  BVHTreeFromMesh data_new;
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  BKE_bvhtree_from_mesh_get(&data_new, mesh_copy, BVHTREE_FROM_CORNER_TRIS, 2);
+  ASSERT_NE(data.tree, data_new.tree);
+  EXPECT_EQ(BLI_bvhtree_get_len(data.tree), BLI_bvhtree_get_len(data_new.tree));
+
+  for (const int y : IndexRange(size)) {
+    for (const int x : IndexRange(size)) {
+      const float3 co(x + 0.3f, y + 0.6f, 10.0f);
+      const BVHTreeRayHit hit = raycast_down(data, co);
+      const BVHTreeRayHit hit_new = raycast_down(data_new, co);
+      EXPECT_EQ(hit.index, hit_new.index);
+      EXPECT_FLOAT_EQ(hit.dist, hit_new.dist);
+
+      const float3 co_near(x + 0.3f, y + 0.6f, 0.5f);
+      const BVHTreeNearest nearest = find_nearest(data, co_near);
+      const BVHTreeNearest nearest_new = find_nearest(data_new, co_near);
+      EXPECT_FLOAT_EQ(nearest.dist_sq, nearest_new.dist_sq);
+    }
+  }
+
+  free_bvhtree_from_mesh(&data);
+  free_bvhtree_from_mesh(&data_new);
+  BKE_id_free(nullptr, mesh_copy);
+}
+
+static float3 tilted_position(const float3 &position)
+{
+  return float3(position.x, position.y, 1.0f + position.x * 0.1f);
+}
+
+TEST_F(BVHCacheTest, RefitAfterDeform)
+{
+  Mesh *mesh = create_grid(8);
+  BVHTreeFromMesh data;
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  const BVHTree *tree = data.tree;
+  free_bvhtree_from_mesh(&data);
+
+  for (float3 &position : mesh->vert_positions_for_write()) {
+    position = tilted_position(position);
+  }
+  mesh->tag_positions_changed();
+
+  /* The cached tree is updated instead of built again. */
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  EXPECT_EQ(data.tree, tree);
+  const BVHTreeRayHit hit = raycast_down(data, float3(2.5f, 3.5f, 10.0f));
+  EXPECT_NE(hit.index, -1);
+  EXPECT_NEAR(hit.co[2], 1.25f, 1e-5f);
+  const BVHTreeNearest nearest = find_nearest(data, float3(7.5f, 0.5f, 5.0f));
+  EXPECT_NE(nearest.index, -1);
+  EXPECT_NEAR(nearest.co[2], tilted_position(float3(nearest.co)).z, 1e-5f);
+  free_bvhtree_from_mesh(&data);
+
+  expect_queries_match_new_tree(mesh, 8);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(BVHCacheTest, RebuildWhenInefficient)
+{
+  Mesh *mesh = create_grid(16);
+  BVHTreeFromMesh data;
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  free_bvhtree_from_mesh(&data);
+
+  /* Shuffle the positions, so that every face spans a large part of the grid. Updating the
+   * bounds would result in a tree where every query visits most nodes. */
+  MutableSpan<float3> positions = mesh->vert_positions_for_write();
+  const Array<float3> positions_orig(positions.as_span());
+  for (const int i : positions.index_range()) {
+    positions[i] = positions_orig[(i * 7919) % positions.size()];
+  }
+  mesh->tag_positions_changed();
+
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(*mesh);
+  BVHTreeFromMesh data_new;
+  BKE_bvhtree_from_mesh_get(&data_new, mesh_copy, BVHTREE_FROM_CORNER_TRIS, 2);
+  EXPECT_FLOAT_EQ(BLI_bvhtree_get_cost(data.tree), BLI_bvhtree_get_cost(data_new.tree));
+  free_bvhtree_from_mesh(&data);
+  free_bvhtree_from_mesh(&data_new);
+  BKE_id_free(nullptr, mesh_copy);
+
+  expect_queries_match_new_tree(mesh, 16);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(BVHCacheTest, RebuildOnTopologyChange)
+{
+  Mesh *mesh = create_grid(4);
+  BVHTreeFromMesh data;
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  EXPECT_NE(raycast_down(data, float3(0.5f, 0.5f, 10.0f)).index, -1);
+  free_bvhtree_from_mesh(&data);
+
+  /* Move the first face onto the last one, without changing the number of elements. */
+  MutableSpan<int> corner_verts = mesh->corner_verts_for_write();
+  corner_verts.take_front(4).copy_from(corner_verts.take_back(4));
+  mesh_calc_edges(*mesh, false, false);
+  mesh->tag_topology_changed();
+
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  EXPECT_EQ(raycast_down(data, float3(0.5f, 0.5f, 10.0f)).index, -1);
+  EXPECT_NE(raycast_down(data, float3(3.5f, 3.5f, 10.0f)).index, -1);
+  free_bvhtree_from_mesh(&data);
+
+  expect_queries_match_new_tree(mesh, 4);
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST_F(BVHCacheTest, Reuse)
+{
+  Mesh *mesh = create_grid(8);
+  BVHTreeFromMesh data;
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  free_bvhtree_from_mesh(&data);
+
+  /* A mesh with the same topology, like the next evaluated mesh during playback. */
+  Mesh *mesh_next = BKE_mesh_copy_for_eval(*mesh);
+  for (float3 &position : mesh_next->vert_positions_for_write()) {
+    position = tilted_position(position);
+  }
+  mesh_next->tag_positions_changed();
+
+  BVHCacheReuse *reuse = bvhcache_reuse_create(*mesh);
+  ASSERT_NE(reuse, nullptr);
+  EXPECT_EQ(mesh->runtime->bvh_cache, nullptr);
+  BKE_id_free(nullptr, mesh);
+
+  bvhcache_reuse_apply(reuse, *mesh_next);
+  EXPECT_NE(mesh_next->runtime->bvh_cache, nullptr);
+  expect_queries_match_new_tree(mesh_next, 8);
+  BKE_id_free(nullptr, mesh_next);
+}
+
+TEST_F(BVHCacheTest, ReuseOtherTopology)
+{
+  Mesh *mesh = create_grid(8);
+  BVHTreeFromMesh data;
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  free_bvhtree_from_mesh(&data);
+
+  /* A different number of elements. */
+  Mesh *mesh_other = create_grid(4);
+  BVHCacheReuse *reuse = bvhcache_reuse_create(*mesh);
+  ASSERT_NE(reuse, nullptr);
+  bvhcache_reuse_apply(reuse, *mesh_other);
+  EXPECT_EQ(mesh_other->runtime->bvh_cache, nullptr);
+  BKE_id_free(nullptr, mesh_other);
+
+  /* Arrays that are not shared with the mesh the trees were built for. */
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  free_bvhtree_from_mesh(&data);
+  mesh_other = create_grid(8);
+  reuse = bvhcache_reuse_create(*mesh);
+  ASSERT_NE(reuse, nullptr);
+  bvhcache_reuse_apply(reuse, *mesh_other);
+  EXPECT_EQ(mesh_other->runtime->bvh_cache, nullptr);
+  BKE_id_free(nullptr, mesh_other);
+
+  /* Shared arrays that were modified after the trees were built. */
+  BKE_bvhtree_from_mesh_get(&data, mesh, BVHTREE_FROM_CORNER_TRIS, 2);
+  free_bvhtree_from_mesh(&data);
+  mesh_other = BKE_mesh_copy_for_eval(*mesh);
+  reuse = bvhcache_reuse_create(*mesh);
+  ASSERT_NE(reuse, nullptr);
+  BKE_id_free(nullptr, mesh);
+  /* The copy is the only user of the arrays now, so they are modified in place. */
+  MutableSpan<int> corner_verts = mesh_other->corner_verts_for_write();
+  corner_verts.take_front(4).copy_from(corner_verts.take_back(4));
+  bvhcache_reuse_apply(reuse, *mesh_other);
+  EXPECT_EQ(mesh_other->runtime->bvh_cache, nullptr);
+  BKE_id_free(nullptr, mesh_other);
+}
+
+}  // namespace blender::bke::tests
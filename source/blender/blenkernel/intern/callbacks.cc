@@ -79,6 +79,18 @@ void BKE_callback_add(bCallbackFuncStore *funcstore, eCbEvent evt)
   BLI_addtail(lb, funcstore);
 }
 
+bool BKE_callback_has_handlers(eCbEvent evt)
+{
+  ASSERT_CALLBACKS_INITIALIZED();
+  ListBase *lb = &callback_slots[evt];
+  LISTBASE_FOREACH (bCallbackFuncStore *, funcstore, lb) {
+    if (funcstore->poll == nullptr || funcstore->poll(funcstore->arg)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void BKE_callback_remove(bCallbackFuncStore *funcstore, eCbEvent evt)
 {
   /* The callback may have already been removed by BKE_callback_global_finalize(), for
@@ -4728,7 +4728,15 @@ bool CustomData_layer_validate(CustomDataLayer *layer, const uint totitems, cons
   }
 
   BLI_assert((totitems == 0) || layer->data);
-  BLI_assert(MEM_allocN_len(layer->data) >= totitems * typeInfo->size);
+#ifndef NDEBUG
+  /* Data owned by other kinds of sharing info (e.g. referencing a memory-mapped blend-file) is not
+   * necessarily allocated with the guarded allocator. */
+  if (layer->sharing_info == nullptr ||
+      dynamic_cast<const CustomDataLayerImplicitSharing *>(layer->sharing_info))
+  {
+    BLI_assert(MEM_allocN_len(layer->data) >= totitems * typeInfo->size);
+  }
+#endif
 
   if (typeInfo->validate != nullptr) {
     return typeInfo->validate(layer->data, totitems, do_fixes);
@@ -5457,6 +5465,19 @@ static void blend_read_paint_mask(BlendDataReader *reader,
   }
 }
 
+/**
+ * Whether the layer data is a plain array that doesn't reference other data, so that it doesn't
+ * need any processing after being read from a file.
+ */
+static bool layer_data_is_trivial(const eCustomDataType type)
+{
+  if (ELEM(type, CD_MDEFORMVERT, CD_MDISPS, CD_GRID_PAINT_MASK)) {
+    return false;
+  }
+  const LayerTypeInfo *typeInfo = layerType_getInfo(type);
+  return typeInfo->free == nullptr;
+}
+
 static void blend_read_layer_data(BlendDataReader *reader, CustomDataLayer &layer, const int count)
 {
   switch (layer.type) {
@@ -5530,15 +5551,21 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, const int
     layer->sharing_info = nullptr;
 
     if (CustomData_verify_versions(data, i)) {
-      layer->sharing_info = BLO_read_shared(
-          reader, &layer->data, [&]() -> const ImplicitSharingInfo * {
-            blend_read_layer_data(reader, *layer, count);
-            if (layer->data == nullptr) {
-              return nullptr;
-            }
-            return make_implicit_sharing_info_for_layer(
-                eCustomDataType(layer->type), layer->data, count);
-          });
+      const eCustomDataType type = eCustomDataType(layer->type);
+      const auto read_fn = [&]() -> const ImplicitSharingInfo * {
+        blend_read_layer_data(reader, *layer, count);
+        if (layer->data == nullptr) {
+          return nullptr;
+        }
+        return make_implicit_sharing_info_for_layer(type, layer->data, count);
+      };
+      if (layer_data_is_trivial(type)) {
+        layer->sharing_info = BLO_read_shared_trivial(
+            reader, &layer->data, int64_t(count) * CustomData_sizeof(type), read_fn);
+      }
+      else {
+        layer->sharing_info = BLO_read_shared(reader, &layer->data, read_fn);
+      }
       i++;
     }
   }
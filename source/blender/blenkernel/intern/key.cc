@@ -18,7 +18,9 @@
 #include "BLI_math_matrix.h"
 #include "BLI_math_vector.h"
 #include "BLI_string_utils.hh"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "BLT_translation.hh"
 
@@ -61,10 +63,13 @@ static void shapekey_copy_data(Main * /*bmain*/,
                                const ID *id_src,
                                const int /*flag*/)
 {
+  using namespace blender;
   Key *key_dst = (Key *)id_dst;
   const Key *key_src = (const Key *)id_src;
   BLI_duplicatelist(&key_dst->block, &key_src->block);
 
+  Vector<KeyBlock *> blocks_with_data;
+  int64_t data_size = 0;
   KeyBlock *kb_dst, *kb_src;
   for (kb_src = static_cast<KeyBlock *>(key_src->block.first),
       kb_dst = static_cast<KeyBlock *>(key_dst->block.first);
@@ -72,12 +77,29 @@ static void shapekey_copy_data(Main * /*bmain*/,
        kb_src = kb_src->next, kb_dst = kb_dst->next)
   {
     if (kb_dst->data) {
-      kb_dst->data = MEM_dupallocN(kb_dst->data);
+      blocks_with_data.append(kb_dst);
+      data_size += int64_t(MEM_allocN_len(kb_dst->data));
     }
     if (kb_src == key_src->refkey) {
       key_dst->refkey = kb_dst;
     }
   }
+
+  /* Shape keys of dense meshes are the largest arrays which are copied when a mesh is copied,
+   * for example when it is evaluated for the first time. Copy the blocks in parallel when there is
+   * enough data to make it worth it. */
+  const auto copy_blocks = [&](const IndexRange range) {
+    for (KeyBlock *kb : blocks_with_data.as_span().slice(range)) {
+      kb->data = MEM_dupallocN(kb->data);
+    }
+  };
+  if (data_size < 1024 * 1024) {
+    copy_blocks(blocks_with_data.index_range());
+    return;
+  }
+  threading::memory_bandwidth_bound_task(data_size * 2, [&]() {
+    threading::parallel_for(blocks_with_data.index_range(), 1, copy_blocks);
+  });
 }
 
 static void shapekey_free_data(ID *id)
@@ -1015,6 +1015,15 @@ static void mesh_build_data(Depsgraph &depsgraph,
   const bool is_mesh_eval_owned = (mesh_eval != mesh->runtime->mesh_eval);
   BKE_object_eval_assign_data(&ob, &mesh_eval->id, is_mesh_eval_owned);
 
+  if (BVHCacheReuse *bvh_cache_reuse = std::exchange(ob.runtime->bvh_cache_reuse, nullptr)) {
+    if (is_mesh_eval_owned) {
+      bvhcache_reuse_apply(bvh_cache_reuse, *mesh_eval);
+    }
+    else {
+      bvhcache_reuse_free(bvh_cache_reuse);
+    }
+  }
+
   /* Add the final mesh as a non-owning component to the geometry set. */
   MeshComponent &mesh_component = geometry_set_eval->get_component_for_write<MeshComponent>();
   mesh_component.replace(mesh_eval, GeometryOwnershipType::Editable);
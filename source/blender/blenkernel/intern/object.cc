@@ -73,6 +73,7 @@
 #include "BKE_armature.hh"
 #include "BKE_asset.hh"
 #include "BKE_bpath.hh"
+#include "BKE_bvhutils.hh"
 #include "BKE_camera.h"
 #include "BKE_collection.hh"
 #include "BKE_constraint.h"
@@ -1651,6 +1652,10 @@ void BKE_object_free_derived_caches(Object *ob)
     BKE_id_free(nullptr, mesh_deform_eval);
     ob->runtime->mesh_deform_eval = nullptr;
   }
+  if (ob->runtime->bvh_cache_reuse != nullptr) {
+    bvhcache_reuse_free(ob->runtime->bvh_cache_reuse);
+    ob->runtime->bvh_cache_reuse = nullptr;
+  }
 
   /* Restore initial pointer for copy-on-evaluation data-blocks, object->data
    * might be pointing to an evaluated data-block data was just freed above. */
@@ -4881,6 +4886,7 @@ void BKE_object_runtime_reset_on_copy(Object *object, const int /*flag*/)
   runtime->data_eval = nullptr;
   runtime->gpd_eval = nullptr;
   runtime->mesh_deform_eval = nullptr;
+  runtime->bvh_cache_reuse = nullptr;
   runtime->curve_cache = nullptr;
   runtime->object_as_temp_mesh = nullptr;
   runtime->pose_backup = nullptr;
@@ -17,6 +17,7 @@
 #include "BLI_utildefines.h"
 
 #include "BKE_armature.hh"
+#include "BKE_bvhutils.hh"
 #include "BKE_constraint.h"
 #include "BKE_curve.hh"
 #include "BKE_curves.h"
@@ -47,7 +48,17 @@ namespace deg = blender::deg;
 
 void BKE_object_eval_reset(Object *ob_eval)
 {
+  /* Keep the BVH trees of the evaluated mesh, they only need to be updated when the new evaluated
+   * mesh has the same topology, e.g. when it is deformed by an armature during playback. */
+  BVHCacheReuse *bvh_cache_reuse = nullptr;
+  ID *data_eval = ob_eval->runtime->data_eval;
+  if (data_eval && ob_eval->runtime->is_data_eval_owned && GS(data_eval->name) == ID_ME) {
+    bvh_cache_reuse = bvhcache_reuse_create(*reinterpret_cast<Mesh *>(data_eval));
+  }
+
   BKE_object_free_derived_caches(ob_eval);
+
+  ob_eval->runtime->bvh_cache_reuse = bvh_cache_reuse;
 }
 
 void BKE_object_eval_local_transform(Depsgraph *depsgraph, Object *ob)
@@ -906,7 +906,7 @@ void BKE_packedfile_blend_read(BlendDataReader *reader, PackedFile **pf_p)
     return;
   }
   /* NOTE: there is no way to handle endianness switch here. */
-  pf->sharing_info = BLO_read_shared(reader, &pf->data, [&]() {
+  pf->sharing_info = BLO_read_shared_trivial(reader, &pf->data, pf->size, [&]() {
     BLO_read_data_address(reader, &pf->data);
     return blender::implicit_sharing::info_for_mem_free(const_cast<void *>(pf->data));
   });
@@ -2545,7 +2545,9 @@ void BKE_scene_graph_evaluated_ensure(Depsgraph *depsgraph, Main *bmain)
   scene_graph_update_tagged(depsgraph, bmain, true);
 }
 
-void BKE_scene_graph_update_for_newframe_ex(Depsgraph *depsgraph, const bool clear_recalc)
+static void scene_graph_update_for_newframe(Depsgraph *depsgraph,
+                                            const bool clear_recalc,
+                                            const bool is_frame_evaluated)
 {
   Scene *scene = DEG_get_input_scene(depsgraph);
   Main *bmain = DEG_get_bmain(depsgraph);
@@ -2565,8 +2567,9 @@ void BKE_scene_graph_update_for_newframe_ex(Depsgraph *depsgraph, const bool cle
      *
      * NOTE: Only update for new frame on first iteration. Second iteration is for ensuring user
      * edits from callback are properly taken into account. Doing a time update on those would
-     * lose any possible unkeyed changes made by the handler. */
-    if (pass == 0) {
+     * lose any possible unkeyed changes made by the handler. When the frame has already been
+     * evaluated ahead of time, only the changes tagged by the handler are evaluated. */
+    if (pass == 0 && !is_frame_evaluated) {
       const float frame = BKE_scene_frame_get(scene);
       DEG_evaluate_on_framechange(depsgraph, frame, DEG_EVALUATE_SYNC_WRITEBACK_YES);
     }
@@ -2614,6 +2617,16 @@ void BKE_scene_graph_update_for_newframe_ex(Depsgraph *depsgraph, const bool cle
   }
 }
 
+void BKE_scene_graph_update_for_newframe_ex(Depsgraph *depsgraph, const bool clear_recalc)
+{
+  scene_graph_update_for_newframe(depsgraph, clear_recalc, false);
+}
+
+void BKE_scene_graph_update_for_prefetched_frame(Depsgraph *depsgraph, const bool clear_recalc)
+{
+  scene_graph_update_for_newframe(depsgraph, clear_recalc, true);
+}
+
 void BKE_scene_graph_update_for_newframe(Depsgraph *depsgraph)
 {
   BKE_scene_graph_update_for_newframe_ex(depsgraph, true);
@@ -0,0 +1,400 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * A `blender::ConcurrentMap<Key, Value>` is a hash map that supports adding and looking up keys
+ * from multiple threads at the same time, without locks. It is useful when parallel code has to
+ * deduplicate keys, where the alternatives are to build a map per thread and merge them afterwards
+ * or to protect a #blender::Map with a mutex.
+ *
+ * Like #blender::Map, it uses open addressing in a slot array with a power-of-two size and the
+ * probing strategies from BLI_probing_strategies.hh. A slot is claimed by a thread with an atomic
+ * compare-and-swap. Other threads only wait for that thread when they are looking for a key with
+ * the same hash while the key is being constructed.
+ *
+ * Some noteworthy information:
+ * - The map does not grow while it is used by multiple threads. #reserve has to be called
+ *   beforehand with the maximum number of keys that will be added, adding more keys aborts.
+ * - Keys can't be removed, only the entire map can be cleared.
+ * - References to keys and values stay valid until the map is reserved, cleared or destructed.
+ * - Values can be accessed by multiple threads at the same time, changing them has to be
+ *   synchronized by the caller.
+ * - All methods that are not thread-safe are documented as such.
+ * - A rudimentary benchmark comparing it to `tbb::concurrent_hash_map` can be found in
+ *   BLI_concurrent_map_test.cc.
+ */
+
+#include "BLI_array.hh"
+#include "BLI_concurrent_slots.hh"
+#include "BLI_hash.hh"
+#include "BLI_hash_tables.hh"
+#include "BLI_probing_strategies.hh"
+
+namespace blender {
+
+template<
+    /** Type of the keys stored in the map. The hash and is-equal functions have to support it. */
+    typename Key,
+    /** Type of the value that is stored per key. */
+    typename Value,
+    /**
+     * The strategy used to deal with collisions. They are defined in BLI_probing_strategies.hh.
+     */
+    typename ProbingStrategy = DefaultProbingStrategy,
+    /** The hash function used to hash the keys. See BLI_hash.hh. */
+    typename Hash = DefaultHash<Key>,
+    /** The equality operator used to compare keys. */
+    typename IsEqual = DefaultEquality<Key>,
+    /** The allocator used by this map. */
+    typename Allocator = GuardedAllocator>
+class ConcurrentMap {
+ public:
+  using size_type = int64_t;
+
+ private:
+  using Slot = ConcurrentMapSlot<Key, Value>;
+
+  /** The number of occupied slots. */
+  std::atomic<int64_t> occupied_slots_;
+
+  /**
+   * The maximum number of slots that can be occupied. This is the total number of slots times the
+   * max load factor.
+   */
+  int64_t usable_slots_;
+
+  /** The number of slots minus one, to turn any integer into a valid slot index. */
+  uint64_t slot_mask_;
+
+  BLI_NO_UNIQUE_ADDRESS Hash hash_;
+  BLI_NO_UNIQUE_ADDRESS IsEqual is_equal_;
+
+  /** The max load factor is 1/2 = 50% by default. */
+#define LOAD_FACTOR 1, 2
+  LoadFactor max_load_factor_ = LoadFactor(LOAD_FACTOR);
+#undef LOAD_FACTOR
+
+  /** There is always at least one empty slot and the size is a power of two. */
+  using SlotArray = Array<Slot, 1, Allocator>;
+  SlotArray slots_;
+
+  /** Iterate over a slot index sequence for a given hash. */
+#define CONCURRENT_MAP_SLOT_PROBING_BEGIN(HASH, R_SLOT) \
+  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, SLOT_INDEX) \
+    auto &R_SLOT = slots_[SLOT_INDEX];
+#define CONCURRENT_MAP_SLOT_PROBING_END() SLOT_PROBING_END()
+
+ public:
+  ConcurrentMap(Allocator allocator = {}) noexcept
+      : occupied_slots_(0), usable_slots_(0), slot_mask_(0), slots_(1, allocator)
+  {
+  }
+
+  /** Create a map that can hold at least \a n keys without growing. */
+  explicit ConcurrentMap(const int64_t n, Allocator allocator = {}) : ConcurrentMap(allocator)
+  {
+    this->reserve(n);
+  }
+
+  ConcurrentMap(const ConcurrentMap &other) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &other) = delete;
+
+  /**
+   * Add a key-value-pair to the map. If the key exists already, nothing is changed.
+   * \return True when the key has been added.
+   *
+   * This is thread-safe.
+   */
+  bool add(const Key &key, const Value &value)
+  {
+    return this->add_as(key, value);
+  }
+  bool add(const Key &key, Value &&value)
+  {
+    return this->add_as(key, std::move(value));
+  }
+  bool add(Key &&key, const Value &value)
+  {
+    return this->add_as(std::move(key), value);
+  }
+  bool add(Key &&key, Value &&value)
+  {
+    return this->add_as(std::move(key), std::move(value));
+  }
+  template<typename ForwardKey, typename... ForwardValue>
+  bool add_as(ForwardKey &&key, ForwardValue &&...value)
+  {
+    bool added;
+    this->lookup_or_add__impl(
+        std::forward<ForwardKey>(key),
+        [&]() { return Value(std::forward<ForwardValue>(value)...); },
+        hash_(key),
+        &added);
+    return added;
+  }
+
+  /**
+   * Get a reference to the value corresponding to the key. If the key does not exist yet, the
+   * value is created by calling \a create_value. It is only called once per key, even when
+   * multiple threads add the same key at the same time.
+   *
+   * This is thread-safe.
+   */
+  template<typename CreateValueF>
+  Value &lookup_or_add_cb(const Key &key, const CreateValueF &create_value)
+  {
+    return this->lookup_or_add_cb_as(key, create_value);
+  }
+  template<typename CreateValueF>
+  Value &lookup_or_add_cb(Key &&key, const CreateValueF &create_value)
+  {
+    return this->lookup_or_add_cb_as(std::move(key), create_value);
+  }
+  template<typename ForwardKey, typename CreateValueF>
+  Value &lookup_or_add_cb_as(ForwardKey &&key, const CreateValueF &create_value)
+  {
+    bool added;
+    return this->lookup_or_add__impl(
+        std::forward<ForwardKey>(key), create_value, hash_(key), &added);
+  }
+
+  /**
+   * Get a reference to the value corresponding to the key. If the key does not exist yet, a
+   * default constructed value is added.
+   *
+   * This is thread-safe.
+   */
+  Value &lookup_or_add_default(const Key &key)
+  {
+    return this->lookup_or_add_cb(key, []() { return Value(); });
+  }
+  Value &lookup_or_add_default(Key &&key)
+  {
+    return this->lookup_or_add_cb(std::move(key), []() { return Value(); });
+  }
+
+  /**
+   * Get a pointer to the value corresponding to the key, or null when the key does not exist.
+   *
+   * This is thread-safe.
+   */
+  const Value *lookup_ptr(const Key &key) const
+  {
+    return this->lookup_ptr_as(key);
+  }
+  Value *lookup_ptr(const Key &key)
+  {
+    return this->lookup_ptr_as(key);
+  }
+  template<typename ForwardKey> const Value *lookup_ptr_as(const ForwardKey &key) const
+  {
+    const Slot *slot = this->lookup_slot_ptr(key, hash_(key));
+    return (slot != nullptr) ? slot->value() : nullptr;
+  }
+  template<typename ForwardKey> Value *lookup_ptr_as(const ForwardKey &key)
+  {
+    return const_cast<Value *>(const_cast<const ConcurrentMap *>(this)->lookup_ptr_as(key));
+  }
+
+  /**
+   * Get a copy of the value corresponding to the key, or the default value when the key does not
+   * exist.
+   *
+   * This is thread-safe.
+   */
+  Value lookup_default(const Key &key, const Value &default_value) const
+  {
+    const Value *ptr = this->lookup_ptr(key);
+    return (ptr != nullptr) ? *ptr : default_value;
+  }
+
+  /**
+   * Return true if the key exists in the map.
+   *
+   * This is thread-safe.
+   */
+  bool contains(const Key &key) const
+  {
+    return this->contains_as(key);
+  }
+  template<typename ForwardKey> bool contains_as(const ForwardKey &key) const
+  {
+    return this->lookup_slot_ptr(key, hash_(key)) != nullptr;
+  }
+
+  /**
+   * Call \a fn with the key and value of every item in the map, in no particular order.
+   *
+   * This is not thread-safe, there must be no concurrent changes to the map.
+   */
+  template<typename FuncT> void foreach_item(const FuncT &fn) const
+  {
+    for (const Slot &slot : slots_) {
+      if (slot.state().is_occupied()) {
+        fn(*slot.key(), *slot.value());
+      }
+    }
+  }
+  template<typename FuncT> void foreach_item(const FuncT &fn)
+  {
+    for (Slot &slot : slots_) {
+      if (slot.state().is_occupied()) {
+        fn(*slot.key(), *slot.value());
+      }
+    }
+  }
+
+  /**
+   * Return the number of key-value-pairs in the map. This is thread-safe, but the result may
+   * already be outdated when other threads are adding keys.
+   */
+  int64_t size() const
+  {
+    return occupied_slots_.load(std::memory_order_relaxed);
+  }
+
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Return the number of keys that can be added before the map has to grow, which it never does
+   * while it is accessed by multiple threads.
+   */
+  int64_t capacity() const
+  {
+    return usable_slots_;
+  }
+
+  /**
+   * Allocate memory such that at least \a n keys can be added to the map. This has to be called
+   * before the map is accessed by multiple threads.
+   *
+   * This is not thread-safe.
+   */
+  void reserve(const int64_t n)
+  {
+    if (usable_slots_ < n) {
+      this->realloc_and_reinsert(n);
+    }
+  }
+
+  /**
+   * Remove all keys from the map. The allocated slots are kept, so the map can be filled again
+   * without reallocation.
+   *
+   * This is not thread-safe.
+   */
+  void clear()
+  {
+    slots_.reinitialize(slots_.size());
+    occupied_slots_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  BLI_NOINLINE void realloc_and_reinsert(const int64_t min_usable_slots)
+  {
+    int64_t total_slots, usable_slots;
+    max_load_factor_.compute_total_and_usable_slots(
+        SlotArray::inline_buffer_capacity(), min_usable_slots, &total_slots, &usable_slots);
+    BLI_assert(total_slots >= 1);
+    const uint64_t new_slot_mask = uint64_t(total_slots) - 1;
+
+    if (this->is_empty()) {
+      slots_.reinitialize(total_slots);
+      usable_slots_ = usable_slots;
+      slot_mask_ = new_slot_mask;
+      return;
+    }
+
+    SlotArray new_slots(total_slots);
+    for (Slot &slot : slots_) {
+      if (slot.state().is_occupied()) {
+        this->add_after_grow(slot, new_slots, new_slot_mask);
+      }
+    }
+    slots_ = std::move(new_slots);
+    usable_slots_ = usable_slots;
+    slot_mask_ = new_slot_mask;
+  }
+
+  void add_after_grow(Slot &old_slot, SlotArray &new_slots, const uint64_t new_slot_mask)
+  {
+    const uint64_t hash = hash_(*old_slot.key());
+    SLOT_PROBING_BEGIN (ProbingStrategy, hash, new_slot_mask, slot_index) {
+      Slot &slot = new_slots[slot_index];
+      if (ConcurrentSlotState::is_empty(slot.state().load())) {
+        new (slot.key()) Key(std::move(*old_slot.key()));
+        new (slot.value()) Value(std::move(*old_slot.value()));
+        slot.state().occupy(hash);
+        return;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  template<typename ForwardKey, typename CreateValueF>
+  Value &lookup_or_add__impl(ForwardKey &&key,
+                             const CreateValueF &create_value,
+                             const uint64_t hash,
+                             bool *r_added)
+  {
+    CONCURRENT_MAP_SLOT_PROBING_BEGIN (hash, slot) {
+      uint32_t state = slot.state().load();
+      if (ConcurrentSlotState::is_empty(state)) {
+        if (slot.state().try_claim(state, hash)) {
+          this->increment_size();
+          new (slot.key()) Key(std::forward<ForwardKey>(key));
+          new (slot.value()) Value(create_value());
+          slot.state().occupy(hash);
+          *r_added = true;
+          return *slot.value();
+        }
+        /* Another thread claimed the slot first, it may be adding the same key. */
+      }
+      if (ConcurrentSlotState::may_contain(state, hash)) {
+        slot.state().wait_until_occupied(state);
+        if (is_equal_(key, *slot.key())) {
+          *r_added = false;
+          return *slot.value();
+        }
+      }
+    }
+    CONCURRENT_MAP_SLOT_PROBING_END();
+  }
+
+  template<typename ForwardKey>
+  const Slot *lookup_slot_ptr(const ForwardKey &key, const uint64_t hash) const
+  {
+    CONCURRENT_MAP_SLOT_PROBING_BEGIN (hash, slot) {
+      uint32_t state = slot.state().load();
+      if (ConcurrentSlotState::is_empty(state)) {
+        return nullptr;
+      }
+      if (ConcurrentSlotState::may_contain(state, hash)) {
+        slot.state().wait_until_occupied(state);
+        if (is_equal_(key, *slot.key())) {
+          return &slot;
+        }
+      }
+    }
+    CONCURRENT_MAP_SLOT_PROBING_END();
+  }
+
+  void increment_size()
+  {
+    const int64_t old_size = occupied_slots_.fetch_add(1, std::memory_order_relaxed);
+    /* The map can't grow while it is used by multiple threads, see #reserve. */
+    if (UNLIKELY(old_size >= usable_slots_)) {
+      concurrent_slots_capacity_exceeded("ConcurrentMap");
+    }
+  }
+};
+
+}  // namespace blender
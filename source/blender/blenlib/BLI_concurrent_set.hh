@@ -0,0 +1,316 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * A `blender::ConcurrentSet<Key>` is an unordered container of unique keys that supports adding
+ * and looking up keys from multiple threads at the same time, without locks. It works the same way
+ * as #blender::ConcurrentMap, see BLI_concurrent_map.hh for details.
+ *
+ * Some noteworthy information:
+ * - The set does not grow while it is used by multiple threads. #reserve has to be called
+ *   beforehand with the maximum number of keys that will be added, adding more keys aborts.
+ * - Keys can't be removed, only the entire set can be cleared.
+ * - All methods that are not thread-safe are documented as such.
+ */
+
+#include "BLI_array.hh"
+#include "BLI_concurrent_slots.hh"
+#include "BLI_hash.hh"
+#include "BLI_hash_tables.hh"
+#include "BLI_probing_strategies.hh"
+
+namespace blender {
+
+template<
+    /** Type of the keys stored in the set. The hash and is-equal functions have to support it. */
+    typename Key,
+    /**
+     * The strategy used to deal with collisions. They are defined in BLI_probing_strategies.hh.
+     */
+    typename ProbingStrategy = DefaultProbingStrategy,
+    /** The hash function used to hash the keys. See BLI_hash.hh. */
+    typename Hash = DefaultHash<Key>,
+    /** The equality operator used to compare keys. */
+    typename IsEqual = DefaultEquality<Key>,
+    /** The allocator used by this set. */
+    typename Allocator = GuardedAllocator>
+class ConcurrentSet {
+ public:
+  using size_type = int64_t;
+
+ private:
+  using Slot = ConcurrentSetSlot<Key>;
+
+  /** The number of occupied slots. */
+  std::atomic<int64_t> occupied_slots_;
+
+  /**
+   * The maximum number of slots that can be occupied. This is the total number of slots times the
+   * max load factor.
+   */
+  int64_t usable_slots_;
+
+  /** The number of slots minus one, to turn any integer into a valid slot index. */
+  uint64_t slot_mask_;
+
+  BLI_NO_UNIQUE_ADDRESS Hash hash_;
+  BLI_NO_UNIQUE_ADDRESS IsEqual is_equal_;
+
+  /** The max load factor is 1/2 = 50% by default. */
+#define LOAD_FACTOR 1, 2
+  LoadFactor max_load_factor_ = LoadFactor(LOAD_FACTOR);
+#undef LOAD_FACTOR
+
+  /** There is always at least one empty slot and the size is a power of two. */
+  using SlotArray = Array<Slot, 1, Allocator>;
+  SlotArray slots_;
+
+  /** Iterate over a slot index sequence for a given hash. */
+#define CONCURRENT_SET_SLOT_PROBING_BEGIN(HASH, R_SLOT) \
+  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, SLOT_INDEX) \
+    auto &R_SLOT = slots_[SLOT_INDEX];
+#define CONCURRENT_SET_SLOT_PROBING_END() SLOT_PROBING_END()
+
+ public:
+  ConcurrentSet(Allocator allocator = {}) noexcept
+      : occupied_slots_(0), usable_slots_(0), slot_mask_(0), slots_(1, allocator)
+  {
+  }
+
+  /** Create a set that can hold at least \a n keys without growing. */
+  explicit ConcurrentSet(const int64_t n, Allocator allocator = {}) : ConcurrentSet(allocator)
+  {
+    this->reserve(n);
+  }
+
+  ConcurrentSet(const ConcurrentSet &other) = delete;
+  ConcurrentSet &operator=(const ConcurrentSet &other) = delete;
+
+  /**
+   * Add a key to the set. If the key exists already, nothing is changed.
+   * \return True when the key has been added.
+   *
+   * This is thread-safe.
+   */
+  bool add(const Key &key)
+  {
+    return this->add_as(key);
+  }
+  bool add(Key &&key)
+  {
+    return this->add_as(std::move(key));
+  }
+  template<typename ForwardKey> bool add_as(ForwardKey &&key)
+  {
+    bool added;
+    this->lookup_or_add__impl(std::forward<ForwardKey>(key), hash_(key), &added);
+    return added;
+  }
+
+  /**
+   * Get the key that is stored in the set that compares equal to the given key. If it does not
+   * exist yet, the given key is added.
+   *
+   * This is thread-safe.
+   */
+  const Key &lookup_key_or_add(const Key &key)
+  {
+    return this->lookup_key_or_add_as(key);
+  }
+  const Key &lookup_key_or_add(Key &&key)
+  {
+    return this->lookup_key_or_add_as(std::move(key));
+  }
+  template<typename ForwardKey> const Key &lookup_key_or_add_as(ForwardKey &&key)
+  {
+    bool added;
+    return this->lookup_or_add__impl(std::forward<ForwardKey>(key), hash_(key), &added);
+  }
+
+  /**
+   * Get a pointer to the key that is stored in the set that compares equal to the given key, or
+   * null when there is none.
+   *
+   * This is thread-safe.
+   */
+  const Key *lookup_key_ptr(const Key &key) const
+  {
+    return this->lookup_key_ptr_as(key);
+  }
+  template<typename ForwardKey> const Key *lookup_key_ptr_as(const ForwardKey &key) const
+  {
+    const uint64_t hash = hash_(key);
+    CONCURRENT_SET_SLOT_PROBING_BEGIN (hash, slot) {
+      uint32_t state = slot.state().load();
+      if (ConcurrentSlotState::is_empty(state)) {
+        return nullptr;
+      }
+      if (ConcurrentSlotState::may_contain(state, hash)) {
+        slot.state().wait_until_occupied(state);
+        if (is_equal_(key, *slot.key())) {
+          return slot.key();
+        }
+      }
+    }
+    CONCURRENT_SET_SLOT_PROBING_END();
+  }
+
+  /**
+   * Return true if the key exists in the set.
+   *
+   * This is thread-safe.
+   */
+  bool contains(const Key &key) const
+  {
+    return this->contains_as(key);
+  }
+  template<typename ForwardKey> bool contains_as(const ForwardKey &key) const
+  {
+    return this->lookup_key_ptr_as(key) != nullptr;
+  }
+
+  /**
+   * Call \a fn with every key in the set, in no particular order.
+   *
+   * This is not thread-safe, there must be no concurrent changes to the set.
+   */
+  template<typename FuncT> void foreach_key(const FuncT &fn) const
+  {
+    for (const Slot &slot : slots_) {
+      if (slot.state().is_occupied()) {
+        fn(*slot.key());
+      }
+    }
+  }
+
+  /**
+   * Return the number of keys in the set. This is thread-safe, but the result may already be
+   * outdated when other threads are adding keys.
+   */
+  int64_t size() const
+  {
+    return occupied_slots_.load(std::memory_order_relaxed);
+  }
+
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Return the number of keys that can be added before the set has to grow, which it never does
+   * while it is accessed by multiple threads.
+   */
+  int64_t capacity() const
+  {
+    return usable_slots_;
+  }
+
+  /**
+   * Allocate memory such that at least \a n keys can be added to the set. This has to be called
+   * before the set is accessed by multiple threads.
+   *
+   * This is not thread-safe.
+   */
+  void reserve(const int64_t n)
+  {
+    if (usable_slots_ < n) {
+      this->realloc_and_reinsert(n);
+    }
+  }
+
+  /**
+   * Remove all keys from the set. The allocated slots are kept, so the set can be filled again
+   * without reallocation.
+   *
+   * This is not thread-safe.
+   */
+  void clear()
+  {
+    slots_.reinitialize(slots_.size());
+    occupied_slots_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  BLI_NOINLINE void realloc_and_reinsert(const int64_t min_usable_slots)
+  {
+    int64_t total_slots, usable_slots;
+    max_load_factor_.compute_total_and_usable_slots(
+        SlotArray::inline_buffer_capacity(), min_usable_slots, &total_slots, &usable_slots);
+    BLI_assert(total_slots >= 1);
+    const uint64_t new_slot_mask = uint64_t(total_slots) - 1;
+
+    if (this->is_empty()) {
+      slots_.reinitialize(total_slots);
+      usable_slots_ = usable_slots;
+      slot_mask_ = new_slot_mask;
+      return;
+    }
+
+    SlotArray new_slots(total_slots);
+    for (Slot &slot : slots_) {
+      if (slot.state().is_occupied()) {
+        this->add_after_grow(slot, new_slots, new_slot_mask);
+      }
+    }
+    slots_ = std::move(new_slots);
+    usable_slots_ = usable_slots;
+    slot_mask_ = new_slot_mask;
+  }
+
+  void add_after_grow(Slot &old_slot, SlotArray &new_slots, const uint64_t new_slot_mask)
+  {
+    const uint64_t hash = hash_(*old_slot.key());
+    SLOT_PROBING_BEGIN (ProbingStrategy, hash, new_slot_mask, slot_index) {
+      Slot &slot = new_slots[slot_index];
+      if (ConcurrentSlotState::is_empty(slot.state().load())) {
+        new (slot.key()) Key(std::move(*old_slot.key()));
+        slot.state().occupy(hash);
+        return;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  template<typename ForwardKey>
+  const Key &lookup_or_add__impl(ForwardKey &&key, const uint64_t hash, bool *r_added)
+  {
+    CONCURRENT_SET_SLOT_PROBING_BEGIN (hash, slot) {
+      uint32_t state = slot.state().load();
+      if (ConcurrentSlotState::is_empty(state)) {
+        if (slot.state().try_claim(state, hash)) {
+          this->increment_size();
+          new (slot.key()) Key(std::forward<ForwardKey>(key));
+          slot.state().occupy(hash);
+          *r_added = true;
+          return *slot.key();
+        }
+        /* Another thread claimed the slot first, it may be adding the same key. */
+      }
+      if (ConcurrentSlotState::may_contain(state, hash)) {
+        slot.state().wait_until_occupied(state);
+        if (is_equal_(key, *slot.key())) {
+          *r_added = false;
+          return *slot.key();
+        }
+      }
+    }
+    CONCURRENT_SET_SLOT_PROBING_END();
+  }
+
+  void increment_size()
+  {
+    const int64_t old_size = occupied_slots_.fetch_add(1, std::memory_order_relaxed);
+    /* The set can't grow while it is used by multiple threads, see #reserve. */
+    if (UNLIKELY(old_size >= usable_slots_)) {
+      concurrent_slots_capacity_exceeded("ConcurrentSet");
+    }
+  }
+};
+
+}  // namespace blender
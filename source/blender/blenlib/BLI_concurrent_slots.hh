@@ -0,0 +1,250 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * This file contains the slot types used by blender::ConcurrentMap and blender::ConcurrentSet.
+ *
+ * A slot in a concurrent hash table is either empty, claimed by a thread that is constructing the
+ * key in it, or occupied. Once a slot is occupied, it stays occupied until the hash table is
+ * cleared or destructed. There is no removed state, because keys can't be removed while the hash
+ * table is used by multiple threads.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "BLI_memory_utils.hh"
+
+namespace blender {
+
+/**
+ * Called when more keys are added to a concurrent hash table than it reserved slots for. It can't
+ * grow while it is used by multiple threads, and once there is no empty slot left, looking up keys
+ * would never end. So this aborts, also in release builds.
+ */
+[[noreturn]] BLI_NOINLINE inline void concurrent_slots_capacity_exceeded(const char *type_name)
+{
+  std::fprintf(stderr,
+               "Error: more keys added to a %s than reserved, see its reserve method\n",
+               type_name);
+  BLI_assert_unreachable();
+  std::abort();
+}
+
+/**
+ * Atomic state of a slot in a concurrent hash table. Besides the state, it contains some bits of
+ * the hash of the key, so that a thread that is looking for a key only has to wait for a slot that
+ * is being written, when the hash of the key in that slot is likely the same.
+ */
+class ConcurrentSlotState {
+ private:
+  static constexpr uint32_t Empty = 0;
+  /** The slot has been claimed by a thread, its key might not be constructed yet. */
+  static constexpr uint32_t ClaimedFlag = 1 << 0;
+  /** The key and value in the slot are constructed and can be accessed. */
+  static constexpr uint32_t OccupiedFlag = 1 << 1;
+  static constexpr uint32_t HashMask = ~(ClaimedFlag | OccupiedFlag);
+
+  std::atomic<uint32_t> state_ = Empty;
+
+  static uint32_t hash_bits(const uint64_t hash)
+  {
+    return uint32_t(hash ^ (hash >> 32)) & HashMask;
+  }
+
+ public:
+  ConcurrentSlotState() = default;
+
+  /** Only used when the hash table is not accessed by multiple threads. */
+  ConcurrentSlotState(const ConcurrentSlotState &other)
+      : state_(other.state_.load(std::memory_order_relaxed))
+  {
+  }
+
+  /**
+   * Get the current state, which is passed to the static methods below. When the slot is occupied,
+   * its key can be accessed afterwards.
+   */
+  uint32_t load() const
+  {
+    return state_.load(std::memory_order_acquire);
+  }
+
+  static bool is_empty(const uint32_t state)
+  {
+    return state == Empty;
+  }
+
+  /**
+   * \return True when the slot may contain a key with the given hash. Otherwise the key in the
+   * slot is known to be different without having to access it.
+   */
+  static bool may_contain(const uint32_t state, const uint64_t hash)
+  {
+    return (state & HashMask) == hash_bits(hash);
+  }
+
+  /**
+   * Wait until the thread that claimed the slot has constructed the key in it.
+   */
+  void wait_until_occupied(uint32_t &state) const
+  {
+    while (!(state & OccupiedFlag)) {
+      std::this_thread::yield();
+      state = this->load();
+    }
+  }
+
+  /**
+   * Try to claim the slot for a key with the given hash. This only succeeds for one thread. If it
+   * fails, \a state is updated to the state the slot has been changed to by another thread.
+   * \return True when the key should be constructed in the slot by the calling thread, after which
+   * #occupy has to be called.
+   */
+  bool try_claim(uint32_t &state, const uint64_t hash)
+  {
+    BLI_assert(is_empty(state));
+    return state_.compare_exchange_strong(state,
+                                          hash_bits(hash) | ClaimedFlag,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire);
+  }
+
+  /**
+   * Make the key that has been constructed in a claimed slot visible to other threads. This can
+   * also be used to occupy an empty slot directly when there is no concurrent access.
+   */
+  void occupy(const uint64_t hash)
+  {
+    state_.store(hash_bits(hash) | ClaimedFlag | OccupiedFlag, std::memory_order_release);
+  }
+
+  /** Only valid when there are no concurrent changes to the slot. */
+  bool is_occupied() const
+  {
+    return state_.load(std::memory_order_relaxed) & OccupiedFlag;
+  }
+};
+
+/**
+ * Slot of a #ConcurrentMap, which stores the key and value next to the state.
+ */
+template<typename Key, typename Value> class ConcurrentMapSlot {
+ private:
+  ConcurrentSlotState state_;
+  TypedBuffer<Key> key_buffer_;
+  TypedBuffer<Value> value_buffer_;
+
+ public:
+  ConcurrentMapSlot() = default;
+
+  ~ConcurrentMapSlot()
+  {
+    if (state_.is_occupied()) {
+      key_buffer_.ref().~Key();
+      value_buffer_.ref().~Value();
+    }
+  }
+
+  /**
+   * Used when the slot array is reallocated, which does not happen while the map is accessed by
+   * multiple threads. The other slot keeps its state, its key and value are left in a moved-from
+   * state.
+   */
+  ConcurrentMapSlot(ConcurrentMapSlot &&other) noexcept(
+      std::is_nothrow_move_constructible_v<Key> && std::is_nothrow_move_constructible_v<Value>)
+      : state_(other.state_)
+  {
+    if (other.state_.is_occupied()) {
+      new (&key_buffer_) Key(std::move(*other.key_buffer_));
+      new (&value_buffer_) Value(std::move(*other.value_buffer_));
+    }
+  }
+
+  ConcurrentSlotState &state()
+  {
+    return state_;
+  }
+
+  const ConcurrentSlotState &state() const
+  {
+    return state_;
+  }
+
+  Key *key()
+  {
+    return key_buffer_;
+  }
+
+  const Key *key() const
+  {
+    return key_buffer_;
+  }
+
+  Value *value()
+  {
+    return value_buffer_;
+  }
+
+  const Value *value() const
+  {
+    return value_buffer_;
+  }
+};
+
+/**
+ * Slot of a #ConcurrentSet, which stores the key next to the state.
+ */
+template<typename Key> class ConcurrentSetSlot {
+ private:
+  ConcurrentSlotState state_;
+  TypedBuffer<Key> key_buffer_;
+
+ public:
+  ConcurrentSetSlot() = default;
+
+  ~ConcurrentSetSlot()
+  {
+    if (state_.is_occupied()) {
+      key_buffer_.ref().~Key();
+    }
+  }
+
+  /** See #ConcurrentMapSlot. */
+  ConcurrentSetSlot(ConcurrentSetSlot &&other) noexcept(std::is_nothrow_move_constructible_v<Key>)
+      : state_(other.state_)
+  {
+    if (other.state_.is_occupied()) {
+      new (&key_buffer_) Key(std::move(*other.key_buffer_));
+    }
+  }
+
+  ConcurrentSlotState &state()
+  {
+    return state_;
+  }
+
+  const ConcurrentSlotState &state() const
+  {
+    return state_;
+  }
+
+  Key *key()
+  {
+    return key_buffer_;
+  }
+
+  const Key *key() const
+  {
+    return key_buffer_;
+  }
+};
+
+}  // namespace blender
@@ -59,6 +59,17 @@ FileReader *BLI_filereader_new_memory(const void *data, size_t len) ATTR_WARN_UN
     ATTR_NONNULL();
 /** Create #FileReader from applying `Zstd` decompression on an underlying file. */
 FileReader *BLI_filereader_new_zstd(FileReader *base) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+/**
+ * Read the content of a skippable frame with the given \a magic number from a seekable `Zstd`
+ * #FileReader. Such frames are listed in the seek table as frames without uncompressed content.
+ *
+ * \return The frame content (to be freed with #MEM_freeN) or NULL when \a reader isn't a
+ * seekable `Zstd` reader or the frame doesn't exist.
+ */
+void *BLI_filereader_zstd_skippable_frame_read(FileReader *reader,
+                                               uint32_t magic,
+                                               size_t *r_size) ATTR_WARN_UNUSED_RESULT
+    ATTR_NONNULL();
 /** Create #FileReader from applying `Gzip` decompression on an underlying file. */
 FileReader *BLI_filereader_new_gzip(FileReader *base) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
 
@@ -73,6 +73,14 @@ typedef struct BVHTreeRayHit {
   float dist;
 } BVHTreeRayHit;
 
+enum {
+  /**
+   * Split nodes using the surface area heuristic instead of building an implicit balanced tree.
+   * Building is slower, but queries are usually faster (especially ray-casts on meshes with an
+   * uneven distribution of faces). Best used for trees that are queried many times.
+   */
+  BVH_BALANCE_SAH = (1 << 0),
+};
 enum {
   BVH_OVERLAP_USE_THREADING = (1 << 0),
   BVH_OVERLAP_RETURN_PAIRS = (1 << 1),
@@ -138,6 +146,10 @@ void BLI_bvhtree_free(BVHTree *tree);
  */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
+/**
+ * Same as #BLI_bvhtree_balance, with `BVH_BALANCE_*` flags to control how the tree is built.
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag);
 
 /**
  * Update: first update points/nodes, then call update_tree to refit the bounding volumes.
@@ -203,6 +215,18 @@ float BLI_bvhtree_get_epsilon(const BVHTree *tree);
  * This function returns the bounding box of the BVH tree.
  */
 void BLI_bvhtree_get_bounding_box(const BVHTree *tree, float r_bb_min[3], float r_bb_max[3]);
+/**
+ * The index passed to #BLI_bvhtree_insert for the element inserted at position \a leaf,
+ * which is the index to pass to #BLI_bvhtree_update_node for that element.
+ */
+int BLI_bvhtree_get_leaf_index(const BVHTree *tree, int leaf);
+/**
+ * Estimate of the cost of queries with the surface area heuristic: the sum of the surface areas
+ * of all branches relative to the area of the root. It grows as the elements move away from the
+ * positions the tree was balanced for, which can be used to decide when updating the tree with
+ * #BLI_bvhtree_update_tree isn't worth it anymore compared to building a new tree.
+ */
+float BLI_bvhtree_get_cost(const BVHTree *tree);
 
 /**
  * Find nearest node to the given coordinates
@@ -308,7 +332,9 @@ extern const float bvhtree_kdop_axes[13][3];
 #ifdef __cplusplus
 
 #  include "BLI_function_ref.hh"
+#  include "BLI_index_mask_fwd.hh"
 #  include "BLI_math_vector.hh"
+#  include "BLI_span.hh"
 
 namespace blender {
 
@@ -353,6 +379,41 @@ inline void BLI_bvhtree_range_query_cpp(const BVHTree &tree,
       &fn);
 }
 
+/**
+ * Cast many rays at once, one for every index in \a mask.
+ *
+ * Each ray uses the origin and (normalized) direction at its index. Every \a r_hits element must
+ * be initialized by the caller like for #BLI_bvhtree_ray_cast_ex, the hit distance limits the
+ * length of the ray. Rays are sorted by their direction and origin so that neighboring rays are
+ * traced together, and the work is split over multiple threads: the callback must be thread-safe.
+ */
+void BLI_bvhtree_ray_cast_batch(const BVHTree &tree,
+                                const IndexMask &mask,
+                                Span<float3> origins,
+                                Span<float3> directions,
+                                float radius,
+                                MutableSpan<BVHTreeRayHit> r_hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag = BVH_RAYCAST_DEFAULT);
+
+/**
+ * Find the nearest element for many positions at once, one for every index in \a mask.
+ *
+ * Every \a r_nearest element must be initialized by the caller like for
+ * #BLI_bvhtree_find_nearest_ex. Positions are sorted spatially and processed on multiple
+ * threads (the callback must be thread-safe). The results are the same as calling
+ * #BLI_bvhtree_find_nearest_ex for every position, including which element is found when several
+ * are at the same distance.
+ */
+void BLI_bvhtree_find_nearest_batch(const BVHTree &tree,
+                                    const IndexMask &mask,
+                                    Span<float3> positions,
+                                    MutableSpan<BVHTreeNearest> r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag = 0);
+
 }  // namespace blender
 
 #endif
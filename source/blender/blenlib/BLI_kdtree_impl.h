@@ -62,6 +62,25 @@ void BLI_kdtree_nd_(range_search_cb)(
     bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
     void *user_data);
 
+/**
+ * Batched versions of #find_nearest_n and #range_search_cb,
+ * running the queries for all coordinates in parallel.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co_array)[KD_DIMS],
+                                          uint co_len,
+                                          KDTreeNearest *r_nearest,
+                                          uint nearest_len_capacity,
+                                          int *r_nearest_len) ATTR_NONNULL(1, 4);
+void BLI_kdtree_nd_(range_search_batch_cb)(
+    const KDTree *tree,
+    const float (*co_array)[KD_DIMS],
+    uint co_len,
+    float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data);
+
 int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
                                          float range,
                                          bool use_index_order,
@@ -111,6 +130,29 @@ inline void BLI_kdtree_nd_(range_search_cb_cpp)(const KDTree *tree,
       const_cast<Fn *>(&fn));
 }
 
+template<typename Fn>
+inline void BLI_kdtree_nd_(range_search_batch_cb_cpp)(const KDTree *tree,
+                                                      const float (*co_array)[KD_DIMS],
+                                                      const uint co_len,
+                                                      float distance,
+                                                      const Fn &fn)
+{
+  BLI_kdtree_nd_(range_search_batch_cb)(
+      tree,
+      co_array,
+      co_len,
+      distance,
+      [](void *user_data,
+         const int co_index,
+         const int index,
+         const float *co,
+         const float dist_sq) {
+        const Fn &fn = *static_cast<const Fn *>(user_data);
+        return fn(co_index, index, co, dist_sq);
+      },
+      const_cast<Fn *>(&fn));
+}
+
 template<typename Fn>
 inline int BLI_kdtree_nd_(find_nearest_cb_cpp)(const KDTree *tree,
                                                const float co[KD_DIMS],
@@ -25,6 +25,9 @@ typedef struct BLI_mmap_file BLI_mmap_file;
  * May return NULL if the operation fails.
  * Note that this seeks to the end of the file to determine its length. */
 BLI_mmap_file *BLI_mmap_open(int fd) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+/* Same as #BLI_mmap_open, but the mapped memory may also be written to. Writes are private to the
+ * mapping and never reach the file: the system copies the affected pages on first write. */
+BLI_mmap_file *BLI_mmap_open_copy_on_write(int fd) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
 
 /* Reads length bytes from file at the given offset into dest.
  * Returns whether the operation was successful (may fail when reading beyond the file
@@ -54,6 +54,15 @@ struct GrainSize {
 
 namespace blender::threading {
 
+/** Priority of tasks relative to other tasks that are running at the same time. */
+enum class TaskPriority : int8_t {
+  /** Background work that the user is not waiting for, like generating previews. */
+  Low,
+  Normal,
+  /** Work that the user interface is blocked on. */
+  High,
+};
+
 template<typename Range, typename Function>
 inline void parallel_for_each(Range &&range, const Function &function)
 {
@@ -72,6 +81,13 @@ void parallel_for_impl(IndexRange range,
                        FunctionRef<void(IndexRange)> function,
                        const TaskSizeHints &size_hints);
 void memory_bandwidth_bound_task_impl(FunctionRef<void()> function);
+void parallel_for_numa_impl(IndexRange range,
+                            int64_t grain_size,
+                            FunctionRef<void(IndexRange)> function);
+#ifdef WITH_TBB
+/** Arena for tasks with the given priority, null when the default arena should be used. */
+tbb::task_arena *task_arena_for_priority(TaskPriority priority);
+#endif
 }  // namespace detail
 
 /**
@@ -255,4 +271,44 @@ inline void memory_bandwidth_bound_task(const int64_t approximate_bytes_touched,
   detail::memory_bandwidth_bound_task_impl(function);
 }
 
+/**
+ * Execute the function in a task arena with the given priority. Tasks spawned by the function are
+ * executed in the same arena, and idle worker threads join higher priority arenas first. While
+ * waiting, the calling thread only executes tasks from that arena, like with #isolate_task.
+ */
+void execute_with_priority(TaskPriority priority, FunctionRef<void()> function);
+
+/**
+ * Number of NUMA nodes that #execute_on_numa_node and #parallel_for_numa distribute work over.
+ * This is 1 on systems with a single node and when TBB can't detect the NUMA topology.
+ */
+int numa_nodes_num();
+
+/**
+ * Execute the function and the tasks it spawns on the threads of the given NUMA node. Memory is
+ * usually placed on the node of the thread that touches it first, so data that is created and
+ * later processed on the same node avoids slower memory accesses across nodes.
+ */
+void execute_on_numa_node(int numa_node, FunctionRef<void()> function);
+
+/**
+ * Same as #parallel_for, but splits the range into one contiguous part per NUMA node first. A
+ * range is always split the same way, so arrays that are filled and later processed with this
+ * function are mostly accessed by threads of the node that holds their memory.
+ */
+template<typename Function>
+inline void parallel_for_numa(const IndexRange range,
+                              const int64_t grain_size,
+                              const Function &function)
+{
+  if (range.is_empty()) {
+    return;
+  }
+  if (range.size() <= grain_size) {
+    function(range);
+    return;
+  }
+  detail::parallel_for_numa_impl(range, grain_size, function);
+}
+
 }  // namespace blender::threading
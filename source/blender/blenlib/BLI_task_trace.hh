@@ -0,0 +1,101 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Optional recording of named scopes per thread, to see which work runs in parallel and where
+ * threads are idle. The recorded trace is written in the Chrome trace event format, which can be
+ * opened in `chrome://tracing` or https://ui.perfetto.dev.
+ *
+ * When tracing is disabled a scope only costs a check of an atomic flag, so scopes can be placed
+ * in code that runs for every task.
+ *
+ * \code{.cc}
+ * {
+ *   threading::trace::Scope scope("Subdivide", "geometry");
+ *   ...
+ * }
+ * \endcode
+ */
+
+#include <atomic>
+#include <string>
+
+#include "BLI_string_ref.hh"
+
+namespace blender::threading::trace {
+
+namespace detail {
+extern std::atomic<bool> is_enabled;
+void record_scope(std::string &&name, const char *category, int64_t start_ns);
+int64_t now_ns();
+}  // namespace detail
+
+inline bool is_enabled()
+{
+  return detail::is_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Start recording scopes on all threads, until #stop is called.
+ * \return False when a trace is already being recorded.
+ */
+bool start(StringRefNull filepath);
+
+/**
+ * Stop recording and write the trace to the file path passed to #start.
+ * \return False when no trace was being recorded or writing the file failed.
+ */
+bool stop();
+
+/** File path of the trace that is being recorded, empty when tracing is disabled. */
+std::string filepath();
+
+/**
+ * Record the time between construction and destruction of the scope on the current thread. Scopes
+ * can be nested.
+ */
+class Scope {
+ private:
+  std::string name_;
+  const char *category_;
+  int64_t start_ns_ = -1;
+
+ public:
+  /**
+   * \param name: Label of the scope, it is copied when tracing.
+   * \param category: Static string to group scopes by the code they are from.
+   */
+  Scope(const StringRef name, const char *category = "") : category_(category)
+  {
+    if (is_enabled()) {
+      name_ = name;
+      start_ns_ = detail::now_ns();
+    }
+  }
+
+  /** Avoids computing the length of the name when tracing is disabled. */
+  Scope(const char *name, const char *category = "") : category_(category)
+  {
+    if (is_enabled()) {
+      name_ = name;
+      start_ns_ = detail::now_ns();
+    }
+  }
+
+  ~Scope()
+  {
+    if (start_ns_ != -1) {
+      detail::record_scope(std::move(name_), category_, start_ns_);
+    }
+  }
+
+  Scope(const Scope &other) = delete;
+  Scope &operator=(const Scope &other) = delete;
+};
+
+}  // namespace blender::threading::trace
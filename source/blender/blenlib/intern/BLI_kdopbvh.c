@@ -25,6 +25,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_alloca.h"
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
@@ -46,6 +48,15 @@
 
 #define MAX_TREETYPE 32
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+/* Test the children packed in #BVHPackedChildren using SSE instructions. */
+#  define USE_PACKED_SSE
+#endif
+
+/* Number of bins used to evaluate split candidates for #BVH_BALANCE_SAH. */
+#define SAH_BINS_NUM 16
+
 /* Setting zero so we can catch bugs in BLI_task/KDOPBVH.
  * TODO(sergey): Deduplicate the limits with #blender::bke::pbvh::Tree from BKE.
  */
@@ -73,12 +84,27 @@ typedef struct BVHNode {
   char main_axis; /* Axis used to split this node */
 } BVHNode;
 
+/**
+ * Bounds of up to 4 children of a branch along the X/Y/Z axes, stored per axis so they can be
+ * tested against a query at once. Unused lanes have inverted (empty) bounds.
+ */
+typedef struct BVHPackedChildren {
+  float min[3][4];
+  float max[3][4];
+} BVHPackedChildren;
+
 /* keep under 26 bytes for speed purposes */
 struct BVHTree {
   BVHNode **nodes;
   BVHNode *nodearray;  /* pre-alloc branch nodes */
   BVHNode **nodechild; /* pre-alloc children for nodes */
   float *nodebv;       /* pre-alloc bounding-volumes for nodes */
+  /**
+   * Children bounds of every branch (#packed_groups per branch, in the order of the branches in
+   * #nodearray), only used when the tree has X/Y/Z axes, NULL otherwise.
+   * See #bvhtree_packed_children_update.
+   */
+  BVHPackedChildren *packed;
   float epsilon;       /* Epsilon is used for inflation of the K-DOP. */
   int leaf_num;        /* leafs */
   int branch_num;
@@ -88,8 +114,8 @@ struct BVHTree {
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -856,6 +882,403 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Surface Area Heuristic Build
+ *
+ * Alternative to the implicit tree build for #BVH_BALANCE_SAH: leafs are split where the sum of
+ * the surface areas of the children weighted by their number of leafs is the smallest (evaluated
+ * for a fixed number of candidate positions, "binning"). This results in a tree that adapts to
+ * the distribution of the leafs, which makes queries faster at the cost of a slower build.
+ *
+ * Branches aren't implicit anymore, they are allocated from #BVHTree.nodearray as they are
+ * created, so every child still has an index greater than its parent.
+ * Large sub-trees are built in parallel.
+ * \{ */
+
+typedef struct BVHSAHBuildData {
+  BVHTree *tree;
+  /** Index of the next free branch, relative to the root. */
+  int32_t branch_next;
+  /** Null when building single-threaded. */
+  TaskPool *pool;
+} BVHSAHBuildData;
+
+typedef struct BVHSAHBuildTask {
+  BVHNode *node;
+  int leafs_begin;
+  int leafs_end;
+} BVHSAHBuildTask;
+
+typedef struct BVHSAHBin {
+  float bv[3][2];
+  int leafs_num;
+} BVHSAHBin;
+
+/** Half of the surface area of the box defined by 3 axes of a bounding volume. */
+static float sah_half_area(const float bv[3][2])
+{
+  const float ext[3] = {
+      max_ff(bv[0][1] - bv[0][0], 0.0f),
+      max_ff(bv[1][1] - bv[1][0], 0.0f),
+      max_ff(bv[2][1] - bv[2][0], 0.0f),
+  };
+  return ext[0] * ext[1] + ext[1] * ext[2] + ext[2] * ext[0];
+}
+
+static void sah_bounds_init(float bv[3][2])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    bv[axis][0] = FLT_MAX;
+    bv[axis][1] = -FLT_MAX;
+  }
+}
+
+static void sah_bounds_join(float bv[3][2], const float bv_other[3][2])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    bv[axis][0] = min_ff(bv[axis][0], bv_other[axis][0]);
+    bv[axis][1] = max_ff(bv[axis][1], bv_other[axis][1]);
+  }
+}
+
+/** Center of the leaf along the three first axes of the tree (scaled by two). */
+static float sah_leaf_center(const BVHTree *tree, const BVHNode *leaf, const int axis)
+{
+  const float *bv = leaf->bv + 2 * (tree->start_axis + axis);
+  return bv[0] + bv[1];
+}
+
+static int sah_bin_index(const float center, const float center_min, const float bin_scale)
+{
+  return min_ii((int)((center - center_min) * bin_scale), SAH_BINS_NUM - 1);
+}
+
+/**
+ * Split the leafs in range `[leafs_begin, leafs_end)` in two, reordering them in place.
+ *
+ * \param r_axis: The axis the leafs are split along.
+ * \return The start of the second range.
+ */
+static int sah_split_leafs(const BVHTree *tree,
+                           BVHNode **leafs_array,
+                           const int leafs_begin,
+                           const int leafs_end,
+                           int *r_axis)
+{
+  float center_min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float center_max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = leafs_begin; i < leafs_end; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float center = sah_leaf_center(tree, leafs_array[i], axis);
+      center_min[axis] = min_ff(center_min[axis], center);
+      center_max[axis] = max_ff(center_max[axis], center);
+    }
+  }
+
+  float best_cost = FLT_MAX;
+  int best_axis = -1;
+  int best_bin = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = center_max[axis] - center_min[axis];
+    if (!(extent > 0.0f)) {
+      continue;
+    }
+    const float bin_scale = (float)SAH_BINS_NUM / extent;
+
+    BVHSAHBin bins[SAH_BINS_NUM];
+    for (int bin = 0; bin < SAH_BINS_NUM; bin++) {
+      sah_bounds_init(bins[bin].bv);
+      bins[bin].leafs_num = 0;
+    }
+
+    for (int i = leafs_begin; i < leafs_end; i++) {
+      const BVHNode *leaf = leafs_array[i];
+      BVHSAHBin *bin = &bins[sah_bin_index(
+          sah_leaf_center(tree, leaf, axis), center_min[axis], bin_scale)];
+      bin->bv[0][0] = min_ff(bin->bv[0][0], leaf->bv[2 * tree->start_axis]);
+      bin->bv[0][1] = max_ff(bin->bv[0][1], leaf->bv[2 * tree->start_axis + 1]);
+      bin->bv[1][0] = min_ff(bin->bv[1][0], leaf->bv[2 * tree->start_axis + 2]);
+      bin->bv[1][1] = max_ff(bin->bv[1][1], leaf->bv[2 * tree->start_axis + 3]);
+      bin->bv[2][0] = min_ff(bin->bv[2][0], leaf->bv[2 * tree->start_axis + 4]);
+      bin->bv[2][1] = max_ff(bin->bv[2][1], leaf->bv[2 * tree->start_axis + 5]);
+      bin->leafs_num++;
+    }
+
+    /* Cost of the leafs on the right of every split candidate (after `bin`). */
+    float right_cost[SAH_BINS_NUM];
+    {
+      float bv[3][2];
+      sah_bounds_init(bv);
+      int leafs_num = 0;
+      for (int bin = SAH_BINS_NUM - 1; bin > 0; bin--) {
+        sah_bounds_join(bv, bins[bin].bv);
+        leafs_num += bins[bin].leafs_num;
+        right_cost[bin - 1] = leafs_num ? sah_half_area(bv) * (float)leafs_num : FLT_MAX;
+      }
+    }
+
+    float bv[3][2];
+    sah_bounds_init(bv);
+    int leafs_num = 0;
+    for (int bin = 0; bin < SAH_BINS_NUM - 1; bin++) {
+      sah_bounds_join(bv, bins[bin].bv);
+      leafs_num += bins[bin].leafs_num;
+      if (leafs_num == 0 || right_cost[bin] == FLT_MAX) {
+        continue;
+      }
+      const float cost = sah_half_area(bv) * (float)leafs_num + right_cost[bin];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin = bin;
+      }
+    }
+  }
+
+  if (best_axis == -1) {
+    /* All leafs have the same center, split in the middle. */
+    const int leafs_mid = (leafs_begin + leafs_end) / 2;
+    *r_axis = 0;
+    partition_nth_element(
+        leafs_array, leafs_begin, leafs_end, leafs_mid, 2 * tree->start_axis + 1);
+    return leafs_mid;
+  }
+
+  const float bin_scale = (float)SAH_BINS_NUM / (center_max[best_axis] - center_min[best_axis]);
+  int i = leafs_begin, j = leafs_end - 1;
+  while (i <= j) {
+    if (sah_bin_index(sah_leaf_center(tree, leafs_array[i], best_axis),
+                      center_min[best_axis],
+                      bin_scale) <= best_bin)
+    {
+      i++;
+    }
+    else {
+      SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+      j--;
+    }
+  }
+
+  *r_axis = best_axis;
+  return i;
+}
+
+static void sah_build_node(BVHSAHBuildData *data, BVHNode *node, int leafs_begin, int leafs_end);
+
+static void sah_build_node_task(TaskPool *__restrict pool, void *taskdata)
+{
+  BVHSAHBuildData *data = BLI_task_pool_user_data(pool);
+  const BVHSAHBuildTask *task = taskdata;
+  sah_build_node(data, task->node, task->leafs_begin, task->leafs_end);
+}
+
+/** Build the branch \a node for the leafs in `[leafs_begin, leafs_end)` and its sub-tree. */
+static void sah_build_node(BVHSAHBuildData *data, BVHNode *node, int leafs_begin, int leafs_end)
+{
+  BVHTree *tree = data->tree;
+  BVHNode **leafs_array = tree->nodes;
+
+  refit_kdop_hull(tree, node, leafs_begin, leafs_end);
+
+  /* Split the leafs until there is a range for every child,
+   * always splitting the range with the most leafs. */
+  int ranges[MAX_TREETYPE + 1] = {leafs_begin, leafs_end};
+  int ranges_num = 1;
+  while (ranges_num < tree->tree_type) {
+    int range_split = -1;
+    for (int i = 0; i < ranges_num; i++) {
+      if ((ranges[i + 1] - ranges[i] > 1) &&
+          (range_split == -1 ||
+           ranges[i + 1] - ranges[i] > ranges[range_split + 1] - ranges[range_split]))
+      {
+        range_split = i;
+      }
+    }
+    if (range_split == -1) {
+      break;
+    }
+
+    int axis;
+    const int leafs_mid = sah_split_leafs(
+        tree, leafs_array, ranges[range_split], ranges[range_split + 1], &axis);
+    if (ranges_num == 1) {
+      /* The first split is the most significant one. */
+      node->main_axis = (char)axis;
+    }
+
+    memmove(&ranges[range_split + 2],
+            &ranges[range_split + 1],
+            sizeof(*ranges) * (size_t)(ranges_num - range_split));
+    ranges[range_split + 1] = leafs_mid;
+    ranges_num++;
+  }
+
+  int child_branches_num = 0;
+  for (int i = 0; i < ranges_num; i++) {
+    if (ranges[i + 1] - ranges[i] > 1) {
+      child_branches_num++;
+    }
+  }
+  /* Allocate all child branches at once, so siblings are next to each other in memory. */
+  int branch_index = atomic_fetch_and_add_int32(&data->branch_next, child_branches_num);
+
+  for (int i = 0; i < ranges_num; i++) {
+    if (ranges[i + 1] - ranges[i] == 1) {
+      node->children[i] = leafs_array[ranges[i]];
+      node->children[i]->parent = node;
+      continue;
+    }
+
+    BVHNode *child = &tree->nodearray[tree->leaf_num + branch_index];
+    branch_index++;
+    child->parent = node;
+    node->children[i] = child;
+
+    if (data->pool && ranges[i + 1] - ranges[i] > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+      BVHSAHBuildTask *task = MEM_mallocN(sizeof(*task), __func__);
+      task->node = child;
+      task->leafs_begin = ranges[i];
+      task->leafs_end = ranges[i + 1];
+      BLI_task_pool_push(data->pool, sah_build_node_task, task, true, NULL);
+    }
+    else {
+      sah_build_node(data, child, ranges[i], ranges[i + 1]);
+    }
+  }
+  node->node_num = (char)ranges_num;
+}
+
+/**
+ * Make sure there is room for the worst case number of branches of a tree that isn't implicit,
+ * where every branch may only have two children.
+ */
+static void sah_ensure_branches_capacity(BVHTree *tree)
+{
+  const int numnodes = tree->leaf_num + max_ii(1, tree->leaf_num - 1) + tree->tree_type;
+  if (MEM_allocN_len(tree->nodearray) / sizeof(*tree->nodearray) >= (size_t)numnodes) {
+    return;
+  }
+
+  tree->nodes = MEM_recallocN(tree->nodes, sizeof(BVHNode *) * (size_t)numnodes);
+  tree->nodebv = MEM_recallocN(tree->nodebv, sizeof(float) * (size_t)(tree->axis * numnodes));
+  tree->nodechild = MEM_recallocN(tree->nodechild,
+                                  sizeof(BVHNode *) * (size_t)(tree->tree_type * numnodes));
+  tree->nodearray = MEM_recallocN(tree->nodearray, sizeof(BVHNode) * (size_t)numnodes);
+
+  for (int i = 0; i < numnodes; i++) {
+    tree->nodearray[i].bv = &tree->nodebv[i * tree->axis];
+    tree->nodearray[i].children = &tree->nodechild[i * tree->tree_type];
+  }
+  /* Not balanced yet, so leafs are still in insertion order. */
+  for (int i = 0; i < tree->leaf_num; i++) {
+    tree->nodes[i] = &tree->nodearray[i];
+  }
+}
+
+/** \return The number of created branches. */
+static int sah_build(BVHTree *tree)
+{
+  BLI_assert(tree->leaf_num > 1);
+
+  sah_ensure_branches_capacity(tree);
+
+  BVHNode *root = &tree->nodearray[tree->leaf_num];
+  root->parent = NULL;
+
+  BVHSAHBuildData data = {
+      .tree = tree,
+      .branch_next = 1,
+      .pool = NULL,
+  };
+
+  if (tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    data.pool = BLI_task_pool_create(&data, TASK_PRIORITY_HIGH);
+    sah_build_node(&data, root, 0, tree->leaf_num);
+    BLI_task_pool_work_and_wait(data.pool);
+    BLI_task_pool_free(data.pool);
+  }
+  else {
+    sah_build_node(&data, root, 0, tree->leaf_num);
+  }
+
+  return data.branch_next;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Packed Children Bounds
+ *
+ * Copies of the X/Y/Z bounds of the children of every branch, laid out so the children can be
+ * tested against a ray or point four at a time (see #BVHPackedChildren).
+ * \{ */
+
+static int bvhtree_packed_groups(const BVHTree *tree)
+{
+  return (tree->tree_type + 3) / 4;
+}
+
+/** \return The packed children bounds of the branch \a node or null. */
+BLI_INLINE const BVHPackedChildren *bvhtree_packed_children(const BVHTree *tree,
+                                                            const BVHNode *node)
+{
+  if (tree->packed == NULL) {
+    return NULL;
+  }
+  const int branch_index = (int)(node - tree->nodearray) - tree->leaf_num;
+  BLI_assert(branch_index >= 0 && branch_index < tree->branch_num);
+  return tree->packed + branch_index * bvhtree_packed_groups(tree);
+}
+
+static void bvhtree_packed_children_update_task_cb(void *__restrict userdata,
+                                                   const int branch_index,
+                                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  const BVHNode *node = &tree->nodearray[tree->leaf_num + branch_index];
+  const int groups_num = bvhtree_packed_groups(tree);
+  BVHPackedChildren *packed = tree->packed + branch_index * groups_num;
+
+  for (int i = 0; i < groups_num * 4; i++) {
+    BVHPackedChildren *group = &packed[i / 4];
+    const int lane = i % 4;
+    for (int axis = 0; axis < 3; axis++) {
+      if (i < node->node_num) {
+        group->min[axis][lane] = node->children[i]->bv[2 * axis];
+        group->max[axis][lane] = node->children[i]->bv[2 * axis + 1];
+      }
+      else {
+        group->min[axis][lane] = FLT_MAX;
+        group->max[axis][lane] = -FLT_MAX;
+      }
+    }
+  }
+}
+
+/** Ensure #BVHTree.packed matches the bounds of the children of all branches. */
+static void bvhtree_packed_children_update(BVHTree *tree)
+{
+  if (tree->start_axis != 0 || tree->branch_num == 0) {
+    /* Queries using the packed bounds rely on the first axes being X/Y/Z. */
+    return;
+  }
+
+  if (tree->packed == NULL) {
+    const size_t packed_num = (size_t)(tree->branch_num * bvhtree_packed_groups(tree));
+    tree->packed = MEM_mallocN_aligned(sizeof(BVHPackedChildren) * packed_num, 16, __func__);
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (tree->leaf_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(
+      0, tree->branch_num, tree, bvhtree_packed_children_update_task_cb, &settings);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -939,11 +1362,12 @@ void BLI_bvhtree_free(BVHTree *tree)
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
     MEM_SAFE_FREE(tree->nodechild);
+    MEM_SAFE_FREE(tree->packed);
     MEM_freeN(tree);
   }
 }
 
-void BLI_bvhtree_balance(BVHTree *tree)
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int flag)
 {
   BVHNode **leafs_array = tree->nodes;
 
@@ -951,13 +1375,18 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->branch_num == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->leaf_num - 1), leafs_array, tree->leaf_num);
+  if ((flag & BVH_BALANCE_SAH) && tree->leaf_num > 2) {
+    tree->branch_num = sah_build(tree);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->leaf_num - 1), leafs_array, tree->leaf_num);
+    tree->branch_num = implicit_needed_branches(tree->tree_type, tree->leaf_num);
+  }
 
   /* current code expects the branches to be linked to the nodes array
    * we perform that linkage here */
-  tree->branch_num = implicit_needed_branches(tree->tree_type, tree->leaf_num);
   for (int i = 0; i < tree->branch_num; i++) {
     tree->nodes[tree->leaf_num + i] = &tree->nodearray[tree->leaf_num + i];
   }
@@ -973,6 +1402,13 @@ void BLI_bvhtree_balance(BVHTree *tree)
 #ifdef USE_PRINT_TREE
   bvhtree_info(tree);
 #endif
+
+  bvhtree_packed_children_update(tree);
+}
+
+void BLI_bvhtree_balance(BVHTree *tree)
+{
+  BLI_bvhtree_balance_ex(tree, 0);
 }
 
 static void bvhtree_node_inflate(const BVHTree *tree, BVHNode *node, const float dist)
@@ -1039,6 +1475,8 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
   for (; index >= root; index--) {
     node_join(tree, *index);
   }
+
+  bvhtree_packed_children_update(tree);
 }
 int BLI_bvhtree_get_len(const BVHTree *tree)
 {
@@ -1071,6 +1509,30 @@ void BLI_bvhtree_get_bounding_box(const BVHTree *tree, float r_bb_min[3], float
   }
 }
 
+int BLI_bvhtree_get_leaf_index(const BVHTree *tree, const int leaf)
+{
+  BLI_assert(leaf >= 0 && leaf < tree->leaf_num);
+  return tree->nodearray[leaf].index;
+}
+
+float BLI_bvhtree_get_cost(const BVHTree *tree)
+{
+  if (tree->branch_num == 0) {
+    return 0.0f;
+  }
+  const BVHNode *root = tree->nodes[tree->leaf_num];
+  const float root_area = sah_half_area((const float(*)[2])(root->bv + 2 * tree->start_axis));
+  if (root_area == 0.0f) {
+    return 0.0f;
+  }
+  double area = 0.0;
+  for (int i = 0; i < tree->branch_num; i++) {
+    const BVHNode *node = &tree->nodearray[tree->leaf_num + i];
+    area += (double)sah_half_area((const float(*)[2])(node->bv + 2 * tree->start_axis));
+  }
+  return (float)(area / (double)root_area);
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -1099,6 +1561,54 @@ static bool tree_overlap_test(const BVHNode *node1,
   return 1;
 }
 
+/**
+ * \return A bit for every child of the branch \a node of \a tree that may overlap \a other_node.
+ * All bits are set when the packed children bounds can't be used.
+ */
+static uint tree_overlap_children_mask(const BVHOverlapData_Shared *data,
+                                       const BVHTree *tree,
+                                       const BVHNode *node,
+                                       const BVHNode *other_node)
+{
+  if (data->start_axis != 0 || data->stop_axis != 3) {
+    return UINT_MAX;
+  }
+  const BVHPackedChildren *packed = bvhtree_packed_children(tree, node);
+  if (packed == NULL) {
+    return UINT_MAX;
+  }
+
+  const float *bv = other_node->bv;
+  uint mask = 0;
+  for (int i = 0; i < node->node_num; i += 4) {
+    const BVHPackedChildren *group = &packed[i / 4];
+#ifdef USE_PACKED_SSE
+    __m128 miss = _mm_setzero_ps();
+    for (int axis = 0; axis < 3; axis++) {
+      const __m128 bv_min = _mm_set1_ps(bv[2 * axis]);
+      const __m128 bv_max = _mm_set1_ps(bv[2 * axis + 1]);
+      miss = _mm_or_ps(miss, _mm_cmpgt_ps(_mm_load_ps(group->min[axis]), bv_max));
+      miss = _mm_or_ps(miss, _mm_cmpgt_ps(bv_min, _mm_load_ps(group->max[axis])));
+    }
+    const uint group_mask = ~(uint)_mm_movemask_ps(miss) & 0xfu;
+#else
+    uint group_mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+      bool miss = false;
+      for (int axis = 0; axis < 3; axis++) {
+        miss |= (group->min[axis][lane] > bv[2 * axis + 1]) ||
+                (bv[2 * axis] > group->max[axis][lane]);
+      }
+      if (!miss) {
+        group_mask |= 1u << lane;
+      }
+    }
+#endif
+    mask |= group_mask << i;
+  }
+  return mask;
+}
+
 static void tree_overlap_traverse(BVHOverlapData_Thread *data_thread,
                                   const BVHNode *node1,
                                   const BVHNode *node2)
@@ -1123,16 +1633,18 @@ static void tree_overlap_traverse(BVHOverlapData_Thread *data_thread,
         overlap->indexB = node2->index;
       }
       else {
+        const uint mask = tree_overlap_children_mask(data, data->tree2, node2, node1);
         for (j = 0; j < data->tree2->tree_type; j++) {
-          if (node2->children[j]) {
+          if (node2->children[j] && (mask & (1u << j))) {
             tree_overlap_traverse(data_thread, node1, node2->children[j]);
           }
         }
       }
     }
     else {
+      const uint mask = tree_overlap_children_mask(data, data->tree1, node1, node2);
       for (j = 0; j < data->tree1->tree_type; j++) {
-        if (node1->children[j]) {
+        if (node1->children[j] && (mask & (1u << j))) {
           tree_overlap_traverse(data_thread, node1->children[j], node2);
         }
       }
@@ -1170,16 +1682,18 @@ static void tree_overlap_traverse_cb(BVHOverlapData_Thread *data_thread,
         }
       }
       else {
+        const uint mask = tree_overlap_children_mask(data, data->tree2, node2, node1);
         for (j = 0; j < data->tree2->tree_type; j++) {
-          if (node2->children[j]) {
+          if (node2->children[j] && (mask & (1u << j))) {
             tree_overlap_traverse_cb(data_thread, node1, node2->children[j]);
           }
         }
       }
     }
     else {
+      const uint mask = tree_overlap_children_mask(data, data->tree1, node1, node2);
       for (j = 0; j < data->tree1->tree_type; j++) {
-        if (node1->children[j]) {
+        if (node1->children[j] && (mask & (1u << j))) {
           tree_overlap_traverse_cb(data_thread, node1->children[j], node2);
         }
       }
@@ -1557,6 +2071,35 @@ static float calc_nearest_point_squared(const float proj[3], BVHNode *node, floa
   return len_squared_v3v3(proj, nearest);
 }
 
+/** Same as #calc_nearest_point_squared for all children of a branch at once. */
+static void calc_nearest_point_squared_packed(const float proj[3],
+                                              const BVHPackedChildren *packed,
+                                              float r_dist_sq[4])
+{
+#ifdef USE_PACKED_SSE
+  __m128 dist_sq = _mm_setzero_ps();
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 co = _mm_set1_ps(proj[axis]);
+    const __m128 nearest = _mm_min_ps(_mm_load_ps(packed->max[axis]),
+                                      _mm_max_ps(_mm_load_ps(packed->min[axis]), co));
+    const __m128 delta = _mm_sub_ps(co, nearest);
+    dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(delta, delta));
+  }
+  _mm_storeu_ps(r_dist_sq, dist_sq);
+#else
+  for (int lane = 0; lane < 4; lane++) {
+    float dist_sq = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+      const float nearest = min_ff(packed->max[axis][lane],
+                                   max_ff(packed->min[axis][lane], proj[axis]));
+      const float delta = proj[axis] - nearest;
+      dist_sq += delta * delta;
+    }
+    r_dist_sq[lane] = dist_sq;
+  }
+#endif
+}
+
 /* Depth first search method */
 static void dfs_find_nearest_dfs(BVHNearestData *data, BVHNode *node)
 {
@@ -1574,6 +2117,30 @@ static void dfs_find_nearest_dfs(BVHNearestData *data, BVHNode *node)
     int i;
     float nearest[3];
 
+    const BVHPackedChildren *packed = bvhtree_packed_children(data->tree, node);
+    if (packed) {
+      /* Test all children at once, visiting them in the same order as below. */
+      float child_dist_sq[MAX_TREETYPE];
+      for (i = 0; i < node->node_num; i += 4) {
+        calc_nearest_point_squared_packed(data->proj, &packed[i / 4], &child_dist_sq[i]);
+      }
+      if (data->proj[node->main_axis] <= node->children[0]->bv[node->main_axis * 2 + 1]) {
+        for (i = 0; i != node->node_num; i++) {
+          if (child_dist_sq[i] < data->nearest.dist_sq) {
+            dfs_find_nearest_dfs(data, node->children[i]);
+          }
+        }
+      }
+      else {
+        for (i = node->node_num - 1; i >= 0; i--) {
+          if (child_dist_sq[i] < data->nearest.dist_sq) {
+            dfs_find_nearest_dfs(data, node->children[i]);
+          }
+        }
+      }
+      return;
+    }
+
     if (data->proj[node->main_axis] <= node->children[0]->bv[node->main_axis * 2 + 1]) {
 
       for (i = 0; i != node->node_num; i++) {
@@ -1623,6 +2190,20 @@ static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHN
   else {
     float nearest[3];
 
+    const BVHPackedChildren *packed = bvhtree_packed_children(data->tree, node);
+    if (packed) {
+      float child_dist_sq[MAX_TREETYPE];
+      for (int i = 0; i < node->node_num; i += 4) {
+        calc_nearest_point_squared_packed(data->proj, &packed[i / 4], &child_dist_sq[i]);
+      }
+      for (int i = 0; i != node->node_num; i++) {
+        if (child_dist_sq[i] < data->nearest.dist_sq) {
+          BLI_heapsimple_insert(heap, child_dist_sq[i], node->children[i]);
+        }
+      }
+      return;
+    }
+
     for (int i = 0; i != node->node_num; i++) {
       float dist_sq = calc_nearest_point_squared(data->proj, node->children[i], nearest);
 
@@ -1876,10 +2457,64 @@ static float fast_ray_nearest_hit(const BVHRayCastData *data, const BVHNode *nod
   return max_fff(t1x, t1y, t1z);
 }
 
+/**
+ * Same as #fast_ray_nearest_hit for all children of a branch at once, without the early out on
+ * `data->hit.dist` (callers compare the distances with it before visiting the children).
+ */
+static void fast_ray_nearest_hit_packed(const BVHRayCastData *data,
+                                        const BVHPackedChildren *packed,
+                                        float r_dist[4])
+{
+  /* The bounds to use for the near and far planes along each axis. */
+  const float *bv_near[3], *bv_far[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const bool is_negative = data->index[2 * axis] != 2 * axis;
+    bv_near[axis] = is_negative ? packed->max[axis] : packed->min[axis];
+    bv_far[axis] = is_negative ? packed->min[axis] : packed->max[axis];
+  }
+
+#ifdef USE_PACKED_SSE
+  __m128 t1[3], t2[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 origin = _mm_set1_ps(data->ray.origin[axis]);
+    const __m128 idot = _mm_set1_ps(data->idot_axis[axis]);
+    t1[axis] = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bv_near[axis]), origin), idot);
+    t2[axis] = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bv_far[axis]), origin), idot);
+  }
+  const __m128 zero = _mm_setzero_ps();
+  __m128 miss = _mm_or_ps(_mm_cmpgt_ps(t1[0], t2[1]), _mm_cmplt_ps(t2[0], t1[1]));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[0], t2[2]), _mm_cmplt_ps(t2[0], t1[2])));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[1], t2[2]), _mm_cmplt_ps(t2[1], t1[2])));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(t2[0], zero), _mm_cmplt_ps(t2[1], zero)));
+  miss = _mm_or_ps(miss, _mm_cmplt_ps(t2[2], zero));
+
+  const __m128 dist = _mm_max_ps(_mm_max_ps(t1[0], t1[1]), t1[2]);
+  _mm_storeu_ps(r_dist,
+                _mm_or_ps(_mm_and_ps(miss, _mm_set1_ps(FLT_MAX)), _mm_andnot_ps(miss, dist)));
+#else
+  for (int lane = 0; lane < 4; lane++) {
+    float t1[3], t2[3];
+    for (int axis = 0; axis < 3; axis++) {
+      t1[axis] = (bv_near[axis][lane] - data->ray.origin[axis]) * data->idot_axis[axis];
+      t2[axis] = (bv_far[axis][lane] - data->ray.origin[axis]) * data->idot_axis[axis];
+    }
+    if ((t1[0] > t2[1] || t2[0] < t1[1] || t1[0] > t2[2] || t2[0] < t1[2] || t1[1] > t2[2] ||
+         t2[1] < t1[2]) ||
+        (t2[0] < 0.0f || t2[1] < 0.0f || t2[2] < 0.0f))
+    {
+      r_dist[lane] = FLT_MAX;
+    }
+    else {
+      r_dist[lane] = max_fff(t1[0], t1[1], t1[2]);
+    }
+  }
+#endif
+}
+
+static void dfs_raycast_node(BVHRayCastData *data, BVHNode *node, float dist);
+
 static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
 {
-  int i;
-
   /* ray-bv is really fast.. and simple tests revealed its worth to test it
    * before calling the ray-primitive functions */
   /* XXX: temporary solution for particles until fast_ray_nearest_hit supports ray.radius */
@@ -1888,6 +2523,13 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
   if (dist >= data->hit.dist) {
     return;
   }
+  dfs_raycast_node(data, node, dist);
+}
+
+/** Visit a node of #dfs_raycast, \a dist being the distance to its bounding volume. */
+static void dfs_raycast_node(BVHRayCastData *data, BVHNode *node, float dist)
+{
+  int i;
 
   if (node->node_num == 0) {
     if (data->callback) {
@@ -1900,6 +2542,32 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
     }
   }
   else {
+    const BVHPackedChildren *packed = (data->ray.radius == 0.0f) ?
+                                          bvhtree_packed_children(data->tree, node) :
+                                          NULL;
+    if (packed) {
+      /* Test all children at once, visiting them in the same order as below. */
+      float child_dist[MAX_TREETYPE];
+      for (i = 0; i < node->node_num; i += 4) {
+        fast_ray_nearest_hit_packed(data, &packed[i / 4], &child_dist[i]);
+      }
+      if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+        for (i = 0; i != node->node_num; i++) {
+          if (child_dist[i] < data->hit.dist) {
+            dfs_raycast_node(data, node->children[i], child_dist[i]);
+          }
+        }
+      }
+      else {
+        for (i = node->node_num - 1; i >= 0; i--) {
+          if (child_dist[i] < data->hit.dist) {
+            dfs_raycast_node(data, node->children[i], child_dist[i]);
+          }
+        }
+      }
+      return;
+    }
+
     /* pick loop direction to dive into the tree (based on ray direction and split axis) */
     if (data->ray_dot_axis[node->main_axis] > 0.0f) {
       for (i = 0; i != node->node_num; i++) {
@@ -1917,10 +2585,10 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
 /**
  * A version of #dfs_raycast with minor changes to reset the index & dist each ray cast.
  */
+static void dfs_raycast_all_node(BVHRayCastData *data, BVHNode *node);
+
 static void dfs_raycast_all(BVHRayCastData *data, BVHNode *node)
 {
-  int i;
-
   /* ray-bv is really fast.. and simple tests revealed its worth to test it
    * before calling the ray-primitive functions */
   /* XXX: temporary solution for particles until fast_ray_nearest_hit supports ray.radius */
@@ -1929,8 +2597,16 @@ static void dfs_raycast_all(BVHRayCastData *data, BVHNode *node)
   if (dist >= data->hit.dist) {
     return;
   }
+  dfs_raycast_all_node(data, node);
+}
+
+/** Visit a node of #dfs_raycast_all that is hit by the ray. */
+static void dfs_raycast_all_node(BVHRayCastData *data, BVHNode *node)
+{
+  int i;
 
   if (node->node_num == 0) {
+    float dist;
     /* no need to check for 'data->callback' (using 'all' only makes sense with a callback). */
     dist = data->hit.dist;
     data->callback(data->userdata, node->index, &data->ray, &data->hit);
@@ -1938,6 +2614,32 @@ static void dfs_raycast_all(BVHRayCastData *data, BVHNode *node)
     data->hit.dist = dist;
   }
   else {
+    const BVHPackedChildren *packed = (data->ray.radius == 0.0f) ?
+                                          bvhtree_packed_children(data->tree, node) :
+                                          NULL;
+    if (packed) {
+      /* Test all children at once, visiting them in the same order as below. */
+      float child_dist[MAX_TREETYPE];
+      for (i = 0; i < node->node_num; i += 4) {
+        fast_ray_nearest_hit_packed(data, &packed[i / 4], &child_dist[i]);
+      }
+      if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+        for (i = 0; i != node->node_num; i++) {
+          if (child_dist[i] < data->hit.dist) {
+            dfs_raycast_all_node(data, node->children[i]);
+          }
+        }
+      }
+      else {
+        for (i = node->node_num - 1; i >= 0; i--) {
+          if (child_dist[i] < data->hit.dist) {
+            dfs_raycast_all_node(data, node->children[i]);
+          }
+        }
+      }
+      return;
+    }
+
     /* pick loop direction to dive into the tree (based on ray direction and split axis) */
     if (data->ray_dot_axis[node->main_axis] > 0.0f) {
       for (i = 0; i != node->node_num; i++) {
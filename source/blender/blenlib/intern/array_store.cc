@@ -94,7 +94,10 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_math_bits.h"
 #include "BLI_mempool.h"
+#include "BLI_task.hh"
 
 #include "BLI_array_store.h" /* Own include. */
 #include "BLI_ghash.h"       /* Only for #BLI_array_store_is_valid. */
@@ -173,6 +176,19 @@ struct BChunkList;
 #  define BCHUNK_HASH_LEN 16
 #endif
 
+#ifdef USE_HASH_TABLE_ACCUMULATE
+/**
+ * Hash large arrays and find the positions that may match a chunk in the hash table using
+ * multiple threads. The resulting chunks are the same as when hashing on a single thread.
+ */
+#  define USE_HASH_TABLE_PARALLEL
+#endif
+
+#ifdef USE_HASH_TABLE_PARALLEL
+/** Number of hashes computed or tested for a match by a single task. */
+#  define BCHUNK_HASH_PARALLEL_GRAIN_SIZE 16384
+#endif
+
 /**
  * Calculate the key once and reuse it.
  */
@@ -885,6 +901,91 @@ static void hash_accum(hash_key *hash_array, const size_t hash_array_len, size_t
   }
 }
 
+#  ifdef USE_HASH_TABLE_PARALLEL
+
+/**
+ * Multi-threaded #hash_array_from_data, for the hashes of all remaining data.
+ */
+static void hash_array_from_data_parallel(const BArrayInfo *info,
+                                          const uchar *data_slice,
+                                          const size_t data_slice_len,
+                                          hash_key *hash_array)
+{
+  const size_t hash_array_len = data_slice_len / info->chunk_stride;
+  blender::threading::parallel_for(
+      blender::IndexRange(int64_t(hash_array_len)),
+      BCHUNK_HASH_PARALLEL_GRAIN_SIZE,
+      [&](const blender::IndexRange range) {
+        const size_t i_start = size_t(range.start());
+        hash_array_from_data(info,
+                             &data_slice[i_start * info->chunk_stride],
+                             size_t(range.size()) * info->chunk_stride,
+                             &hash_array[i_start]);
+      });
+}
+
+/**
+ * Multi-threaded #hash_accum, with the same result.
+ *
+ * Every step reads the hashes ahead of the one that is written, which the single threaded loop
+ * reads before they are written themselves. The array is split into blocks that keep a copy of
+ * the hashes after their end, so the last hashes of a block don't read hashes that were already
+ * written by the next block.
+ */
+static void hash_accum_parallel(hash_key *hash_array,
+                                const size_t hash_array_len,
+                                size_t iter_steps)
+{
+  if (UNLIKELY(iter_steps > hash_array_len)) {
+    iter_steps = hash_array_len;
+  }
+
+  const size_t hash_array_search_len = hash_array_len - iter_steps;
+  if (hash_array_search_len < BCHUNK_HASH_PARALLEL_GRAIN_SIZE * 2) {
+    hash_accum(hash_array, hash_array_len, iter_steps);
+    return;
+  }
+
+  const size_t block_size = BCHUNK_HASH_PARALLEL_GRAIN_SIZE;
+  const size_t blocks_num = size_t(divide_ceil_ul(hash_array_search_len, block_size));
+  const size_t block_next_stride = iter_steps;
+  hash_key *block_next = static_cast<hash_key *>(
+      MEM_mallocN(sizeof(*block_next) * blocks_num * block_next_stride, __func__));
+  const blender::IndexRange blocks_range(0, int64_t(blocks_num));
+
+  while (iter_steps != 0) {
+    const size_t hash_offset = iter_steps;
+    blender::threading::parallel_for(blocks_range, 64, [&](const blender::IndexRange blocks) {
+      for (const int64_t block : blocks) {
+        const size_t i_end = std::min(size_t(block + 1) * block_size, hash_array_search_len);
+        memcpy(&block_next[size_t(block) * block_next_stride],
+               &hash_array[i_end],
+               sizeof(*hash_array) * hash_offset);
+      }
+    });
+    blender::threading::parallel_for(blocks_range, 1, [&](const blender::IndexRange blocks) {
+      for (const int64_t block : blocks) {
+        const size_t i_start = size_t(block) * block_size;
+        const size_t i_end = std::min(i_start + block_size, hash_array_search_len);
+        const size_t i_end_inner = std::max(i_start, i_end - std::min(i_end, hash_offset));
+        for (size_t i = i_start; i < i_end_inner; i++) {
+          hash_accum_impl(hash_array, i, i + hash_offset);
+        }
+        /* Same as #hash_accum_impl, reading the copied hashes. */
+        const hash_key *next = &block_next[size_t(block) * block_next_stride];
+        for (size_t i = i_end_inner; i < i_end; i++) {
+          hash_array[i] += ((next[i + hash_offset - i_end] << 3) ^ (hash_array[i] >> 1));
+        }
+      }
+    });
+    iter_steps -= 1;
+  }
+
+  MEM_freeN(block_next);
+}
+
+#  endif /* USE_HASH_TABLE_PARALLEL */
+
 /**
  * When we only need a single value, can use a small optimization.
  * we can avoid accumulating the tail of the array a little, each iteration.
@@ -995,6 +1096,81 @@ static const BChunkRef *table_lookup(const BArrayInfo *info,
   return nullptr;
 }
 
+#  ifdef USE_HASH_TABLE_PARALLEL
+
+/**
+ * Set a bit for every hash in \a table_hash_array for which #table_lookup may find a chunk, so
+ * the search over all positions can skip the others without accessing the table.
+ *
+ * \param data_len: Length of the data the hashes are computed for.
+ * \param r_candidates: Bits for every hash. Every word is written, so the buffer doesn't need to
+ * be initialized.
+ */
+static void table_lookup_candidates(const BArrayInfo *info,
+                                    BTableRef **table,
+                                    const size_t table_len,
+                                    const hash_key *table_hash_array,
+                                    const size_t table_hash_array_len,
+                                    const size_t data_len,
+                                    uint64_t *r_candidates)
+{
+  const size_t words_num = size_t(divide_ceil_ul(table_hash_array_len, 64));
+  blender::threading::parallel_for(
+      blender::IndexRange(int64_t(words_num)),
+      BCHUNK_HASH_PARALLEL_GRAIN_SIZE / 64,
+      [&](const blender::IndexRange words) {
+        for (const int64_t word_index : words) {
+          const size_t i_start = size_t(word_index) * 64;
+          const size_t i_end = std::min(i_start + 64, table_hash_array_len);
+          uint64_t word = 0;
+          for (size_t i = i_start; i < i_end; i++) {
+            const hash_key key = table_hash_array[i];
+            const size_t size_left = data_len - i * info->chunk_stride;
+            for (const BTableRef *tref = table[key % (hash_key)table_len]; tref; tref = tref->next)
+            {
+              const BChunk *chunk_test = tref->cref->link;
+#    ifdef USE_HASH_TABLE_KEY_CACHE
+              if (chunk_test->key != key) {
+                continue;
+              }
+#    endif
+              if (chunk_test->data_len <= size_left) {
+                word |= uint64_t(1) << (i - i_start);
+                break;
+              }
+            }
+          }
+          r_candidates[word_index] = word;
+        }
+      });
+}
+
+/**
+ * \return The index of the first bit set in \a candidates starting at \a index,
+ * or \a candidates_len when there is none.
+ */
+static size_t table_lookup_candidates_next(const uint64_t *candidates,
+                                           const size_t candidates_len,
+                                           const size_t index)
+{
+  const size_t words_num = size_t(divide_ceil_ul(candidates_len, 64));
+  size_t word_index = index / 64;
+  if (word_index >= words_num) {
+    return candidates_len;
+  }
+  uint64_t word = candidates[word_index] & (~uint64_t(0) << (index % 64));
+  while (word == 0) {
+    word_index++;
+    if (word_index == words_num) {
+      return candidates_len;
+    }
+    word = candidates[word_index];
+  }
+  return std::min(word_index * 64 + bitscan_forward_uint64(word), candidates_len);
+}
+
+#  endif /* USE_HASH_TABLE_PARALLEL */
+
 #else /* USE_HASH_TABLE_ACCUMULATE */
 
 /* NON USE_HASH_TABLE_ACCUMULATE code (simply hash each chunk). */
@@ -1264,9 +1440,15 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     const size_t table_hash_array_len = (data_len - i_prev) / info->chunk_stride;
     hash_key *table_hash_array = static_cast<hash_key *>(
         MEM_mallocN(sizeof(*table_hash_array) * table_hash_array_len, __func__));
+#  ifdef USE_HASH_TABLE_PARALLEL
+    hash_array_from_data_parallel(info, &data[i_prev], data_len - i_prev, table_hash_array);
+
+    hash_accum_parallel(table_hash_array, table_hash_array_len, info->accum_steps);
+#  else
     hash_array_from_data(info, &data[i_prev], data_len - i_prev, table_hash_array);
 
     hash_accum(table_hash_array, table_hash_array_len, info->accum_steps);
+#  endif
 #else
     /* Dummy vars. */
     uint i_table_start = 0;
@@ -1378,10 +1560,34 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     }
     /* Done making the table. */
 
+#ifdef USE_HASH_TABLE_PARALLEL
+    uint64_t *table_candidates = static_cast<uint64_t *>(MEM_mallocN(
+        sizeof(*table_candidates) * size_t(divide_ceil_ul(table_hash_array_len, 64)), __func__));
+    table_lookup_candidates(info,
+                            table,
+                            table_len,
+                            table_hash_array,
+                            table_hash_array_len,
+                            data_len - i_table_start,
+                            table_candidates);
+#endif
+
     BLI_assert(i_prev <= data_len);
     for (size_t i = i_prev; i < data_len;) {
       /* Assumes exiting chunk isn't a match! */
 
+#ifdef USE_HASH_TABLE_PARALLEL
+      {
+        /* Skip positions where the lookup can't find a chunk. */
+        const size_t i_hash = table_lookup_candidates_next(
+            table_candidates, table_hash_array_len, (i - i_table_start) / info->chunk_stride);
+        if (i_hash == table_hash_array_len) {
+          break;
+        }
+        i = i_table_start + i_hash * info->chunk_stride;
+      }
+#endif
+
       const BChunkRef *cref_found = table_lookup(
           info, table, table_len, i_table_start, data, data_len, i, table_hash_array);
       if (cref_found != nullptr) {
@@ -1430,6 +1636,9 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
 
 #ifdef USE_HASH_TABLE_ACCUMULATE
     MEM_freeN(table_hash_array);
+#endif
+#ifdef USE_HASH_TABLE_PARALLEL
+    MEM_freeN(table_candidates);
 #endif
     MEM_freeN(table);
     MEM_freeN(table_ref_stack);
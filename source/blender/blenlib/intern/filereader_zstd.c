@@ -277,6 +277,51 @@ static int64_t zstd_read(FileReader *reader, void *buffer, size_t size)
   return output.pos;
 }
 
+void *BLI_filereader_zstd_skippable_frame_read(FileReader *reader,
+                                               uint32_t magic,
+                                               size_t *r_size)
+{
+  *r_size = 0;
+  if (reader->read != zstd_read_seekable) {
+    return NULL;
+  }
+
+  ZstdReader *zstd = (ZstdReader *)reader;
+  FileReader *base = zstd->base;
+
+  /* Skippable frames are listed in the seek table as frames without any uncompressed content.
+   * The base offset doesn't need restoring, #zstd_ensure_cache always seeks before reading. */
+  for (int frame = 0; frame < zstd->seek.frames_num; frame++) {
+    const size_t compressed_size = zstd->seek.compressed_ofs[frame + 1] -
+                                   zstd->seek.compressed_ofs[frame];
+    if (zstd->seek.uncompressed_ofs[frame + 1] != zstd->seek.uncompressed_ofs[frame] ||
+        compressed_size < 8)
+    {
+      continue;
+    }
+
+    uint32_t frame_magic, frame_size;
+    if (base->seek(base, zstd->seek.compressed_ofs[frame], SEEK_SET) < 0 ||
+        !zstd_read_u32(base, &frame_magic) || !zstd_read_u32(base, &frame_size))
+    {
+      return NULL;
+    }
+    if (frame_magic != magic || frame_size != compressed_size - 8) {
+      continue;
+    }
+
+    void *content = MEM_mallocN(max_zz(frame_size, 1), __func__);
+    if (base->read(base, content, frame_size) != (int64_t)frame_size) {
+      MEM_freeN(content);
+      return NULL;
+    }
+    *r_size = frame_size;
+    return content;
+  }
+
+  return NULL;
+}
+
 static void zstd_close(FileReader *reader)
 {
   ZstdReader *zstd = (ZstdReader *)reader;
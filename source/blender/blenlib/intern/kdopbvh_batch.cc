@@ -0,0 +1,165 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ *
+ * Batched queries on #BVHTree.
+ *
+ * The queries are reordered along a Morton curve so that queries processed after each other
+ * visit mostly the same nodes, which keeps them in the CPU caches. Consecutive queries of the
+ * reordered batch are processed by the same thread.
+ */
+
+#include "BLI_array.hh"
+#include "BLI_bounds.hh"
+#include "BLI_index_mask.hh"
+#include "BLI_kdopbvh.h"
+#include "BLI_sort.hh"
+#include "BLI_task.hh"
+
+namespace blender {
+
+/** Below this number of queries, reordering them costs more than it gains. */
+static constexpr int64_t BATCH_SORT_THRESHOLD = 1024;
+static constexpr int64_t BATCH_GRAIN_SIZE = 256;
+
+/** Bits used for every axis of the Morton code. */
+static constexpr int MORTON_AXIS_BITS = 20;
+
+/** Insert two zero bits between each of the lower #MORTON_AXIS_BITS bits of \a v. */
+static uint64_t morton_spread_bits(uint64_t v)
+{
+  v &= 0xfffff;
+  v = (v | (v << 32)) & 0x001f00000000ffffull;
+  v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+  v = (v | (v << 8)) & 0x100f00f00f00f00full;
+  v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+  v = (v | (v << 2)) & 0x1249249249249249ull;
+  return v;
+}
+
+static uint64_t morton_code(const float3 &co, const float3 &min, const float3 &scale)
+{
+  const float max_cell = float((1 << MORTON_AXIS_BITS) - 1);
+  uint64_t code = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    const float cell = math::clamp((co[axis] - min[axis]) * scale[axis], 0.0f, max_cell);
+    code |= morton_spread_bits(uint64_t(cell)) << axis;
+  }
+  return code;
+}
+
+/**
+ * Order the indices of \a mask by the Morton code of their position, with an optional per-index
+ * prefix that is stored in the bits above the Morton code.
+ */
+template<typename PrefixFn>
+static Array<int> batch_sorted_indices(const IndexMask &mask,
+                                       const Span<float3> positions,
+                                       const PrefixFn &prefix_fn)
+{
+  const Bounds<float3> bounds = *bounds::min_max(mask, positions);
+  const float3 size = bounds.max - bounds.min;
+  float3 scale;
+  for (int axis = 0; axis < 3; axis++) {
+    scale[axis] = size[axis] > 0.0f ? float(1 << MORTON_AXIS_BITS) / size[axis] : 0.0f;
+  }
+
+  Array<std::pair<uint64_t, int>> keys(mask.size());
+  mask.foreach_index(GrainSize(4096), [&](const int i, const int pos) {
+    keys[pos] = {(uint64_t(prefix_fn(i)) << (MORTON_AXIS_BITS * 3)) |
+                     morton_code(positions[i], bounds.min, scale),
+                 i};
+  });
+  parallel_sort(keys.begin(), keys.end());
+
+  Array<int> indices(mask.size());
+  threading::parallel_for(indices.index_range(), 4096, [&](const IndexRange range) {
+    for (const int64_t pos : range) {
+      indices[pos] = keys[pos].second;
+    }
+  });
+  return indices;
+}
+
+/**
+ * Call \a fn for ranges of indices in \a mask, so that indices within a range are spatially
+ * close to each other when the batch is large enough to benefit from sorting.
+ */
+template<typename PrefixFn, typename Fn>
+static void batch_foreach_range(const IndexMask &mask,
+                                const Span<float3> positions,
+                                const PrefixFn &prefix_fn,
+                                const Fn &fn)
+{
+  if (mask.size() < BATCH_SORT_THRESHOLD) {
+    mask.foreach_segment(GrainSize(BATCH_GRAIN_SIZE),
+                         [&](const IndexMaskSegment segment) { fn(segment); });
+    return;
+  }
+  const Array<int> indices = batch_sorted_indices(mask, positions, prefix_fn);
+  threading::parallel_for(indices.index_range(), BATCH_GRAIN_SIZE, [&](const IndexRange range) {
+    fn(indices.as_span().slice(range));
+  });
+}
+
+void BLI_bvhtree_ray_cast_batch(const BVHTree &tree,
+                                const IndexMask &mask,
+                                const Span<float3> origins,
+                                const Span<float3> directions,
+                                const float radius,
+                                MutableSpan<BVHTreeRayHit> r_hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                const int flag)
+{
+  if (mask.is_empty()) {
+    return;
+  }
+  BLI_assert(origins.size() >= mask.min_array_size());
+  BLI_assert(directions.size() >= mask.min_array_size());
+  BLI_assert(r_hits.size() >= mask.min_array_size());
+
+  /* Group rays by the octant of their direction first, rays pointing in different directions
+   * traverse the tree in a different order. */
+  const auto direction_octant = [&](const int i) {
+    const float3 &dir = directions[i];
+    return int(dir.x < 0.0f) | (int(dir.y < 0.0f) << 1) | (int(dir.z < 0.0f) << 2);
+  };
+
+  batch_foreach_range(mask, origins, direction_octant, [&](const auto indices) {
+    for (const int i : indices) {
+      BLI_bvhtree_ray_cast_ex(
+          &tree, origins[i], directions[i], radius, &r_hits[i], callback, userdata, flag);
+    }
+  });
+}
+
+void BLI_bvhtree_find_nearest_batch(const BVHTree &tree,
+                                    const IndexMask &mask,
+                                    const Span<float3> positions,
+                                    MutableSpan<BVHTreeNearest> r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    const int flag)
+{
+  if (mask.is_empty()) {
+    return;
+  }
+  BLI_assert(positions.size() >= mask.min_array_size());
+  BLI_assert(r_nearest.size() >= mask.min_array_size());
+
+  /* Every query starts from its own initial state (no seeding from the previous result), so the
+   * found element doesn't depend on how the batch is sorted and split over threads. */
+  batch_foreach_range(
+      mask, positions, [](const int /*i*/) { return 0; }, [&](const auto indices) {
+        for (const int i : indices) {
+          BLI_bvhtree_find_nearest_ex(
+              &tree, positions[i], &r_nearest[i], callback, userdata, flag);
+        }
+      });
+}
+
+}  // namespace blender
@@ -10,6 +10,7 @@
 
 #include "BLI_kdtree_impl.h"
 #include "BLI_math_base.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include <string.h>
@@ -50,6 +51,23 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/** Balance sub-trees with at least this many nodes in separate tasks. */
+#define KD_BALANCE_TASK_THRESHOLD 4096
+/** Minimum number of queries handled by a thread in batched queries. */
+#define KD_BATCH_QUERY_GRAIN_SIZE 1024
+/** Reorder batched queries when there are at least this many. */
+#define KD_BATCH_ORDER_THRESHOLD 4096
+/**
+ * Search duplicates of nodes in parallel for trees with at least this many nodes,
+ * #KD_DUPLICATES_CHUNK_SIZE nodes at a time. Nodes with more than #KD_DUPLICATES_NEIGHBORS_MAX
+ * nodes in range (including themselves) are searched again when merging instead.
+ */
+#define KD_DUPLICATES_PARALLEL_THRESHOLD 16384
+#define KD_DUPLICATES_CHUNK_SIZE 16384
+#define KD_DUPLICATES_NEIGHBORS_MAX 16
+/** Neighbor count of nodes that have too many nodes in range to store them. */
+#define KD_DUPLICATES_NEIGHBORS_OVERFLOW ((uint)-1)
+
 /**
  * When set we know all values are unbalanced,
  * otherwise clear them when re-balancing: see #62210.
@@ -139,17 +157,66 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/** Index of the root of a sub-tree, the first of its nodes (see #kdtree_balance). */
+static uint kdtree_balance_root(const uint nodes_len, const uint ofs)
+{
+  if (nodes_len == 0) {
+    return KD_NODE_UNSET;
+  }
+  return ofs;
+}
+
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+} KDTreeBalanceTask;
+
+static void kdtree_balance(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs);
+
+static void kdtree_balance_task(TaskPool *__restrict pool, void *taskdata)
+{
+  const KDTreeBalanceTask *task = taskdata;
+  kdtree_balance(pool, task->nodes, task->nodes_len, task->axis, task->ofs);
+}
+
+/**
+ * Balance a sub-tree, or push a task to do it when it's large enough and a \a pool is used.
+ */
+static void kdtree_balance_subtree(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  if (pool && nodes_len >= KD_BALANCE_TASK_THRESHOLD) {
+    KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+    task->nodes = nodes;
+    task->nodes_len = nodes_len;
+    task->axis = axis;
+    task->ofs = ofs;
+    BLI_task_pool_push(pool, kdtree_balance_task, task, true, NULL);
+  }
+  else {
+    kdtree_balance(pool, nodes, nodes_len, axis, ofs);
+  }
+}
+
+/**
+ * Sort \a nodes around their median, which becomes the root of the sub-tree.
+ *
+ * Nodes are stored depth-first: the root is the first node of the sub-tree, followed by the
+ * left and then the right sub-tree. Compared to storing the root between both sub-trees, nodes
+ * visited one after the other during a search are closer in memory.
+ */
+static void kdtree_balance(
+    TaskPool *pool, KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
 {
   KDTreeNode *node;
   float co;
   uint left, right, median, i, j;
 
-  if (nodes_len <= 0) {
-    return KD_NODE_UNSET;
-  }
-  else if (nodes_len == 1) {
-    return 0 + ofs;
+  if (nodes_len <= 1) {
+    return;
   }
 
   /* Quick-sort style sorting around median. */
@@ -184,27 +251,49 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
     }
   }
 
+  /* Move the median in front of the left nodes. Their order is kept so the resulting tree is
+   * the same as when the median stays in the middle of the nodes. */
+  KDTreeNode_head median_head = *(KDTreeNode_head *)&nodes[median];
+  memmove(&nodes[1], &nodes[0], sizeof(KDTreeNode) * median);
+  *(KDTreeNode_head *)&nodes[0] = median_head;
+
   /* Set node and sort sub-nodes. */
-  node = &nodes[median];
+  node = &nodes[0];
   node->d = axis;
   axis = (axis + 1) % KD_DIMS;
-  node->left = kdtree_balance(nodes, median, axis, ofs);
-  node->right = kdtree_balance(
-      nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
 
-  return median + ofs;
+  const uint right_len = nodes_len - (median + 1);
+  node->left = kdtree_balance_root(median, ofs + 1);
+  node->right = kdtree_balance_root(right_len, (median + 1) + ofs);
+  kdtree_balance_subtree(pool, nodes + 1, median, axis, ofs + 1);
+  kdtree_balance_subtree(pool, nodes + median + 1, right_len, axis, (median + 1) + ofs);
 }
 
+/**
+ * Balance the tree, sub-trees are balanced in parallel for large trees.
+ */
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
     for (uint i = 0; i < tree->nodes_len; i++) {
       tree->nodes[i].left = KD_NODE_UNSET;
       tree->nodes[i].right = KD_NODE_UNSET;
+      /* Leaf nodes keep their axis, match newly inserted nodes. */
+      tree->nodes[i].d = 0;
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  tree->root = kdtree_balance_root(tree->nodes_len, 0);
+
+  if (tree->nodes_len >= KD_BALANCE_TASK_THRESHOLD * 2) {
+    TaskPool *pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    kdtree_balance(pool, tree->nodes, tree->nodes_len, 0, 0);
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
+  else {
+    kdtree_balance(NULL, tree->nodes, tree->nodes_len, 0, 0);
+  }
 
 #ifndef NDEBUG
   tree->is_balanced = true;
@@ -800,6 +889,205 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Large batches are processed in the order of a Morton curve through the coordinates, so that
+ * consecutive queries (which run on the same thread) visit mostly the same nodes.
+ * \{ */
+
+typedef struct KDTreeBatchOrderKey {
+  uint64_t code;
+  uint co_index;
+} KDTreeBatchOrderKey;
+
+static int kdtree_batch_order_cmp(const void *a_p, const void *b_p)
+{
+  const KDTreeBatchOrderKey *a = a_p;
+  const KDTreeBatchOrderKey *b = b_p;
+  if (a->code != b->code) {
+    return (a->code < b->code) ? -1 : 1;
+  }
+  return (a->co_index < b->co_index) ? -1 : (a->co_index > b->co_index);
+}
+
+/**
+ * \return The order to run queries for \a co_array in, or null when the batch is too small for
+ * reordering to be worth it.
+ */
+static uint *kdtree_batch_order(const float (*co_array)[KD_DIMS], const uint co_len)
+{
+  /* Bits of the Morton code for every axis. */
+  const uint axis_bits = 64 / KD_DIMS < 21 ? 64 / KD_DIMS : 21;
+
+  if (co_len < KD_BATCH_ORDER_THRESHOLD) {
+    return NULL;
+  }
+
+  float min[KD_DIMS], max[KD_DIMS], scale[KD_DIMS];
+  copy_vn_vn(min, co_array[0]);
+  copy_vn_vn(max, co_array[0]);
+  for (uint i = 1; i < co_len; i++) {
+    for (uint j = 0; j < KD_DIMS; j++) {
+      min[j] = min_ff(min[j], co_array[i][j]);
+      max[j] = max_ff(max[j], co_array[i][j]);
+    }
+  }
+  const float cells_max = (float)((1u << axis_bits) - 1);
+  for (uint j = 0; j < KD_DIMS; j++) {
+    scale[j] = (max[j] > min[j]) ? cells_max / (max[j] - min[j]) : 0.0f;
+  }
+
+  KDTreeBatchOrderKey *keys = MEM_mallocN(sizeof(*keys) * co_len, __func__);
+  for (uint i = 0; i < co_len; i++) {
+    uint64_t code = 0;
+    for (uint j = 0; j < KD_DIMS; j++) {
+      const uint64_t cell = (uint64_t)((co_array[i][j] - min[j]) * scale[j]);
+      for (uint bit = 0; bit < axis_bits; bit++) {
+        code |= ((cell >> bit) & 1) << (bit * KD_DIMS + j);
+      }
+    }
+    keys[i].code = code;
+    keys[i].co_index = i;
+  }
+  qsort(keys, co_len, sizeof(*keys), kdtree_batch_order_cmp);
+
+  uint *order = MEM_mallocN(sizeof(uint) * co_len, __func__);
+  for (uint i = 0; i < co_len; i++) {
+    order[i] = keys[i].co_index;
+  }
+  MEM_freeN(keys);
+  return order;
+}
+
+typedef struct KDTreeBatchNearestData {
+  const KDTree *tree;
+  const float (*co_array)[KD_DIMS];
+  const uint *order;
+  KDTreeNearest *r_nearest;
+  uint nearest_len_capacity;
+  int *r_nearest_len;
+} KDTreeBatchNearestData;
+
+static void kdtree_batch_find_nearest_n_fn(void *__restrict userdata,
+                                           const int order_index,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchNearestData *data = userdata;
+  const int i = data->order ? (int)data->order[order_index] : order_index;
+  const int nearest_len = BLI_kdtree_nd_(find_nearest_n)(
+      data->tree,
+      data->co_array[i],
+      &data->r_nearest[(size_t)i * data->nearest_len_capacity],
+      data->nearest_len_capacity);
+  if (data->r_nearest_len) {
+    data->r_nearest_len[i] = nearest_len;
+  }
+}
+
+/**
+ * Run #BLI_kdtree_3d_find_nearest_n for every coordinate in \a co_array, in parallel.
+ *
+ * \param r_nearest: An array sized `co_len * nearest_len_capacity`,
+ * the results for `co_array[i]` start at `r_nearest[i * nearest_len_capacity]`.
+ * \param r_nearest_len: Optional array sized \a co_len, the number of points found for
+ * each coordinate.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co_array)[KD_DIMS],
+                                          const uint co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  KDTreeBatchNearestData data = {
+      .tree = tree,
+      .co_array = co_array,
+      .order = kdtree_batch_order(co_array, co_len),
+      .r_nearest = r_nearest,
+      .nearest_len_capacity = nearest_len_capacity,
+      .r_nearest_len = r_nearest_len,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = KD_BATCH_QUERY_GRAIN_SIZE;
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_batch_find_nearest_n_fn, &settings);
+
+  MEM_SAFE_FREE(data.order);
+}
+
+typedef struct KDTreeBatchRangeData {
+  const KDTree *tree;
+  const float (*co_array)[KD_DIMS];
+  const uint *order;
+  float range;
+  bool (*search_cb)(
+      void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq);
+  void *user_data;
+} KDTreeBatchRangeData;
+
+typedef struct KDTreeBatchRangeQuery {
+  const KDTreeBatchRangeData *data;
+  int co_index;
+} KDTreeBatchRangeQuery;
+
+static bool kdtree_batch_range_search_cb(void *user_data,
+                                         const int index,
+                                         const float co[KD_DIMS],
+                                         const float dist_sq)
+{
+  const KDTreeBatchRangeQuery *query = user_data;
+  return query->data->search_cb(query->data->user_data, query->co_index, index, co, dist_sq);
+}
+
+static void kdtree_batch_range_search_fn(void *__restrict userdata,
+                                         const int order_index,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchRangeData *data = userdata;
+  const int i = data->order ? (int)data->order[order_index] : order_index;
+  KDTreeBatchRangeQuery query = {data, i};
+  BLI_kdtree_nd_(range_search_cb)(
+      data->tree, data->co_array[i], data->range, kdtree_batch_range_search_cb, &query);
+}
+
+/**
+ * Run #BLI_kdtree_3d_range_search_cb for every coordinate in \a co_array, in parallel.
+ *
+ * \param search_cb: Called for every node found in \a range of `co_array[co_index]`,
+ * false return value stops the search for that coordinate.
+ * It is called from multiple threads, but all calls for the same \a co_index are made
+ * from the same thread.
+ */
+void BLI_kdtree_nd_(range_search_batch_cb)(
+    const KDTree *tree,
+    const float (*co_array)[KD_DIMS],
+    const uint co_len,
+    const float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  KDTreeBatchRangeData data = {
+      .tree = tree,
+      .co_array = co_array,
+      .order = kdtree_batch_order(co_array, co_len),
+      .range = range,
+      .search_cb = search_cb,
+      .user_data = user_data,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = KD_BATCH_QUERY_GRAIN_SIZE;
+  BLI_task_parallel_range(0, (int)co_len, &data, kdtree_batch_range_search_fn, &settings);
+
+  MEM_SAFE_FREE(data.order);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
@@ -816,6 +1104,32 @@ static int *kdtree_order(const KDTree *tree)
   return order;
 }
 
+/**
+ * Node indices in the order of a left to right (in-order) traversal of the tree.
+ * Unlike the order nodes are stored in, this only depends on the coordinates of the nodes.
+ */
+static uint *kdtree_order_in_tree(const KDTree *tree)
+{
+  const KDTreeNode *nodes = tree->nodes;
+  uint *order = MEM_mallocN(sizeof(uint) * tree->nodes_len, __func__);
+  /* Splitting at the median limits the depth of the tree to the number of bits of #uint. */
+  uint stack[sizeof(uint) * 8];
+  uint order_len = 0, stack_len = 0;
+  uint node_index = tree->root;
+  while (node_index != KD_NODE_UNSET || stack_len != 0) {
+    while (node_index != KD_NODE_UNSET) {
+      BLI_assert(stack_len < ARRAY_SIZE(stack));
+      stack[stack_len++] = node_index;
+      node_index = nodes[node_index].left;
+    }
+    node_index = stack[--stack_len];
+    order[order_len++] = node_index;
+    node_index = nodes[node_index].right;
+  }
+  BLI_assert(order_len == tree->nodes_len);
+  return order;
+}
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_kdtree_3d_calc_duplicates_fast
  * \{ */
@@ -823,10 +1137,17 @@ static int *kdtree_order(const KDTree *tree)
 struct DeDuplicateParams {
   /* Static */
   const KDTreeNode *nodes;
+  uint root;
   float range;
   float range_sq;
   int *duplicates;
   int *duplicates_found;
+  /**
+   * Optional, nodes in range of the nodes of the current chunk, #KD_DUPLICATES_NEIGHBORS_MAX per
+   * node (see #deduplicate_neighbors_gather).
+   */
+  const uint *neighbors;
+  const uint *neighbors_len;
 
   /* Per Search */
   float search_co[KD_DIMS];
@@ -862,6 +1183,122 @@ static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
   }
 }
 
+/**
+ * Collect the nodes in range of \a search_co in the same order as #deduplicate_recursive tests
+ * them. Stops when there are more than #KD_DUPLICATES_NEIGHBORS_MAX, \a r_neighbors_len is set
+ * to #KD_DUPLICATES_NEIGHBORS_OVERFLOW then.
+ * \return False when the search was stopped.
+ */
+static bool deduplicate_gather_recursive(const struct DeDuplicateParams *p,
+                                         const float search_co[KD_DIMS],
+                                         uint i,
+                                         uint *r_neighbors,
+                                         uint *r_neighbors_len)
+{
+  const KDTreeNode *node = &p->nodes[i];
+  if (search_co[node->d] + p->range <= node->co[node->d]) {
+    if (node->left != KD_NODE_UNSET) {
+      return deduplicate_gather_recursive(p, search_co, node->left, r_neighbors, r_neighbors_len);
+    }
+    return true;
+  }
+  if (search_co[node->d] - p->range >= node->co[node->d]) {
+    if (node->right != KD_NODE_UNSET) {
+      return deduplicate_gather_recursive(
+          p, search_co, node->right, r_neighbors, r_neighbors_len);
+    }
+    return true;
+  }
+  if (len_squared_vnvn(node->co, search_co) <= p->range_sq) {
+    if (*r_neighbors_len == KD_DUPLICATES_NEIGHBORS_MAX) {
+      *r_neighbors_len = KD_DUPLICATES_NEIGHBORS_OVERFLOW;
+      return false;
+    }
+    r_neighbors[*r_neighbors_len] = i;
+    *r_neighbors_len += 1;
+  }
+  if (node->left != KD_NODE_UNSET) {
+    if (!deduplicate_gather_recursive(p, search_co, node->left, r_neighbors, r_neighbors_len)) {
+      return false;
+    }
+  }
+  if (node->right != KD_NODE_UNSET) {
+    return deduplicate_gather_recursive(p, search_co, node->right, r_neighbors, r_neighbors_len);
+  }
+  return true;
+}
+
+typedef struct DeDuplicateGatherData {
+  const struct DeDuplicateParams *p;
+  /** Node indices of the current chunk. */
+  const uint *chunk_nodes;
+  uint *neighbors;
+  uint *neighbors_len;
+} DeDuplicateGatherData;
+
+static void deduplicate_gather_fn(void *__restrict userdata,
+                                  const int i,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const DeDuplicateGatherData *data = userdata;
+  const struct DeDuplicateParams *p = data->p;
+  const uint node_index = data->chunk_nodes[i];
+  const int index = p->nodes[node_index].index;
+  data->neighbors_len[i] = 0;
+  /* Nodes merged by a previous chunk are skipped when merging. */
+  if (!ELEM(p->duplicates[index], -1, index)) {
+    return;
+  }
+  deduplicate_gather_recursive(p,
+                               p->nodes[node_index].co,
+                               p->root,
+                               &data->neighbors[(size_t)i * KD_DUPLICATES_NEIGHBORS_MAX],
+                               &data->neighbors_len[i]);
+}
+
+/**
+ * Search the nodes in range of all nodes of a chunk in parallel, so the (order dependent) merging
+ * only has to loop over the results. Memory use is bounded by the chunk size.
+ */
+static void deduplicate_neighbors_gather(const struct DeDuplicateParams *p,
+                                         const uint *chunk_nodes,
+                                         const uint chunk_len,
+                                         uint *r_neighbors,
+                                         uint *r_neighbors_len)
+{
+  DeDuplicateGatherData data = {
+      .p = p,
+      .chunk_nodes = chunk_nodes,
+      .neighbors = r_neighbors,
+      .neighbors_len = r_neighbors_len,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = KD_BATCH_QUERY_GRAIN_SIZE;
+  BLI_task_parallel_range(0, (int)chunk_len, &data, deduplicate_gather_fn, &settings);
+}
+
+/**
+ * Search for duplicates of the node with \a p.search as index.
+ * \param chunk_index: Position of the node in the current chunk, when neighbors were gathered.
+ */
+static void deduplicate_search(const struct DeDuplicateParams *p, const uint chunk_index)
+{
+  if (p->neighbors == NULL || p->neighbors_len[chunk_index] == KD_DUPLICATES_NEIGHBORS_OVERFLOW) {
+    deduplicate_recursive(p, p->root);
+    return;
+  }
+  const uint *neighbors = &p->neighbors[(size_t)chunk_index * KD_DUPLICATES_NEIGHBORS_MAX];
+  for (uint i = 0; i < p->neighbors_len[chunk_index]; i++) {
+    const KDTreeNode *node = &p->nodes[neighbors[i]];
+    if ((p->search != node->index) && (p->duplicates[node->index] == -1)) {
+      p->duplicates[node->index] = (int)p->search;
+      *p->duplicates_found += 1;
+    }
+  }
+}
+
 /**
  * Find duplicate points in \a range.
  * Favors speed over quality since it doesn't find the best target vertex for merging.
@@ -888,42 +1325,56 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
   int found = 0;
   struct DeDuplicateParams p = {
       .nodes = tree->nodes,
+      .root = tree->root,
       .range = range,
       .range_sq = square_f(range),
       .duplicates = duplicates,
       .duplicates_found = &found,
   };
 
+  /* Node indices in the order they are merged. */
+  uint *order;
+  uint order_len = 0;
   if (use_index_order) {
-    int *order = kdtree_order(tree);
+    int *index_order = kdtree_order(tree);
+    order = MEM_mallocN(sizeof(uint) * tree->nodes_len, __func__);
     for (int i = 0; i < tree->max_node_index + 1; i++) {
-      const int node_index = order[i];
-      if (node_index == -1) {
-        continue;
-      }
-      const int index = i;
-      if (ELEM(duplicates[index], -1, index)) {
-        p.search = index;
-        copy_vn_vn(p.search_co, tree->nodes[node_index].co);
-        int found_prev = found;
-        deduplicate_recursive(&p, tree->root);
-        if (found != found_prev) {
-          /* Prevent chains of doubles. */
-          duplicates[index] = index;
-        }
+      if (index_order[i] != -1) {
+        order[order_len++] = (uint)index_order[i];
       }
     }
-    MEM_freeN(order);
+    MEM_freeN(index_order);
   }
   else {
-    for (uint i = 0; i < tree->nodes_len; i++) {
-      const uint node_index = i;
+    order = kdtree_order_in_tree(tree);
+    order_len = tree->nodes_len;
+  }
+
+  uint *neighbors = NULL;
+  uint *neighbors_len = NULL;
+  if (tree->nodes_len >= KD_DUPLICATES_PARALLEL_THRESHOLD &&
+      BLI_task_scheduler_num_threads() > 2)
+  {
+    neighbors = MEM_mallocN(
+        sizeof(uint) * KD_DUPLICATES_CHUNK_SIZE * KD_DUPLICATES_NEIGHBORS_MAX, __func__);
+    neighbors_len = MEM_mallocN(sizeof(uint) * KD_DUPLICATES_CHUNK_SIZE, __func__);
+    p.neighbors = neighbors;
+    p.neighbors_len = neighbors_len;
+  }
+
+  for (uint chunk_start = 0; chunk_start < order_len; chunk_start += KD_DUPLICATES_CHUNK_SIZE) {
+    const uint chunk_len = MIN2(order_len - chunk_start, KD_DUPLICATES_CHUNK_SIZE);
+    if (neighbors) {
+      deduplicate_neighbors_gather(&p, &order[chunk_start], chunk_len, neighbors, neighbors_len);
+    }
+    for (uint i = 0; i < chunk_len; i++) {
+      const uint node_index = order[chunk_start + i];
       const int index = p.nodes[node_index].index;
       if (ELEM(duplicates[index], -1, index)) {
         p.search = index;
         copy_vn_vn(p.search_co, tree->nodes[node_index].co);
         int found_prev = found;
-        deduplicate_recursive(&p, tree->root);
+        deduplicate_search(&p, i);
         if (found != found_prev) {
           /* Prevent chains of doubles. */
           duplicates[index] = index;
@@ -931,6 +1382,12 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
       }
     }
   }
+  MEM_freeN(order);
+
+  if (neighbors) {
+    MEM_freeN(neighbors);
+    MEM_freeN(neighbors_len);
+  }
   return found;
 }
 
@@ -13,6 +13,7 @@
 #endif
 
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 
 #include <memory>
 #include <vector>
@@ -81,6 +82,7 @@ struct TaskNode {
 #ifdef WITH_TBB
   tbb::flow::continue_msg run(const tbb::flow::continue_msg /*input*/)
   {
+    blender::threading::trace::Scope trace_scope("node", "task_graph");
     run_func(task_data);
     return tbb::flow::continue_msg();
   }
@@ -88,7 +90,10 @@ struct TaskNode {
 
   void run_serial()
   {
-    run_func(task_data);
+    {
+      blender::threading::trace::Scope trace_scope("node", "task_graph");
+      run_func(task_data);
+    }
     for (TaskNode *successor : successors) {
       successor->run_serial();
     }
@@ -16,8 +16,11 @@
 
 #include "DNA_listBase.h"
 
+#include "BLI_lazy_threading.hh"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 
 #ifdef WITH_TBB
@@ -113,14 +116,22 @@ class Task {
 
 #ifdef WITH_TBB
 class TBBTaskGroup : public tbb::task_group {
+#  if TBB_INTERFACE_VERSION_MAJOR >= 12
+  /** Arena that runs the tasks, null for the default arena. */
+  tbb::task_arena *arena_ = nullptr;
+#  endif
+
  public:
   TBBTaskGroup(eTaskPriority priority)
   {
 #  if TBB_INTERFACE_VERSION_MAJOR >= 12
-    /* TODO: support priorities in TBB 2021, where they are only available as
-     * part of task arenas, no longer for task groups. Or remove support for
-     * task priorities if they are no longer useful. */
-    UNUSED_VARS(priority);
+    /* In TBB 2021 priorities are only available as part of task arenas, no longer for task
+     * groups. High priority pools use the default arena, matching the normal priority that they
+     * had with older TBB versions. */
+    if (priority == TASK_PRIORITY_LOW) {
+      arena_ = blender::threading::detail::task_arena_for_priority(
+          blender::threading::TaskPriority::Low);
+    }
 #  else
     switch (priority) {
       case TASK_PRIORITY_LOW:
@@ -132,6 +143,34 @@ class TBBTaskGroup : public tbb::task_group {
     }
 #  endif
   }
+
+  void run_in_arena(Task &&task)
+  {
+#  if TBB_INTERFACE_VERSION_MAJOR >= 12
+    if (arena_) {
+      /* Entering another arena isolates like #BLI_task_isolate, hints must not cross it. */
+      blender::lazy_threading::ReceiverIsolation isolation;
+      arena_->execute([&]() { this->run(std::move(task)); });
+      return;
+    }
+#  endif
+    this->run(std::move(task));
+  }
+
+  void wait_in_arena()
+  {
+#  if TBB_INTERFACE_VERSION_MAJOR >= 12
+    if (arena_) {
+      /* Same as #blender::threading::execute_with_priority, send the hints before waiting in an
+       * isolated region. */
+      blender::lazy_threading::send_hint();
+      blender::lazy_threading::ReceiverIsolation isolation;
+      arena_->execute([&]() { this->wait(); });
+      return;
+    }
+#  endif
+    this->wait();
+  }
 };
 #endif
 
@@ -168,6 +207,7 @@ struct TaskPool {
 /* Execute task. */
 void Task::operator()() const
 {
+  blender::threading::trace::Scope trace_scope("task", "task_pool");
   run(pool, taskdata);
 }
 
@@ -212,7 +252,7 @@ static void tbb_task_pool_run(TaskPool *pool, Task &&task)
 #ifdef WITH_TBB
   else if (pool->use_threads) {
     /* Execute in TBB task group. */
-    pool->tbb_group.run(std::move(task));
+    pool->tbb_group.run_in_arena(std::move(task));
   }
 #endif
   else {
@@ -241,7 +281,7 @@ static void tbb_task_pool_work_and_wait(TaskPool *pool)
     /* This is called wait(), but internally it can actually do work. This
      * matters because we don't want recursive usage of task pools to run
      * out of threads and get stuck. */
-    pool->tbb_group.wait();
+    pool->tbb_group.wait_in_arena();
   }
 #endif
 }
@@ -251,7 +291,7 @@ static void tbb_task_pool_cancel(TaskPool *pool)
 #ifdef WITH_TBB
   if (pool->use_threads) {
     pool->tbb_group.cancel();
-    pool->tbb_group.wait();
+    pool->tbb_group.wait_in_arena();
   }
 #else
   UNUSED_VARS(pool);
@@ -17,6 +17,7 @@
 #include "BLI_offset_indices.hh"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 #include "BLI_vector.hh"
 
@@ -81,6 +82,7 @@ struct RangeTask {
 
   void operator()(const tbb::blocked_range<int> &r) const
   {
+    blender::threading::trace::Scope trace_scope("parallel_range", "task_range");
     TaskParallelTLS tls;
     tls.userdata_chunk = userdata_chunk;
     for (int i = r.begin(); i != r.end(); ++i) {
@@ -246,13 +248,12 @@ static void parallel_for_impl_accumulated_size_lookup(
       });
 }
 
-void parallel_for_impl(const IndexRange range,
-                       const int64_t grain_size,
-                       const FunctionRef<void(IndexRange)> function,
-                       const TaskSizeHints &size_hints)
-{
 #ifdef WITH_TBB
-  lazy_threading::send_hint();
+static void parallel_for_impl_dispatch(const IndexRange range,
+                                       const int64_t grain_size,
+                                       const FunctionRef<void(IndexRange)> function,
+                                       const TaskSizeHints &size_hints)
+{
   switch (size_hints.type) {
     case TaskSizeHints::Type::Static: {
       const int64_t task_size = static_cast<const detail::TaskSizeHints_Static &>(size_hints).size;
@@ -279,7 +280,28 @@ void parallel_for_impl(const IndexRange range,
       break;
     }
   }
+}
+#endif /* WITH_TBB */
 
+void parallel_for_impl(const IndexRange range,
+                       const int64_t grain_size,
+                       const FunctionRef<void(IndexRange)> function,
+                       const TaskSizeHints &size_hints)
+{
+#ifdef WITH_TBB
+  lazy_threading::send_hint();
+  if (trace::is_enabled()) {
+    parallel_for_impl_dispatch(
+        range,
+        grain_size,
+        [&](const IndexRange sub_range) {
+          trace::Scope trace_scope("parallel_for", "task_range");
+          function(sub_range);
+        },
+        size_hints);
+    return;
+  }
+  parallel_for_impl_dispatch(range, grain_size, function, size_hints);
 #else
   UNUSED_VARS(grain_size, size_hints);
   function(range);
@@ -8,10 +8,14 @@
  * Task scheduler initialization.
  */
 
+#include <memory>
+#include <vector>
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_lazy_threading.hh"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
 
 #ifdef WITH_TBB
@@ -22,6 +26,12 @@
 #    include <tbb/global_control.h>
 #    define WITH_TBB_GLOBAL_CONTROL
 #  endif
+#  if TBB_INTERFACE_VERSION_MAJOR >= 12
+#    include <tbb/info.h>
+#    include <tbb/task_group.h>
+/* Arena priorities and NUMA constraints are available since TBB 2021. */
+#    define WITH_TBB_ARENA_CONSTRAINTS
+#  endif
 #endif
 
 /* Task Scheduler */
@@ -76,3 +86,134 @@ void BLI_task_isolate(void (*func)(void *userdata), void *userdata)
   func(userdata);
 #endif
 }
+
+namespace blender::threading {
+
+#ifdef WITH_TBB_ARENA_CONSTRAINTS
+
+/**
+ * Arenas are created on first use, work that doesn't use priorities or NUMA nodes doesn't pay for
+ * the additional worker thread management.
+ */
+static tbb::task_arena &priority_arena(const TaskPriority priority)
+{
+  static tbb::task_arena low_arena{tbb::task_arena::automatic, 1, tbb::task_arena::priority::low};
+  static tbb::task_arena high_arena{
+      tbb::task_arena::automatic, 1, tbb::task_arena::priority::high};
+  return priority == TaskPriority::Low ? low_arena : high_arena;
+}
+
+/** One arena per NUMA node, empty when there is only a single node. */
+static const std::vector<std::unique_ptr<tbb::task_arena>> &numa_arenas()
+{
+  static const std::vector<std::unique_ptr<tbb::task_arena>> arenas = []() {
+    std::vector<std::unique_ptr<tbb::task_arena>> result;
+    /* Without the `tbbbind` library TBB reports a single node with an invalid id. */
+    const std::vector<tbb::numa_node_id> numa_nodes = tbb::info::numa_nodes();
+    if (numa_nodes.size() > 1) {
+      for (const tbb::numa_node_id numa_node : numa_nodes) {
+        result.push_back(
+            std::make_unique<tbb::task_arena>(tbb::task_arena::constraints(numa_node)));
+      }
+    }
+    return result;
+  }();
+  return arenas;
+}
+
+#endif
+
+namespace detail {
+
+#ifdef WITH_TBB
+tbb::task_arena *task_arena_for_priority(const TaskPriority priority)
+{
+#  ifdef WITH_TBB_ARENA_CONSTRAINTS
+  if (priority != TaskPriority::Normal && BLI_task_scheduler_num_threads() > 1) {
+    return &priority_arena(priority);
+  }
+#  else
+  UNUSED_VARS(priority);
+#  endif
+  return nullptr;
+}
+#endif
+
+void parallel_for_numa_impl(const IndexRange range,
+                            const int64_t grain_size,
+                            const FunctionRef<void(IndexRange)> function)
+{
+  const int nodes_num = numa_nodes_num();
+  if (nodes_num == 1) {
+    parallel_for(range, grain_size, function);
+    return;
+  }
+#ifdef WITH_TBB_ARENA_CONSTRAINTS
+  const std::vector<std::unique_ptr<tbb::task_arena>> &arenas = numa_arenas();
+  lazy_threading::send_hint();
+  lazy_threading::ReceiverIsolation isolation;
+
+  /* Start the work on all nodes before waiting, each node has its own worker threads. */
+  std::vector<tbb::task_group> task_groups(nodes_num);
+  for (const int node : IndexRange(nodes_num)) {
+    const int64_t begin = range.start() + range.size() * node / nodes_num;
+    const int64_t end = range.start() + range.size() * (node + 1) / nodes_num;
+    const IndexRange node_range = IndexRange::from_begin_end(begin, end);
+    arenas[node]->execute([&]() {
+      task_groups[node].run([node_range, grain_size, function]() {
+        parallel_for(node_range, grain_size, function);
+      });
+    });
+  }
+  for (const int node : IndexRange(nodes_num)) {
+    arenas[node]->execute([&]() { task_groups[node].wait(); });
+  }
+#endif
+}
+
+}  // namespace detail
+
+void execute_with_priority(const TaskPriority priority, const FunctionRef<void()> function)
+{
+#ifdef WITH_TBB
+  tbb::task_arena *arena = detail::task_arena_for_priority(priority);
+  if (arena == nullptr) {
+    function();
+    return;
+  }
+  /* Make sure the lazy threading hints are send now, because they shouldn't be send out of an
+   * isolated region. */
+  lazy_threading::send_hint();
+  lazy_threading::ReceiverIsolation isolation;
+  arena->execute(function);
+#else
+  UNUSED_VARS(priority);
+  function();
+#endif
+}
+
+int numa_nodes_num()
+{
+#ifdef WITH_TBB_ARENA_CONSTRAINTS
+  if (BLI_task_scheduler_num_threads() > 1) {
+    return std::max(int(numa_arenas().size()), 1);
+  }
+#endif
+  return 1;
+}
+
+void execute_on_numa_node(const int numa_node, const FunctionRef<void()> function)
+{
+  BLI_assert(numa_node >= 0 && numa_node < numa_nodes_num());
+  if (numa_nodes_num() == 1) {
+    function();
+    return;
+  }
+#ifdef WITH_TBB_ARENA_CONSTRAINTS
+  lazy_threading::send_hint();
+  lazy_threading::ReceiverIsolation isolation;
+  numa_arenas()[numa_node]->execute(function);
+#endif
+}
+
+}  // namespace blender::threading
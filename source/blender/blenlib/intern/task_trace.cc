@@ -0,0 +1,227 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup bli
+ *
+ * Recording of task scopes, written in the Chrome trace event format.
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BLI_fileops.hh"
+#include "BLI_string.h"
+#include "BLI_task_trace.hh"
+#include "BLI_threads.h"
+
+namespace blender::threading::trace {
+
+namespace detail {
+std::atomic<bool> is_enabled = false;
+}
+
+struct Event {
+  std::string name;
+  const char *category;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+/** Events recorded by a single thread. */
+struct ThreadEvents {
+  /** Only contended while the trace is written or cleared. */
+  std::mutex mutex;
+  std::vector<Event> events;
+  int thread_index;
+  bool is_main_thread;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadEvents>> threads;
+  std::string filepath;
+  int64_t start_ns = 0;
+};
+
+/**
+ * Never freed, because threads that are not stopped before exit may still record events during
+ * destruction of static variables.
+ */
+static Registry &registry()
+{
+  static Registry *instance = new Registry();
+  return *instance;
+}
+
+/** Trivially destructible, so it's safe to use from threads that are being destructed. */
+static thread_local ThreadEvents *thread_events = nullptr;
+
+static ThreadEvents &ensure_thread_events()
+{
+  if (thread_events) {
+    return *thread_events;
+  }
+  Registry &reg = registry();
+  std::lock_guard lock{reg.mutex};
+  std::unique_ptr<ThreadEvents> events = std::make_unique<ThreadEvents>();
+  events->thread_index = int(reg.threads.size());
+  events->is_main_thread = BLI_thread_is_main();
+  thread_events = events.get();
+  reg.threads.push_back(std::move(events));
+  return *thread_events;
+}
+
+namespace detail {
+
+int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void record_scope(std::string &&name, const char *category, const int64_t start_ns)
+{
+  const int64_t end_ns = now_ns();
+  ThreadEvents &events = ensure_thread_events();
+  std::lock_guard lock{events.mutex};
+  events.events.push_back({std::move(name), category, start_ns, end_ns});
+}
+
+}  // namespace detail
+
+static void clear_events(Registry &reg)
+{
+  for (std::unique_ptr<ThreadEvents> &events : reg.threads) {
+    std::lock_guard lock{events->mutex};
+    events->events.clear();
+    events->events.shrink_to_fit();
+  }
+}
+
+bool start(const StringRefNull filepath)
+{
+  Registry &reg = registry();
+  std::lock_guard lock{reg.mutex};
+  if (detail::is_enabled) {
+    return false;
+  }
+  clear_events(reg);
+  reg.filepath = filepath;
+  reg.start_ns = detail::now_ns();
+  detail::is_enabled = true;
+  return true;
+}
+
+std::string filepath()
+{
+  Registry &reg = registry();
+  std::lock_guard lock{reg.mutex};
+  return detail::is_enabled ? reg.filepath : std::string();
+}
+
+static void write_json_string(std::ostream &stream, const StringRef str)
+{
+  stream << '"';
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        stream << "\\\"";
+        break;
+      case '\\':
+        stream << "\\\\";
+        break;
+      default:
+        if (uint8_t(c) < 0x20) {
+          char buf[8];
+          SNPRINTF(buf, "\\u%04x", int(c));
+          stream << buf;
+        }
+        else {
+          stream << c;
+        }
+        break;
+    }
+  }
+  stream << '"';
+}
+
+/** Chrome traces use microseconds. */
+static void write_json_time(std::ostream &stream, const int64_t ns)
+{
+  char buf[32];
+  SNPRINTF(buf, "%" PRId64 ".%03d", ns / 1000, int(ns % 1000));
+  stream << buf;
+}
+
+static void write_trace(std::ostream &stream, Registry &reg)
+{
+  stream << "{\"traceEvents\":[\n";
+  bool first = true;
+  auto separator = [&]() {
+    if (!first) {
+      stream << ",\n";
+    }
+    first = false;
+  };
+
+  for (std::unique_ptr<ThreadEvents> &events : reg.threads) {
+    std::lock_guard lock{events->mutex};
+    if (events->events.empty()) {
+      continue;
+    }
+    separator();
+    const std::string thread_name = events->is_main_thread ?
+                                        "Main" :
+                                        "Thread " + std::to_string(events->thread_index);
+    stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << events->thread_index
+           << ",\"args\":{\"name\":";
+    write_json_string(stream, thread_name);
+    stream << "}}";
+
+    for (const Event &event : events->events) {
+      /* Scopes that started before the trace. */
+      if (event.start_ns < reg.start_ns) {
+        continue;
+      }
+      separator();
+      stream << "{\"name\":";
+      write_json_string(stream, event.name);
+      stream << ",\"cat\":";
+      write_json_string(stream, event.category);
+      stream << ",\"ph\":\"X\",\"ts\":";
+      write_json_time(stream, event.start_ns - reg.start_ns);
+      stream << ",\"dur\":";
+      write_json_time(stream, event.end_ns - event.start_ns);
+      stream << ",\"pid\":1,\"tid\":" << events->thread_index << "}";
+    }
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool stop()
+{
+  Registry &reg = registry();
+  std::lock_guard lock{reg.mutex};
+  if (!detail::is_enabled) {
+    return false;
+  }
+  detail::is_enabled = false;
+
+  bool success = false;
+  blender::fstream stream(reg.filepath, std::ios::out | std::ios::trunc);
+  if (stream.is_open()) {
+    write_trace(stream, reg);
+    stream.close();
+    success = !stream.fail();
+  }
+  clear_events(reg);
+  return success;
+}
+
+}  // namespace blender::threading::trace
@@ -790,6 +790,16 @@ TEST(array_store, TestChunk_Rand31_Stride11_Chunk21)
   random_chunk_mutate_helper(31, 100, 11, 21, 7117);
 }
 
+/* Large enough to be hashed and searched using multiple threads. */
+TEST(array_store, TestChunk_Rand2048_Stride1_Chunk64)
+{
+  random_chunk_mutate_helper(2048, 10, 1, 64, 3112);
+}
+TEST(array_store, TestChunk_Rand1024_Stride12_Chunk48)
+{
+  random_chunk_mutate_helper(1024, 10, 12, 48, 1001);
+}
+
 #if 0
 /* -------------------------------------------------------------------- */
 
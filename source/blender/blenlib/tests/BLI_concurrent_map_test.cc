@@ -0,0 +1,204 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include <mutex>
+#include <string>
+
+#include "testing/testing.h"
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_map.hh"
+#include "BLI_task.hh"
+#include "BLI_timeit.hh"
+
+#ifdef WITH_TBB
+#  include <tbb/concurrent_hash_map.h>
+#endif
+
+#include "BLI_strict_flags.h" /* Keep last. */
+
+namespace blender::tests {
+
+TEST(concurrent_map, DefaultConstructor)
+{
+  ConcurrentMap<int, float> map;
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_FALSE(map.contains(0));
+}
+
+TEST(concurrent_map, AddLookup)
+{
+  ConcurrentMap<int, float> map(10);
+  EXPECT_GE(map.capacity(), 10);
+  EXPECT_TRUE(map.add(2, 5.0f));
+  EXPECT_TRUE(map.add(3, 6.0f));
+  EXPECT_FALSE(map.add(2, 7.0f));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_TRUE(map.contains(2));
+  EXPECT_FALSE(map.contains(4));
+  EXPECT_EQ(*map.lookup_ptr(2), 5.0f);
+  EXPECT_EQ(*map.lookup_ptr(3), 6.0f);
+  EXPECT_EQ(map.lookup_ptr(4), nullptr);
+  EXPECT_EQ(map.lookup_default(4, 1.0f), 1.0f);
+}
+
+TEST(concurrent_map, LookupOrAdd)
+{
+  ConcurrentMap<std::string, int> map(10);
+  int calls = 0;
+  auto create_value = [&]() {
+    calls++;
+    return 10;
+  };
+  EXPECT_EQ(map.lookup_or_add_cb("a", create_value), 10);
+  map.lookup_or_add_cb("a", create_value) += 5;
+  EXPECT_EQ(map.lookup_or_add_cb("a", create_value), 15);
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(map.lookup_or_add_default("b"), 0);
+  EXPECT_EQ(map.size(), 2);
+}
+
+TEST(concurrent_map, ReserveKeepsItems)
+{
+  ConcurrentMap<int, int> map(4);
+  for (int i = 0; i < 4; i++) {
+    map.add(i, i * 2);
+  }
+  map.reserve(1000);
+  EXPECT_GE(map.capacity(), 1000);
+  EXPECT_EQ(map.size(), 4);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(*map.lookup_ptr(i), i * 2);
+  }
+}
+
+TEST(concurrent_map, Clear)
+{
+  ConcurrentMap<int, std::string> map(100);
+  map.add(1, "a");
+  map.add(2, "b");
+  const int64_t capacity = map.capacity();
+  map.clear();
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_FALSE(map.contains(1));
+  EXPECT_EQ(map.capacity(), capacity);
+  map.add(1, "c");
+  EXPECT_EQ(*map.lookup_ptr(1), "c");
+}
+
+TEST(concurrent_map, ForeachItem)
+{
+  ConcurrentMap<int, int> map(10);
+  map.add(1, 10);
+  map.add(2, 20);
+  map.add(3, 30);
+  int key_sum = 0;
+  int value_sum = 0;
+  map.foreach_item([&](const int key, const int value) {
+    key_sum += key;
+    value_sum += value;
+  });
+  EXPECT_EQ(key_sum, 6);
+  EXPECT_EQ(value_sum, 60);
+}
+
+TEST(concurrent_map, ParallelAdd)
+{
+  const int keys_num = 100000;
+  ConcurrentMap<int, int> map(keys_num);
+  std::atomic<int> added_num = 0;
+  /* Every key is added by multiple tasks, but only one of them succeeds. */
+  threading::parallel_for(IndexRange(keys_num * 4), 512, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const int key = int(i % keys_num);
+      if (map.add(key, key + 1)) {
+        added_num++;
+      }
+    }
+  });
+  EXPECT_EQ(added_num, keys_num);
+  EXPECT_EQ(map.size(), keys_num);
+  threading::parallel_for(IndexRange(keys_num), 512, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      EXPECT_EQ(map.lookup_default(int(i), 0), i + 1);
+    }
+  });
+  EXPECT_FALSE(map.contains(keys_num));
+}
+
+TEST(concurrent_map, ParallelLookupOrAdd)
+{
+  const int keys_num = 1000;
+  ConcurrentMap<int, int> map(keys_num);
+  std::atomic<int> create_num = 0;
+  threading::parallel_for(IndexRange(keys_num * 10), 64, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      const int value = map.lookup_or_add_cb(int(i % keys_num),
+                                             [&]() { return create_num++; });
+      EXPECT_LT(value, keys_num);
+    }
+  });
+  /* The value of every key is only created once. */
+  EXPECT_EQ(create_num, keys_num);
+  EXPECT_EQ(map.size(), keys_num);
+}
+
+/**
+ * Set this to 1 to activate the benchmark. It is disabled by default, because it prints a lot.
+ */
+#if 0
+static void benchmark_add(const StringRef name,
+                          const int keys_num,
+                          const FunctionRef<void(IndexRange range)> fn)
+{
+  SCOPED_TIMER(name);
+  /* Every key is added twice, to also measure looking up existing keys. */
+  threading::parallel_for(IndexRange(keys_num * 2), 4096, fn);
+}
+
+/**
+ * The benchmark is only meaningful with many threads: with a single thread the mutex is never
+ * contended, and the map with a mutex is about as fast as #ConcurrentMap.
+ */
+TEST(concurrent_map, Benchmark)
+{
+  const int keys_num = 10000000;
+  std::cout << "Threads: " << BLI_task_scheduler_num_threads() << "\n";
+  for (int run = 0; run < 3; run++) {
+    {
+      ConcurrentMap<int, int> map(keys_num);
+      benchmark_add("blender::ConcurrentMap      ", keys_num, [&](const IndexRange range) {
+        for (const int64_t i : range) {
+          map.add(int(i % keys_num * 3), int(i));
+        }
+      });
+    }
+#  ifdef WITH_TBB
+    {
+      tbb::concurrent_hash_map<int, int> map(keys_num);
+      benchmark_add("tbb::concurrent_hash_map    ", keys_num, [&](const IndexRange range) {
+        for (const int64_t i : range) {
+          map.insert({int(i % keys_num * 3), int(i)});
+        }
+      });
+    }
+#  endif
+    {
+      std::mutex mutex;
+      Map<int, int> map;
+      map.reserve(keys_num);
+      benchmark_add("blender::Map with mutex     ", keys_num, [&](const IndexRange range) {
+        for (const int64_t i : range) {
+          std::lock_guard lock{mutex};
+          map.add(int(i % keys_num * 3), int(i));
+        }
+      });
+    }
+  }
+}
+
+#endif /* Benchmark */
+
+}  // namespace blender::tests
@@ -0,0 +1,81 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include <string>
+
+#include "testing/testing.h"
+
+#include "BLI_concurrent_set.hh"
+#include "BLI_task.hh"
+
+#include "BLI_strict_flags.h" /* Keep last. */
+
+namespace blender::tests {
+
+TEST(concurrent_set, DefaultConstructor)
+{
+  ConcurrentSet<int> set;
+  EXPECT_EQ(set.size(), 0);
+  EXPECT_TRUE(set.is_empty());
+  EXPECT_FALSE(set.contains(0));
+}
+
+TEST(concurrent_set, AddContains)
+{
+  ConcurrentSet<std::string> set(10);
+  EXPECT_TRUE(set.add("a"));
+  EXPECT_TRUE(set.add("b"));
+  EXPECT_FALSE(set.add("a"));
+  EXPECT_EQ(set.size(), 2);
+  EXPECT_TRUE(set.contains("a"));
+  EXPECT_FALSE(set.contains("c"));
+  EXPECT_EQ(set.lookup_key_ptr("c"), nullptr);
+  EXPECT_EQ(*set.lookup_key_ptr("b"), "b");
+}
+
+TEST(concurrent_set, LookupKeyOrAdd)
+{
+  ConcurrentSet<std::string> set(10);
+  const std::string &a = set.lookup_key_or_add("a");
+  EXPECT_EQ(&set.lookup_key_or_add("a"), &a);
+  EXPECT_EQ(set.size(), 1);
+}
+
+TEST(concurrent_set, ReserveKeepsKeys)
+{
+  ConcurrentSet<int> set(4);
+  for (int i = 0; i < 4; i++) {
+    set.add(i);
+  }
+  set.reserve(1000);
+  EXPECT_GE(set.capacity(), 1000);
+  EXPECT_EQ(set.size(), 4);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(set.contains(i));
+  }
+  set.clear();
+  EXPECT_TRUE(set.is_empty());
+  EXPECT_FALSE(set.contains(0));
+}
+
+TEST(concurrent_set, ParallelAdd)
+{
+  const int keys_num = 100000;
+  ConcurrentSet<int> set(keys_num);
+  std::atomic<int> added_num = 0;
+  threading::parallel_for(IndexRange(keys_num * 4), 512, [&](const IndexRange range) {
+    for (const int64_t i : range) {
+      if (set.add(int(i % keys_num * 7))) {
+        added_num++;
+      }
+    }
+  });
+  EXPECT_EQ(added_num, keys_num);
+  EXPECT_EQ(set.size(), keys_num);
+  int64_t sum = 0;
+  set.foreach_key([&](const int key) { sum += key; });
+  EXPECT_EQ(sum, int64_t(keys_num) * (keys_num - 1) / 2 * 7);
+}
+
+}  // namespace blender::tests
@@ -8,8 +8,11 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_compiler_attrs.h"
+#include "BLI_index_mask.hh"
 #include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
 #include "BLI_math_vector.h"
 #include "BLI_rand.h"
 
@@ -68,11 +71,17 @@ static void optimal_check_callback(void *userdata,
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(
-    int points_len, float scale, int round, int random_seed, bool optimal = false)
+static void find_nearest_points_test(int points_len,
+                                     float scale,
+                                     int round,
+                                     int random_seed,
+                                     bool optimal = false,
+                                     int balance_flag = 0,
+                                     int tree_type = 8,
+                                     int axis = 8)
 {
   RNG *rng = BLI_rng_new(random_seed);
-  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, axis);
 
   void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
   float(*points)[3] = (float(*)[3])mem;
@@ -81,7 +90,7 @@ static void find_nearest_points_test(
     rng_v3_round(points[i], 3, rng, round, scale);
     BLI_bvhtree_insert(tree, i, points[i], 1);
   }
-  BLI_bvhtree_balance(tree);
+  BLI_bvhtree_balance_ex(tree, balance_flag);
 
   /* first find each point */
   BVHTree_NearestPointCallback callback = optimal ? optimal_check_callback : nullptr;
@@ -134,3 +143,278 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+TEST(kdopbvh, SAHFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BALANCE_SAH);
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BALANCE_SAH, 2, 6);
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BALANCE_SAH, 4, 26);
+}
+TEST(kdopbvh, SAHOptimalFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, true, BVH_BALANCE_SAH);
+  find_nearest_points_test(500, 1.0, 1000, 12, true, BVH_BALANCE_SAH, 4, 6);
+}
+TEST(kdopbvh, FindNearestAxisAligned_500)
+{
+  /* Uses the packed children bounds. */
+  find_nearest_points_test(500, 1.0, 1000, 12, false, 0, 4, 6);
+  find_nearest_points_test(500, 1.0, 1000, 12, true, 0, 2, 6);
+}
+
+static void raycast_tris_callback(void *userdata,
+                                  int index,
+                                  const BVHTreeRay *ray,
+                                  BVHTreeRayHit *hit)
+{
+  const float(*tris)[3][3] = static_cast<const float(*)[3][3]>(userdata);
+  float dist;
+  if (isect_ray_tri_v3(ray->origin, ray->direction, UNPACK3(tris[index]), &dist, nullptr) &&
+      dist < hit->dist)
+  {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+/**
+ * Compare ray-casts on a tree of random triangles with the result of testing all triangles.
+ */
+static void raycast_tris_test(
+    int tris_len, int rays_len, int random_seed, int balance_flag, int tree_type, int axis)
+{
+  RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0, tree_type, axis);
+
+  float(*tris)[3][3] = static_cast<float(*)[3][3]>(
+      MEM_mallocN(sizeof(float[3][3]) * tris_len, __func__));
+  for (int i = 0; i < tris_len; i++) {
+    float center[3], offset[3];
+    rng_v3_round(center, 3, rng, 1000, 10.0f);
+    for (int j = 0; j < 3; j++) {
+      rng_v3_round(offset, 3, rng, 1000, 0.5f);
+      add_v3_v3v3(tris[i][j], center, offset);
+    }
+    BLI_bvhtree_insert(tree, i, &tris[i][0][0], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+
+  for (int i = 0; i < rays_len; i++) {
+    float origin[3], dir[3];
+    rng_v3_round(origin, 3, rng, 1000, 12.0f);
+    BLI_rng_get_float_unit_v3(rng, dir);
+
+    int index_expect = -1;
+    float dist_expect = BVH_RAYCAST_DIST_MAX;
+    for (int j = 0; j < tris_len; j++) {
+      float dist;
+      if (isect_ray_tri_v3(origin, dir, UNPACK3(tris[j]), &dist, nullptr) && dist < dist_expect) {
+        index_expect = j;
+        dist_expect = dist;
+      }
+    }
+
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, origin, dir, 0.0f, &hit, raycast_tris_callback, tris);
+    EXPECT_EQ(hit.index, index_expect);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(tris);
+}
+
+TEST(kdopbvh, RayCast_2000)
+{
+  raycast_tris_test(2000, 500, 123, 0, 4, 6);
+  raycast_tris_test(2000, 500, 123, 0, 2, 26);
+}
+TEST(kdopbvh, SAHRayCast_2000)
+{
+  raycast_tris_test(2000, 500, 123, BVH_BALANCE_SAH, 2, 6);
+  raycast_tris_test(2000, 500, 123, BVH_BALANCE_SAH, 4, 6);
+  raycast_tris_test(2000, 500, 123, BVH_BALANCE_SAH, 8, 8);
+}
+
+static void raycast_batch_test(int tris_len, int rays_len, int random_seed, int balance_flag)
+{
+  using namespace blender;
+  RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0, 4, 6);
+
+  /* Three corners per triangle, as expected by #raycast_tris_callback. */
+  Array<float3> tris(tris_len * 3);
+  for (int i = 0; i < tris_len; i++) {
+    float center[3], offset[3];
+    rng_v3_round(center, 3, rng, 1000, 10.0f);
+    for (int j = 0; j < 3; j++) {
+      rng_v3_round(offset, 3, rng, 1000, 0.5f);
+      add_v3_v3v3(tris[i * 3 + j], center, offset);
+    }
+    BLI_bvhtree_insert(tree, i, tris[i * 3], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+
+  Array<float3> origins(rays_len);
+  Array<float3> directions(rays_len);
+  Array<BVHTreeRayHit> hits(rays_len);
+  for (int i = 0; i < rays_len; i++) {
+    rng_v3_round(origins[i], 3, rng, 1000, 12.0f);
+    BLI_rng_get_float_unit_v3(rng, directions[i]);
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+  /* Skip some rays to check that only the masked indices are used. */
+  IndexMaskMemory memory;
+  const IndexMask mask = IndexMask::from_predicate(
+      IndexRange(rays_len), GrainSize(1024), memory, [](const int i) { return i % 7 != 0; });
+  BLI_bvhtree_ray_cast_batch(
+      *tree, mask, origins, directions, 0.0f, hits, raycast_tris_callback, tris.data());
+
+  for (int i = 0; i < rays_len; i++) {
+    if (!mask.contains(i)) {
+      EXPECT_EQ(hits[i].index, -1);
+      continue;
+    }
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(
+        tree, origins[i], directions[i], 0.0f, &hit, raycast_tris_callback, tris.data());
+    EXPECT_EQ(hits[i].index, hit.index);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, RayCastBatch)
+{
+  raycast_batch_test(2000, 100, 123, 0);
+  raycast_batch_test(2000, 5000, 123, 0);
+  raycast_batch_test(2000, 5000, 123, BVH_BALANCE_SAH);
+}
+
+static void nearest_points_callback(void *userdata,
+                                    int index,
+                                    const float co[3],
+                                    BVHTreeNearest *nearest)
+{
+  const float(*points)[3] = static_cast<const float(*)[3]>(userdata);
+  const float dist_sq = len_squared_v3v3(co, points[index]);
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+    copy_v3_v3(nearest->co, points[index]);
+  }
+}
+
+static void find_nearest_batch_test(int points_len, int queries_len, int random_seed, int flag)
+{
+  using namespace blender;
+  RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+
+  Array<float3> points(points_len);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  Array<float3> positions(queries_len);
+  Array<BVHTreeNearest> nearest(queries_len);
+  for (int i = 0; i < queries_len; i++) {
+    rng_v3_round(positions[i], 3, rng, 1000, 1.5f);
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+  }
+  BLI_bvhtree_find_nearest_batch(*tree,
+                                 IndexRange(queries_len),
+                                 positions,
+                                 nearest,
+                                 nearest_points_callback,
+                                 points.data(),
+                                 flag);
+
+  for (int i = 0; i < queries_len; i++) {
+    BVHTreeNearest expect;
+    expect.index = -1;
+    expect.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest_ex(
+        tree, positions[i], &expect, nearest_points_callback, points.data(), flag);
+    EXPECT_EQ(nearest[i].index, expect.index);
+    EXPECT_EQ(nearest[i].dist_sq, expect.dist_sq);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, FindNearestBatch)
+{
+  find_nearest_batch_test(500, 100, 12, 0);
+  find_nearest_batch_test(500, 5000, 12, 0);
+  find_nearest_batch_test(500, 5000, 12, BVH_NEAREST_OPTIMAL_ORDER);
+}
+
+static void update_tree_test(int points_len, int random_seed, int balance_flag)
+{
+  using namespace blender;
+  RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 6);
+
+  Array<float3> points(points_len);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    /* Insert every other point only, to test #BLI_bvhtree_get_leaf_index. */
+    if (i % 2 == 0) {
+      BLI_bvhtree_insert(tree, i, points[i], 1);
+    }
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+  const float cost = BLI_bvhtree_get_cost(tree);
+  EXPECT_GT(cost, 1.0f);
+
+  /* Moving all points by the same amount keeps the quality of the tree. */
+  const int leafs_num = BLI_bvhtree_get_len(tree);
+  for (int leaf = 0; leaf < leafs_num; leaf++) {
+    const int i = BLI_bvhtree_get_leaf_index(tree, leaf);
+    EXPECT_EQ(i, leaf * 2);
+    points[i] += float3(2.0f, 0.0f, 0.0f);
+    BLI_bvhtree_update_node(tree, leaf, points[i], nullptr, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+  EXPECT_NEAR(BLI_bvhtree_get_cost(tree), cost, cost * 1e-4f);
+  for (int i = 0; i < points_len; i += 2) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], nullptr, nullptr, nullptr);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  /* Shuffling the points makes the tree a lot worse, but queries still work. */
+  for (int leaf = 0; leaf < leafs_num; leaf++) {
+    const int i = BLI_bvhtree_get_leaf_index(tree, leaf);
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_update_node(tree, leaf, points[i], nullptr, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+  EXPECT_GT(BLI_bvhtree_get_cost(tree), cost * 2.0f);
+  for (int i = 0; i < points_len; i += 2) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], nullptr, nullptr, nullptr);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, UpdateTree)
+{
+  update_tree_test(2000, 5, 0);
+}
+TEST(kdopbvh, SAHUpdateTree)
+{
+  update_tree_test(2000, 5, BVH_BALANCE_SAH);
+}
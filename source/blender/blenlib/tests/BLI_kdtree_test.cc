@@ -4,7 +4,13 @@
 
 #include "testing/testing.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_math_vector_types.hh"
+#include "BLI_rand.h"
+#include "BLI_vector.hh"
 
 #include <cmath>
 
@@ -63,3 +69,122 @@ TEST(kdtree, Deduplicate)
 {
   deduplicate_test();
 }
+
+/**
+ * Points on a grid with a spacing of 0.01, so a small range finds exact duplicates only.
+ * Large enough for the tree to be balanced and searched in parallel.
+ */
+static blender::Vector<blender::float3> random_grid_points(const int points_len)
+{
+  RNG *rng = BLI_rng_new(1234);
+  blender::Vector<blender::float3> points(points_len);
+  for (blender::float3 &co : points) {
+    for (int j = 0; j < 3; j++) {
+      co[j] = float(int(BLI_rng_get_float(rng) * 30.0f)) * 0.01f;
+    }
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static KDTree_3d *points_kdtree(const blender::Span<blender::float3> points)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(points.size());
+  for (const int i : points.index_range()) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+TEST(kdtree, BalanceLarge)
+{
+  const blender::Vector<blender::float3> points = random_grid_points(50000);
+  KDTree_3d *tree = points_kdtree(points);
+  RNG *rng = BLI_rng_new(4321);
+  for (int i = 0; i < 100; i++) {
+    float co[3];
+    BLI_rng_get_float_unit_v3(rng, co);
+    float dist_sq_expect = FLT_MAX;
+    for (const blender::float3 &point : points) {
+      dist_sq_expect = std::min(dist_sq_expect, len_squared_v3v3(co, point));
+    }
+    KDTreeNearest_3d nearest;
+    EXPECT_NE(BLI_kdtree_3d_find_nearest(tree, co, &nearest), -1);
+    EXPECT_FLOAT_EQ(nearest.dist, std::sqrt(dist_sq_expect));
+  }
+  BLI_rng_free(rng);
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, FindNearestNBatch)
+{
+  const blender::Vector<blender::float3> points = random_grid_points(20000);
+  KDTree_3d *tree = points_kdtree(points);
+  const int nearest_len = 4;
+  blender::Vector<KDTreeNearest_3d> nearest(points.size() * nearest_len);
+  blender::Vector<int> found(points.size());
+  BLI_kdtree_3d_find_nearest_n_batch(tree,
+                                     reinterpret_cast<const float(*)[3]>(points.data()),
+                                     points.size(),
+                                     nearest.data(),
+                                     nearest_len,
+                                     found.data());
+  for (const int i : points.index_range()) {
+    KDTreeNearest_3d expect[nearest_len];
+    EXPECT_EQ(found[i], BLI_kdtree_3d_find_nearest_n(tree, points[i], expect, nearest_len));
+    for (int j = 0; j < found[i]; j++) {
+      EXPECT_EQ(nearest[i * nearest_len + j].dist, expect[j].dist);
+    }
+  }
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  const blender::Vector<blender::float3> points = random_grid_points(20000);
+  KDTree_3d *tree = points_kdtree(points);
+  const float range = 0.015f;
+  blender::Vector<int> found(points.size(), 0);
+  BLI_kdtree_3d_range_search_batch_cb_cpp(
+      tree,
+      reinterpret_cast<const float(*)[3]>(points.data()),
+      points.size(),
+      range,
+      [&](const int co_index, const int /*index*/, const float * /*co*/, float dist_sq) {
+        EXPECT_LE(dist_sq, range * range);
+        found[co_index]++;
+        return true;
+      });
+  for (const int i : points.index_range()) {
+    KDTreeNearest_3d *nearest = nullptr;
+    EXPECT_EQ(found[i], BLI_kdtree_3d_range_search(tree, points[i], &nearest, range));
+    if (nearest) {
+      MEM_freeN(nearest);
+    }
+  }
+  BLI_kdtree_3d_free(tree);
+}
+
+TEST(kdtree, CalcDuplicatesFastLarge)
+{
+  const blender::Vector<blender::float3> points = random_grid_points(20000);
+  KDTree_3d *tree = points_kdtree(points);
+  blender::Vector<int> duplicates(points.size(), -1);
+  const int found = BLI_kdtree_3d_calc_duplicates_fast(tree, 0.001f, true, duplicates.data());
+
+  /* Every point is either kept, or merged into a kept point at the same position. */
+  int found_expect = 0;
+  for (const int i : points.index_range()) {
+    if (duplicates[i] == -1 || duplicates[i] == i) {
+      continue;
+    }
+    found_expect++;
+    EXPECT_EQ(duplicates[duplicates[i]], duplicates[i]);
+    EXPECT_EQ(points[i], points[duplicates[i]]);
+    /* Points are searched in index order, so they are merged into the first point. */
+    EXPECT_LT(duplicates[i], i);
+  }
+  EXPECT_EQ(found, found_expect);
+  BLI_kdtree_3d_free(tree);
+}
@@ -12,10 +12,12 @@
 
 #include "BLI_utildefines.h"
 
+#include "BLI_array.hh"
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_timeit.hh"
 
 #define ITEMS_NUM 10000
 
@@ -245,3 +247,120 @@ TEST(task, ParallelInvoke)
                                       [&]() { counter++; });
   EXPECT_EQ(counter, 6);
 }
+
+static void task_pool_priority_func(TaskPool *__restrict pool, void * /*taskdata*/)
+{
+  std::atomic<int> *counter = static_cast<std::atomic<int> *>(BLI_task_pool_user_data(pool));
+  (*counter)++;
+}
+
+TEST(task, PoolPriority)
+{
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  for (const eTaskPriority priority : {TASK_PRIORITY_LOW, TASK_PRIORITY_HIGH}) {
+    std::atomic<int> counter = 0;
+    TaskPool *pool = BLI_task_pool_create(&counter, priority);
+    for (int i = 0; i < ITEMS_NUM; i++) {
+      BLI_task_pool_push(pool, task_pool_priority_func, nullptr, false, nullptr);
+    }
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+    EXPECT_EQ(counter, ITEMS_NUM);
+  }
+
+  BLI_threadapi_exit();
+}
+
+TEST(task, ExecuteWithPriority)
+{
+  using namespace blender::threading;
+  BLI_task_scheduler_init();
+
+  for (const TaskPriority priority :
+       {TaskPriority::Low, TaskPriority::Normal, TaskPriority::High})
+  {
+    std::atomic<int> counter = 0;
+    execute_with_priority(priority, [&]() {
+      parallel_for(blender::IndexRange(ITEMS_NUM), 16, [&](const blender::IndexRange range) {
+        counter += int(range.size());
+      });
+    });
+    EXPECT_EQ(counter, ITEMS_NUM);
+  }
+}
+
+TEST(task, ParallelForNuma)
+{
+  using namespace blender::threading;
+  BLI_task_scheduler_init();
+
+  const int nodes_num = numa_nodes_num();
+  EXPECT_GE(nodes_num, 1);
+
+  blender::Array<int> data(ITEMS_NUM, 0);
+  parallel_for_numa(data.index_range(), 16, [&](const blender::IndexRange range) {
+    for (const int64_t i : range) {
+      data[i]++;
+    }
+  });
+  for (const int value : data) {
+    EXPECT_EQ(value, 1);
+  }
+
+  std::atomic<int> counter = 0;
+  for (const int node : blender::IndexRange(nodes_num)) {
+    execute_on_numa_node(node, [&]() { counter++; });
+  }
+  EXPECT_EQ(counter, nodes_num);
+}
+
+#if 0
+
+/**
+ * Sum large arrays repeatedly, after initializing them with the same scheduling. Comparing the
+ * timings on a machine with multiple NUMA nodes shows the effect of keeping the memory accesses
+ * local to a node.
+ */
+TEST(task, ParallelForNumaBenchmark)
+{
+  using namespace blender::threading;
+  BLI_task_scheduler_init();
+  std::cout << "NUMA nodes: " << numa_nodes_num() << "\n";
+
+  const int64_t size = 256 * 1024 * 1024;
+  const int64_t grain_size = 64 * 1024;
+  for ([[maybe_unused]] const int iteration : blender::IndexRange(3)) {
+    {
+      blender::Array<float> data(size, blender::NoInitialization());
+      parallel_for(data.index_range(), grain_size, [&](const blender::IndexRange range) {
+        data.as_mutable_span().slice(range).fill(1.0f);
+      });
+      SCOPED_TIMER("parallel_for");
+      for ([[maybe_unused]] const int pass : blender::IndexRange(10)) {
+        parallel_for(data.index_range(), grain_size, [&](const blender::IndexRange range) {
+          for (const int64_t i : range) {
+            data[i] = data[i] * 0.5f + 1.0f;
+          }
+        });
+      }
+    }
+    {
+      blender::Array<float> data(size, blender::NoInitialization());
+      parallel_for_numa(data.index_range(), grain_size, [&](const blender::IndexRange range) {
+        data.as_mutable_span().slice(range).fill(1.0f);
+      });
+      SCOPED_TIMER("parallel_for_numa");
+      for ([[maybe_unused]] const int pass : blender::IndexRange(10)) {
+        parallel_for_numa(data.index_range(), grain_size, [&](const blender::IndexRange range) {
+          for (const int64_t i : range) {
+            data[i] = data[i] * 0.5f + 1.0f;
+          }
+        });
+      }
+    }
+  }
+}
+
+#endif /* Benchmark */
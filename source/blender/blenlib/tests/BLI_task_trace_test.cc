@@ -0,0 +1,77 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0 */
+
+#include "testing/testing.h"
+
+#include <string>
+
+#include "BLI_fileops.hh"
+#include "BLI_path_util.h"
+#include "BLI_system.h"
+#include "BLI_task.hh"
+#include "BLI_task_trace.hh"
+#include "BLI_tempfile.h"
+#include "BLI_threads.h"
+
+#include BLI_SYSTEM_PID_H
+
+namespace blender::threading::trace::tests {
+
+static std::string temp_trace_filepath()
+{
+  char temp_dir[FILE_MAX];
+  BLI_temp_directory_path_get(temp_dir, sizeof(temp_dir));
+  const std::string filename = "blender_test_trace_" + std::to_string(getpid()) + ".json";
+  char filepath[FILE_MAX];
+  BLI_path_join(filepath, sizeof(filepath), temp_dir, filename.c_str());
+  return filepath;
+}
+
+static std::string read_file(const std::string &filepath)
+{
+  blender::fstream stream(filepath, std::ios::in);
+  return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+TEST(task_trace, Disabled)
+{
+  EXPECT_FALSE(is_enabled());
+  EXPECT_FALSE(stop());
+  {
+    Scope scope("not_recorded");
+  }
+  EXPECT_TRUE(filepath().empty());
+}
+
+TEST(task_trace, WriteScopes)
+{
+  BLI_threadapi_init();
+  const std::string trace_filepath = temp_trace_filepath();
+
+  EXPECT_TRUE(start(trace_filepath));
+  EXPECT_TRUE(is_enabled());
+  EXPECT_FALSE(start(trace_filepath));
+  EXPECT_EQ(filepath(), trace_filepath);
+  {
+    Scope scope("outer \"scope\"", "test");
+    threading::parallel_for(IndexRange(1000), 10, [&](const IndexRange range) {
+      Scope inner_scope(std::string("inner_") + std::to_string(range.size()), "test");
+    });
+  }
+  EXPECT_TRUE(stop());
+  EXPECT_FALSE(is_enabled());
+
+  const std::string trace = read_file(trace_filepath);
+  EXPECT_EQ(trace.find("{\"traceEvents\":["), 0);
+  EXPECT_NE(trace.find("\"name\":\"outer \\\"scope\\\"\",\"cat\":\"test\",\"ph\":\"X\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"name\":\"inner_"), std::string::npos);
+  EXPECT_NE(trace.find("\"thread_name\""), std::string::npos);
+  EXPECT_EQ(trace.find("not_recorded"), std::string::npos);
+
+  BLI_delete(trace_filepath.c_str(), false, false);
+  BLI_threadapi_exit();
+}
+
+}  // namespace blender::threading::trace::tests
@@ -58,4 +58,11 @@ enum {
   BLO_CODE_ENDB = BLEND_MAKE_ID('E', 'N', 'D', 'B'),
 };
 
+/**
+ * Magic number of the skippable `Zstd` frame holding a copy of all #BHead headers of a compressed
+ * blend-file (written in front of the seek table). It allows walking the file's block structure
+ * without decompressing the frames the headers are stored in.
+ */
+#define BLEN_ZSTD_BHEAD_INDEX_MAGIC 0x184D2A5B
+
 #define BLEN_THUMB_MEMSIZE_FILE(_x, _y) (sizeof(int) * (2 + (size_t)(_x) * (size_t)(_y)))
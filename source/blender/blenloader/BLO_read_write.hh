@@ -338,7 +338,8 @@ void BLO_read_string(BlendDataReader *reader, const char **ptr_p);
 blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     BlendDataReader *reader,
     const void **ptr_p,
-    blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn);
+    blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn,
+    int64_t trivial_data_size = 0);
 
 /**
  * Check if there is any shared data for the given data pointer. If yes, return the existing
@@ -358,6 +359,28 @@ const blender::ImplicitSharingInfo *BLO_read_shared(
   return shared_data.sharing_info;
 }
 
+/**
+ * Same as #BLO_read_shared, for arrays of trivial data that don't reference any other data and
+ * don't need any processing after being read (besides byte-order correction).
+ *
+ * When the blend-file is memory-mapped (see #G_FLAG_READ_FILE_MAPPED), such an array may directly
+ * reference the mapped file instead of being copied, in which case \a read_fn is not called.
+ *
+ * \param data_size: The expected size of the array in bytes.
+ */
+template<typename T>
+const blender::ImplicitSharingInfo *BLO_read_shared_trivial(
+    BlendDataReader *reader,
+    T **data_ptr,
+    const int64_t data_size,
+    blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn)
+{
+  blender::ImplicitSharingInfoAndData shared_data = blo_read_shared_impl(
+      reader, (const void **)data_ptr, read_fn, data_size);
+  *data_ptr = const_cast<T *>(static_cast<const T *>(shared_data.data));
+  return shared_data.sharing_info;
+}
+
 int BLO_read_fileversion_get(BlendDataReader *reader);
 bool BLO_read_requires_endian_switch(BlendDataReader *reader);
 bool BLO_read_data_is_undo(BlendDataReader *reader);
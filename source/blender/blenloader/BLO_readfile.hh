@@ -4,6 +4,7 @@
 #pragma once
 
 #include "BLI_listbase.h"
+#include "BLI_map.hh"
 #include "BLI_sys_types.h"
 
 /** \file
@@ -87,7 +88,7 @@ struct BlendFileReadWMSetupData {
 };
 
 struct BlendFileReadParams {
-  uint skip_flags : 3; /* #eBLOReadSkip */
+  uint skip_flags : 4; /* #eBLOReadSkip */
   uint is_startup : 1;
   uint is_factory_settings : 1;
 
@@ -95,10 +96,53 @@ struct BlendFileReadParams {
   int undo_direction; /* #eUndoStepDir */
 };
 
+/**
+ * Detailed timings of reading a blend-file, see #BlendFileReadReport.profile.
+ *
+ * Nested phases are included in their parent phase too: e.g. reading data-blocks includes reading
+ * their block headers, which includes reading from the file.
+ */
+struct BlendFileReadProfile {
+  struct Phase {
+    /** In seconds. */
+    double duration = 0.0;
+    /** Number of processed items (blocks, data-blocks, calls...). */
+    int64_t count = 0;
+    int64_t bytes = 0;
+  };
+
+  /** The whole reading process, from the first block header to the final #Main. */
+  Phase whole;
+  /** Reading (and decompressing) data from the files, after their file header. */
+  Phase file_read;
+  /** Reading the block headers of the data of read data-blocks, timed once per data-block. */
+  Phase bhead_parse;
+  /** Reading all data-blocks of the main file (#id_types contains the details). */
+  Phase read_data;
+  /**
+   * Inserting the data of read data-blocks into the map used to remap pointers, timed once per
+   * data-block.
+   */
+  Phase pointer_map;
+  Phase versioning;
+  /** Reading linked data-blocks from libraries. */
+  Phase libraries;
+  Phase lib_link;
+  Phase versioning_after_linking;
+
+  /** Reading of data-blocks (from the main file and libraries), by ID code. */
+  blender::Map<short, Phase> id_types;
+  /** Reading (and decompressing) data from each file, by absolute file path. */
+  blender::Map<std::string, Phase> files;
+};
+
 struct BlendFileReadReport {
   /** General reports handling. */
   ReportList *reports;
 
+  /** When set, detailed timings are gathered while reading. */
+  BlendFileReadProfile *profile = nullptr;
+
   /** Timing information. */
   struct {
     double whole;
@@ -140,6 +184,17 @@ struct BlendFileReadReport {
   LinkNode *resynced_lib_overrides_libraries;
 };
 
+/**
+ * Write \a profile to \a filepath as a single line JSON object (JSON Lines format).
+ * \param blendfile_path: The file the profile was gathered for, stored as `filepath` key.
+ * \param append: Add the profile after the ones already in the file instead of replacing them.
+ * \return Success.
+ */
+bool BLO_read_profile_write_json(const BlendFileReadProfile &profile,
+                                 const char *blendfile_path,
+                                 const char *filepath,
+                                 bool append);
+
 /** Skip reading some data-block types (may want to skip screen data too). */
 enum eBLOReadSkip {
   BLO_READ_SKIP_NONE = 0,
@@ -149,8 +204,15 @@ enum eBLOReadSkip {
   BLO_READ_SKIP_DATA = (1 << 1),
   /** Do not attempt to re-use IDs from old bmain for unchanged ones in case of undo. */
   BLO_READ_SKIP_UNDO_OLD_MAIN = (1 << 2),
+  /**
+   * Only read the active scene, the window-manager, texts registered as Python modules,
+   * data-blocks with a fake user and the data-blocks they use (directly or indirectly). Other
+   * data-blocks are only read when they are referenced by an already read one, like when linking
+   * data-blocks from a library. Sets #Main.is_read_partial.
+   */
+  BLO_READ_SKIP_INACTIVE_DATA = (1 << 3),
 };
-ENUM_OPERATORS(eBLOReadSkip, BLO_READ_SKIP_UNDO_OLD_MAIN)
+ENUM_OPERATORS(eBLOReadSkip, BLO_READ_SKIP_INACTIVE_DATA)
 #define BLO_READ_SKIP_ALL (BLO_READ_SKIP_USERDEF | BLO_READ_SKIP_DATA)
 
 /**
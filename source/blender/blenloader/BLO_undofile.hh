@@ -25,6 +25,12 @@ struct MemFileSharedStorage {
    * Maps the data pointer to the sharing info that it is owned by.
    */
   blender::Map<const void *, const blender::ImplicitSharingInfo *> map;
+  /**
+   * Chunk buffers used by the #MemFile, mapped to the sharing info owning them. Kept separate from
+   * #map, which is looked up with addresses from the written file that might be the same as the
+   * address of a chunk buffer.
+   */
+  blender::Map<const char *, const blender::ImplicitSharingInfo *> chunk_buffers;
 
   ~MemFileSharedStorage();
 };
@@ -34,7 +40,10 @@ struct MemFileChunk {
   const char *buf;
   /** Size in bytes. */
   size_t size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /**
+   * When true, this chunk is identical to the matching chunk in the previous step (used by undo
+   * code to detect unchanged IDs). Buffers are always owned through #MemFile.shared_storage.
+   */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
@@ -51,6 +60,9 @@ struct MemFile {
   /**
    * Some data is not serialized into a new buffer because the undo-step can take ownership of it
    * without making a copy. This is faster and requires less memory.
+   *
+   * Also owns the buffers of #chunks, which are shared with all other #MemFile's containing the
+   * same data.
    */
   MemFileSharedStorage *shared_storage;
 };
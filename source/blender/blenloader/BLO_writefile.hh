@@ -9,6 +9,7 @@
  * \brief external `writefile.cc` function prototypes.
  */
 
+struct BlendFileJournal;
 struct BlendThumbnail;
 struct Main;
 struct MemFile;
@@ -34,6 +35,21 @@ enum eBLO_WritePathRemap {
   BLO_WRITE_PATH_REMAP_ABSOLUTE = 3,
 };
 
+/**
+ * Trade-off between speed and size when writing compressed files (see #G_FILE_COMPRESS).
+ */
+enum eBLO_WriteCompressionProfile {
+  /** Fast compression with a good ratio (default). */
+  BLO_WRITE_COMPRESSION_BALANCED = 0,
+  /** Fastest compression, for when saving time matters more than size. */
+  BLO_WRITE_COMPRESSION_FAST = 1,
+  /**
+   * Slow, strong compression using larger frames,
+   * for files that are stored or transferred rather than saved often.
+   */
+  BLO_WRITE_COMPRESSION_ARCHIVAL = 2,
+};
+
 /** Similar to #BlendFileReadParams. */
 struct BlendFileWriteParams {
   eBLO_WritePathRemap remap_mode;
@@ -42,6 +58,8 @@ struct BlendFileWriteParams {
   /** On write, restore paths after editing them (see #BLO_WRITE_PATH_REMAP_RELATIVE). */
   uint use_save_as_copy : 1;
   uint use_userdef : 1;
+  /** Only used when writing compressed files. */
+  eBLO_WriteCompressionProfile compression_profile;
   const BlendThumbnail *thumb;
 };
 
@@ -54,6 +72,28 @@ extern bool BLO_write_file(Main *mainvar,
                            const BlendFileWriteParams *params,
                            ReportList *reports);
 
+/**
+ * Write \a mainvar into a journal file, only appending the parts of the file that are not in the
+ * journal yet (see `blend_journal.hh`). The journal keeps track of what was written before, it is
+ * meant for files that are written repeatedly, like auto-save.
+ *
+ * \note All of \a mainvar is still serialized and hashed, only writing to disk is reduced.
+ *
+ * \return Success.
+ */
+extern bool BLO_write_file_journal(Main *mainvar,
+                                   const char *filepath,
+                                   int write_flags,
+                                   BlendFileJournal *journal,
+                                   ReportList *reports);
+
+BlendFileJournal *BLO_write_journal_new();
+void BLO_write_journal_free(BlendFileJournal *journal);
+/**
+ * Rewrite the journal file with only the data that is still used, when most of it isn't.
+ */
+void BLO_write_journal_compact(BlendFileJournal *journal);
+
 /**
  * \return Success.
  */
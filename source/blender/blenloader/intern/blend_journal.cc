@@ -0,0 +1,469 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup blenloader
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+#include <xxhash.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+#include "BLI_math_base.h"
+#include "BLI_utildefines.h"
+
+#include "CLG_log.h"
+
+#include "BLO_writefile.hh"
+
+#include "blend_journal.hh"
+
+static CLG_LogRef LOG = {"blo.journal"};
+
+/* -------------------------------------------------------------------- */
+/** \name Journal State
+ * \{ */
+
+BlendJournalChunkKey BlendJournalChunkKey::from_data(const void *data, const size_t size)
+{
+  const XXH128_hash_t hash = XXH3_128bits(data, size);
+  return {hash.low64, hash.high64, size};
+}
+
+uint64_t BlendFileJournal::manifest_data_size() const
+{
+  uint64_t size = 0;
+  for (const BlendJournalChunkKey &key : this->manifest) {
+    size += key.size;
+  }
+  return size;
+}
+
+void BlendFileJournal::reset()
+{
+  this->file_size = 0;
+  this->chunks.clear();
+  this->manifest.clear();
+}
+
+bool blo_journal_magic_check(const char *header, const size_t header_len)
+{
+  return header_len >= BLEND_JOURNAL_MAGIC_LEN &&
+         memcmp(header, BLEND_JOURNAL_MAGIC, BLEND_JOURNAL_MAGIC_LEN) == 0;
+}
+
+bool blo_journal_write(const int file, const void *data, const size_t size)
+{
+  const char *data_ptr = static_cast<const char *>(data);
+  size_t remaining = size;
+  while (remaining > 0) {
+    /* Limit the size of a single write, the size is an `unsigned int` on WIN32. */
+    const size_t write_len = std::min<size_t>(remaining, INT_MAX);
+    const int64_t written = ::write(file, data_ptr, write_len);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (written == 0) {
+      return false;
+    }
+    data_ptr += written;
+    remaining -= size_t(written);
+  }
+  return true;
+}
+
+bool blo_journal_record_write(const int file,
+                              const int32_t code,
+                              const void *data,
+                              const uint64_t size,
+                              uint64_t *r_file_size,
+                              uint64_t *r_data_offset)
+{
+  BlendJournalRecord record{};
+  record.code = code;
+  record.size = size;
+  if (!blo_journal_write(file, &record, sizeof(record)) || !blo_journal_write(file, data, size)) {
+    return false;
+  }
+  if (r_data_offset) {
+    *r_data_offset = *r_file_size + sizeof(record);
+  }
+  *r_file_size += sizeof(record) + size;
+  return true;
+}
+
+bool blo_journal_manifest_write(const int file,
+                                const BlendFileJournal &journal,
+                                uint64_t *r_file_size)
+{
+  blender::Array<BlendJournalChunkRef> refs(journal.manifest.size());
+  for (const int i : journal.manifest.index_range()) {
+    refs[i] = journal.chunks.lookup(journal.manifest[i]);
+  }
+
+  BlendJournalFooter footer;
+  footer.manifest_offset = *r_file_size;
+  memcpy(footer.magic, BLEND_JOURNAL_MAGIC, BLEND_JOURNAL_MAGIC_LEN);
+
+  if (!blo_journal_record_write(file,
+                                BLEND_JOURNAL_RECORD_MANIFEST,
+                                refs.data(),
+                                refs.as_span().size_in_bytes(),
+                                r_file_size,
+                                nullptr))
+  {
+    return false;
+  }
+  if (!blo_journal_write(file, &footer, sizeof(footer))) {
+    return false;
+  }
+  *r_file_size += sizeof(footer);
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Journal API
+ * \{ */
+
+BlendFileJournal *BLO_write_journal_new()
+{
+  return MEM_new<BlendFileJournal>(__func__);
+}
+
+void BLO_write_journal_free(BlendFileJournal *journal)
+{
+  MEM_delete(journal);
+}
+
+/**
+ * Copy the chunks referenced by the last manifest into a new journal file.
+ */
+static bool journal_compact(BlendFileJournal &journal, const char *filepath_tmp)
+{
+  const int file_src = BLI_open(journal.filepath.c_str(), O_BINARY | O_RDONLY, 0);
+  if (file_src == -1) {
+    return false;
+  }
+  const int file_dst = BLI_open(filepath_tmp, O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (file_dst == -1) {
+    close(file_src);
+    return false;
+  }
+
+  blender::Map<BlendJournalChunkKey, BlendJournalChunkRef> chunks;
+  uint64_t file_size = 0;
+  bool ok = blo_journal_write(file_dst, BLEND_JOURNAL_MAGIC, BLEND_JOURNAL_MAGIC_LEN);
+  file_size += BLEND_JOURNAL_MAGIC_LEN;
+
+  blender::Vector<char> buffer;
+  for (const BlendJournalChunkKey &key : journal.manifest) {
+    if (!ok) {
+      break;
+    }
+    if (chunks.contains(key)) {
+      continue;
+    }
+    const BlendJournalChunkRef &ref = journal.chunks.lookup(key);
+    buffer.resize(int64_t(ref.size));
+    if (BLI_lseek(file_src, int64_t(ref.offset), SEEK_SET) == -1 ||
+        BLI_read(file_src, buffer.data(), size_t(ref.size)) != int64_t(ref.size))
+    {
+      ok = false;
+      break;
+    }
+    BlendJournalChunkRef new_ref{0, ref.size};
+    ok = blo_journal_record_write(file_dst,
+                                  BLEND_JOURNAL_RECORD_CHUNK,
+                                  buffer.data(),
+                                  ref.size,
+                                  &file_size,
+                                  &new_ref.offset);
+    chunks.add_new(key, new_ref);
+  }
+
+  if (ok) {
+    std::swap(journal.chunks, chunks);
+    ok = blo_journal_manifest_write(file_dst, journal, &file_size);
+    if (!ok) {
+      std::swap(journal.chunks, chunks);
+    }
+  }
+
+  close(file_src);
+  if (close(file_dst) == -1) {
+    ok = false;
+  }
+  if (ok) {
+    journal.file_size = file_size;
+  }
+  return ok;
+}
+
+void BLO_write_journal_compact(BlendFileJournal *journal)
+{
+  if (journal->file_size == 0) {
+    return;
+  }
+  /* Only compact when most of the file isn't used anymore,
+   * to avoid rewriting large files for little gain. */
+  const uint64_t data_size = journal->manifest_data_size();
+  if (journal->file_size < data_size * 2) {
+    return;
+  }
+
+  const std::string filepath_tmp = journal->filepath + "@";
+  if (!journal_compact(*journal, filepath_tmp.c_str()) ||
+      BLI_rename_overwrite(filepath_tmp.c_str(), journal->filepath.c_str()) != 0)
+  {
+    CLOG_WARN(&LOG, "Failed to compact journal '%s'", journal->filepath.c_str());
+    BLI_delete(filepath_tmp.c_str(), false, false);
+    /* The journal file may not match the state anymore, start over on the next write. */
+    journal->reset();
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Journal Reading
+ * \{ */
+
+struct JournalReader {
+  FileReader reader;
+
+  FileReader *base;
+
+  int chunks_num;
+  /** Chunks of the last complete manifest. */
+  BlendJournalChunkRef *chunks;
+  /** Offset of each chunk in the blend-file stream, followed by the total size. */
+  uint64_t *stream_ofs;
+};
+
+static bool journal_read_exact(FileReader *base, void *buffer, const uint64_t size)
+{
+  return base->read(base, buffer, size_t(size)) == int64_t(size);
+}
+
+/**
+ * Check that a complete manifest record starts at \a offset, returning the number of chunks.
+ */
+static bool journal_manifest_check(FileReader *base,
+                                   const uint64_t offset,
+                                   const uint64_t file_size,
+                                   uint64_t *r_chunks_num)
+{
+  BlendJournalRecord record;
+  if (base->seek(base, off64_t(offset), SEEK_SET) == -1 ||
+      !journal_read_exact(base, &record, sizeof(record)) ||
+      record.code != BLEND_JOURNAL_RECORD_MANIFEST ||
+      record.size % sizeof(BlendJournalChunkRef) != 0)
+  {
+    return false;
+  }
+  const uint64_t footer_offset = offset + sizeof(record) + record.size;
+  if (footer_offset + sizeof(BlendJournalFooter) > file_size) {
+    return false;
+  }
+  BlendJournalFooter footer;
+  if (base->seek(base, off64_t(footer_offset), SEEK_SET) == -1 ||
+      !journal_read_exact(base, &footer, sizeof(footer)) || footer.manifest_offset != offset ||
+      memcmp(footer.magic, BLEND_JOURNAL_MAGIC, BLEND_JOURNAL_MAGIC_LEN) != 0)
+  {
+    return false;
+  }
+  *r_chunks_num = record.size / sizeof(BlendJournalChunkRef);
+  return true;
+}
+
+/**
+ * Find the last complete manifest, either using the footer at the end of the file or,
+ * when the last write was interrupted, by walking over all records.
+ */
+static bool journal_manifest_find(FileReader *base,
+                                  uint64_t *r_manifest_offset,
+                                  uint64_t *r_chunks_num)
+{
+  const off64_t file_size = base->seek(base, 0, SEEK_END);
+  if (file_size < off64_t(BLEND_JOURNAL_MAGIC_LEN + sizeof(BlendJournalFooter))) {
+    return false;
+  }
+
+  BlendJournalFooter footer;
+  if (base->seek(base, file_size - off64_t(sizeof(footer)), SEEK_SET) != -1 &&
+      journal_read_exact(base, &footer, sizeof(footer)) &&
+      journal_manifest_check(base, footer.manifest_offset, uint64_t(file_size), r_chunks_num))
+  {
+    *r_manifest_offset = footer.manifest_offset;
+    return true;
+  }
+
+  bool found = false;
+  uint64_t offset = BLEND_JOURNAL_MAGIC_LEN;
+  BlendJournalRecord record;
+  while (offset + sizeof(record) <= uint64_t(file_size)) {
+    if (base->seek(base, off64_t(offset), SEEK_SET) == -1 ||
+        !journal_read_exact(base, &record, sizeof(record)) ||
+        !ELEM(record.code, BLEND_JOURNAL_RECORD_CHUNK, BLEND_JOURNAL_RECORD_MANIFEST))
+    {
+      break;
+    }
+    uint64_t chunks_num;
+    if (record.code == BLEND_JOURNAL_RECORD_MANIFEST) {
+      if (!journal_manifest_check(base, offset, uint64_t(file_size), &chunks_num)) {
+        break;
+      }
+      *r_manifest_offset = offset;
+      *r_chunks_num = chunks_num;
+      found = true;
+      offset += sizeof(BlendJournalFooter);
+    }
+    offset += sizeof(record) + record.size;
+  }
+  return found;
+}
+
+static int journal_chunk_from_pos(const JournalReader *journal, const uint64_t pos)
+{
+  /* Bisection, see #zstd_frame_from_pos. */
+  int low = 0, high = journal->chunks_num;
+  if (pos >= journal->stream_ofs[journal->chunks_num]) {
+    return -1;
+  }
+  while (low + 1 < high) {
+    const int mid = low + ((high - low) >> 1);
+    if (journal->stream_ofs[mid] <= pos) {
+      low = mid;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static int64_t journal_read(FileReader *reader, void *buffer, size_t size)
+{
+  JournalReader *journal = (JournalReader *)reader;
+  FileReader *base = journal->base;
+
+  const uint64_t end_offset = uint64_t(journal->reader.offset) + size;
+  int64_t read_len = 0;
+  while (uint64_t(journal->reader.offset) < end_offset) {
+    const int chunk = journal_chunk_from_pos(journal, uint64_t(journal->reader.offset));
+    if (chunk < 0) {
+      /* EOF is reached, so return as much as we can. */
+      break;
+    }
+    const uint64_t offset_in_chunk = uint64_t(journal->reader.offset) - journal->stream_ofs[chunk];
+    const uint64_t chunk_read_len = std::min(journal->stream_ofs[chunk + 1], end_offset) -
+                                    uint64_t(journal->reader.offset);
+    if (base->seek(base, off64_t(journal->chunks[chunk].offset + offset_in_chunk), SEEK_SET) ==
+            -1 ||
+        !journal_read_exact(base, static_cast<char *>(buffer) + read_len, chunk_read_len))
+    {
+      break;
+    }
+    read_len += int64_t(chunk_read_len);
+    journal->reader.offset += off64_t(chunk_read_len);
+  }
+  return read_len;
+}
+
+static off64_t journal_seek(FileReader *reader, off64_t offset, int whence)
+{
+  JournalReader *journal = (JournalReader *)reader;
+  const off64_t stream_size = off64_t(journal->stream_ofs[journal->chunks_num]);
+  off64_t new_pos;
+  if (whence == SEEK_SET) {
+    new_pos = offset;
+  }
+  else if (whence == SEEK_END) {
+    new_pos = stream_size + offset;
+  }
+  else {
+    new_pos = journal->reader.offset + offset;
+  }
+
+  if (new_pos < 0 || new_pos > stream_size) {
+    return -1;
+  }
+  journal->reader.offset = new_pos;
+  return journal->reader.offset;
+}
+
+static void journal_close(FileReader *reader)
+{
+  JournalReader *journal = (JournalReader *)reader;
+  MEM_SAFE_FREE(journal->chunks);
+  MEM_SAFE_FREE(journal->stream_ofs);
+  journal->base->close(journal->base);
+  MEM_freeN(journal);
+}
+
+FileReader *blo_journal_filereader_new(FileReader *base)
+{
+  if (base->seek == nullptr) {
+    return nullptr;
+  }
+
+  char magic[BLEND_JOURNAL_MAGIC_LEN];
+  uint64_t manifest_offset, chunks_num;
+  if (base->seek(base, 0, SEEK_SET) == -1 || !journal_read_exact(base, magic, sizeof(magic)) ||
+      !blo_journal_magic_check(magic, sizeof(magic)) ||
+      !journal_manifest_find(base, &manifest_offset, &chunks_num) || chunks_num > INT_MAX)
+  {
+    return nullptr;
+  }
+
+  BlendJournalChunkRef *chunks = static_cast<BlendJournalChunkRef *>(
+      MEM_malloc_arrayN(std::max<size_t>(chunks_num, 1), sizeof(BlendJournalChunkRef), __func__));
+  if (base->seek(base, off64_t(manifest_offset + sizeof(BlendJournalRecord)), SEEK_SET) == -1 ||
+      !journal_read_exact(base, chunks, chunks_num * sizeof(BlendJournalChunkRef)))
+  {
+    MEM_freeN(chunks);
+    return nullptr;
+  }
+
+  JournalReader *journal = static_cast<JournalReader *>(
+      MEM_callocN(sizeof(JournalReader), __func__));
+  journal->base = base;
+  journal->chunks_num = int(chunks_num);
+  journal->chunks = chunks;
+  journal->stream_ofs = static_cast<uint64_t *>(
+      MEM_malloc_arrayN(chunks_num + 1, sizeof(uint64_t), __func__));
+  uint64_t stream_ofs = 0;
+  for (int i = 0; i < journal->chunks_num; i++) {
+    journal->stream_ofs[i] = stream_ofs;
+    stream_ofs += chunks[i].size;
+  }
+  journal->stream_ofs[chunks_num] = stream_ofs;
+
+  journal->reader.read = journal_read;
+  journal->reader.seek = journal_seek;
+  journal->reader.close = journal_close;
+
+  return (FileReader *)journal;
+}
+
+/** \} */
@@ -0,0 +1,126 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#pragma once
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Journal files store a blend-file as chunks identified by their content: writing only appends
+ * the chunks of the blend-file stream that are not stored in the journal yet, followed by a
+ * manifest listing the chunks the blend-file is made of. This is used for auto-saving, so large
+ * scenes where only a few data-blocks changed don't have to be written to disk completely each
+ * time. The whole blend-file is still serialized and hashed on every write, only the amount of
+ * data written to disk is reduced.
+ *
+ * Layout, in native byte order (journals are temporary files, not shared between systems):
+ * - #BLEND_JOURNAL_MAGIC.
+ * - A sequence of records, each starting with a #BlendJournalRecord:
+ *   - #BLEND_JOURNAL_RECORD_CHUNK: followed by `size` bytes of the blend-file stream.
+ *   - #BLEND_JOURNAL_RECORD_MANIFEST: followed by `size` bytes of #BlendJournalChunkRef
+ *     and a #BlendJournalFooter.
+ *
+ * The last complete manifest defines the content of the blend-file. Because existing records are
+ * never modified, an interrupted write leaves the previous content readable.
+ */
+
+#include <string>
+
+#include "BLI_filereader.h"
+#include "BLI_map.hh"
+#include "BLI_vector.hh"
+
+#include "BLO_blend_defs.hh"
+
+#define BLEND_JOURNAL_MAGIC "BLENDJNL"
+#define BLEND_JOURNAL_MAGIC_LEN 8
+
+enum {
+  BLEND_JOURNAL_RECORD_CHUNK = BLEND_MAKE_ID('C', 'H', 'N', 'K'),
+  BLEND_JOURNAL_RECORD_MANIFEST = BLEND_MAKE_ID('M', 'A', 'N', 'I'),
+};
+
+struct BlendJournalRecord {
+  int32_t code;
+  uint32_t _pad;
+  uint64_t size;
+};
+
+/** Location of a chunk's data in the journal file. */
+struct BlendJournalChunkRef {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct BlendJournalFooter {
+  /** Offset of the #BlendJournalRecord of the manifest. */
+  uint64_t manifest_offset;
+  char magic[BLEND_JOURNAL_MAGIC_LEN];
+};
+
+/** Identifies chunks by their content. */
+struct BlendJournalChunkKey {
+  uint64_t hash_low;
+  uint64_t hash_high;
+  uint64_t size;
+
+  static BlendJournalChunkKey from_data(const void *data, size_t size);
+
+  uint64_t hash() const
+  {
+    return hash_low;
+  }
+
+  friend bool operator==(const BlendJournalChunkKey &a, const BlendJournalChunkKey &b)
+  {
+    return a.hash_low == b.hash_low && a.hash_high == b.hash_high && a.size == b.size;
+  }
+};
+
+/**
+ * State of a journal file kept between writes, see #BLO_write_file_journal.
+ */
+struct BlendFileJournal {
+  /** Journal file this state belongs to. */
+  std::string filepath;
+  /** Size of the journal file after the last successful write, zero when it has to be created. */
+  uint64_t file_size = 0;
+  /** All chunks stored in the journal file. */
+  blender::Map<BlendJournalChunkKey, BlendJournalChunkRef> chunks;
+  /** Chunks of the last written manifest. */
+  blender::Vector<BlendJournalChunkKey> manifest;
+
+  /** Size of the blend-file described by the last manifest. */
+  uint64_t manifest_data_size() const;
+  /** Forget about the journal file, the next write creates it from scratch. */
+  void reset();
+};
+
+/** Check the beginning of a file (at least #BLEND_JOURNAL_MAGIC_LEN bytes). */
+bool blo_journal_magic_check(const char *header, size_t header_len);
+
+/** Write all of \a data to \a file, continuing after partial and interrupted writes. */
+bool blo_journal_write(int file, const void *data, size_t size);
+
+/**
+ * Write a record to \a file, advancing \a r_file_size.
+ * \param r_data_offset: Optional, set to the offset of the data in the file.
+ */
+bool blo_journal_record_write(int file,
+                              int32_t code,
+                              const void *data,
+                              uint64_t size,
+                              uint64_t *r_file_size,
+                              uint64_t *r_data_offset);
+
+/**
+ * Write the manifest of \a journal (including the footer), advancing \a r_file_size.
+ */
+bool blo_journal_manifest_write(int file, const BlendFileJournal &journal, uint64_t *r_file_size);
+
+/**
+ * Create a #FileReader for the blend-file stored in the journal read by \a base,
+ * taking ownership of \a base on success.
+ */
+FileReader *blo_journal_filereader_new(FileReader *base);
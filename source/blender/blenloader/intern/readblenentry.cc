@@ -15,9 +15,11 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_fileops.hh"
 #include "BLI_ghash.h"
 #include "BLI_linklist.h"
 #include "BLI_path_util.h" /* Only for assertions. */
+#include "BLI_serialize.hh"
 #include "BLI_string.h"
 #include "BLI_utildefines.h"
 
@@ -408,3 +410,59 @@ void BLO_read_do_version_after_setup(Main *new_bmain, BlendFileReadReport *repor
 {
   do_versions_after_setup(new_bmain, reports);
 }
+
+bool BLO_read_profile_write_json(const BlendFileReadProfile &profile,
+                                 const char *blendfile_path,
+                                 const char *filepath,
+                                 const bool append)
+{
+  using namespace blender::io::serialize;
+
+  auto append_phase = [](DictionaryValue &dict,
+                         const char *name,
+                         const BlendFileReadProfile::Phase &phase) {
+    std::shared_ptr<DictionaryValue> phase_dict = dict.append_dict(name);
+    phase_dict->append_double("duration", phase.duration);
+    phase_dict->append_int("count", phase.count);
+    phase_dict->append_int("bytes", phase.bytes);
+  };
+
+  DictionaryValue root;
+  root.append_str("filepath", blendfile_path);
+
+  std::shared_ptr<DictionaryValue> phases = root.append_dict("phases");
+  append_phase(*phases, "whole", profile.whole);
+  append_phase(*phases, "file_read", profile.file_read);
+  append_phase(*phases, "bhead_parse", profile.bhead_parse);
+  append_phase(*phases, "read_data", profile.read_data);
+  append_phase(*phases, "pointer_map", profile.pointer_map);
+  append_phase(*phases, "versioning", profile.versioning);
+  append_phase(*phases, "libraries", profile.libraries);
+  append_phase(*phases, "lib_link", profile.lib_link);
+  append_phase(*phases, "versioning_after_linking", profile.versioning_after_linking);
+
+  std::shared_ptr<DictionaryValue> id_types = root.append_dict("id_types");
+  for (const auto item : profile.id_types.items()) {
+    const IDTypeInfo *id_type = BKE_idtype_get_info_from_idcode(item.key);
+    const char *name = id_type ? id_type->name :
+                       (item.key == ID_LINK_PLACEHOLDER) ? "LinkPlaceholder" :
+                                                           "Unknown";
+    append_phase(*id_types, name, item.value);
+  }
+
+  std::shared_ptr<DictionaryValue> files = root.append_dict("files");
+  for (const auto item : profile.files.items()) {
+    append_phase(*files, item.key.c_str(), item.value);
+  }
+
+  blender::fstream stream(filepath, std::ios::out | (append ? std::ios::app : std::ios::trunc));
+  if (!stream.is_open()) {
+    return false;
+  }
+  /* One object per line, so that the profiles of multiple reads can be appended. */
+  JsonFormatter formatter;
+  formatter.serialize(stream, root);
+  stream << "\n";
+  stream.close();
+  return !stream.fail();
+}
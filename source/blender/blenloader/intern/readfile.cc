@@ -43,6 +43,7 @@
 #include "DNA_packedFile_types.h"
 #include "DNA_sdna_types.h"
 #include "DNA_sound_types.h"
+#include "DNA_text_types.h"
 #include "DNA_vfont_types.h"
 #include "DNA_volume_types.h"
 #include "DNA_workspace_types.h"
@@ -50,6 +51,7 @@
 #include "MEM_alloc_string_storage.hh"
 #include "MEM_guardedalloc.h"
 
+#include "BLI_array.hh"
 #include "BLI_blenlib.h"
 #include "BLI_endian_defines.h"
 #include "BLI_endian_switch.h"
@@ -58,8 +60,11 @@
 #include "BLI_map.hh"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
 #include "BLI_time.h"
+#include "BLI_vector.hh"
 
 #include "BLT_translation.hh"
 
@@ -107,6 +112,7 @@
 #include "SEQ_sequencer.hh"
 #include "SEQ_utils.hh"
 
+#include "blend_journal.hh"
 #include "readfile.hh"
 
 /* Make preferences read-only. */
@@ -177,6 +183,13 @@
 /** Use #GHash for restoring pointers by name. */
 #define USE_GHASH_RESTORE_POINTER
 
+/**
+ * Decode the data blocks of large IDs (e.g. meshes with many big custom-data arrays) on multiple
+ * threads. All file access and #FileData handling remains on the reading thread, only the endian
+ * switching, DNA reconstruction and copying of the block contents is done in parallel.
+ */
+#define USE_PARALLEL_DATA_READ
+
 static CLG_LogRef LOG = {"blo.readfile"};
 static CLG_LogRef LOG_UNDO = {"blo.readfile.undo"};
 
@@ -185,6 +198,7 @@ static void read_libraries(FileData *basefd, ListBase *mainlist);
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname, const int id_type_index);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname);
+static void expand_doit_library(void *fdhandle, Main *mainvar, void *old);
 
 struct BHeadN {
   BHeadN *next, *prev;
@@ -237,6 +251,144 @@ static const char *library_parent_filepath(Library *lib)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Read Profiling
+ *
+ * Only active when #BlendFileReadReport.profile is set, see #BLO_read_profile_write_json.
+ * \{ */
+
+/**
+ * Adds the time spent in its scope to \a phase, does nothing when \a phase is null.
+ *
+ * Reading the timer isn't free, so items that are processed in large numbers (like blocks) are
+ * timed in batches, with \a count being the number of items in the batch.
+ */
+class ReadProfileScope {
+  BlendFileReadProfile::Phase *phase_;
+  double start_time_ = 0.0;
+
+ public:
+  ReadProfileScope(BlendFileReadProfile::Phase *phase,
+                   const int64_t bytes = 0,
+                   const int64_t count = 1)
+      : phase_(phase)
+  {
+    if (phase_) {
+      phase_->count += count;
+      phase_->bytes += bytes;
+      start_time_ = BLI_time_now_seconds();
+    }
+  }
+
+  ~ReadProfileScope()
+  {
+    this->finish();
+  }
+
+  /** Add items to the batch, when their number is only known after processing them. */
+  void add_items(const int64_t count)
+  {
+    if (phase_) {
+      phase_->count += count;
+    }
+  }
+
+  /** Stop timing before the end of the scope. */
+  void finish()
+  {
+    if (phase_) {
+      phase_->duration += BLI_time_now_seconds() - start_time_;
+      phase_ = nullptr;
+    }
+  }
+};
+
+#define READ_PROFILE_PHASE(fd, member) ((fd)->profile ? &(fd)->profile->member : nullptr)
+
+/** Wraps the file reader of a #FileData to time all reads. */
+struct ProfileFileReader {
+  FileReader reader;
+  FileReader *base;
+  BlendFileReadProfile *profile;
+  /** Reads of this file only, added to #BlendFileReadProfile.files when closing. */
+  BlendFileReadProfile::Phase file_phase;
+  char filepath[FILE_MAX];
+};
+
+static int64_t profile_read(FileReader *reader, void *buffer, size_t size)
+{
+  ProfileFileReader *profile_reader = (ProfileFileReader *)reader;
+  FileReader *base = profile_reader->base;
+
+  const double start_time = BLI_time_now_seconds();
+  const int64_t readsize = base->read(base, buffer, size);
+  const double duration = BLI_time_now_seconds() - start_time;
+  for (BlendFileReadProfile::Phase *phase :
+       {&profile_reader->profile->file_read, &profile_reader->file_phase})
+  {
+    phase->count++;
+    phase->duration += duration;
+    if (readsize > 0) {
+      phase->bytes += readsize;
+    }
+  }
+  reader->offset = base->offset;
+  return readsize;
+}
+
+static off64_t profile_seek(FileReader *reader, off64_t offset, int whence)
+{
+  ProfileFileReader *profile_reader = (ProfileFileReader *)reader;
+  FileReader *base = profile_reader->base;
+
+  const off64_t result = base->seek(base, offset, whence);
+  reader->offset = base->offset;
+  return result;
+}
+
+static void profile_close(FileReader *reader)
+{
+  ProfileFileReader *profile_reader = (ProfileFileReader *)reader;
+  profile_reader->base->close(profile_reader->base);
+
+  /* A library can be opened more than once, e.g. when linking from it again. */
+  BlendFileReadProfile::Phase &file_phase = profile_reader->profile->files.lookup_or_add_default(
+      profile_reader->filepath);
+  file_phase.duration += profile_reader->file_phase.duration;
+  file_phase.count += profile_reader->file_phase.count;
+  file_phase.bytes += profile_reader->file_phase.bytes;
+
+  MEM_delete(profile_reader);
+}
+
+/**
+ * Start timing all reads from the file of \a fd, when profiling. Done after the file header and
+ * DNA are read, since reading those relies on the type of the reader.
+ */
+static void read_profile_filereader_ensure(FileData *fd)
+{
+  if (fd->profile == nullptr || fd->file == nullptr || fd->file->read == profile_read) {
+    return;
+  }
+  if (fd->flags & FD_FLAGS_IS_MEMFILE) {
+    /* Undo code accesses the #UndoReader directly. */
+    return;
+  }
+
+  ProfileFileReader *profile_reader = MEM_new<ProfileFileReader>(__func__);
+  profile_reader->base = fd->file;
+  profile_reader->profile = fd->profile;
+  STRNCPY(profile_reader->filepath, fd->relabase);
+  profile_reader->reader.read = profile_read;
+  profile_reader->reader.seek = fd->file->seek ? profile_seek : nullptr;
+  profile_reader->reader.close = profile_close;
+  profile_reader->reader.offset = fd->file->offset;
+
+  fd->file = &profile_reader->reader;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name OldNewMap API
  * \{ */
@@ -246,6 +398,14 @@ struct NewAddress {
 
   /** `nr` is "user count" for data, and ID code for libdata. */
   int nr;
+
+  /**
+   * Set when `newp` points into the memory-mapped file instead of memory owned by the map. Such
+   * data is only referenced directly by shared data, see #blo_read_shared_impl. Other users get
+   * a copy made on first access.
+   */
+  BHead *file_mapped_bhead = nullptr;
+  const char *file_mapped_alloc_name = nullptr;
 };
 
 struct OldNewMap {
@@ -313,7 +473,7 @@ static void oldnewmap_clear(OldNewMap *onm)
 {
   /* Free unused data. */
   for (NewAddress &new_addr : onm->map.values()) {
-    if (new_addr.nr == 0) {
+    if (new_addr.nr == 0 && new_addr.file_mapped_bhead == nullptr) {
       MEM_freeN(new_addr.newp);
     }
   }
@@ -692,6 +852,26 @@ static void bh8_from_bh4(BHead *bhead, BHead4 *bhead4)
   }
 }
 
+/**
+ * Read the raw header of the next block, taking it from the #BHead index when available
+ * (skipping over it in the file without decompressing it).
+ */
+static int64_t bhead_header_read(FileData *fd, void *buf, const size_t size)
+{
+  if (fd->bhead_index == nullptr) {
+    return fd->file->read(fd->file, buf, size);
+  }
+  if (fd->bhead_index_offset + size > fd->bhead_index_size) {
+    return 0;
+  }
+  if (fd->file->seek(fd->file, off64_t(size), SEEK_CUR) == -1) {
+    return 0;
+  }
+  memcpy(buf, fd->bhead_index + fd->bhead_index_offset, size);
+  fd->bhead_index_offset += size;
+  return int64_t(size);
+}
+
 static BHeadN *get_bhead(FileData *fd)
 {
   BHeadN *new_bhead = nullptr;
@@ -714,7 +894,7 @@ static BHeadN *get_bhead(FileData *fd)
        */
       if (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) {
         bhead4.code = BLO_CODE_DATA;
-        readsize = fd->file->read(fd->file, &bhead4, sizeof(bhead4));
+        readsize = bhead_header_read(fd, &bhead4, sizeof(bhead4));
 
         if (readsize == sizeof(bhead4) || bhead4.code == BLO_CODE_ENDB) {
           if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
@@ -737,7 +917,7 @@ static BHeadN *get_bhead(FileData *fd)
       }
       else {
         bhead8.code = BLO_CODE_DATA;
-        readsize = fd->file->read(fd->file, &bhead8, sizeof(bhead8));
+        readsize = bhead_header_read(fd, &bhead8, sizeof(bhead8));
 
         if (readsize == sizeof(bhead8) || bhead8.code == BLO_CODE_ENDB) {
           if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
@@ -985,6 +1165,71 @@ static void decode_blender_header(FileData *fd)
   }
 }
 
+/**
+ * Load the #BHead index of a compressed file (see #BLEN_ZSTD_BHEAD_INDEX_MAGIC). This avoids
+ * decompressing the whole file just to find its blocks, so e.g. linking from a compressed library
+ * only decompresses the frames containing the data that is actually read.
+ *
+ * The index is only used when it describes the decompressed stream exactly,
+ * otherwise headers are read from the file as usual.
+ */
+static void read_file_bhead_index(FileData *fd)
+{
+  size_t index_size;
+  char *index = static_cast<char *>(BLI_filereader_zstd_skippable_frame_read(
+      fd->file, BLEN_ZSTD_BHEAD_INDEX_MAGIC, &index_size));
+  if (index == nullptr) {
+    return;
+  }
+
+  const size_t bhead_size = (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) ? sizeof(BHead4) :
+                                                                          sizeof(BHead8);
+  /* Version, size of a #BHead and number of headers. */
+  uint32_t info[3];
+  bool is_valid = false;
+  if (index_size >= sizeof(info)) {
+    memcpy(info, index, sizeof(info));
+#ifdef __BIG_ENDIAN__
+    BLI_endian_switch_uint32_array(info, ARRAY_SIZE(info));
+#endif
+    is_valid = info[0] == 1 && info[1] == bhead_size &&
+               size_t(info[2]) * bhead_size == index_size - sizeof(info);
+  }
+
+  if (is_valid) {
+    /* The blocks have to span the whole decompressed stream, starting right after the
+     * file header that was just read. */
+    const off64_t offset = fd->file->offset;
+    const off64_t file_end = fd->file->seek(fd->file, 0, SEEK_END);
+    if (fd->file->seek(fd->file, offset, SEEK_SET) == -1) {
+      is_valid = false;
+    }
+    off64_t blocks_end = offset;
+    for (size_t i = 0; is_valid && i < info[2]; i++) {
+      /* The length directly follows the code in both #BHead4 and #BHead8. */
+      int len;
+      memcpy(&len, index + sizeof(info) + i * bhead_size + sizeof(int), sizeof(int));
+      if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+        BLI_endian_switch_int32(&len);
+      }
+      if (len < 0) {
+        is_valid = false;
+      }
+      blocks_end += off64_t(bhead_size) + len;
+    }
+    is_valid = is_valid && (blocks_end == file_end);
+  }
+
+  if (!is_valid) {
+    MEM_freeN(index);
+    return;
+  }
+
+  fd->bhead_index = index;
+  fd->bhead_index_size = index_size;
+  fd->bhead_index_offset = sizeof(info);
+}
+
 /**
  * \return Success if the file is read correctly, else set \a r_error_message.
  */
@@ -1028,6 +1273,10 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
         BLI_assert(fd->id_name_offset != -1);
         fd->id_asset_data_offset = DNA_struct_member_offset_by_name_with_alias(
             fd->filesdna, "ID", "AssetMetaData", "*asset_data");
+        fd->id_flag_offset = DNA_struct_member_offset_by_name_with_alias(
+            fd->filesdna, "ID", "short", "flag");
+        fd->text_flags_offset = DNA_struct_member_offset_by_name_with_alias(
+            fd->filesdna, "Text", "int", "flags");
 
         return true;
       }
@@ -1085,6 +1334,111 @@ static int *read_file_thumbnail(FileData *fd)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Memory-Mapped File Data
+ *
+ * Large arrays of uncompressed files can reference a copy-on-write mapping of the file directly
+ * instead of being copied, when they are read as shared data. The mapping is kept alive as long as
+ * any of these arrays is used. Since it is mapped copy-on-write, the arrays can still be modified
+ * in place, the system then only copies the modified pages.
+ * \{ */
+
+/** Minimum size of a data block to reference it in the mapped file instead of copying it. */
+#define FILE_MAPPED_DATA_MIN_SIZE (64 * 1024)
+
+struct BlendFileMapping : public blender::ImplicitSharingMixin {
+  BLI_mmap_file *mmap_file;
+
+  BlendFileMapping(BLI_mmap_file *mmap_file) : mmap_file(mmap_file) {}
+
+ private:
+  void delete_self() override
+  {
+    BLI_mmap_free(mmap_file);
+    MEM_delete(this);
+  }
+};
+
+/** Sharing info of an array that references memory of a #BlendFileMapping. */
+class FileMappedSharingInfo : public blender::ImplicitSharingInfo {
+ private:
+  const BlendFileMapping &mapping_;
+
+ public:
+  FileMappedSharingInfo(const BlendFileMapping &mapping) : mapping_(mapping)
+  {
+    mapping_.add_user();
+  }
+
+ private:
+  void delete_self_with_data() override
+  {
+    mapping_.remove_user_and_delete_if_last();
+    MEM_delete(this);
+  }
+};
+
+static BlendFileMapping *blo_file_mapping_create(const int filedes)
+{
+  BLI_mmap_file *mmap_file = BLI_mmap_open_copy_on_write(filedes);
+  if (mmap_file == nullptr) {
+    return nullptr;
+  }
+  return MEM_new<BlendFileMapping>(__func__, mmap_file);
+}
+
+/**
+ * \return The address of the data of \a bhead in the mapped file, or null if this data cannot be
+ * used directly (because it needs any kind of conversion, is too small, or is not aligned).
+ */
+static void *blo_bhead_file_mapped_data(FileData *fd, BHead *bhead)
+{
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  if (fd->file_mapping == nullptr || bhead->len < FILE_MAPPED_DATA_MIN_SIZE) {
+    return nullptr;
+  }
+  if ((fd->flags & FD_FLAGS_SWITCH_ENDIAN) || fd->compflags[bhead->SDNAnr] != SDNA_CMP_EQUAL) {
+    return nullptr;
+  }
+  const BHeadN *new_bhead = BHEADN_FROM_BHEAD(bhead);
+  if (new_bhead->has_data) {
+    return nullptr;
+  }
+  BLI_mmap_file *mmap_file = fd->file_mapping->mmap_file;
+  const size_t offset = size_t(new_bhead->file_offset);
+  if (offset + size_t(bhead->len) > BLI_mmap_get_length(mmap_file)) {
+    return nullptr;
+  }
+  const int alignment = DNA_struct_alignment(fd->filesdna, bhead->SDNAnr);
+  if (offset % size_t(alignment) != 0) {
+    return nullptr;
+  }
+  return POINTER_OFFSET(BLI_mmap_get_pointer(mmap_file), offset);
+#else
+  UNUSED_VARS(fd, bhead);
+  return nullptr;
+#endif
+}
+
+/** Replace the reference to the mapped file of a datamap entry with an owned copy. */
+static void *blo_file_mapped_data_copy(FileData *fd, NewAddress &entry)
+{
+  BHead *bhead = entry.file_mapped_bhead;
+  const int alignment = DNA_struct_alignment(fd->filesdna, bhead->SDNAnr);
+  void *data = MEM_mallocN_aligned(bhead->len, alignment, entry.file_mapped_alloc_name);
+  if (UNLIKELY(!blo_bhead_read_data(fd, bhead, data))) {
+    fd->flags &= ~FD_FLAGS_FILE_OK;
+    MEM_freeN(data);
+    return nullptr;
+  }
+  entry.newp = data;
+  entry.file_mapped_bhead = nullptr;
+  entry.file_mapped_alloc_name = nullptr;
+  return data;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name File Data API
  * \{ */
@@ -1102,6 +1456,7 @@ static FileData *filedata_new(BlendFileReadReport *reports)
   fd->libmap = oldnewmap_new();
 
   fd->reports = reports;
+  fd->profile = reports->profile;
 
   return fd;
 }
@@ -1162,6 +1517,8 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
   decode_blender_header(fd);
 
   if (fd->flags & FD_FLAGS_FILE_OK) {
+    read_file_bhead_index(fd);
+
     const char *error_message = nullptr;
     if (read_file_dna(fd, &error_message) == false) {
       BKE_reportf(
@@ -1212,8 +1569,13 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   /* Rewind the file after reading the header. */
   rawfile->seek(rawfile, 0, SEEK_SET);
 
+  BlendFileMapping *file_mapping = nullptr;
+
   /* Check if we have a regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
+    if (G.f & G_FLAG_READ_FILE_MAPPED) {
+      file_mapping = blo_file_mapping_create(filedes);
+    }
     /* Try opening the file with memory-mapped IO. */
     file = BLI_filereader_new_mmap(filedes);
     if (file == nullptr) {
@@ -1234,6 +1596,24 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
       rawfile = nullptr; /* The `Zstd` #FileReader takes ownership of `rawfile`. */
     }
   }
+  else if (memcmp(header, BLEND_JOURNAL_MAGIC, sizeof(header)) == 0) {
+    /* Journals are read in small pieces spread over the file, so prefer memory-mapped IO. */
+    FileReader *base = BLI_filereader_new_mmap(filedes);
+    if (base == nullptr) {
+      base = rawfile;
+      rawfile = nullptr;
+    }
+    file = blo_journal_filereader_new(base);
+    if (file == nullptr) {
+      /* Give `base` back to the cleanup below, unless it's the memory-mapped reader. */
+      if (rawfile != nullptr) {
+        base->close(base);
+      }
+      else {
+        rawfile = base;
+      }
+    }
+  }
 
   /* Clean up `rawfile` if it wasn't taken over. */
   if (rawfile != nullptr) {
@@ -1241,11 +1621,15 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   }
   if (file == nullptr) {
     BKE_reportf(reports->reports, RPT_WARNING, "Unrecognized file format '%s'", filepath);
+    if (file_mapping) {
+      file_mapping->remove_user_and_delete_if_last();
+    }
     return nullptr;
   }
 
   FileData *fd = filedata_new(reports);
   fd->file = file;
+  fd->file_mapping = file_mapping;
 
   return fd;
 }
@@ -1359,6 +1743,11 @@ void blo_filedata_free(FileData *fd)
   }
 #endif
   fd->file->close(fd->file);
+  MEM_SAFE_FREE(fd->bhead_index);
+  if (fd->file_mapping) {
+    /* The mapping is only freed once no data references it anymore. */
+    fd->file_mapping->remove_user_and_delete_if_last();
+  }
 
   if (fd->filesdna) {
     DNA_sdna_free(fd->filesdna);
@@ -1450,15 +1839,33 @@ short BLO_version_from_file(const char *filepath)
  * \{ */
 
 /* Only direct data-blocks. */
+static void *newdataadr_ex(FileData *fd, const void *adr, const bool increase_users)
+{
+  NewAddress *entry = fd->datamap->map.lookup_ptr(adr);
+  if (entry == nullptr) {
+    return nullptr;
+  }
+  if (entry->file_mapped_bhead != nullptr) {
+    if (blo_file_mapped_data_copy(fd, *entry) == nullptr) {
+      fd->datamap->map.remove(adr);
+      return nullptr;
+    }
+  }
+  if (increase_users) {
+    entry->nr++;
+  }
+  return entry->newp;
+}
+
 static void *newdataadr(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
+  return newdataadr_ex(fd, adr, true);
 }
 
 /* Only direct data-blocks. */
 static void *newdataadr_no_us(FileData *fd, const void *adr)
 {
-  return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
+  return newdataadr_ex(fd, adr, false);
 }
 
 void *blo_read_get_new_globaldata_address(FileData *fd, const void *adr)
@@ -2458,28 +2865,206 @@ static bool direct_link_id(FileData *fd, Main *main, const int tag, ID *id, ID *
   return success;
 }
 
+#ifdef USE_PARALLEL_DATA_READ
+
+/** Minimum accumulated size of the data blocks of an ID to decode them in parallel. */
+#  define PARALLEL_DATA_READ_MIN_SIZE (1 << 20)
+
+/**
+ * Same as calling #read_struct on each of the given data blocks, but with the CPU-heavy part
+ * (endian switching, DNA reconstruction and copying) done in parallel.
+ *
+ * Reading from the file is done first on the calling thread, since #FileReader is not thread-safe.
+ * Data that does not need any conversion is read from the file directly into its final memory.
+ */
+static void read_structs_parallel(FileData *fd,
+                                  const blender::Span<BHead *> bheads,
+                                  const char *blockname,
+                                  const int id_type_index,
+                                  blender::MutableSpan<void *> r_data)
+{
+  struct DecodeTask {
+    /** Block holding the data to decode, may be a temporary copy read from the file. */
+    BHead *bhead;
+    bool is_temp_copy;
+    const char *alloc_name;
+    void **r_data;
+  };
+  blender::Vector<DecodeTask> tasks;
+  tasks.reserve(bheads.size());
+
+  const bool do_endian_switch = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
+
+  for (const int i : bheads.index_range()) {
+    BHead *bh = bheads[i];
+    r_data[i] = nullptr;
+    if (bh->len == 0 || fd->compflags[bh->SDNAnr] == SDNA_CMP_REMOVED) {
+      continue;
+    }
+    /* #get_alloc_name uses thread local storage, it has to be called from the reading thread. */
+    const char *alloc_name = get_alloc_name(fd, bh, blockname, id_type_index);
+    const bool needs_conversion = (bh->SDNAnr && do_endian_switch) ||
+                                  fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL;
+#  ifdef USE_BHEAD_READ_ON_DEMAND
+    if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
+      if (!needs_conversion) {
+        /* Nothing to do in parallel, read the data from the file directly into the memory. */
+        const int alignment = DNA_struct_alignment(fd->filesdna, bh->SDNAnr);
+        void *temp = MEM_mallocN_aligned(bh->len, alignment, alloc_name);
+        if (UNLIKELY(!blo_bhead_read_data(fd, bh, temp))) {
+          fd->flags &= ~FD_FLAGS_FILE_OK;
+          MEM_freeN(temp);
+          temp = nullptr;
+        }
+        r_data[i] = temp;
+        continue;
+      }
+      BHead *bh_full = blo_bhead_read_full(fd, bh);
+      if (UNLIKELY(bh_full == nullptr)) {
+        fd->flags &= ~FD_FLAGS_FILE_OK;
+        continue;
+      }
+      tasks.append({bh_full, true, alloc_name, &r_data[i]});
+      continue;
+    }
+#  endif
+    tasks.append({bh, false, alloc_name, &r_data[i]});
+  }
+
+  const SDNA *filesdna = fd->filesdna;
+  const char *compflags = fd->compflags;
+  const DNA_ReconstructInfo *reconstruct_info = fd->reconstruct_info;
+
+  blender::threading::parallel_for(
+      tasks.index_range(),
+      PARALLEL_DATA_READ_MIN_SIZE / 4,
+      [&](const blender::IndexRange range) {
+        for (const DecodeTask &task : tasks.as_span().slice(range)) {
+          BHead *bh = task.bhead;
+          if (bh->SDNAnr && do_endian_switch) {
+            switch_endian_structs(filesdna, bh);
+          }
+          if (compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+            *task.r_data = DNA_struct_reconstruct(
+                reconstruct_info, bh->SDNAnr, bh->nr, (bh + 1), task.alloc_name);
+          }
+          else {
+            const int alignment = DNA_struct_alignment(filesdna, bh->SDNAnr);
+            void *temp = MEM_mallocN_aligned(bh->len, alignment, task.alloc_name);
+            memcpy(temp, (bh + 1), bh->len);
+            *task.r_data = temp;
+          }
+        }
+      },
+      blender::threading::individual_task_sizes(
+          [&](const int64_t i) { return int64_t(tasks[i].bhead->len); }));
+
+  for (const DecodeTask &task : tasks) {
+    if (task.is_temp_copy) {
+      MEM_freeN(BHEADN_FROM_BHEAD(task.bhead));
+    }
+  }
+}
+
+#endif /* USE_PARALLEL_DATA_READ */
+
+/**
+ * Insert the read \a data of \a bheads into the datamap. Done for all data blocks of an ID at once
+ * so that profiling doesn't have to time each insert.
+ */
+static void read_data_insert_into_datamap(FileData *fd,
+                                          const blender::Span<BHead *> bheads,
+                                          const blender::Span<void *> data)
+{
+  ReadProfileScope profile_scope(READ_PROFILE_PHASE(fd, pointer_map), 0, bheads.size());
+  for (const int i : bheads.index_range()) {
+    if (data[i] == nullptr) {
+      continue;
+    }
+    const bool is_new = oldnewmap_insert(fd->datamap, bheads[i]->old, data[i], 0);
+    if (!is_new) {
+      CLOG_ERROR(&LOG,
+                 "Blendfile corruption: Invalid, or multiple `bhead` with same old address "
+                 "value (%p) for a given ID.",
+                 bheads[i]->old);
+    }
+  }
+}
+
+/**
+ * Insert a reference to the data of \a bhead in the mapped file into the datamap, instead of
+ * reading it.
+ *
+ * \return False if the data cannot be used from the mapped file directly.
+ */
+static bool read_data_file_mapped_into_datamap(FileData *fd,
+                                               BHead *bhead,
+                                               const char *allocname,
+                                               const int id_type_index)
+{
+  void *data = blo_bhead_file_mapped_data(fd, bhead);
+  if (data == nullptr || bhead->old == nullptr) {
+    return false;
+  }
+  NewAddress entry{data, 0};
+  entry.file_mapped_bhead = bhead;
+  entry.file_mapped_alloc_name = get_alloc_name(fd, bhead, allocname, id_type_index);
+  if (!fd->datamap->map.add_overwrite(bhead->old, entry)) {
+    CLOG_ERROR(&LOG,
+               "Blendfile corruption: Invalid, or multiple `bhead` with same old address "
+               "value (%p) for a given ID.",
+               bhead->old);
+  }
+  return true;
+}
+
 /* Read all data associated with a datablock into datamap. */
 static BHead *read_data_into_datamap(FileData *fd,
                                      BHead *bhead,
                                      const char *allocname,
                                      const int id_type_index)
 {
-  bhead = blo_bhead_next(fd, bhead);
+  /* Gather all data blocks of the ID first, so that profiling times parsing their headers once
+   * per ID. The blocks are still inserted into the datamap in file order. */
+  blender::Vector<BHead *, 64> data_bheads;
+  {
+    ReadProfileScope profile_scope(READ_PROFILE_PHASE(fd, bhead_parse), 0, 0);
+    bhead = blo_bhead_next(fd, bhead);
+    while (bhead && bhead->code == BLO_CODE_DATA) {
+      data_bheads.append(bhead);
+      bhead = blo_bhead_next(fd, bhead);
+    }
+    /* The header following the data is parsed too. */
+    profile_scope.add_items(data_bheads.size() + 1);
+  }
 
-  while (bhead && bhead->code == BLO_CODE_DATA) {
-    void *data = read_struct(fd, bhead, allocname, id_type_index);
-    if (data) {
-      const bool is_new = oldnewmap_insert(fd->datamap, bhead->old, data, 0);
-      if (!is_new) {
-        CLOG_ERROR(&LOG,
-                   "Blendfile corruption: Invalid, or multiple `bhead` with same old address "
-                   "value (%p) for a given ID.",
-                   bhead->old);
-      }
+  blender::Vector<BHead *, 64> read_bheads;
+  int64_t data_size = 0;
+  for (BHead *data_bhead : data_bheads) {
+    if (!read_data_file_mapped_into_datamap(fd, data_bhead, allocname, id_type_index)) {
+      read_bheads.append(data_bhead);
+      data_size += data_bhead->len;
     }
+  }
 
-    bhead = blo_bhead_next(fd, bhead);
+  blender::Array<void *, 64> data(read_bheads.size());
+#ifdef USE_PARALLEL_DATA_READ
+  /* Decoding in parallel is only worth it for large amounts of data. */
+  if (read_bheads.size() > 1 && data_size >= PARALLEL_DATA_READ_MIN_SIZE) {
+    read_structs_parallel(fd, read_bheads, allocname, id_type_index, data);
   }
+  else {
+    for (const int i : read_bheads.index_range()) {
+      data[i] = read_struct(fd, read_bheads[i], allocname, id_type_index);
+    }
+  }
+#else
+  UNUSED_VARS(data_size);
+  for (const int i : read_bheads.index_range()) {
+    data[i] = read_struct(fd, read_bheads[i], allocname, id_type_index);
+  }
+#endif
+  read_data_insert_into_datamap(fd, read_bheads, data);
 
   return bhead;
 }
@@ -2867,6 +3452,10 @@ static BHead *read_libblock(FileData *fd,
 {
   const bool do_partial_undo = (fd->skip_flags & BLO_READ_SKIP_UNDO_OLD_MAIN) == 0;
 
+  BlendFileReadProfile::Phase *profile_phase =
+      fd->profile ? &fd->profile->id_types.lookup_or_add_default(bhead->code) : nullptr;
+  ReadProfileScope profile_scope(profile_phase, bhead->len);
+
   /* First attempt to restore existing datablocks for undo.
    * When datablocks are changed but still exist, we restore them at the old
    * address and inherit recalc flags for the dependency graph. */
@@ -2956,7 +3545,15 @@ static BHead *read_libblock(FileData *fd,
 
   /* Read datablock contents.
    * Use convenient malloc name for debugging and better memory link prints. */
+  BHead *id_bhead = bhead;
   bhead = read_data_into_datamap(fd, bhead, blockname, id_type_index);
+  if (profile_phase) {
+    for (BHead *data_bhead = blo_bhead_next(fd, id_bhead); data_bhead != bhead;
+         data_bhead = blo_bhead_next(fd, data_bhead))
+    {
+      profile_phase->bytes += data_bhead->len;
+    }
+  }
   const bool success = direct_link_id(fd, main, id_tag, id, id_old);
   oldnewmap_clear(fd->datamap);
 
@@ -3102,6 +3699,7 @@ static void do_versions_userdef(FileData * /*fd*/, BlendFileData *bfd)
 static void do_versions(FileData *fd, Library *lib, Main *main)
 {
   /* WATCH IT!!!: pointers from libdata have not been converted */
+  ReadProfileScope profile_scope(READ_PROFILE_PHASE(fd, versioning));
 
   /* Don't allow versioning to create new data-blocks. */
   main->is_locked_for_linking = true;
@@ -3163,6 +3761,7 @@ static void do_versions(FileData *fd, Library *lib, Main *main)
 static void do_versions_after_linking(FileData *fd, Main *main)
 {
   BLI_assert(fd != nullptr);
+  ReadProfileScope profile_scope(READ_PROFILE_PHASE(fd, versioning_after_linking));
 
   CLOG_INFO(&LOG,
             2,
@@ -3236,6 +3835,7 @@ static int lib_link_cb(LibraryIDLinkCallbackData *cb_data)
 
 static void lib_link_all(FileData *fd, Main *bmain)
 {
+  ReadProfileScope profile_scope(READ_PROFILE_PHASE(fd, lib_link));
   BlendLibReader reader = {fd, bmain};
 
   ID *id;
@@ -3512,13 +4112,71 @@ static void blo_read_file_checks(Main *bmain)
   UNUSED_VARS_NDEBUG(bmain);
 }
 
+/** Read an integer member of the data-block stored in (bhead+1), or 0 when it isn't available. */
+template<typename T>
+static T read_file_bhead_id_member(const FileData *fd, const BHead *bhead, const int offset)
+{
+  if (offset < 0 || offset + int(sizeof(T)) > bhead->len) {
+    return 0;
+  }
+  T value;
+  memcpy(&value, POINTER_OFFSET(bhead, sizeof(*bhead) + offset), sizeof(T));
+  if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+    if constexpr (sizeof(T) == sizeof(int16_t)) {
+      BLI_endian_switch_int16(reinterpret_cast<int16_t *>(&value));
+    }
+    else {
+      BLI_endian_switch_int32(reinterpret_cast<int32_t *>(&value));
+    }
+  }
+  return value;
+}
+
+/**
+ * Data-blocks always read when only reading the active data, see #BLO_READ_SKIP_INACTIVE_DATA.
+ * The other ones are read when expanding these.
+ */
+static bool read_file_partial_is_root(const FileData *fd, BlendFileData *bfd, const BHead *bhead)
+{
+  switch (bhead->code) {
+    /* Libraries are needed to read linked data-blocks when they are used. */
+    case ID_LI:
+    case ID_WM:
+      return true;
+    case ID_SCE:
+      /* Files written without a window-manager have no active scene, the first one is used then,
+       * see #link_global. The global block is written before all data-blocks. */
+      if (bfd->curscene == nullptr) {
+        bfd->curscene = static_cast<Scene *>(const_cast<void *>(bhead->old));
+      }
+      if (bhead->old == bfd->curscene) {
+        return true;
+      }
+      break;
+    case ID_TXT:
+      /* Texts registered as modules run on load, and are used by other scripts and drivers
+       * without being referenced. */
+      if (read_file_bhead_id_member<int>(fd, bhead, fd->text_flags_offset) & TXT_ISSCRIPT) {
+        return true;
+      }
+      break;
+  }
+  /* Data-blocks with a fake user are kept on purpose, typically for scripts and drivers which
+   * access them by name. */
+  return (read_file_bhead_id_member<short>(fd, bhead, fd->id_flag_offset) & LIB_FAKEUSER) != 0;
+}
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
+  read_profile_filereader_ensure(fd);
+  ReadProfileScope profile_scope(READ_PROFILE_PHASE(fd, whole));
+
   BHead *bhead = blo_bhead_first(fd);
   BlendFileData *bfd;
   ListBase mainlist = {nullptr, nullptr};
 
   const bool is_undo = (fd->flags & FD_FLAGS_IS_MEMFILE) != 0;
+  const bool is_partial = !is_undo && (fd->skip_flags & BLO_READ_SKIP_INACTIVE_DATA) != 0;
   if (is_undo) {
     CLOG_INFO(&LOG_UNDO, 2, "UNDO: read step");
   }
@@ -3576,6 +4234,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     read_undo_reuse_noundo_local_ids(fd);
   }
 
+  ReadProfileScope read_data_profile_scope(READ_PROFILE_PHASE(fd, read_data));
   while (bhead) {
     switch (bhead->code) {
       case BLO_CODE_DATA:
@@ -3600,7 +4259,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
         break;
 
       case ID_LINK_PLACEHOLDER:
-        if (fd->skip_flags & BLO_READ_SKIP_DATA) {
+        if ((fd->skip_flags & BLO_READ_SKIP_DATA) || is_partial) {
+          /* When reading partially, the placeholder is added when expanding. */
           bhead = blo_bhead_next(fd, bhead);
         }
         else {
@@ -3621,6 +4281,15 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
         if (fd->skip_flags & BLO_READ_SKIP_DATA) {
           bhead = blo_bhead_next(fd, bhead);
         }
+        else if (is_partial) {
+          if (read_file_partial_is_root(fd, bfd, bhead)) {
+            bhead = read_libblock(
+                fd, bfd->main, bhead, LIB_TAG_LOCAL | LIB_TAG_NEED_EXPAND, false, nullptr);
+          }
+          else {
+            bhead = blo_bhead_next(fd, bhead);
+          }
+        }
         else {
           bhead = read_libblock(fd, bfd->main, bhead, LIB_TAG_LOCAL, false, nullptr);
         }
@@ -3631,6 +4300,21 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  if (is_partial && (fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    /* Read all data-blocks used by the ones read so far, and placeholders for the linked ones. */
+    BLO_expand_main(fd, bfd->main, expand_doit_library);
+    if (bfd->main->id_map != nullptr) {
+      BKE_main_idmap_destroy(bfd->main->id_map);
+      bfd->main->id_map = nullptr;
+    }
+    bfd->main->is_read_partial = true;
+
+    if (bfd->main->is_read_invalid) {
+      return bfd;
+    }
+  }
+  read_data_profile_scope.finish();
+
   if (is_undo) {
     /* Move the remaining Library IDs and their linked data to the new main.
      *
@@ -3994,7 +4678,7 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
                        RPT_WARNING,
                        RPT_("LIB: Data refers to main .blend file: '%s' from %s"),
                        idname,
-                       mainvar->curlib->runtime.filepath_abs);
+                       mainvar->curlib ? mainvar->curlib->runtime.filepath_abs : fd->relabase);
       return;
     }
 
@@ -4003,7 +4687,15 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
     if (id == nullptr) {
       /* ID has not been read yet, add placeholder to the main of the
        * library it belongs to, so that it will be read later. */
-      read_libblock(fd, libmain, bhead, fd->id_tag_extra | LIB_TAG_INDIRECT, false, &id);
+      if (mainvar->curlib == nullptr) {
+        /* Expanding the main file when reading partially, tag the placeholder like
+         * #blo_read_file_internal does, so directly linked data stays #LIB_TAG_EXTERN and is
+         * written back as a link instead of being dropped or treated as local data. */
+        read_libblock(fd, libmain, bhead, fd->id_tag_extra, true, &id);
+      }
+      else {
+        read_libblock(fd, libmain, bhead, fd->id_tag_extra | LIB_TAG_INDIRECT, false, &id);
+      }
       BLI_assert(id != nullptr);
       id_sort_by_name(which_libbase(libmain, GS(id->name)), id, static_cast<ID *>(id->prev));
 
@@ -4052,10 +4744,12 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
 
     ID *id = library_id_is_yet_read(fd, mainvar, bhead);
     if (id == nullptr) {
+      /* The main of the file itself is only expanded when reading partially. */
+      const int id_tag_location = mainvar->curlib ? LIB_TAG_INDIRECT : LIB_TAG_LOCAL;
       read_libblock(fd,
                     mainvar,
                     bhead,
-                    fd->id_tag_extra | LIB_TAG_NEED_EXPAND | LIB_TAG_INDIRECT,
+                    fd->id_tag_extra | LIB_TAG_NEED_EXPAND | id_tag_location,
                     false,
                     &id);
       BLI_assert(id != nullptr);
@@ -4658,6 +5352,8 @@ static FileData *read_library_file_data(FileData *basefd,
     fd->mainlist = mainlist;
 
     fd->reports = basefd->reports;
+    fd->profile = basefd->profile;
+    read_profile_filereader_ensure(fd);
 
     if (fd->libmap) {
       oldnewmap_free(fd->libmap);
@@ -4695,6 +5391,7 @@ static FileData *read_library_file_data(FileData *basefd,
 
 static void read_libraries(FileData *basefd, ListBase *mainlist)
 {
+  ReadProfileScope profile_scope(READ_PROFILE_PHASE(basefd, libraries));
   Main *mainl = static_cast<Main *>(mainlist->first);
   bool do_it = true;
 
@@ -5045,7 +5742,8 @@ void BLO_read_pointer_array(BlendDataReader *reader, const int array_size, void
 blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     BlendDataReader *reader,
     const void **ptr_p,
-    const blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn)
+    const blender::FunctionRef<const blender::ImplicitSharingInfo *()> read_fn,
+    const int64_t trivial_data_size)
 {
   const void *old_address = *ptr_p;
   if (BLO_read_data_is_undo(reader)) {
@@ -5076,6 +5774,19 @@ blender::ImplicitSharingInfoAndData blo_read_shared_impl(
     return *shared_data;
   }
 
+  if (trivial_data_size > 0) {
+    FileData *fd = reader->fd;
+    NewAddress *entry = fd->datamap->map.lookup_ptr(old_address);
+    if (entry && entry->file_mapped_bhead && entry->file_mapped_bhead->len >= trivial_data_size) {
+      /* Reference the data in the mapped file directly, without calling the callback. */
+      entry->nr++;
+      const blender::ImplicitSharingInfoAndData shared_data{
+          MEM_new<FileMappedSharingInfo>(__func__, *fd->file_mapping), entry->newp};
+      reader->shared_data_by_stored_address.add(old_address, shared_data);
+      return shared_data;
+    }
+  }
+
   /* This is the first time this data is loaded. The callback also creates the corresponding
    * sharing info which may be reused later. */
   const blender::ImplicitSharingInfo *sharing_info = read_fn();
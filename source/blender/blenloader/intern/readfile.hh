@@ -27,6 +27,7 @@ struct BlendFileReadParams;
 struct BlendFileReadReport;
 struct BLOCacheStorage;
 struct BHeadSort;
+struct BlendFileMapping;
 struct DNA_ReconstructInfo;
 struct IDNameLib_Map;
 struct Key;
@@ -65,6 +66,22 @@ struct FileData {
 
   FileReader *file;
 
+  /**
+   * Copy-on-write mapping of the whole file, when data may reference it directly instead of being
+   * copied (see #G_FLAG_READ_FILE_MAPPED). Only available for uncompressed files.
+   */
+  BlendFileMapping *file_mapping;
+
+  /**
+   * Raw #BHead headers of a compressed file (see #BLEN_ZSTD_BHEAD_INDEX_MAGIC), so the file's
+   * blocks can be walked without decompressing the frames storing their headers.
+   * Null when the file has no (valid) index.
+   */
+  char *bhead_index;
+  size_t bhead_index_size;
+  /** Offset in #bhead_index of the header of the next block to read. */
+  size_t bhead_index_offset;
+
   /** Whether we are undoing (< 0) or redoing (> 0), used to choose which 'unchanged' flag to use
    * to detect unchanged data from memfile. */
   int undo_direction; /* eUndoStepDir */
@@ -91,6 +108,10 @@ struct FileData {
   /** Used to retrieve asset data from (bhead+1). NOTE: This may not be available in old files,
    * will be -1 then! */
   int id_asset_data_offset;
+  /** Used to retrieve ID flags from (bhead+1), -1 when not available. */
+  int id_flag_offset;
+  /** Used to retrieve text flags from (bhead+1) of texts, -1 when not available. */
+  int text_flags_offset;
   /** For do_versions patching. */
   int globalf, fileflags;
 
@@ -142,6 +163,8 @@ struct FileData {
   IDNameLib_Map *new_idmap_uid;
 
   BlendFileReadReport *reports;
+  /** Same as `reports->profile`, only set when profiling. */
+  BlendFileReadProfile *profile;
 
   /** Opaque handle to the storage system used for non-static allocation strings. */
   void *storage_handle;
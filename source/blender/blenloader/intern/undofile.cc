@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <mutex>
 
 /* open/close */
 #ifndef _WIN32
@@ -20,6 +21,8 @@
 #  include <io.h>
 #endif
 
+#include <xxhash.h>
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
@@ -36,18 +39,136 @@
 
 #include "BLI_strict_flags.h" /* Keep last. */
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Buffer Storage
+ *
+ * Chunk buffers are stored by their content in a storage shared by all #MemFile's, so identical
+ * chunks are stored once, even when they are not at the same location in consecutive undo steps
+ * (e.g. after data-blocks were reordered, or when undoing back to an older state and continuing
+ * from there). Every #MemFile owns one user of each buffer it uses through its
+ * #MemFileSharedStorage.
+ * \{ */
+
+struct MemFileChunkKey {
+  uint64_t hash_low;
+  uint64_t hash_high;
+  size_t size;
+
+  uint64_t hash() const
+  {
+    return hash_low;
+  }
+
+  friend bool operator==(const MemFileChunkKey &a, const MemFileChunkKey &b)
+  {
+    return a.hash_low == b.hash_low && a.hash_high == b.hash_high && a.size == b.size;
+  }
+};
+
+class MemFileChunkBuffer : public blender::ImplicitSharingMixin {
+ public:
+  MemFileChunkKey key;
+  char *data;
+
+  MemFileChunkBuffer(const MemFileChunkKey &chunk_key, char *chunk_data)
+      : key(chunk_key), data(chunk_data)
+  {
+  }
+
+ private:
+  void delete_self() override;
+};
+
+struct MemFileChunkStore {
+  /**
+   * Users of buffers in the store are only added and removed while this is locked, so a buffer
+   * found in the store can't be freed concurrently.
+   */
+  std::mutex mutex;
+  blender::Map<MemFileChunkKey, MemFileChunkBuffer *> buffers;
+};
+
+static MemFileChunkStore &memfile_chunk_store()
+{
+  static MemFileChunkStore store;
+  return store;
+}
+
+void MemFileChunkBuffer::delete_self()
+{
+  /* Called with the store locked, when the last #MemFile using this buffer is freed. */
+  MemFileChunkStore &store = memfile_chunk_store();
+  if (store.buffers.lookup_default(this->key, nullptr) == this) {
+    store.buffers.remove(this->key);
+  }
+  MEM_freeN(this->data);
+  MEM_delete(this);
+}
+
+/** Make \a memfile a user of a chunk buffer, unless it uses it already. */
+static void memfile_chunk_buffer_add_user(MemFile *memfile,
+                                          const char *buf,
+                                          const blender::ImplicitSharingInfo *sharing_info)
+{
+  if (memfile->shared_storage == nullptr) {
+    memfile->shared_storage = MEM_new<MemFileSharedStorage>(__func__);
+  }
+  if (memfile->shared_storage->chunk_buffers.add(buf, sharing_info)) {
+    sharing_info->add_user();
+  }
+}
+
+/**
+ * Find a buffer with the same content in the store, or add a copy of \a buf to it.
+ * \return The buffer, with a user added for \a memfile.
+ */
+static const char *memfile_chunk_buffer_ensure(MemFile *memfile, const char *buf, size_t size)
+{
+  const XXH128_hash_t hash = XXH3_128bits(buf, size);
+  const MemFileChunkKey key{hash.low64, hash.high64, size};
+
+  MemFileChunkStore &store = memfile_chunk_store();
+  std::scoped_lock lock(store.mutex);
+
+  MemFileChunkBuffer *buffer = store.buffers.lookup_default(key, nullptr);
+  if (buffer != nullptr && memcmp(buffer->data, buf, size) == 0) {
+    memfile_chunk_buffer_add_user(memfile, buffer->data, buffer);
+    return buffer->data;
+  }
+
+  char *buf_new = static_cast<char *>(MEM_mallocN(size, "Chunk buffer"));
+  memcpy(buf_new, buf, size);
+  buffer = MEM_new<MemFileChunkBuffer>(__func__, key, buf_new);
+  /* Hash collisions are not expected in practice, but in that case the buffer is simply not
+   * shared with other chunks. */
+  store.buffers.add(key, buffer);
+
+  if (memfile->shared_storage == nullptr) {
+    memfile->shared_storage = MEM_new<MemFileSharedStorage>(__func__);
+  }
+  /* The new buffer already has one user, owned by the #MemFile from now on. */
+  memfile->shared_storage->chunk_buffers.add_new(buf_new, buffer);
+  memfile->size += size;
+  return buf_new;
+}
+
+/** \} */
+
 /* **************** support for memory-write, for undo buffers *************** */
 
 void BLO_memfile_free(MemFile *memfile)
 {
   while (MemFileChunk *chunk = static_cast<MemFileChunk *>(BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    /* The buffer is owned by the shared storage. */
     MEM_freeN(chunk);
   }
-  MEM_delete(memfile->shared_storage);
-  memfile->shared_storage = nullptr;
+  if (memfile->shared_storage) {
+    /* Chunk buffers may be removed from the store when freeing the shared storage. */
+    MemFileChunkStore &store = memfile_chunk_store();
+    std::scoped_lock lock(store.mutex);
+    MEM_delete(memfile->shared_storage);
+    memfile->shared_storage = nullptr;
+  }
   memfile->size = 0;
 }
 
@@ -57,35 +178,21 @@ MemFileSharedStorage::~MemFileSharedStorage()
     /* Removing the user makes sure shared data is freed when the undo step was its last owner. */
     sharing_info->remove_user_and_delete_if_last();
   }
+  for (const blender::ImplicitSharingInfo *sharing_info : chunk_buffers.values()) {
+    sharing_info->remove_user_and_delete_if_last();
+  }
 }
 
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  /* We use this mapping to store the memory buffers from second memfile chunks which are not owned
-   * by it (i.e. shared with some previous memory steps). */
-  blender::Map<const char *, MemFileChunk *> buffer_to_second_memchunk;
-
-  /* First, detect all memchunks in second memfile that are not owned by it. */
+  /* Every memfile owns a user of all the chunk buffers it uses, so buffers still used by the
+   * second memfile are kept alive when freeing the first one. */
+  UNUSED_VARS_NDEBUG(second);
+#ifndef NDEBUG
   LISTBASE_FOREACH (MemFileChunk *, sc, &second->chunks) {
-    if (sc->is_identical) {
-      buffer_to_second_memchunk.add(sc->buf, sc);
-    }
-  }
-
-  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
-   * it is also used by the second memfile, transfer the ownership. */
-  LISTBASE_FOREACH (MemFileChunk *, fc, &first->chunks) {
-    if (!fc->is_identical) {
-      if (MemFileChunk *sc = buffer_to_second_memchunk.lookup_default(fc->buf, nullptr)) {
-        BLI_assert(sc->is_identical);
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-      /* Note that if the second memfile does not use that chunk, we assume that the first one
-       * fully owns it without sharing it with any other memfile, and hence it should be freed with
-       * it. */
-    }
+    BLI_assert(second->shared_storage->chunk_buffers.contains(sc->buf));
   }
+#endif
 
   BLO_memfile_free(first);
 }
@@ -153,17 +260,20 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, size_t s
         curchunk->buf = compchunk->buf;
         curchunk->is_identical = true;
         compchunk->is_identical_future = true;
+        /* The reference memfile owns a user, so the buffer can't be freed in the meantime and
+         * the store doesn't need to be locked. */
+        memfile_chunk_buffer_add_user(
+            memfile,
+            curchunk->buf,
+            mem_data->reference_memfile->shared_storage->chunk_buffers.lookup(curchunk->buf));
       }
     }
     *compchunk_step = static_cast<MemFileChunk *>(compchunk->next);
   }
 
-  /* not equal... */
+  /* Not equal to the previous step, but the same data may still be stored already. */
   if (curchunk->buf == nullptr) {
-    char *buf_new = static_cast<char *>(MEM_mallocN(size, "Chunk buffer"));
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+    curchunk->buf = memfile_chunk_buffer_ensure(memfile, buf, size);
   }
 }
 
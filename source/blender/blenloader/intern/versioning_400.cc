@@ -1135,9 +1135,8 @@ static void version_vertex_weight_edit_preserve_threshold_exclusivity(Main *bmai
 
 static void version_mesh_crease_generic(Main &bmain)
 {
-  LISTBASE_FOREACH (Mesh *, mesh, &bmain.meshes) {
-    BKE_mesh_legacy_crease_to_generic(mesh);
-  }
+  version_foreach_id_parallel<Mesh>(bmain.meshes,
+                                    [](Mesh &mesh) { BKE_mesh_legacy_crease_to_generic(&mesh); });
 
   LISTBASE_FOREACH (bNodeTree *, ntree, &bmain.nodetrees) {
     if (ntree->type == NTREE_GEOMETRY) {
@@ -2798,16 +2797,14 @@ static void fix_built_in_curve_attribute_defaults(Main *bmain)
 void blo_do_versions_400(FileData *fd, Library * /*lib*/, Main *bmain)
 {
   if (!MAIN_VERSION_FILE_ATLEAST(bmain, 400, 1)) {
-    LISTBASE_FOREACH (Mesh *, mesh, &bmain->meshes) {
-      version_mesh_legacy_to_struct_of_array_format(*mesh);
-    }
+    version_foreach_id_parallel<Mesh>(bmain->meshes,
+                                      version_mesh_legacy_to_struct_of_array_format);
     version_movieclips_legacy_camera_object(bmain);
   }
 
   if (!MAIN_VERSION_FILE_ATLEAST(bmain, 400, 2)) {
-    LISTBASE_FOREACH (Mesh *, mesh, &bmain->meshes) {
-      BKE_mesh_legacy_bevel_weight_to_generic(mesh);
-    }
+    version_foreach_id_parallel<Mesh>(
+        bmain->meshes, [](Mesh &mesh) { BKE_mesh_legacy_bevel_weight_to_generic(&mesh); });
   }
 
   /* 400 4 did not require any do_version here. */
@@ -18,6 +18,8 @@
 #include "BLI_string.h"
 #include "BLI_string_ref.hh"
 #include "BLI_string_utf8.h"
+#include "BLI_task.hh"
+#include "BLI_vector.hh"
 
 #include "BKE_animsys.h"
 #include "BKE_grease_pencil_legacy_convert.hh"
@@ -113,6 +115,20 @@ ID *do_versions_rename_id(Main *bmain,
   return id;
 }
 
+void version_foreach_id_parallel(ListBase &id_list, FunctionRef<void(ID &id)> fn)
+{
+  blender::Vector<ID *> ids;
+  LISTBASE_FOREACH (ID *, id, &id_list) {
+    ids.append(id);
+  }
+  /* IDs can be very different in size, so let each one be a separate task. */
+  blender::threading::parallel_for(ids.index_range(), 1, [&](const blender::IndexRange range) {
+    for (const int64_t i : range) {
+      fn(*ids[i]);
+    }
+  });
+}
+
 static void change_node_socket_name(ListBase *sockets, const char *old_name, const char *new_name)
 {
   LISTBASE_FOREACH (bNodeSocket *, socket, sockets) {
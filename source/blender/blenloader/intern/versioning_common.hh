@@ -50,6 +50,21 @@ ARegion *do_versions_ensure_region(ListBase *regionbase,
  */
 ID *do_versions_rename_id(Main *bmain, short id_type, const char *name_src, const char *name_dst);
 
+/**
+ * Call \a fn for all IDs in \a id_list, using multiple threads.
+ *
+ * Only use this for versioning that is local to each ID, i.e. that only reads and modifies the ID
+ * itself and the data it owns (like converting legacy mesh arrays). Changes involving other IDs or
+ * the #Main (renaming, adding or removing IDs, changing user counts, ...) have to be done in a
+ * regular loop afterwards.
+ */
+void version_foreach_id_parallel(ListBase &id_list, FunctionRef<void(ID &id)> fn);
+template<typename IDType>
+inline void version_foreach_id_parallel(ListBase &id_list, FunctionRef<void(IDType &id)> fn)
+{
+  version_foreach_id_parallel(id_list, [&](ID &id) { fn(reinterpret_cast<IDType &>(id)); });
+}
+
 bool version_node_socket_is_used(bNodeSocket *sock);
 
 void version_node_socket_name(bNodeTree *ntree,
@@ -98,6 +98,7 @@
 #include "BLI_mempool.h"
 #include "BLI_set.hh"
 #include "BLI_threads.h"
+#include "BLI_vector.hh"
 
 #include "MEM_guardedalloc.h" /* MEM_freeN */
 
@@ -128,6 +129,7 @@
 #include "BLO_undofile.hh"
 #include "BLO_writefile.hh"
 
+#include "blend_journal.hh"
 #include "readfile.hh"
 
 #include <zstd.h>
@@ -144,8 +146,6 @@
 #define ZSTD_BUFFER_SIZE (1 << 21) /* 2mb */
 #define ZSTD_CHUNK_SIZE (1 << 20)  /* 1mb */
 
-#define ZSTD_COMPRESSION_LEVEL 3
-
 static CLG_LogRef LOG = {"blo.writefile"};
 
 /** Use if we want to store how many bytes have been written to the file. */
@@ -155,6 +155,34 @@ static CLG_LogRef LOG = {"blo.writefile"};
 /** \name Internal Write Wrapper's (Abstracts Compression)
  * \{ */
 
+/**
+ * Compression settings for each #eBLO_WriteCompressionProfile.
+ *
+ * Every frame is compressed independently (so they can be compressed in parallel and seeked to
+ * when reading), which limits how far back matches can be found. Larger chunks therefore give
+ * better compression, at the cost of more memory and coarser seeking when reading. For the same
+ * reason long-distance matching isn't used, it can't find anything beyond the frame either.
+ */
+struct ZstdCompressionProfile {
+  int level;
+  /** Size of the frames (the write buffer is twice as large). */
+  size_t chunk_size;
+};
+
+static ZstdCompressionProfile zstd_compression_profile_get(
+    const eBLO_WriteCompressionProfile profile)
+{
+  switch (profile) {
+    case BLO_WRITE_COMPRESSION_FAST:
+      return {1, ZSTD_CHUNK_SIZE};
+    case BLO_WRITE_COMPRESSION_ARCHIVAL:
+      return {15, ZSTD_CHUNK_SIZE << 3};
+    case BLO_WRITE_COMPRESSION_BALANCED:
+      break;
+  }
+  return {3, ZSTD_CHUNK_SIZE};
+}
+
 struct ZstdFrame {
   ZstdFrame *next, *prev;
 
@@ -167,9 +195,19 @@ class WriteWrap {
   virtual bool open(const char *filepath) = 0;
   virtual bool close() = 0;
   virtual bool write(const void *buf, size_t buf_len) = 0;
+  /**
+   * Called for every #BHead header after it has been passed to #write,
+   * so wrappers can store an index of the file's blocks.
+   */
+  virtual void add_bhead(const BHead & /*bhead*/) {}
 
   /** Buffer output (we only want when output isn't already buffered). */
   bool use_buf = true;
+  /** Flush the buffer after every ID, so unchanged IDs are written as identical chunks. */
+  bool use_id_chunks = false;
+  /** Size of the #WriteData buffer, see #WriteData.buffer. */
+  size_t buffer_max_size = ZSTD_BUFFER_SIZE;
+  size_t buffer_chunk_size = ZSTD_CHUNK_SIZE;
 };
 
 class RawWriteWrap : public WriteWrap {
@@ -206,6 +244,7 @@ bool RawWriteWrap::write(const void *buf, size_t buf_len)
 
 class ZstdWriteWrap : public WriteWrap {
   WriteWrap &base_wrap;
+  ZstdCompressionProfile profile;
 
   ListBase threadpool = {};
   ListBase tasks = {};
@@ -216,19 +255,29 @@ class ZstdWriteWrap : public WriteWrap {
 
   ListBase frames = {};
 
+  /** Copy of all written #BHead headers, see #BLEN_ZSTD_BHEAD_INDEX_MAGIC. */
+  blender::Vector<BHead> bhead_index;
+
   bool write_error = false;
 
  public:
-  ZstdWriteWrap(WriteWrap &base_wrap) : base_wrap(base_wrap) {}
+  ZstdWriteWrap(WriteWrap &base_wrap, const eBLO_WriteCompressionProfile profile)
+      : base_wrap(base_wrap), profile(zstd_compression_profile_get(profile))
+  {
+    buffer_max_size = this->profile.chunk_size * 2;
+    buffer_chunk_size = this->profile.chunk_size;
+  }
 
   bool open(const char *filepath) override;
   bool close() override;
   bool write(const void *buf, size_t buf_len) override;
+  void add_bhead(const BHead &bhead) override;
 
  private:
   struct ZstdWriteBlockTask;
   void write_task(ZstdWriteBlockTask *task);
   void write_u32_le(uint32_t val);
+  void write_bhead_index_frame();
   void write_seekable_frames();
 };
 
@@ -251,8 +300,11 @@ void ZstdWriteWrap::write_task(ZstdWriteBlockTask *task)
 {
   size_t out_buf_len = ZSTD_compressBound(task->size);
   void *out_buf = MEM_mallocN(out_buf_len, "Zstd out buffer");
-  size_t out_size = ZSTD_compress(
-      out_buf, out_buf_len, task->data, task->size, ZSTD_COMPRESSION_LEVEL);
+
+  ZSTD_CCtx *ctx = ZSTD_createCCtx();
+  ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, profile.level);
+  size_t out_size = ZSTD_compress2(ctx, out_buf, out_buf_len, task->data, task->size);
+  ZSTD_freeCCtx(ctx);
 
   MEM_freeN(task->data);
 
@@ -309,6 +361,42 @@ void ZstdWriteWrap::write_u32_le(uint32_t val)
   base_wrap.write(&val, sizeof(uint32_t));
 }
 
+void ZstdWriteWrap::add_bhead(const BHead &bhead)
+{
+  bhead_index.append(bhead);
+}
+
+/* Loading a compressed file has to walk all block headers, which are spread over all frames.
+ * To avoid decompressing the whole file just for that (e.g. when linking a few data-blocks from a
+ * library), a copy of the headers is stored uncompressed in a skippable frame. The frame has no
+ * uncompressed content, so it is listed in the seek table with an uncompressed size of zero,
+ * readers that don't know about it skip it.
+ *
+ * Content (all u32 little endian): version, size of a #BHead, number of headers,
+ * followed by the headers as they are written in the file. */
+void ZstdWriteWrap::write_bhead_index_frame()
+{
+  const uint32_t index_size = 12 + uint32_t(bhead_index.as_span().size_in_bytes());
+
+  write_u32_le(BLEN_ZSTD_BHEAD_INDEX_MAGIC);
+  write_u32_le(index_size);
+  write_u32_le(1);
+  write_u32_le(uint32_t(sizeof(BHead)));
+  write_u32_le(uint32_t(bhead_index.size()));
+  if (!bhead_index.is_empty() &&
+      !base_wrap.write(bhead_index.data(), bhead_index.as_span().size_in_bytes()))
+  {
+    write_error = true;
+    return;
+  }
+
+  ZstdFrame *frameinfo = static_cast<ZstdFrame *>(
+      MEM_mallocN(sizeof(ZstdFrame), "zstd frameinfo"));
+  frameinfo->uncompressed_size = 0;
+  frameinfo->compressed_size = 8 + index_size;
+  BLI_addtail(&frames, frameinfo);
+}
+
 /* In order to implement efficient seeking when reading the .blend, we append
  * a skippable frame that encodes information about the other frames present
  * in the file.
@@ -350,6 +438,9 @@ bool ZstdWriteWrap::close()
   BLI_mutex_end(&mutex);
   BLI_condition_end(&condition);
 
+  if (!write_error) {
+    write_bhead_index_frame();
+  }
   write_seekable_frames();
   BLI_freelistN(&frames);
 
@@ -393,6 +484,133 @@ bool ZstdWriteWrap::write(const void *buf, size_t buf_len)
   return true;
 }
 
+/**
+ * Appends to a journal file, see `blend_journal.hh`.
+ */
+class JournalWriteWrap : public WriteWrap {
+  BlendFileJournal &journal;
+
+  int file_handle = -1;
+  uint64_t file_size = 0;
+  /** When the journal is written from scratch, it's written to a temporary file first. */
+  bool is_new_file = false;
+  std::string filepath;
+  std::string filepath_tmp;
+
+  /** Chunks of the file being written. */
+  blender::Vector<BlendJournalChunkKey> manifest;
+
+  bool write_error = false;
+
+ public:
+  JournalWriteWrap(BlendFileJournal &journal) : journal(journal)
+  {
+    use_id_chunks = true;
+  }
+
+  bool open(const char *filepath) override;
+  bool close() override;
+  bool write(const void *buf, size_t buf_len) override;
+
+  /** Don't store the written file in the journal (when writing failed elsewhere). */
+  void cancel()
+  {
+    write_error = true;
+  }
+};
+
+bool JournalWriteWrap::open(const char *filepath)
+{
+  this->filepath = filepath;
+
+  /* Start over when the journal doesn't match the file on disk, or when most of the journal isn't
+   * used anymore (usually #BLO_write_journal_compact takes care of that). */
+  if (journal.filepath != this->filepath || journal.file_size == 0 ||
+      BLI_file_size(filepath) != journal.file_size ||
+      journal.file_size > journal.manifest_data_size() * 4)
+  {
+    journal.reset();
+    journal.filepath = this->filepath;
+    is_new_file = true;
+  }
+
+  if (is_new_file) {
+    filepath_tmp = this->filepath + "@";
+    file_handle = BLI_open(
+        filepath_tmp.c_str(), O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+    if (file_handle == -1) {
+      return false;
+    }
+    if (!blo_journal_write(file_handle, BLEND_JOURNAL_MAGIC, BLEND_JOURNAL_MAGIC_LEN)) {
+      write_error = true;
+    }
+    file_size = BLEND_JOURNAL_MAGIC_LEN;
+  }
+  else {
+    file_handle = BLI_open(filepath, O_BINARY + O_WRONLY, 0);
+    if (file_handle == -1) {
+      return false;
+    }
+    if (BLI_lseek(file_handle, int64_t(journal.file_size), SEEK_SET) == -1) {
+      ::close(file_handle);
+      return false;
+    }
+    file_size = journal.file_size;
+  }
+
+  return true;
+}
+
+bool JournalWriteWrap::close()
+{
+  bool ok = !write_error;
+  if (ok) {
+    std::swap(journal.manifest, manifest);
+    ok = blo_journal_manifest_write(file_handle, journal, &file_size);
+  }
+  if (::close(file_handle) == -1) {
+    ok = false;
+  }
+  if (ok && is_new_file) {
+    ok = BLI_rename_overwrite(filepath_tmp.c_str(), filepath.c_str()) == 0;
+  }
+
+  if (ok) {
+    journal.file_size = file_size;
+  }
+  else {
+    /* An interrupted append leaves the previous content of the journal readable, but the state
+     * doesn't match the file anymore. */
+    journal.reset();
+    if (is_new_file) {
+      BLI_delete(filepath_tmp.c_str(), false, false);
+    }
+  }
+  return ok;
+}
+
+bool JournalWriteWrap::write(const void *buf, size_t buf_len)
+{
+  if (write_error) {
+    return false;
+  }
+
+  const BlendJournalChunkKey key = BlendJournalChunkKey::from_data(buf, buf_len);
+  if (!journal.chunks.contains(key)) {
+    BlendJournalChunkRef ref{0, buf_len};
+    if (!blo_journal_record_write(
+            file_handle, BLEND_JOURNAL_RECORD_CHUNK, buf, buf_len, &file_size, &ref.offset))
+    {
+      write_error = true;
+      return false;
+    }
+    journal.chunks.add_new(key, ref);
+  }
+  manifest.append(key);
+
+  return true;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -473,8 +691,8 @@ static WriteData *writedata_new(WriteWrap *ww)
       wd->buffer.chunk_size = MEM_CHUNK_SIZE;
     }
     else {
-      wd->buffer.max_size = ZSTD_BUFFER_SIZE;
-      wd->buffer.chunk_size = ZSTD_CHUNK_SIZE;
+      wd->buffer.max_size = ww->buffer_max_size;
+      wd->buffer.chunk_size = ww->buffer_chunk_size;
     }
     wd->buffer.buf = static_cast<uchar *>(MEM_mallocN(wd->buffer.max_size, "wd->buffer.buf"));
   }
@@ -588,6 +806,18 @@ static void mywrite(WriteData *wd, const void *adr, size_t len)
   }
 }
 
+/**
+ * Write a #BHead header, also passing it to the write wrapper's block index.
+ * The block's data is expected to be written right after.
+ */
+static void mywrite_bhead(WriteData *wd, const BHead &bhead)
+{
+  mywrite(wd, &bhead, sizeof(BHead));
+  if (wd->ww && !wd->validation_data.critical_error) {
+    wd->ww->add_bhead(bhead);
+  }
+}
+
 /**
  * BeGiN initializer for mywrite
  * \param ww: File write wrapper.
@@ -680,6 +910,9 @@ static void mywrite_id_end(WriteData *wd, ID * /*id*/)
     mywrite_flush(wd);
     wd->mem.current_id_session_uid = MAIN_ID_SESSION_UID_UNSET;
   }
+  else if (wd->ww->use_id_chunks) {
+    mywrite_flush(wd);
+  }
 
   wd->validation_data.per_id_addresses_set.clear();
   wd->per_id_written_shared_addresses.clear();
@@ -746,7 +979,7 @@ static void writestruct_at_address_nr(
     return;
   }
 
-  mywrite(wd, &bh, sizeof(BHead));
+  mywrite_bhead(wd, bh);
   mywrite(wd, data, size_t(bh.len));
 }
 
@@ -786,7 +1019,7 @@ static void writedata(WriteData *wd, int filecode, size_t len, const void *adr)
   bh.SDNAnr = 0;
   bh.len = int(len);
 
-  mywrite(wd, &bh, sizeof(BHead));
+  mywrite_bhead(wd, bh);
   mywrite(wd, adr, len);
 }
 
@@ -1497,7 +1730,7 @@ static bool write_file_handle(Main *mainvar,
   /* End of file. */
   memset(&bhead, 0, sizeof(BHead));
   bhead.code = BLO_CODE_ENDB;
-  mywrite(wd, &bhead, sizeof(BHead));
+  mywrite_bhead(wd, bhead);
 
   blo_join_main(&mainlist);
 
@@ -1764,13 +1997,47 @@ bool BLO_write_file(Main *mainvar,
   RawWriteWrap raw_wrap;
 
   if (write_flags & G_FILE_COMPRESS) {
-    ZstdWriteWrap zstd_wrap(raw_wrap);
+    ZstdWriteWrap zstd_wrap(raw_wrap, params->compression_profile);
     return BLO_write_file_impl(mainvar, filepath, write_flags, params, reports, zstd_wrap);
   }
 
   return BLO_write_file_impl(mainvar, filepath, write_flags, params, reports, raw_wrap);
 }
 
+bool BLO_write_file_journal(Main *mainvar,
+                            const char *filepath,
+                            const int write_flags,
+                            BlendFileJournal *journal,
+                            ReportList *reports)
+{
+  BLI_assert(!BLI_path_is_rel(filepath));
+
+  JournalWriteWrap journal_wrap(*journal);
+
+  write_file_main_validate_pre(mainvar, reports);
+
+  if (journal_wrap.open(filepath) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", filepath, strerror(errno));
+    return false;
+  }
+
+  const bool err = write_file_handle(
+      mainvar, &journal_wrap, nullptr, nullptr, write_flags, false, nullptr);
+  if (err) {
+    journal_wrap.cancel();
+  }
+
+  if (!journal_wrap.close() || err) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot write file %s: %s", filepath, strerror(errno));
+    return false;
+  }
+
+  write_file_main_validate_post(mainvar, reports);
+
+  return true;
+}
+
 bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int write_flags)
 {
   bool use_userdef = false;
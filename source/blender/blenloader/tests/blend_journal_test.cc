@@ -0,0 +1,193 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "testing/testing.h"
+
+#include <cstddef>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_span.hh"
+#include "BLI_tempfile.h"
+
+#include "intern/blend_journal.hh"
+
+namespace blender::blenloader::tests {
+
+class BlendJournalTest : public testing::Test {
+ protected:
+  std::string filepath;
+  int file = -1;
+  BlendFileJournal journal;
+
+  void SetUp() override
+  {
+    char tempdir[FILE_MAX];
+    BLI_temp_directory_path_get(tempdir, sizeof(tempdir));
+    char path[FILE_MAX];
+    BLI_path_join(path, sizeof(path), tempdir, "blend_journal_test.jnl");
+    filepath = path;
+
+    file = BLI_open(filepath.c_str(), O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ASSERT_NE(file, -1);
+    ASSERT_TRUE(blo_journal_write(file, BLEND_JOURNAL_MAGIC, BLEND_JOURNAL_MAGIC_LEN));
+    journal.filepath = filepath;
+    journal.file_size = BLEND_JOURNAL_MAGIC_LEN;
+  }
+
+  void TearDown() override
+  {
+    if (file != -1) {
+      close(file);
+    }
+    BLI_delete(filepath.c_str(), false, false);
+  }
+
+  /** Append a manifest made of \a chunks, writing the chunks that are not in the journal yet. */
+  void append(const Span<std::string> chunks)
+  {
+    journal.manifest.clear();
+    for (const std::string &chunk : chunks) {
+      const BlendJournalChunkKey key = BlendJournalChunkKey::from_data(chunk.data(),
+                                                                       chunk.size());
+      if (!journal.chunks.contains(key)) {
+        BlendJournalChunkRef ref{0, chunk.size()};
+        ASSERT_TRUE(blo_journal_record_write(file,
+                                             BLEND_JOURNAL_RECORD_CHUNK,
+                                             chunk.data(),
+                                             chunk.size(),
+                                             &journal.file_size,
+                                             &ref.offset));
+        journal.chunks.add_new(key, ref);
+      }
+      journal.manifest.append(key);
+    }
+    ASSERT_TRUE(blo_journal_manifest_write(file, journal, &journal.file_size));
+  }
+
+  /** Contents of the journal file as written so far. */
+  std::string contents() const
+  {
+    size_t size = 0;
+    void *data = BLI_file_read_binary_as_mem(filepath.c_str(), 0, &size);
+    if (data == nullptr) {
+      return {};
+    }
+    std::string result(static_cast<const char *>(data), size);
+    MEM_freeN(data);
+    return result;
+  }
+};
+
+/** Read the blend-file stored in the journal file \a data, if any. */
+static std::optional<std::string> journal_read_stream(const std::string &data)
+{
+  FileReader *base = BLI_filereader_new_memory(data.data(), data.size());
+  FileReader *reader = blo_journal_filereader_new(base);
+  if (reader == nullptr) {
+    base->close(base);
+    return std::nullopt;
+  }
+  const off64_t size = reader->seek(reader, 0, SEEK_END);
+  std::string stream(size_t(size), '\0');
+  reader->seek(reader, 0, SEEK_SET);
+  const int64_t read_len = reader->read(reader, stream.data(), stream.size());
+  reader->close(reader);
+  if (read_len != size) {
+    return std::nullopt;
+  }
+  return stream;
+}
+
+TEST_F(BlendJournalTest, RoundTrip)
+{
+  append({"AAAA", "BB"});
+  EXPECT_EQ(journal_read_stream(contents()), "AAAABB");
+
+  /* Chunks are only stored once, the last manifest defines the content. */
+  append({"AAAA", "CCC", "AAAA"});
+  EXPECT_EQ(journal.chunks.size(), 3);
+  EXPECT_EQ(journal.manifest_data_size(), 11);
+  const std::string data = contents();
+  EXPECT_EQ(data.size(), journal.file_size);
+  EXPECT_EQ(journal_read_stream(data), "AAAACCCAAAA");
+
+  /* Reads spanning multiple chunks. */
+  FileReader *reader = blo_journal_filereader_new(
+      BLI_filereader_new_memory(data.data(), data.size()));
+  ASSERT_NE(reader, nullptr);
+  char buffer[5] = {};
+  EXPECT_EQ(reader->seek(reader, 3, SEEK_SET), 3);
+  EXPECT_EQ(reader->read(reader, buffer, 5), 5);
+  EXPECT_EQ(std::string(buffer, 5), "ACCCA");
+  /* Reading past the end returns what is left. */
+  EXPECT_EQ(reader->seek(reader, -2, SEEK_END), 9);
+  EXPECT_EQ(reader->read(reader, buffer, 5), 2);
+  EXPECT_EQ(std::string(buffer, 2), "AA");
+  reader->close(reader);
+}
+
+TEST_F(BlendJournalTest, Empty)
+{
+  append({});
+  EXPECT_EQ(journal_read_stream(contents()), "");
+}
+
+TEST_F(BlendJournalTest, Truncated)
+{
+  append({"AAAA", "BB"});
+  const size_t first_size = journal.file_size;
+  append({"AAAA", "CCC"});
+  const std::string data = contents();
+
+  /* An interrupted write leaves the previous content readable. */
+  for (size_t size = first_size; size < data.size(); size++) {
+    EXPECT_EQ(journal_read_stream(data.substr(0, size)), "AAAABB") << "Size " << size;
+  }
+  /* Without any complete manifest there is nothing to read. */
+  for (size_t size = 0; size < first_size; size++) {
+    EXPECT_FALSE(journal_read_stream(data.substr(0, size))) << "Size " << size;
+  }
+}
+
+TEST_F(BlendJournalTest, Corrupted)
+{
+  append({"AAAA", "BB"});
+  const size_t first_size = journal.file_size;
+  append({"AAAA", "CCC"});
+  const std::string data = contents();
+  const size_t footer_offset = data.size() - sizeof(BlendJournalFooter);
+
+  /* The last manifest is ignored when its footer is broken. */
+  std::string bad_magic = data;
+  bad_magic[footer_offset + offsetof(BlendJournalFooter, magic)] ^= 0xff;
+  EXPECT_EQ(journal_read_stream(bad_magic), "AAAABB");
+
+  /* When the footer doesn't point at a manifest, the records are scanned. */
+  std::string bad_offset = data;
+  bad_offset[footer_offset + offsetof(BlendJournalFooter, manifest_offset)] ^= 0x01;
+  EXPECT_EQ(journal_read_stream(bad_offset), "AAAACCC");
+
+  /* Scanning stops at records that aren't known. */
+  std::string bad_record = data.substr(0, data.size() - 1);
+  bad_record[first_size + offsetof(BlendJournalRecord, code)] ^= 0xff;
+  EXPECT_EQ(journal_read_stream(bad_record), "AAAABB");
+
+  std::string bad_file_magic = data;
+  bad_file_magic[0] ^= 0xff;
+  EXPECT_FALSE(journal_read_stream(bad_file_magic));
+}
+
+}  // namespace blender::blenloader::tests
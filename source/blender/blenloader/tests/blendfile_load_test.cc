@@ -3,7 +3,35 @@
  * SPDX-License-Identifier: GPL-2.0-or-later */
 #include "blendfile_loading_base_test.h"
 
+#include <cstdio>
+#include <string>
+
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_text_types.h"
+
+#include "BKE_collection.hh"
+#include "BKE_customdata.hh"
+#include "BKE_global.hh"
+#include "BKE_lib_id.hh"
+#include "BKE_main.hh"
+#include "BKE_material.h"
+#include "BKE_mesh.hh"
+#include "BKE_object.hh"
+#include "BKE_scene.hh"
+#include "BKE_text.h"
+
+#include "BLI_fileops.h"
 #include "BLI_path_util.h"
+#include "BLI_tempfile.h"
+
+#include "BLO_blend_defs.hh"
+#include "BLO_readfile.hh"
+#include "BLO_writefile.hh"
+
+#include "MEM_guardedalloc.h"
 
 class BlendfileLoadingTest : public BlendfileLoadingBaseTest {};
 
@@ -16,3 +44,289 @@ TEST_F(BlendfileLoadingTest, CanaryTest)
   depsgraph_create(DAG_EVAL_RENDER);
   EXPECT_NE(nullptr, this->depsgraph);
 }
+
+/* Write a main created by the test and read it back. */
+class BlendfileWriteReadTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  std::string filepath;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+    bmain = BKE_main_new();
+
+    char tempdir[FILE_MAX];
+    BLI_temp_directory_path_get(tempdir, sizeof(tempdir));
+    char path[FILE_MAX];
+    BLI_path_join(path, sizeof(path), tempdir, "blendfile_write_read_test.blend");
+    filepath = path;
+  }
+
+  void TearDown() override
+  {
+    BKE_main_free(bmain);
+    BLI_delete(filepath.c_str(), false, false);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  bool write(const BlendFileWriteParams &params, const int write_flags = 0)
+  {
+    return BLO_write_file(bmain, filepath.c_str(), write_flags, &params, nullptr);
+  }
+
+  bool read(const eBLOReadSkip skip_flags)
+  {
+    blendfile_free();
+    BlendFileReadReport reports = {};
+    bfile = BLO_read_from_file(filepath.c_str(), skip_flags | BLO_READ_SKIP_USERDEF, &reports);
+    return bfile != nullptr;
+  }
+
+  bool is_read(const short type, const char *name) const
+  {
+    return BKE_libblock_find_name(bfile->main, type, name) != nullptr;
+  }
+};
+
+TEST_F(BlendfileWriteReadTest, ReadPartial)
+{
+  /* Without a window-manager the first scene is the active one. */
+  Scene *active_scene = BKE_scene_add(bmain, "Active");
+  Scene *other_scene = BKE_scene_add(bmain, "Other");
+
+  Object *active_object = BKE_object_add_only_object(bmain, OB_EMPTY, "InActive");
+  BKE_collection_object_add(bmain, active_scene->master_collection, active_object);
+
+  Object *other_object = BKE_object_add_only_object(bmain, OB_MESH, "InOther");
+  other_object->data = BKE_mesh_add(bmain, "OtherMesh");
+  BKE_collection_object_add(bmain, other_scene->master_collection, other_object);
+
+  /* Texts have a fake user by default, give them a regular user instead, as if they were used by
+   * data of the other scene. */
+  Text *script = BKE_text_add(bmain, "register.py");
+  script->flags |= TXT_ISSCRIPT;
+  id_fake_user_clear(&script->id);
+  id_us_plus(&script->id);
+  Text *notes = BKE_text_add(bmain, "notes.txt");
+  id_fake_user_clear(&notes->id);
+  id_us_plus(&notes->id);
+
+  Material *kept_material = BKE_material_add(bmain, "Kept");
+  id_fake_user_set(&kept_material->id);
+
+  BlendFileWriteParams params = {};
+  ASSERT_TRUE(write(params));
+
+  ASSERT_TRUE(read(BLO_READ_SKIP_NONE));
+  EXPECT_FALSE(bfile->main->is_read_partial);
+  EXPECT_TRUE(is_read(ID_SCE, "Other"));
+  EXPECT_TRUE(is_read(ID_ME, "OtherMesh"));
+  EXPECT_TRUE(is_read(ID_TXT, "notes.txt"));
+
+  ASSERT_TRUE(read(BLO_READ_SKIP_INACTIVE_DATA));
+  EXPECT_TRUE(bfile->main->is_read_partial);
+  ASSERT_NE(bfile->curscene, nullptr);
+  EXPECT_STREQ(bfile->curscene->id.name, "SCActive");
+  EXPECT_TRUE(is_read(ID_OB, "InActive"));
+  /* Registered scripts and data kept with a fake user are read even when nothing uses them. */
+  EXPECT_TRUE(is_read(ID_TXT, "register.py"));
+  EXPECT_TRUE(is_read(ID_MA, "Kept"));
+  /* Everything else is only read when it is used. */
+  EXPECT_FALSE(is_read(ID_SCE, "Other"));
+  EXPECT_FALSE(is_read(ID_OB, "InOther"));
+  EXPECT_FALSE(is_read(ID_ME, "OtherMesh"));
+  EXPECT_FALSE(is_read(ID_TXT, "notes.txt"));
+}
+
+TEST_F(BlendfileWriteReadTest, Journal)
+{
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  Object *object = BKE_object_add_only_object(bmain, OB_EMPTY, "Empty");
+  BKE_collection_object_add(bmain, scene->master_collection, object);
+
+  BlendFileJournal *journal = BLO_write_journal_new();
+  ASSERT_TRUE(BLO_write_file_journal(bmain, filepath.c_str(), 0, journal, nullptr));
+  const size_t first_size = BLI_file_size(filepath.c_str());
+
+  /* Unchanged data is not written again. */
+  object->loc[0] = 2.0f;
+  Object *added_object = BKE_object_add_only_object(bmain, OB_EMPTY, "Added");
+  BKE_collection_object_add(bmain, scene->master_collection, added_object);
+  ASSERT_TRUE(BLO_write_file_journal(bmain, filepath.c_str(), 0, journal, nullptr));
+  EXPECT_LT(BLI_file_size(filepath.c_str()), first_size * 2);
+  BLO_write_journal_free(journal);
+
+  ASSERT_TRUE(read(BLO_READ_SKIP_NONE));
+  const Object *read_object = reinterpret_cast<const Object *>(
+      BKE_libblock_find_name(bfile->main, ID_OB, "Empty"));
+  ASSERT_NE(read_object, nullptr);
+  EXPECT_EQ(read_object->loc[0], 2.0f);
+  EXPECT_TRUE(is_read(ID_OB, "Added"));
+}
+
+TEST_F(BlendfileWriteReadTest, ReadFileMapped)
+{
+  /* Large enough for the positions to be used from the mapped file. */
+  const int verts_num = 100000;
+  Mesh *mesh = BKE_mesh_add(bmain, "Mesh");
+  id_fake_user_set(&mesh->id);
+  mesh->verts_num = verts_num;
+  CustomData_add_layer_named(
+      &mesh->vert_data, CD_PROP_FLOAT3, CD_CONSTRUCT, verts_num, "position");
+  blender::MutableSpan<blender::float3> positions = mesh->vert_positions_for_write();
+  for (const int i : positions.index_range()) {
+    positions[i] = blender::float3(i, i * 0.5f, -i);
+  }
+
+  BlendFileWriteParams params = {};
+  ASSERT_TRUE(write(params));
+  size_t file_size = 0;
+  void *file_data = BLI_file_read_binary_as_mem(filepath.c_str(), 0, &file_size);
+  ASSERT_NE(file_data, nullptr);
+  const blender::Span<char> file_content(static_cast<const char *>(file_data), file_size);
+
+  ASSERT_TRUE(read(BLO_READ_SKIP_NONE));
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const Mesh *mesh_read = reinterpret_cast<const Mesh *>(
+      BKE_libblock_find_name(bfile->main, ID_ME, "Mesh"));
+  ASSERT_NE(mesh_read, nullptr);
+  EXPECT_EQ(mesh_read->vert_positions(), positions.as_span());
+
+  G.f |= G_FLAG_READ_FILE_MAPPED;
+  const bool is_read = read(BLO_READ_SKIP_NONE);
+  G.f &= ~G_FLAG_READ_FILE_MAPPED;
+  ASSERT_TRUE(is_read);
+  /* The positions reference the mapped file instead of being copied. */
+  EXPECT_LE(MEM_get_memory_in_use() + positions.size_in_bytes() / 2, mem_in_use);
+  Mesh *mesh_mapped = reinterpret_cast<Mesh *>(
+      BKE_libblock_find_name(bfile->main, ID_ME, "Mesh"));
+  ASSERT_NE(mesh_mapped, nullptr);
+  EXPECT_EQ(mesh_mapped->vert_positions(), positions.as_span());
+
+  /* Modifying the data doesn't modify the file. */
+  mesh_mapped->vert_positions_for_write()[0] = blender::float3(1.0f, 2.0f, 3.0f);
+  positions[0] = blender::float3(1.0f, 2.0f, 3.0f);
+  EXPECT_EQ(mesh_mapped->vert_positions(), positions.as_span());
+  size_t file_size_after = 0;
+  void *file_data_after = BLI_file_read_binary_as_mem(filepath.c_str(), 0, &file_size_after);
+  ASSERT_NE(file_data_after, nullptr);
+  EXPECT_EQ(blender::Span<char>(static_cast<const char *>(file_data_after), file_size_after),
+            file_content);
+  MEM_freeN(file_data_after);
+  MEM_freeN(file_data);
+
+  /* The data remains valid when the file data is freed while it is still used. */
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval(*mesh_mapped);
+  blendfile_free();
+  EXPECT_EQ(mesh_copy->vert_positions(), positions.as_span());
+  BKE_id_free(nullptr, mesh_copy);
+}
+
+/* Write \a value little endian at \a offset of \a data. */
+static void write_u32_le(std::string &data, const size_t offset, const uint32_t value)
+{
+  for (const int i : blender::IndexRange(4)) {
+    data[offset + i] = char((value >> (i * 8)) & 0xff);
+  }
+}
+
+static uint32_t read_u32_le(const std::string &data, const size_t offset)
+{
+  uint32_t value = 0;
+  for (const int i : blender::IndexRange(4)) {
+    value |= uint32_t(uint8_t(data[offset + i])) << (i * 8);
+  }
+  return value;
+}
+
+TEST_F(BlendfileWriteReadTest, CompressedBHeadIndex)
+{
+  Scene *scene = BKE_scene_add(bmain, "Scene");
+  for (const int i : blender::IndexRange(10)) {
+    const std::string name = "Object" + std::to_string(i);
+    Object *object = BKE_object_add_only_object(bmain, OB_MESH, name.c_str());
+    Mesh *mesh = BKE_mesh_add(bmain, name.c_str());
+    object->data = mesh;
+    mesh->verts_num = 1000;
+    CustomData_add_layer_named(
+        &mesh->vert_data, CD_PROP_FLOAT3, CD_CONSTRUCT, mesh->verts_num, "position");
+    blender::MutableSpan<blender::float3> positions = mesh->vert_positions_for_write();
+    for (const int vert : positions.index_range()) {
+      positions[vert] = blender::float3(i, vert, 0.0f);
+    }
+    BKE_collection_object_add(bmain, scene->master_collection, object);
+  }
+
+  BlendFileWriteParams params = {};
+  ASSERT_TRUE(write(params, G_FILE_COMPRESS));
+
+  size_t file_size = 0;
+  void *file_data = BLI_file_read_binary_as_mem(filepath.c_str(), 0, &file_size);
+  ASSERT_NE(file_data, nullptr);
+  const std::string file_content(static_cast<const char *>(file_data), file_size);
+  MEM_freeN(file_data);
+
+  /* The index is the last frame listed in the seek table at the end of the file. The table starts
+   * with its magic and size, followed by two values per frame and a 9 bytes footer. */
+  const uint32_t frames_num = read_u32_le(file_content, file_size - 9);
+  const size_t seek_table_size = 8 + frames_num * 8 + 9;
+  const uint32_t index_frame_size = read_u32_le(file_content, file_size - 9 - 8);
+  EXPECT_EQ(read_u32_le(file_content, file_size - 9 - 4), 0u);
+  const size_t index_offset = file_size - seek_table_size - index_frame_size;
+  ASSERT_EQ(read_u32_le(file_content, index_offset), uint32_t(BLEN_ZSTD_BHEAD_INDEX_MAGIC));
+
+  const auto expect_read_content = [&](const char *description) {
+    SCOPED_TRACE(description);
+    ASSERT_TRUE(read(BLO_READ_SKIP_NONE));
+    for (const int i : blender::IndexRange(10)) {
+      const std::string name = "Object" + std::to_string(i);
+      const Object *object = reinterpret_cast<const Object *>(
+          BKE_libblock_find_name(bfile->main, ID_OB, name.c_str()));
+      ASSERT_NE(object, nullptr);
+      ASSERT_NE(object->data, nullptr);
+      const Mesh *mesh = static_cast<const Mesh *>(object->data);
+      const blender::Span<blender::float3> positions = mesh->vert_positions();
+      ASSERT_EQ(positions.size(), 1000);
+      EXPECT_EQ(positions.last(), blender::float3(i, 999.0f, 0.0f));
+    }
+  };
+  const auto write_content = [&](const std::string &content) {
+    FILE *file = BLI_fopen(filepath.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+    fclose(file);
+  };
+
+  expect_read_content("Index");
+
+  /* Any other skippable frame is ignored, as if the file was written without index. */
+  std::string missing_index = file_content;
+  write_u32_le(missing_index, index_offset, BLEN_ZSTD_BHEAD_INDEX_MAGIC + 1);
+  write_content(missing_index);
+  expect_read_content("Missing index");
+
+  /* The index content is: version, size of a BHead, number of BHeads, followed by the BHeads
+   * (starting with their code and length). */
+  const size_t index_content_offset = index_offset + 8;
+  std::string unknown_version = file_content;
+  write_u32_le(unknown_version, index_content_offset, 2);
+  write_content(unknown_version);
+  expect_read_content("Unknown version");
+
+  std::string wrong_count = file_content;
+  write_u32_le(wrong_count,
+               index_content_offset + 8,
+               read_u32_le(file_content, index_content_offset + 8) - 1);
+  write_content(wrong_count);
+  expect_read_content("Wrong count");
+
+  /* The block lengths in the index don't match the file anymore. */
+  std::string wrong_length = file_content;
+  const size_t first_bhead_len_offset = index_content_offset + 12 + 4;
+  write_u32_le(wrong_length,
+               first_bhead_len_offset,
+               read_u32_le(file_content, first_bhead_len_offset) + 4);
+  write_content(wrong_length);
+  expect_read_content("Wrong length");
+}
@@ -50,6 +50,23 @@ void DEG_debug_stats_gnuplot(const Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* ************************************************ */
+/* Evaluation Profiling */
+
+/**
+ * Write a summary of the last evaluation which was profiled, see `--debug-depsgraph-profile`.
+ * It contains the overall parallelism, the critical path and the slowest operations.
+ * \return False when no evaluation of the graph was profiled.
+ */
+bool DEG_debug_profile_write_summary(const Depsgraph *graph, FILE *fp);
+
+/**
+ * Write the last evaluation which was profiled in the Chrome trace event format, which can be
+ * opened in `chrome://tracing` or Perfetto.
+ * \return False when no evaluation of the graph was profiled.
+ */
+bool DEG_debug_profile_write_trace(const Depsgraph *graph, FILE *fp);
+
 /* ************************************************ */
 
 /** Compare two dependency graphs. */
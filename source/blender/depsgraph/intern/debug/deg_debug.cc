@@ -16,17 +16,25 @@
 
 #include "BKE_global.hh"
 
+#include "intern/debug/deg_debug_profile.h"
 #include "intern/depsgraph.hh"
 
 namespace blender::deg {
 
 DepsgraphDebug::DepsgraphDebug() : flags(G.debug), graph_evaluation_start_time_(0) {}
 
+DepsgraphDebug::~DepsgraphDebug() = default;
+
 bool DepsgraphDebug::do_time_debug() const
 {
   return ((G.debug & G_DEBUG_DEPSGRAPH_TIME) != 0);
 }
 
+bool DepsgraphDebug::do_profile() const
+{
+  return ((G.debug & G_DEBUG_DEPSGRAPH_PROFILE) != 0);
+}
+
 void DepsgraphDebug::begin_graph_evaluation()
 {
   if (!do_time_debug()) {
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "intern/depsgraph_type.hh"
 
 #include "BKE_global.hh"
@@ -16,11 +18,15 @@
 
 namespace blender::deg {
 
+class EvaluationProfile;
+
 class DepsgraphDebug {
  public:
   DepsgraphDebug();
+  ~DepsgraphDebug();
 
   bool do_time_debug() const;
+  bool do_profile() const;
 
   void begin_graph_evaluation();
   void end_graph_evaluation();
@@ -32,6 +38,9 @@ class DepsgraphDebug {
    * created for different view layer). */
   string name;
 
+  /* Recording of the last evaluation which happened while profiling was enabled. */
+  std::unique_ptr<EvaluationProfile> profile;
+
  protected:
   /* Maximum number of counters used to calculate frame rate of depsgraph update. */
   static const constexpr int MAX_FPS_COUNTERS = 64;
@@ -0,0 +1,369 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_profile.h"
+
+#include <algorithm>
+
+#include "BLI_array.hh"
+#include "BLI_map.hh"
+#include "BLI_set.hh"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "DEG_depsgraph_debug.hh"
+
+#include "intern/depsgraph.hh"
+#include "intern/depsgraph_relation.hh"
+#include "intern/node/deg_node_operation.hh"
+
+namespace deg = blender::deg;
+
+namespace blender::deg {
+
+/* Number of operations listed in the summary table of the slowest operations. */
+static constexpr int SLOWEST_OPERATIONS_NUM = 10;
+
+void EvaluationProfile::begin_evaluation(const double start_time)
+{
+  for (Vector<ThreadRecord> &thread_records : thread_records_) {
+    thread_records.clear();
+  }
+  records_.clear();
+  critical_path_.clear();
+  time_per_parallelism_.clear();
+  threads_num_ = 0;
+  has_recording_ = false;
+  evaluation_start_time_ = start_time;
+}
+
+void EvaluationProfile::record_operation(const OperationNode *operation_node,
+                                         const double start_time,
+                                         const double end_time)
+{
+  thread_records_.local().append(
+      {operation_node, start_time, end_time, BLI_task_parallel_thread_id(nullptr)});
+}
+
+/* Find the evaluated operation which the given operation waited for: the dependency which
+ * finished last. No-op operations are not evaluated, so dependencies are looked up through them.
+ * Returns -1 when the operation has no evaluated dependencies. */
+static int find_last_dependency(const OperationNode *operation_node,
+                                const double start_time,
+                                const Map<const OperationNode *, int> &record_indices,
+                                const Span<EvaluationProfile::OperationRecord> records)
+{
+  int last_dependency = -1;
+  Vector<const OperationNode *> stack = {operation_node};
+  Set<const OperationNode *> visited;
+  while (!stack.is_empty()) {
+    const OperationNode *node = stack.pop_last();
+    for (const Relation *rel : node->inlinks) {
+      if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+        continue;
+      }
+      const OperationNode *from = reinterpret_cast<const OperationNode *>(rel->from);
+      if (!visited.add(from)) {
+        continue;
+      }
+      const int index = record_indices.lookup_default(from, -1);
+      if (index != -1) {
+        const EvaluationProfile::OperationRecord &record = records[index];
+        if (record.end_time <= start_time &&
+            (last_dependency == -1 || record.end_time > records[last_dependency].end_time))
+        {
+          last_dependency = index;
+        }
+      }
+      else if (from->is_noop()) {
+        stack.append(from);
+      }
+    }
+  }
+  return last_dependency;
+}
+
+void EvaluationProfile::end_evaluation(const double end_time)
+{
+  evaluation_end_time_ = end_time - evaluation_start_time_;
+
+  Vector<ThreadRecord> thread_records;
+  for (const Vector<ThreadRecord> &records : thread_records_) {
+    thread_records.extend(records);
+  }
+  std::sort(thread_records.begin(),
+            thread_records.end(),
+            [](const ThreadRecord &a, const ThreadRecord &b) {
+              return a.start_time < b.start_time;
+            });
+
+  Map<const OperationNode *, int> record_indices;
+  Set<int> threads;
+  for (const int i : thread_records.index_range()) {
+    const ThreadRecord &thread_record = thread_records[i];
+    OperationRecord record;
+    record.name = thread_record.operation_node->full_identifier();
+    record.start_time = thread_record.start_time - evaluation_start_time_;
+    record.end_time = thread_record.end_time - evaluation_start_time_;
+    record.wait_time = 0.0;
+    record.thread_index = thread_record.thread_index;
+    record.is_on_critical_path = false;
+    records_.append(std::move(record));
+    record_indices.add(thread_record.operation_node, i);
+    threads.add(thread_record.thread_index);
+  }
+  threads_num_ = threads.size();
+
+  /* Find the operation each operation waited for. */
+  Array<int> last_dependencies(records_.size());
+  for (const int i : records_.index_range()) {
+    OperationRecord &record = records_[i];
+    last_dependencies[i] = find_last_dependency(
+        thread_records[i].operation_node, record.start_time, record_indices, records_);
+    const double ready_time = last_dependencies[i] == -1 ?
+                                  0.0 :
+                                  records_[last_dependencies[i]].end_time;
+    record.wait_time = std::max(record.start_time - ready_time, 0.0);
+  }
+
+  /* The critical path ends with the operation which finished last. */
+  int last_operation = -1;
+  for (const int i : records_.index_range()) {
+    if (last_operation == -1 || records_[i].end_time > records_[last_operation].end_time) {
+      last_operation = i;
+    }
+  }
+  for (int i = last_operation; i != -1; i = last_dependencies[i]) {
+    records_[i].is_on_critical_path = true;
+    critical_path_.append(i);
+  }
+  std::reverse(critical_path_.begin(), critical_path_.end());
+
+  /* Sweep over the start and end of all operations to find how many were running at a time. */
+  Vector<std::pair<double, int>> events;
+  for (const OperationRecord &record : records_) {
+    events.append({record.start_time, 1});
+    events.append({record.end_time, -1});
+  }
+  std::sort(events.begin(), events.end());
+  double previous_time = 0.0;
+  int running_num = 0;
+  for (const std::pair<double, int> &event : events) {
+    if (time_per_parallelism_.size() <= running_num) {
+      time_per_parallelism_.resize(running_num + 1, 0.0);
+    }
+    time_per_parallelism_[running_num] += event.first - previous_time;
+    previous_time = event.first;
+    running_num += event.second;
+  }
+  if (time_per_parallelism_.is_empty()) {
+    time_per_parallelism_.append(0.0);
+  }
+  time_per_parallelism_[0] += std::max(evaluation_end_time_ - previous_time, 0.0);
+
+  has_recording_ = true;
+}
+
+bool EvaluationProfile::has_recording() const
+{
+  return has_recording_;
+}
+
+Span<EvaluationProfile::OperationRecord> EvaluationProfile::records() const
+{
+  return records_;
+}
+
+Span<int> EvaluationProfile::critical_path() const
+{
+  return critical_path_;
+}
+
+Span<double> EvaluationProfile::time_per_parallelism() const
+{
+  return time_per_parallelism_;
+}
+
+static void write_operation_row(FILE *file, const EvaluationProfile::OperationRecord &record)
+{
+  fprintf(file,
+          "  %10.3f %10.3f %10.3f %6d  %s\n",
+          record.start_time * 1000.0,
+          (record.end_time - record.start_time) * 1000.0,
+          record.wait_time * 1000.0,
+          record.thread_index,
+          record.name.c_str());
+}
+
+static void write_operation_header(FILE *file)
+{
+  fprintf(file,
+          "  %10s %10s %10s %6s  %s\n",
+          "Start ms",
+          "Time ms",
+          "Wait ms",
+          "Thread",
+          "Operation");
+}
+
+void EvaluationProfile::write_summary(FILE *file, const char *label) const
+{
+  double operations_time = 0.0;
+  for (const OperationRecord &record : records_) {
+    operations_time += record.end_time - record.start_time;
+  }
+  double critical_path_time = 0.0;
+  double critical_path_wait_time = 0.0;
+  for (const int i : critical_path_) {
+    critical_path_time += records_[i].end_time - records_[i].start_time;
+    critical_path_wait_time += records_[i].wait_time;
+  }
+
+  if (label != nullptr && label[0] != '\0') {
+    fprintf(file, "Depsgraph [%s] evaluation profile:\n", label);
+  }
+  else {
+    fprintf(file, "Depsgraph evaluation profile:\n");
+  }
+  fprintf(file, "  Evaluation time: %.3f ms\n", evaluation_end_time_ * 1000.0);
+  fprintf(file,
+          "  Operations: %d evaluated on %d threads, %.3f ms in total\n",
+          int(records_.size()),
+          threads_num_,
+          operations_time * 1000.0);
+  fprintf(file,
+          "  Average parallelism: %.2f\n",
+          evaluation_end_time_ > 0.0 ? operations_time / evaluation_end_time_ : 0.0);
+  fprintf(file,
+          "  Critical path: %d operations, %.3f ms evaluating, %.3f ms waiting\n",
+          int(critical_path_.size()),
+          critical_path_time * 1000.0,
+          critical_path_wait_time * 1000.0);
+
+  fprintf(file, "\nTime per number of running operations:\n");
+  for (const int i : time_per_parallelism_.index_range()) {
+    fprintf(file, "  %4d: %10.3f ms\n", i, time_per_parallelism_[i] * 1000.0);
+  }
+
+  fprintf(file, "\nCritical path:\n");
+  write_operation_header(file);
+  for (const int i : critical_path_) {
+    write_operation_row(file, records_[i]);
+  }
+
+  Vector<const OperationRecord *> slowest_records;
+  for (const OperationRecord &record : records_) {
+    slowest_records.append(&record);
+  }
+  const int slowest_num = std::min<int>(SLOWEST_OPERATIONS_NUM, slowest_records.size());
+  std::partial_sort(slowest_records.begin(),
+                    slowest_records.begin() + slowest_num,
+                    slowest_records.end(),
+                    [](const OperationRecord *a, const OperationRecord *b) {
+                      return (a->end_time - a->start_time) > (b->end_time - b->start_time);
+                    });
+  fprintf(file, "\nSlowest operations:\n");
+  write_operation_header(file);
+  for (const OperationRecord *record : slowest_records.as_span().take_front(slowest_num)) {
+    write_operation_row(file, *record);
+  }
+  fflush(file);
+}
+
+static void write_json_string(FILE *file, const StringRef str)
+{
+  fputc('"', file);
+  for (const char c : str) {
+    if (ELEM(c, '"', '\\')) {
+      fputc('\\', file);
+      fputc(c, file);
+    }
+    else if (uint8_t(c) < 0x20) {
+      fprintf(file, "\\u%04x", int(c));
+    }
+    else {
+      fputc(c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+void EvaluationProfile::write_chrome_trace(FILE *file) const
+{
+  /* Chrome traces use microseconds. */
+  const double to_us = 1e6;
+
+  fprintf(file, "{\"traceEvents\":[\n");
+  bool first = true;
+  auto separator = [&]() {
+    if (!first) {
+      fprintf(file, ",\n");
+    }
+    first = false;
+  };
+
+  for (const OperationRecord &record : records_) {
+    separator();
+    fprintf(file, "{\"name\":");
+    write_json_string(file, record.name);
+    fprintf(file,
+            ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+            record.is_on_critical_path ? "depsgraph,critical_path" : "depsgraph",
+            record.start_time * to_us,
+            (record.end_time - record.start_time) * to_us,
+            record.thread_index);
+    if (record.is_on_critical_path) {
+      fprintf(file, ",\"cname\":\"terrible\"");
+    }
+    fprintf(file, ",\"args\":{\"wait_ms\":%.3f}}", record.wait_time * 1000.0);
+  }
+
+  /* Number of running operations over time. */
+  Vector<std::pair<double, int>> events;
+  for (const OperationRecord &record : records_) {
+    events.append({record.start_time, 1});
+    events.append({record.end_time, -1});
+  }
+  std::sort(events.begin(), events.end());
+  int running_num = 0;
+  for (const std::pair<double, int> &event : events) {
+    running_num += event.second;
+    separator();
+    fprintf(file,
+            "{\"name\":\"Running operations\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,"
+            "\"args\":{\"operations\":%d}}",
+            event.first * to_us,
+            running_num);
+  }
+
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+}  // namespace blender::deg
+
+bool DEG_debug_profile_write_summary(const Depsgraph *depsgraph, FILE *fp)
+{
+  const deg::Depsgraph *deg_graph = reinterpret_cast<const deg::Depsgraph *>(depsgraph);
+  const deg::EvaluationProfile *profile = deg_graph->debug.profile.get();
+  if (profile == nullptr || !profile->has_recording()) {
+    return false;
+  }
+  profile->write_summary(fp, deg_graph->debug.name.c_str());
+  return true;
+}
+
+bool DEG_debug_profile_write_trace(const Depsgraph *depsgraph, FILE *fp)
+{
+  const deg::Depsgraph *deg_graph = reinterpret_cast<const deg::Depsgraph *>(depsgraph);
+  const deg::EvaluationProfile *profile = deg_graph->debug.profile.get();
+  if (profile == nullptr || !profile->has_recording()) {
+    return false;
+  }
+  profile->write_chrome_trace(fp);
+  return true;
+}
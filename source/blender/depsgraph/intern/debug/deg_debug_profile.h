@@ -0,0 +1,96 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#pragma once
+
+#include <cstdio>
+
+#include "BLI_enumerable_thread_specific.hh"
+#include "BLI_span.hh"
+#include "BLI_vector.hh"
+
+#include "intern/depsgraph_type.hh"
+
+namespace blender::deg {
+
+struct OperationNode;
+
+/* Recording of when every operation of a graph evaluation ran and on which thread.
+ *
+ * From the recording the critical path of the evaluation is found: the chain of operations which
+ * were waiting on each other and which ended with the operation finishing last. Operations on this
+ * path are the ones which limit how fast the graph can be evaluated, regardless of the number of
+ * threads. */
+class EvaluationProfile {
+ public:
+  struct OperationRecord {
+    /* Full identifier of the operation, including its owner. */
+    string name;
+    /* Times in seconds relative to the start of the evaluation. */
+    double start_time;
+    double end_time;
+    /* Time between the end of the last dependency of the operation and its start. Operations
+     * without evaluated dependencies count from the start of the evaluation. */
+    double wait_time;
+    int thread_index;
+    bool is_on_critical_path;
+  };
+
+  /* Prepare for recording a new evaluation, discarding the previous recording. All times are as
+   * returned by #BLI_time_now_seconds(). */
+  void begin_evaluation(double start_time);
+
+  /* Record the evaluation of an operation. Can be called from multiple threads. */
+  void record_operation(const OperationNode *operation_node, double start_time, double end_time);
+
+  /* Finish the recording and analyze it. Must be called while the evaluated operation nodes still
+   * exist, since their relations are used to find the critical path. */
+  void end_evaluation(double end_time);
+
+  /* Whether an evaluation has been recorded. */
+  bool has_recording() const;
+
+  /* Evaluated operations, ordered by their start time. */
+  Span<OperationRecord> records() const;
+  /* Indices into #records() of the operations on the critical path, in evaluation order. */
+  Span<int> critical_path() const;
+  /* Time during which the given number of operations were running at the same time. */
+  Span<double> time_per_parallelism() const;
+
+  /* Table with the overall timing, the parallelism, the critical path and the slowest
+   * operations. */
+  void write_summary(FILE *file, const char *label) const;
+
+  /* Trace in the Chrome trace event format, which can be opened in `chrome://tracing` or
+   * https://ui.perfetto.dev. Operations on the critical path are highlighted. */
+  void write_chrome_trace(FILE *file) const;
+
+ private:
+  struct ThreadRecord {
+    const OperationNode *operation_node;
+    double start_time;
+    double end_time;
+    int thread_index;
+  };
+
+  threading::EnumerableThreadSpecific<Vector<ThreadRecord>> thread_records_;
+
+  double evaluation_start_time_ = 0.0;
+  double evaluation_end_time_ = 0.0;
+  bool has_recording_ = false;
+
+  /* Evaluated operations, ordered by their start time. */
+  Vector<OperationRecord> records_;
+  /* Indices of the operations on the critical path, in the order they were evaluated. */
+  Vector<int> critical_path_;
+  /* Time during which the given number of operations were running at the same time. */
+  Vector<double> time_per_parallelism_;
+  int threads_num_ = 0;
+};
+
+}  // namespace blender::deg
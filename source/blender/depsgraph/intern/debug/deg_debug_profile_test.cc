@@ -0,0 +1,99 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_profile.h"
+
+#include "intern/depsgraph_relation.hh"
+#include "intern/node/deg_node_component.hh"
+#include "intern/node/deg_node_id.hh"
+#include "intern/node/deg_node_operation.hh"
+
+#include "testing/testing.h"
+
+namespace blender::deg::tests {
+
+TEST(deg_debug_profile, CriticalPath)
+{
+  IDNode id_node;
+  id_node.id_orig = nullptr;
+  id_node.name = "OBCube";
+  ComponentNode component;
+  component.type = NodeType::TRANSFORM;
+  component.owner = &id_node;
+
+  /* a -> c, a -> d, b -> c, with a no-op operation between b and c. */
+  OperationNode a, b, c, d, noop;
+  for (OperationNode *op_node : {&a, &b, &c, &d, &noop}) {
+    op_node->type = NodeType::OPERATION;
+    op_node->owner = &component;
+    op_node->opcode = OperationCode::TRANSFORM_LOCAL;
+    op_node->evaluate = [](::Depsgraph * /*depsgraph*/) {};
+  }
+  noop.evaluate = nullptr;
+  a.name = "a";
+  b.name = "b";
+  c.name = "c";
+  d.name = "d";
+  new Relation(&a, &c, "a -> c");
+  new Relation(&a, &d, "a -> d");
+  new Relation(&b, &noop, "b -> noop");
+  new Relation(&noop, &c, "noop -> c");
+
+  /* Recorded out of order, as happens with multiple threads. */
+  const double start_time = 100.0;
+  EvaluationProfile profile;
+  profile.begin_evaluation(start_time);
+  profile.record_operation(&c, start_time + 2.5, start_time + 3.0);
+  profile.record_operation(&a, start_time + 0.0, start_time + 1.0);
+  profile.record_operation(&d, start_time + 1.0, start_time + 1.5);
+  profile.record_operation(&b, start_time + 0.1, start_time + 2.0);
+  EXPECT_FALSE(profile.has_recording());
+  profile.end_evaluation(start_time + 3.2);
+  EXPECT_TRUE(profile.has_recording());
+
+  const Span<EvaluationProfile::OperationRecord> records = profile.records();
+  ASSERT_EQ(records.size(), 4);
+  EXPECT_EQ(records[0].name, "OBCube/" + a.identifier());
+  EXPECT_EQ(records[1].name, "OBCube/" + b.identifier());
+  EXPECT_EQ(records[2].name, "OBCube/" + d.identifier());
+  EXPECT_EQ(records[3].name, "OBCube/" + c.identifier());
+  EXPECT_DOUBLE_EQ(records[3].start_time, 2.5);
+  EXPECT_DOUBLE_EQ(records[3].end_time, 3.0);
+
+  /* c waited for b through the no-op, which finished after a. */
+  EXPECT_DOUBLE_EQ(records[0].wait_time, 0.0);
+  EXPECT_NEAR(records[1].wait_time, 0.1, 1e-9);
+  EXPECT_DOUBLE_EQ(records[2].wait_time, 0.0);
+  EXPECT_DOUBLE_EQ(records[3].wait_time, 0.5);
+
+  EXPECT_EQ(profile.critical_path(), Span<int>({1, 3}));
+  EXPECT_FALSE(records[0].is_on_critical_path);
+  EXPECT_TRUE(records[1].is_on_critical_path);
+  EXPECT_FALSE(records[2].is_on_critical_path);
+  EXPECT_TRUE(records[3].is_on_critical_path);
+
+  /* Nothing runs between b and c, and after c until the end of the evaluation. */
+  const Span<double> time_per_parallelism = profile.time_per_parallelism();
+  ASSERT_EQ(time_per_parallelism.size(), 3);
+  EXPECT_NEAR(time_per_parallelism[0], 0.7, 1e-9);
+  EXPECT_NEAR(time_per_parallelism[1], 1.1, 1e-9);
+  EXPECT_NEAR(time_per_parallelism[2], 1.4, 1e-9);
+}
+
+TEST(deg_debug_profile, Empty)
+{
+  EvaluationProfile profile;
+  profile.begin_evaluation(0.0);
+  profile.end_evaluation(0.5);
+  EXPECT_TRUE(profile.has_recording());
+  EXPECT_TRUE(profile.records().is_empty());
+  EXPECT_TRUE(profile.critical_path().is_empty());
+  EXPECT_EQ(profile.time_per_parallelism(), Span<double>({0.5}));
+}
+
+}  // namespace blender::deg::tests
@@ -10,14 +10,22 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+#include <atomic>
+#include <optional>
+
 #include "BLI_compiler_attrs.h"
 #include "BLI_function_ref.hh"
 #include "BLI_gsqueue.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
+#include "BLI_task_trace.hh"
 #include "BLI_time.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "BKE_global.hh"
+#include "BKE_scene.hh"
 
 #include "DNA_node_types.h"
 #include "DNA_object_types.h"
@@ -32,6 +40,7 @@
 
 #include "atomic_ops.h"
 
+#include "intern/debug/deg_debug_profile.h"
 #include "intern/depsgraph.hh"
 #include "intern/depsgraph_relation.hh"
 #include "intern/depsgraph_tag.hh"
@@ -80,25 +89,51 @@ enum class EvaluationStage {
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Non-null when the timing of every operation is to be recorded. */
+  EvaluationProfile *profile = nullptr;
   EvaluationStage stage;
   bool need_update_pending_parents = true;
   bool need_single_thread_pass = false;
+  /* Estimated evaluation time of some operations changed, so the priorities are to be updated for
+   * the next evaluation. */
+  std::atomic<bool> operation_costs_changed = false;
 };
 
-void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
+/* Order operations such that the ones with the longest critical path come first. */
+void sort_by_priority(MutableSpan<OperationNode *> operation_nodes)
+{
+  std::sort(operation_nodes.begin(),
+            operation_nodes.end(),
+            [](const OperationNode *a, const OperationNode *b) {
+              return a->critical_path_time > b->critical_path_time;
+            });
+}
+
+void evaluate_node(DepsgraphEvalState *state, OperationNode *operation_node)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
 
   /* Sanity checks. */
   BLI_assert_msg(!operation_node->is_noop(), "NOOP nodes should not actually be scheduled");
+  std::optional<threading::trace::Scope> trace_scope;
+  if (threading::trace::is_enabled()) {
+    trace_scope.emplace(operation_node->full_identifier(), "depsgraph");
+  }
   /* Perform operation. */
+  const double start_time = BLI_time_now_seconds();
+  operation_node->evaluate(depsgraph);
+  const double time = BLI_time_now_seconds() - start_time;
   if (state->do_stats) {
-    const double start_time = BLI_time_now_seconds();
-    operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += BLI_time_now_seconds() - start_time;
+    operation_node->stats.current_time += time;
+  }
+  if (state->profile != nullptr) {
+    state->profile->record_operation(operation_node, start_time, start_time + time);
   }
-  else {
-    operation_node->evaluate(depsgraph);
+  /* Update the cost model used for scheduling. */
+  if (deg_eval_stats_update_cost(operation_node, time) &&
+      !state->operation_costs_changed.load(std::memory_order_relaxed))
+  {
+    state->operation_costs_changed.store(true, std::memory_order_relaxed);
   }
 
   /* Clear the flag early on, allowing partial updates without re-evaluating the same node multiple
@@ -113,14 +148,38 @@ void deg_task_run_func(TaskPool *pool, void *taskdata)
   void *userdata_v = BLI_task_pool_user_data(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
-  OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  /* Operations to be evaluated by this task, the last one is evaluated first. */
+  Vector<OperationNode *, 16> local_nodes;
+  local_nodes.append(reinterpret_cast<OperationNode *>(taskdata));
+  Vector<OperationNode *, 16> ready_children;
 
-  /* Schedule children. */
-  schedule_children(state, operation_node, [&](OperationNode *node) {
-    BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
-  });
+  while (!local_nodes.is_empty()) {
+    /* Evaluate node. */
+    OperationNode *operation_node = local_nodes.pop_last();
+    evaluate_node(state, operation_node);
+
+    /* Schedule children. */
+    ready_children.clear();
+    schedule_children(
+        state, operation_node, [&](OperationNode *node) { ready_children.append(node); });
+    if (ready_children.is_empty()) {
+      continue;
+    }
+    sort_by_priority(ready_children);
+    /* Push expensive children to the pool in the order of their priority, so that other threads
+     * pick up the most critical ones first. Cheap ones are not worth the task overhead. */
+    for (OperationNode *node : ready_children.as_span().drop_front(1)) {
+      if (deg_eval_stats_is_cheap(node)) {
+        local_nodes.append(node);
+      }
+      else {
+        BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
+      }
+    }
+    /* Continue with the most critical child on this thread. This avoids the task overhead for
+     * chains of operations, like bones of a rig which are evaluated one after another. */
+    local_nodes.append(ready_children.first());
+  }
 }
 
 bool check_operation_node_visible(const DepsgraphEvalState *state, OperationNode *op_node)
@@ -317,9 +376,12 @@ void evaluate_graph_threaded_stage(DepsgraphEvalState *state,
 
   calculate_pending_parents_if_needed(state);
 
-  schedule_graph(state, [&](OperationNode *node) {
+  Vector<OperationNode *> ready_nodes;
+  schedule_graph(state, [&](OperationNode *node) { ready_nodes.append(node); });
+  sort_by_priority(ready_nodes);
+  for (OperationNode *node : ready_nodes) {
     BLI_task_pool_push(task_pool, deg_task_run_func, node, false, nullptr);
-  });
+  }
   BLI_task_pool_work_and_wait(task_pool);
 }
 
@@ -366,6 +428,10 @@ void depsgraph_ensure_view_layer(Depsgraph *graph)
 
   const IDNode *scene_id_node = graph->find_id_node(&graph->scene->id);
   deg_update_eval_copy_datablock(graph, scene_id_node);
+
+  /* The copy has the frame of the original scene, which differs from the frame of the graph when
+   * it is evaluated for another frame, for example ahead of time during animation renders. */
+  BKE_scene_frame_set(scene_cow, graph->frame);
 }
 
 TaskPool *deg_evaluate_task_pool_create(DepsgraphEvalState *state)
@@ -402,6 +468,13 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  if (graph->debug.do_profile()) {
+    if (!graph->debug.profile) {
+      graph->debug.profile = std::make_unique<EvaluationProfile>();
+    }
+    state.profile = graph->debug.profile.get();
+    state.profile->begin_evaluation(BLI_time_now_seconds());
+  }
 
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
@@ -423,30 +496,36 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
    *
    * - Single-threaded pass of all remaining operations. */
 
-  TaskPool *task_pool = deg_evaluate_task_pool_create(&state);
+  /* The active depsgraph is what the user is waiting for, run its tasks before other work like
+   * previews. Other depsgraphs keep the priority of the caller, e.g. a low priority prefetch. */
+  const threading::TaskPriority priority = graph->is_active ? threading::TaskPriority::High :
+                                                              threading::TaskPriority::Normal;
+  threading::execute_with_priority(priority, [&]() {
+    TaskPool *task_pool = deg_evaluate_task_pool_create(&state);
 
-  evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::COPY_ON_EVAL);
+    evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::COPY_ON_EVAL);
 
-  if (graph->has_animated_visibility || graph->need_update_nodes_visibility) {
-    /* Update pending parents including only the ones which are affecting operations which are
-     * affecting visibility. */
-    state.need_update_pending_parents = true;
+    if (graph->has_animated_visibility || graph->need_update_nodes_visibility) {
+      /* Update pending parents including only the ones which are affecting operations which are
+       * affecting visibility. */
+      state.need_update_pending_parents = true;
 
-    evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::DYNAMIC_VISIBILITY);
+      evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::DYNAMIC_VISIBILITY);
 
-    deg_graph_flush_visibility_flags_if_needed(graph);
+      deg_graph_flush_visibility_flags_if_needed(graph);
 
-    /* Update parents to an updated visibility and evaluation stage.
-     *
-     * Need to do it regardless of whether visibility is actually changed or not: current state of
-     * the pending parents are all zeroes because it was previously calculated for only visibility
-     * related nodes and those are fully evaluated by now. */
-    state.need_update_pending_parents = true;
-  }
+      /* Update parents to an updated visibility and evaluation stage.
+       *
+       * Need to do it regardless of whether visibility is actually changed or not: current state
+       * of the pending parents are all zeroes because it was previously calculated for only
+       * visibility related nodes and those are fully evaluated by now. */
+      state.need_update_pending_parents = true;
+    }
 
-  evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::THREADED_EVALUATION);
+    evaluate_graph_threaded_stage(&state, task_pool, EvaluationStage::THREADED_EVALUATION);
 
-  BLI_task_pool_free(task_pool);
+    BLI_task_pool_free(task_pool);
+  });
 
   evaluate_graph_single_threaded_if_needed(&state);
 
@@ -457,6 +536,16 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
     deg_eval_stats_aggregate(graph);
   }
 
+  if (state.profile != nullptr) {
+    state.profile->end_evaluation(BLI_time_now_seconds());
+    state.profile->write_summary(stdout, graph->debug.name.c_str());
+  }
+
+  /* Update the scheduling priorities for the next evaluation. */
+  if (state.operation_costs_changed) {
+    deg_eval_stats_update_priorities(graph->operations);
+  }
+
   /* Clear any uncleared tags. */
   deg_graph_clear_tags(graph);
   graph->is_evaluating = false;
@@ -8,9 +8,13 @@
 
 #include "intern/eval/deg_eval_stats.h"
 
+#include <algorithm>
+
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "intern/depsgraph.hh"
+#include "intern/depsgraph_relation.hh"
 
 #include "intern/node/deg_node.hh"
 #include "intern/node/deg_node_component.hh"
@@ -39,4 +43,84 @@ void deg_eval_stats_aggregate(Depsgraph *graph)
   }
 }
 
+/* Weight of the latest evaluation time in the estimate. Smooths out occasional spikes, for example
+ * caused by a cache miss or by the operation being preempted. */
+static constexpr float COST_UPDATE_WEIGHT = 0.25f;
+
+static float operation_cost(const OperationNode *op_node)
+{
+  if (op_node->is_noop()) {
+    return 0.0f;
+  }
+  if (op_node->eval_time_estimate < 0.0f) {
+    return UNKNOWN_OPERATION_COST;
+  }
+  return op_node->eval_time_estimate;
+}
+
+bool deg_eval_stats_update_cost(OperationNode *op_node, const double time)
+{
+  const float old_estimate = op_node->eval_time_estimate;
+  if (old_estimate < 0.0f) {
+    op_node->eval_time_estimate = float(time);
+    return true;
+  }
+  const float new_estimate = old_estimate + (float(time) - old_estimate) * COST_UPDATE_WEIGHT;
+  op_node->eval_time_estimate = new_estimate;
+  return new_estimate > old_estimate * 2.0f || new_estimate < old_estimate * 0.5f;
+}
+
+void deg_eval_stats_update_priorities(const Span<OperationNode *> operations)
+{
+  enum {
+    DEG_NODE_VISITED = (1 << 0),
+  };
+
+  /* Visit operations in reverse topological order, so that the critical path of all children is
+   * known when the critical path of an operation is calculated. */
+  Vector<OperationNode *> stack;
+  for (OperationNode *op_node : operations) {
+    op_node->custom_flags = 0;
+    op_node->num_links_pending = 0;
+    op_node->critical_path_time = operation_cost(op_node);
+    for (Relation *rel : op_node->outlinks) {
+      if ((rel->to->type == NodeType::OPERATION) && (rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+        ++op_node->num_links_pending;
+      }
+    }
+    if (op_node->num_links_pending == 0) {
+      stack.append(op_node);
+      op_node->custom_flags |= DEG_NODE_VISITED;
+    }
+  }
+
+  while (!stack.is_empty()) {
+    OperationNode *op_node = stack.pop_last();
+    for (Relation *rel : op_node->inlinks) {
+      if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+        continue;
+      }
+      OperationNode *op_from = reinterpret_cast<OperationNode *>(rel->from);
+      op_from->critical_path_time = std::max(op_from->critical_path_time,
+                                             operation_cost(op_from) +
+                                                 op_node->critical_path_time);
+      BLI_assert(op_from->num_links_pending > 0);
+      --op_from->num_links_pending;
+      if ((op_from->num_links_pending == 0) && (op_from->custom_flags & DEG_NODE_VISITED) == 0) {
+        stack.append(op_from);
+        op_from->custom_flags |= DEG_NODE_VISITED;
+      }
+    }
+  }
+}
+
+bool deg_eval_stats_is_cheap(const OperationNode *op_node)
+{
+  /* The critical path of operations which were never evaluated is #UNKNOWN_OPERATION_COST, and
+   * also contains that cost when any dependent operation was not evaluated yet. Check the own
+   * estimate as well, in case priorities were not updated since the operation was added. */
+  return op_node->eval_time_estimate >= 0.0f &&
+         op_node->critical_path_time < INLINE_CRITICAL_PATH_TIME;
+}
+
 }  // namespace blender::deg
@@ -8,11 +8,39 @@
 
 #pragma once
 
+#include "BLI_span.hh"
+
 namespace blender::deg {
 
 struct Depsgraph;
+struct OperationNode;
+
+/* Cost which is used for operations which were never evaluated. Chosen such that chains of such
+ * operations are not considered to be cheap by the scheduler. */
+constexpr float UNKNOWN_OPERATION_COST = 1e-4f;
+
+/* Operations which are estimated to finish together with all their dependent operations in less
+ * time than this (in seconds) are evaluated by the thread which made them ready, instead of being
+ * pushed to the task pool. For those the task overhead is comparable to the evaluation itself. */
+constexpr float INLINE_CRITICAL_PATH_TIME = 2e-5f;
 
 /* Aggregate operation timings to overall component and ID nodes timing. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Update the estimated evaluation time of the operation from the time its evaluation took.
+ * Returns true when the estimate changed enough for the priorities to be updated.
+ *
+ * Only accesses the given operation, so it can be called from multiple threads for different
+ * operations. */
+bool deg_eval_stats_update_cost(OperationNode *op_node, double time);
+
+/* Calculate the critical path time of all operations from their estimated evaluation time.
+ * Uses the num_links_pending and custom_flags of the operations, so must not be called while the
+ * graph is being evaluated. */
+void deg_eval_stats_update_priorities(Span<OperationNode *> operations);
+
+/* Whether the operation is cheap enough to be evaluated by the thread which made it ready.
+ * Never true before the operation and all its dependent operations have an estimated cost. */
+bool deg_eval_stats_is_cheap(const OperationNode *op_node);
+
 }  // namespace blender::deg
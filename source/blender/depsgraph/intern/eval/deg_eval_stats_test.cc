@@ -0,0 +1,82 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/eval/deg_eval_stats.h"
+
+#include "BLI_vector.hh"
+
+#include "intern/depsgraph_relation.hh"
+#include "intern/node/deg_node_operation.hh"
+
+#include "testing/testing.h"
+
+namespace blender::deg::tests {
+
+static void make_evaluatable(OperationNode &op_node)
+{
+  op_node.evaluate = [](::Depsgraph * /*depsgraph*/) {};
+}
+
+TEST(deg_eval_stats, UnknownOperationIsNotCheap)
+{
+  OperationNode op_node;
+  make_evaluatable(op_node);
+  EXPECT_EQ(op_node.critical_path_time, UNKNOWN_OPERATION_COST);
+  EXPECT_FALSE(deg_eval_stats_is_cheap(&op_node));
+
+  /* The own estimate is known, but the priorities were not updated yet. */
+  EXPECT_TRUE(deg_eval_stats_update_cost(&op_node, 1e-6));
+  EXPECT_FALSE(deg_eval_stats_is_cheap(&op_node));
+
+  const Vector<OperationNode *> operations = {&op_node};
+  deg_eval_stats_update_priorities(operations);
+  EXPECT_FLOAT_EQ(op_node.critical_path_time, 1e-6f);
+  EXPECT_TRUE(deg_eval_stats_is_cheap(&op_node));
+}
+
+TEST(deg_eval_stats, UpdateCost)
+{
+  OperationNode op_node;
+  make_evaluatable(op_node);
+  EXPECT_TRUE(deg_eval_stats_update_cost(&op_node, 1e-3));
+  EXPECT_FLOAT_EQ(op_node.eval_time_estimate, 1e-3f);
+  /* Small changes are smoothed out and don't require new priorities. */
+  EXPECT_FALSE(deg_eval_stats_update_cost(&op_node, 2e-3));
+  EXPECT_FLOAT_EQ(op_node.eval_time_estimate, 1.25e-3f);
+  /* A large change does. */
+  EXPECT_TRUE(deg_eval_stats_update_cost(&op_node, 1.0));
+}
+
+TEST(deg_eval_stats, CriticalPath)
+{
+  /* a -> b -> c, a -> d, with d never evaluated. */
+  OperationNode a, b, c, d;
+  for (OperationNode *op_node : {&a, &b, &c, &d}) {
+    make_evaluatable(*op_node);
+  }
+  new Relation(&a, &b, "a -> b");
+  new Relation(&b, &c, "b -> c");
+  new Relation(&a, &d, "a -> d");
+  deg_eval_stats_update_cost(&a, 1e-6);
+  deg_eval_stats_update_cost(&b, 2e-6);
+  deg_eval_stats_update_cost(&c, 4e-6);
+
+  const Vector<OperationNode *> operations = {&a, &b, &c, &d};
+  deg_eval_stats_update_priorities(operations);
+  EXPECT_FLOAT_EQ(c.critical_path_time, 4e-6f);
+  EXPECT_FLOAT_EQ(b.critical_path_time, 6e-6f);
+  EXPECT_FLOAT_EQ(d.critical_path_time, UNKNOWN_OPERATION_COST);
+  EXPECT_FLOAT_EQ(a.critical_path_time, 1e-6f + UNKNOWN_OPERATION_COST);
+
+  /* Operations depending on an operation without an estimate are not inlined either. */
+  EXPECT_TRUE(deg_eval_stats_is_cheap(&b));
+  EXPECT_FALSE(deg_eval_stats_is_cheap(&d));
+  EXPECT_FALSE(deg_eval_stats_is_cheap(&a));
+}
+
+}  // namespace blender::deg::tests
@@ -13,6 +13,7 @@
 #include "BLI_utildefines.h"
 
 #include "intern/depsgraph.hh"
+#include "intern/eval/deg_eval_stats.h"
 #include "intern/node/deg_node_component.hh"
 #include "intern/node/deg_node_factory.hh"
 #include "intern/node/deg_node_id.hh"
@@ -209,7 +210,13 @@ const char *operationCodeAsString(OperationCode opcode)
   return "UNKNOWN";
 }
 
-OperationNode::OperationNode() : name_tag(-1), flag(0) {}
+OperationNode::OperationNode()
+    : name_tag(-1),
+      flag(0),
+      eval_time_estimate(-1.0f),
+      critical_path_time(UNKNOWN_OPERATION_COST)
+{
+}
 
 string OperationNode::identifier() const
 {
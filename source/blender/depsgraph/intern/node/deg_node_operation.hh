@@ -288,6 +288,15 @@ struct OperationNode : public Node {
   /* (OperationFlag) extra settings affecting evaluation. */
   int flag;
 
+  /* Estimated evaluation time in seconds, based on the time previous evaluations took.
+   * Negative when the operation was not evaluated yet. See #deg_eval_stats_update_cost(). */
+  float eval_time_estimate;
+  /* Estimated time needed to evaluate the most expensive chain of operations which starts at this
+   * operation, including the operation itself. Operations with a longer critical path are
+   * scheduled first. #UNKNOWN_OPERATION_COST until the priorities are updated after the first
+   * evaluation. See #deg_eval_stats_update_priorities(). */
+  float critical_path_time;
+
   DEG_DEPSNODE_DECLARE;
 };
 
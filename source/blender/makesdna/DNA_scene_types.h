@@ -2132,7 +2132,8 @@ enum {
   R_SIMPLIFY = 1 << 24,
   R_EDGE_FRS = 1 << 25,        /* R_EDGE reserved for Freestyle */
   R_PERSISTENT_DATA = 1 << 26, /* Keep data around for re-render. */
-  R_MODE_UNUSED_27 = 1 << 27,  /* cleared */
+  /** Evaluate the next frame of background animation renders while rendering the current one. */
+  R_PIPELINED_EVALUATION = 1 << 27,
 };
 
 /** #RenderData::seq_flag */
@@ -272,6 +272,40 @@ static void rna_Depsgraph_debug_stats_gnuplot(Depsgraph *depsgraph,
   fclose(f);
 }
 
+static void rna_Depsgraph_debug_profile_write(Depsgraph *depsgraph,
+                                             ReportList *reports,
+                                             const char *filepath,
+                                             bool (*write_fn)(const Depsgraph *, FILE *))
+{
+  FILE *f = fopen(filepath, "w");
+  if (f == nullptr) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot open file '%s' for writing", filepath);
+    return;
+  }
+  if (!write_fn(depsgraph, f)) {
+    BKE_report(reports,
+               RPT_ERROR,
+               "No evaluation of the dependency graph has been profiled, enable "
+               "bpy.app.debug_depsgraph_profile first");
+  }
+  fclose(f);
+}
+
+static void rna_Depsgraph_debug_profile_summary(Depsgraph *depsgraph,
+                                                ReportList *reports,
+                                                const char *filepath)
+{
+  rna_Depsgraph_debug_profile_write(
+      depsgraph, reports, filepath, DEG_debug_profile_write_summary);
+}
+
+static void rna_Depsgraph_debug_profile_trace(Depsgraph *depsgraph,
+                                              ReportList *reports,
+                                              const char *filepath)
+{
+  rna_Depsgraph_debug_profile_write(depsgraph, reports, filepath, DEG_debug_profile_write_trace);
+}
+
 static void rna_Depsgraph_debug_tag_update(Depsgraph *depsgraph)
 {
   DEG_graph_tag_relations_update(depsgraph);
@@ -716,6 +750,24 @@ static void rna_def_depsgraph(BlenderRNA *brna)
                                   "File name where gnuplot script will save the result");
   RNA_def_parameter_flags(parm, PropertyFlag(0), PARM_REQUIRED);
 
+  func = RNA_def_function(srna, "debug_profile_summary", "rna_Depsgraph_debug_profile_summary");
+  RNA_def_function_ui_description(func,
+                                  "Write the critical path, parallelism and slowest operations "
+                                  "of the last profiled evaluation");
+  RNA_def_function_flag(func, FUNC_USE_REPORTS);
+  parm = RNA_def_string_file_path(
+      func, "filepath", nullptr, FILE_MAX, "File Name", "Output path for the summary");
+  RNA_def_parameter_flags(parm, PropertyFlag(0), PARM_REQUIRED);
+
+  func = RNA_def_function(srna, "debug_profile_trace", "rna_Depsgraph_debug_profile_trace");
+  RNA_def_function_ui_description(
+      func,
+      "Write the last profiled evaluation as Chrome trace, for chrome://tracing or Perfetto");
+  RNA_def_function_flag(func, FUNC_USE_REPORTS);
+  parm = RNA_def_string_file_path(
+      func, "filepath", nullptr, FILE_MAX, "File Name", "Output path for the trace");
+  RNA_def_parameter_flags(parm, PropertyFlag(0), PARM_REQUIRED);
+
   func = RNA_def_function(srna, "debug_tag_update", "rna_Depsgraph_debug_tag_update");
 
   func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
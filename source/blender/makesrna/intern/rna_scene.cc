@@ -7502,6 +7502,16 @@ static void rna_def_scene_render_data(BlenderRNA *brna)
                            "at the cost of increased memory usage");
   RNA_def_property_update(prop, 0, "rna_Scene_use_persistent_data_update");
 
+  prop = RNA_def_property(srna, "use_pipelined_evaluation", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, nullptr, "mode", R_PIPELINED_EVALUATION);
+  RNA_def_property_ui_text(
+      prop,
+      "Pipelined Evaluation",
+      "Evaluate the next frame of animation renders while the current frame is rendered, at the "
+      "cost of keeping the evaluated scene of two frames in memory (only used for background "
+      "renders without persistent data, motion blur, or frame change, render pre and render "
+      "stats handlers)");
+
   /* Freestyle line thickness options */
   prop = RNA_def_property(srna, "line_thickness_mode", PROP_ENUM, PROP_NONE);
   RNA_def_property_enum_sdna(prop, nullptr, "line_thickness_mode");
@@ -7475,6 +7475,14 @@ static void rna_def_userdef_experimental(BlenderRNA *brna)
                            "Interactive Editor Docking",
                            "Move editor areas to new locations, including between windows");
   RNA_def_property_update(prop, 0, "rna_userdef_update");
+
+  prop = RNA_def_property(srna, "use_autosave_journal", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_ui_text(prop,
+                           "Auto Save Journal",
+                           "Write auto-saves to a journal file, only appending the data-blocks "
+                           "that changed since the previous auto-save. The whole file is still "
+                           "prepared on every auto-save, only writing it to disk is faster");
+  RNA_def_property_update(prop, 0, "rna_userdef_update");
 }
 
 static void rna_def_userdef_addon_collection(BlenderRNA *brna, PropertyRNA *cprop)
@@ -147,29 +147,52 @@ class SampleNearestSurfaceFunction : public mf::MultiFunction {
     MutableSpan<bool> is_valid_span = params.uninitialized_single_output_if_required<bool>(
         4, "Is Valid");
 
-    mask.foreach_index([&](const int i) {
-      const float3 position = positions[i];
-      const int sample_id = sample_ids[i];
-      const int group_index = group_indices_.index_of_try(sample_id);
-      if (group_index == -1) {
-        triangle_index[i] = -1;
-        sample_position[i] = float3(0, 0, 0);
-        if (!is_valid_span.is_empty()) {
-          is_valid_span[i] = false;
-        }
-        return;
+    const int groups_num = bvh_trees_.size();
+    IndexMaskMemory memory;
+    /* The last mask contains the samples with a group that doesn't exist on the mesh. */
+    Array<IndexMask> group_masks(groups_num + 1);
+    IndexMask::from_groups<int>(
+        mask,
+        memory,
+        [&](const int i) {
+          const int group_index = group_indices_.index_of_try(sample_ids[i]);
+          return group_index == -1 ? groups_num : group_index;
+        },
+        group_masks);
+
+    for (const int group_i : IndexRange(groups_num)) {
+      const IndexMask &group_mask = group_masks[group_i];
+      if (group_mask.is_empty()) {
+        continue;
       }
-      const BVHTreeFromMesh &bvh = bvh_trees_[group_index];
-      BVHTreeNearest nearest;
-      nearest.dist_sq = FLT_MAX;
-      BLI_bvhtree_find_nearest(
-          bvh.tree, position, &nearest, bvh.nearest_callback, const_cast<BVHTreeFromMesh *>(&bvh));
-      triangle_index[i] = nearest.index;
-      sample_position[i] = nearest.co;
+      const BVHTreeFromMesh &bvh = bvh_trees_[group_i];
+      Array<float3> group_positions(group_mask.size());
+      positions.materialize_compressed(group_mask, group_positions);
+      BVHTreeNearest nearest_init{};
+      nearest_init.index = -1;
+      nearest_init.dist_sq = FLT_MAX;
+      Array<BVHTreeNearest> nearest(group_mask.size(), nearest_init);
+      BLI_bvhtree_find_nearest_batch(*bvh.tree,
+                                     nearest.index_range(),
+                                     group_positions,
+                                     nearest,
+                                     bvh.nearest_callback,
+                                     const_cast<BVHTreeFromMesh *>(&bvh));
+      group_mask.foreach_index(GrainSize(4096), [&](const int i, const int pos) {
+        triangle_index[i] = nearest[pos].index;
+        sample_position[i] = nearest[pos].co;
+      });
       if (!is_valid_span.is_empty()) {
-        is_valid_span[i] = true;
+        index_mask::masked_fill(is_valid_span, true, group_mask);
       }
-    });
+    }
+
+    const IndexMask &invalid_mask = group_masks[groups_num];
+    index_mask::masked_fill(triangle_index, -1, invalid_mask);
+    index_mask::masked_fill(sample_position, float3(0, 0, 0), invalid_mask);
+    if (!is_valid_span.is_empty()) {
+      index_mask::masked_fill(is_valid_span, false, invalid_mask);
+    }
   }
 
   ExecutionHints get_execution_hints() const override
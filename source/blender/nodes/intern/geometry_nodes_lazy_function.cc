@@ -34,6 +34,7 @@
 #include "BLI_hash_md5.hh"
 #include "BLI_lazy_threading.hh"
 #include "BLI_map.hh"
+#include "BLI_task_trace.hh"
 
 #include "DNA_ID.h"
 
@@ -326,7 +327,10 @@ class LazyFunctionForGeometryNode : public LazyFunction {
         get_output_attribute_id};
 
     geo_eval_log::TimePoint start_time = geo_eval_log::Clock::now();
-    node_.typeinfo->geometry_node_execute(geo_params);
+    {
+      threading::trace::Scope trace_scope(node_.name, "geometry_nodes");
+      node_.typeinfo->geometry_node_execute(geo_params);
+    }
     geo_eval_log::TimePoint end_time = geo_eval_log::Clock::now();
 
     if (geo_eval_log::GeoTreeLogger *tree_logger = local_user_data.try_get_tree_logger(*user_data))
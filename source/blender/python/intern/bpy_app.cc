@@ -475,6 +475,11 @@ static PyGetSetDef bpy_app_getsets[] = {
      bpy_app_debug_set,
      bpy_app_debug_doc,
      (void *)G_DEBUG_DEPSGRAPH_PRETTY},
+    {"debug_depsgraph_profile",
+     bpy_app_debug_get,
+     bpy_app_debug_set,
+     bpy_app_debug_doc,
+     (void *)G_DEBUG_DEPSGRAPH_PROFILE},
     {"debug_simdata",
      bpy_app_debug_get,
      bpy_app_debug_set,
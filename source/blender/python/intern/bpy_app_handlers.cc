@@ -222,6 +222,13 @@ static PyTypeObject BPyPersistent_Type = {
 
 static PyObject *py_cb_array[BKE_CB_EVT_TOT] = {nullptr};
 
+/* Like #bpy_app_generic_callback, the size of the list is read without holding the GIL. */
+static bool bpy_app_generic_callback_poll(void *arg)
+{
+  PyObject *cb_list = py_cb_array[POINTER_AS_INT(arg)];
+  return PyList_GET_SIZE(cb_list) > 0;
+}
+
 static PyObject *make_app_cb_info()
 {
   PyObject *app_cb_info;
@@ -279,6 +286,7 @@ PyObject *BPY_app_handlers_struct()
     for (pos = 0; pos < BKE_CB_EVT_TOT; pos++) {
       funcstore = &funcstore_array[pos];
       funcstore->func = bpy_app_generic_callback;
+      funcstore->poll = bpy_app_generic_callback_poll;
       funcstore->alloc = 0;
       funcstore->arg = POINTER_FROM_INT(pos);
       BKE_callback_add(funcstore, eCbEvent(pos));
@@ -670,6 +670,13 @@ static void engine_depsgraph_init(RenderEngine *engine, ViewLayer *view_layer)
     reuse_depsgraph = true;
   }
 
+  /* Use the depsgraph which was evaluated for this frame while the previous one was rendered. */
+  bool is_prefetched = false;
+  if (!engine->depsgraph) {
+    engine->depsgraph = render_prefetch_take(engine->re, view_layer);
+    is_prefetched = (engine->depsgraph != nullptr);
+  }
+
   if (!engine->depsgraph) {
     /* Ensure we only use persistent data for one scene / view layer at a time,
      * to avoid excessive memory usage. */
@@ -697,6 +704,10 @@ static void engine_depsgraph_init(RenderEngine *engine, ViewLayer *view_layer)
       DRW_render_context_disable(engine->re);
     }
   }
+  else if (is_prefetched) {
+    /* Only re-evaluate what the Python callbacks change. */
+    BKE_scene_graph_update_for_prefetched_frame(engine->depsgraph, false);
+  }
   else {
     /* Go through update with full Python callbacks for regular render. */
     BKE_scene_graph_update_for_newframe_ex(engine->depsgraph, false);
@@ -894,6 +905,8 @@ static void engine_render_view_layer(Render *re,
 
   /* Perform render with engine. */
   if (use_engine) {
+    render_prefetch_begin(re, view_layer);
+
     const bool use_gpu_context = (engine->type->flag & RE_USE_GPU_CONTEXT);
     if (use_gpu_context) {
       DRW_render_context_enable(engine->re);
@@ -36,6 +36,7 @@
 #include "BLI_rect.h"
 #include "BLI_set.hh"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_time.h"
 #include "BLI_timecode.h"
@@ -91,6 +92,10 @@
 #include "WM_api.hh"
 #include "wm_window.hh"
 
+#ifdef WITH_PYTHON
+#  include "BPY_extern.h"
+#endif
+
 #ifdef WITH_FREESTYLE
 #  include "FRS_freestyle.h"
 #endif
@@ -311,6 +316,148 @@ static bool render_scene_has_layers_to_render(Scene *scene, ViewLayer *single_la
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Pipelined Evaluation
+ *
+ * While a frame of an animation is rendered, the depsgraph of the next frame is evaluated by a
+ * background task. The render engine of the next frame then takes the evaluated depsgraph instead
+ * of evaluating the scene itself, so that scene evaluation and rendering overlap instead of
+ * leaving cores idle in turns.
+ *
+ * The background evaluation only reads the original data, so it has to be finished before any
+ * handlers or other code which might modify it runs on the main thread.
+ * \{ */
+
+/**
+ * Handlers which run while or after the next frame is evaluated ahead:
+ * - Frame change and render pre handlers of the next frame run after its evaluation. Only data
+ *   they tag for an update is evaluated again, but they commonly change data without tagging it,
+ *   e.g. values read by drivers from `bpy.app.driver_namespace`.
+ * - Render stats handlers run while the background task reads the original data.
+ */
+static bool render_prefetch_has_handlers()
+{
+  return BKE_callback_has_handlers(BKE_CB_EVT_FRAME_CHANGE_PRE) ||
+         BKE_callback_has_handlers(BKE_CB_EVT_RENDER_PRE) ||
+         BKE_callback_has_handlers(BKE_CB_EVT_RENDER_STATS);
+}
+
+static bool render_use_prefetch(Render *re, RenderData *rd)
+{
+  /* The interface could modify the scene while evaluating ahead. */
+  if (!G.background || !(rd->mode & R_PIPELINED_EVALUATION)) {
+    return false;
+  }
+  /* Persistent data keeps the depsgraph of the engine across frames, and motion blur changes the
+   * frame of the original scene while rendering. */
+  if (rd->mode & (R_PERSISTENT_DATA | R_MBLUR)) {
+    return false;
+  }
+  /* GPU engines keep their depsgraph across frames as well. */
+  const RenderEngineType *type = RE_engines_find(rd->engine);
+  if (type->flag & RE_USE_GPU_CONTEXT) {
+    return false;
+  }
+  /* Scene strips evaluate depsgraphs of their own while rendering. */
+  if (RE_seq_render_active(re->scene, rd)) {
+    return false;
+  }
+  if (render_prefetch_has_handlers()) {
+    return false;
+  }
+  return true;
+}
+
+static void render_prefetch_task(TaskPool *__restrict pool, void * /*taskdata*/)
+{
+  Render *re = static_cast<Render *>(BLI_task_pool_user_data(pool));
+  DEG_evaluate_on_framechange(re->prefetch_depsgraph, float(re->prefetch_frame));
+}
+
+static void render_prefetch_wait(Render *re)
+{
+  if (re->prefetch_task_pool == nullptr) {
+    return;
+  }
+
+#ifdef WITH_PYTHON
+  /* Release the GIL so that Python drivers can be evaluated by the background task. */
+  BPy_BEGIN_ALLOW_THREADS;
+#endif
+
+  BLI_task_pool_work_and_wait(re->prefetch_task_pool);
+
+#ifdef WITH_PYTHON
+  BPy_END_ALLOW_THREADS;
+#endif
+
+  BLI_task_pool_free(re->prefetch_task_pool);
+  re->prefetch_task_pool = nullptr;
+}
+
+static void render_prefetch_free(Render *re)
+{
+  render_prefetch_wait(re);
+
+  if (re->prefetch_depsgraph != nullptr) {
+    DEG_graph_free(re->prefetch_depsgraph);
+    re->prefetch_depsgraph = nullptr;
+  }
+}
+
+void render_prefetch_begin(Render *re, ViewLayer *view_layer)
+{
+  /* Handlers may also be registered by other handlers while rendering. */
+  if (!re->use_prefetch || render_prefetch_has_handlers()) {
+    return;
+  }
+
+  /* Evaluating multiple view layers ahead would need a depsgraph for each of them. */
+  int view_layers_num = 0;
+  FOREACH_VIEW_LAYER_TO_RENDER_BEGIN (re, view_layer_iter) {
+    view_layers_num++;
+  }
+  FOREACH_VIEW_LAYER_TO_RENDER_END;
+  if (view_layers_num != 1) {
+    return;
+  }
+
+  /* Discard a depsgraph which was evaluated for a frame that has been skipped. */
+  render_prefetch_free(re);
+
+  /* Building relations is cheap compared to evaluation, keep it on the main thread so that the
+   * depsgraph registry is not modified concurrently. */
+  re->prefetch_depsgraph = DEG_graph_new(re->main, re->scene, view_layer, DAG_EVAL_RENDER);
+  DEG_debug_name_set(re->prefetch_depsgraph, "RENDER PREFETCH");
+  DEG_graph_relations_update(re->prefetch_depsgraph);
+
+  re->prefetch_task_pool = BLI_task_pool_create_background(re, TASK_PRIORITY_LOW);
+  BLI_task_pool_push(re->prefetch_task_pool, render_prefetch_task, nullptr, false, nullptr);
+}
+
+Depsgraph *render_prefetch_take(Render *re, ViewLayer *view_layer)
+{
+  render_prefetch_wait(re);
+
+  Depsgraph *depsgraph = re->prefetch_depsgraph;
+  if (depsgraph == nullptr) {
+    return nullptr;
+  }
+  if (DEG_get_bmain(depsgraph) != re->main || DEG_get_input_scene(depsgraph) != re->scene ||
+      DEG_get_input_view_layer(depsgraph) != view_layer ||
+      DEG_get_ctime(depsgraph) != BKE_scene_ctime_get(re->scene) ||
+      render_prefetch_has_handlers())
+  {
+    return nullptr;
+  }
+
+  re->prefetch_depsgraph = nullptr;
+  DEG_debug_name_set(depsgraph, "RENDER");
+  return depsgraph;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Public Render API
  * \{ */
@@ -1272,6 +1419,9 @@ static void do_render_compositor_scenes(Render *re)
       continue;
     }
 
+    /* Rendering another scene evaluates its depsgraph and runs its handlers on the main thread. */
+    render_prefetch_wait(re);
+
     scenes_rendered.add_new(node_scene);
     do_render_compositor_scene(re, node_scene, re->scene->r.cfra);
     node->typeinfo->updatefunc(re->scene->nodetree, node);
@@ -1973,6 +2123,8 @@ static void render_init_depsgraph(Render *re)
 /* Free data only needed during rendering operation. */
 static void render_pipeline_free(Render *re)
 {
+  render_prefetch_free(re);
+
   if (re->engine && !RE_engine_use_persistent_data(re->engine)) {
     RE_engine_free(re->engine);
     re->engine = nullptr;
@@ -2416,6 +2568,8 @@ void RE_RenderAnim(Render *re,
   re->flag |= R_ANIMATION;
   DEG_graph_id_tag_update(re->main, re->pipeline_depsgraph, &re->scene->id, ID_RECALC_AUDIO_MUTE);
 
+  const bool use_prefetch = render_use_prefetch(re, &rd);
+
   scene->r.subframe = 0.0f;
   for (nfra = sfra, scene->r.cfra = sfra; scene->r.cfra <= efra; scene->r.cfra++) {
     char filepath[FILE_MAX];
@@ -2530,6 +2684,10 @@ void RE_RenderAnim(Render *re,
     /* run callbacks before rendering, before the scene is updated */
     render_callback_exec_id(re, re->main, &scene->id, BKE_CB_EVT_RENDER_PRE);
 
+    /* Evaluate the next frame while this one is rendered. */
+    re->use_prefetch = use_prefetch && nfra <= efra;
+    re->prefetch_frame = nfra;
+
     do_render_full_pipeline(re);
     totrendered++;
 
@@ -2545,6 +2703,11 @@ void RE_RenderAnim(Render *re,
       G.is_break = true;
     }
 
+    /* Handlers and the update of the next frame modify the original data, which the prefetch
+     * task might still be reading. */
+    render_prefetch_wait(re);
+    re->use_prefetch = false;
+
     if (G.is_break == true) {
       /* remove touched file */
       if (is_movie == false && do_write_file) {
@@ -8,10 +8,25 @@
 
 #pragma once
 
+struct Depsgraph;
 struct Render;
 struct RenderData;
 struct RenderLayer;
 struct RenderResult;
+struct ViewLayer;
 
 RenderLayer *render_get_single_layer(Render *re, RenderResult *rr);
 void render_copy_renderdata(RenderData *to, RenderData *from);
+
+/**
+ * Start evaluating the depsgraph of the given view layer for the next frame of an animation
+ * render in the background, while the current frame is rendered. Does nothing when pipelined
+ * evaluation is not used.
+ */
+void render_prefetch_begin(Render *re, ViewLayer *view_layer);
+/**
+ * Take ownership of the depsgraph evaluated ahead of time, when it was evaluated for the given
+ * view layer at the current frame. Otherwise null is returned and the prefetched depsgraph is
+ * kept, since it might still be used by a later frame.
+ */
+Depsgraph *render_prefetch_take(Render *re, ViewLayer *view_layer);
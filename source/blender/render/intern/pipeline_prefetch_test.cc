@@ -0,0 +1,159 @@
+/* SPDX-FileCopyrightText: 2024 Blender Authors
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later */
+
+#include "tests/blendfile_loading_base_test.h"
+
+#include "DNA_layer_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_callbacks.hh"
+#include "BKE_layer.hh"
+#include "BKE_main.hh"
+#include "BKE_scene.hh"
+
+#include "DEG_depsgraph.hh"
+#include "DEG_depsgraph_query.hh"
+
+#include "RE_pipeline.h"
+
+#include "pipeline.hh"
+#include "render_types.h"
+
+namespace blender::render::tests {
+
+class RenderPrefetchTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+  Render *re = nullptr;
+
+  void SetUp() override
+  {
+    BlendfileLoadingBaseTest::SetUp();
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = static_cast<ViewLayer *>(scene->view_layers.first);
+    scene->r.cfra = 1;
+
+    re = RE_NewRender("Render Prefetch Test");
+    re->main = bmain;
+    re->scene = scene;
+    re->r = scene->r;
+  }
+
+  void TearDown() override
+  {
+    EXPECT_EQ(re->prefetch_depsgraph, nullptr);
+    RE_FreeRender(re);
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Evaluate the given frame ahead, as done while the previous frame is rendered. */
+  void prefetch(const int frame)
+  {
+    re->use_prefetch = true;
+    re->prefetch_frame = frame;
+    render_prefetch_begin(re, view_layer);
+    re->use_prefetch = false;
+  }
+};
+
+TEST_F(RenderPrefetchTest, take)
+{
+  prefetch(2);
+  scene->r.cfra = 2;
+  Depsgraph *depsgraph = render_prefetch_take(re, view_layer);
+  ASSERT_NE(depsgraph, nullptr);
+  EXPECT_EQ(DEG_get_ctime(depsgraph), 2.0f);
+  EXPECT_EQ(DEG_get_input_view_layer(depsgraph), view_layer);
+  EXPECT_EQ(re->prefetch_depsgraph, nullptr);
+  DEG_graph_free(depsgraph);
+
+  /* Nothing is left to take. */
+  EXPECT_EQ(render_prefetch_take(re, view_layer), nullptr);
+}
+
+TEST_F(RenderPrefetchTest, take_other_frame)
+{
+  prefetch(3);
+
+  /* The frame in between is rendered with a new depsgraph, the prefetched one is kept. */
+  scene->r.cfra = 2;
+  EXPECT_EQ(render_prefetch_take(re, view_layer), nullptr);
+  EXPECT_NE(re->prefetch_depsgraph, nullptr);
+
+  scene->r.cfra = 3;
+  Depsgraph *depsgraph = render_prefetch_take(re, view_layer);
+  ASSERT_NE(depsgraph, nullptr);
+  DEG_graph_free(depsgraph);
+}
+
+TEST_F(RenderPrefetchTest, take_other_view_layer)
+{
+  ViewLayer *other_view_layer = BKE_view_layer_add(scene, "Other", nullptr, VIEWLAYER_ADD_NEW);
+  other_view_layer->flag &= ~VIEW_LAYER_RENDER;
+
+  prefetch(2);
+  scene->r.cfra = 2;
+  EXPECT_EQ(render_prefetch_take(re, other_view_layer), nullptr);
+
+  Depsgraph *depsgraph = render_prefetch_take(re, view_layer);
+  ASSERT_NE(depsgraph, nullptr);
+  DEG_graph_free(depsgraph);
+}
+
+TEST_F(RenderPrefetchTest, multiple_view_layers)
+{
+  BKE_view_layer_add(scene, "Other", nullptr, VIEWLAYER_ADD_NEW);
+
+  prefetch(2);
+  EXPECT_EQ(re->prefetch_depsgraph, nullptr);
+}
+
+static void frame_change_pre(Main * /*bmain*/,
+                             PointerRNA ** /*pointers*/,
+                             const int /*num_pointers*/,
+                             void * /*arg*/)
+{
+}
+
+TEST_F(RenderPrefetchTest, frame_change_handler)
+{
+  /* Handlers of the next frame run after it was evaluated ahead, and may change data without
+   * tagging it for an update. */
+  bCallbackFuncStore funcstore = {};
+  funcstore.func = frame_change_pre;
+  BKE_callback_add(&funcstore, BKE_CB_EVT_FRAME_CHANGE_PRE);
+
+  prefetch(2);
+  EXPECT_EQ(re->prefetch_depsgraph, nullptr);
+  scene->r.cfra = 2;
+  EXPECT_EQ(render_prefetch_take(re, view_layer), nullptr);
+
+  BKE_callback_remove(&funcstore, BKE_CB_EVT_FRAME_CHANGE_PRE);
+}
+
+TEST_F(RenderPrefetchTest, handler_without_work)
+{
+  /* Registered callbacks which have nothing to run, like the Python handlers without any
+   * functions in their lists, don't prevent evaluating ahead. */
+  bCallbackFuncStore funcstore = {};
+  funcstore.func = frame_change_pre;
+  funcstore.poll = [](void * /*arg*/) { return false; };
+  BKE_callback_add(&funcstore, BKE_CB_EVT_FRAME_CHANGE_PRE);
+
+  prefetch(2);
+  scene->r.cfra = 2;
+  Depsgraph *depsgraph = render_prefetch_take(re, view_layer);
+  EXPECT_NE(depsgraph, nullptr);
+  if (depsgraph) {
+    DEG_graph_free(depsgraph);
+  }
+
+  BKE_callback_remove(&funcstore, BKE_CB_EVT_FRAME_CHANGE_PRE);
+}
+
+}  // namespace blender::render::tests
@@ -36,6 +36,7 @@ struct Object;
 struct RenderEngine;
 struct ReportList;
 struct Scene;
+struct TaskPool;
 
 struct BaseRender {
   BaseRender() = default;
@@ -211,6 +212,14 @@ struct Render : public BaseRender {
   struct Depsgraph *pipeline_depsgraph = nullptr;
   Scene *pipeline_scene_eval = nullptr;
 
+  /* Pipelined evaluation of animation renders, see #R_PIPELINED_EVALUATION. While a frame is
+   * rendered, the depsgraph of the next frame is evaluated by a background task. Only one frame
+   * is evaluated ahead, so at most two evaluated copies of the scene exist at the same time. */
+  bool use_prefetch = false;
+  int prefetch_frame = 0;
+  struct Depsgraph *prefetch_depsgraph = nullptr;
+  struct TaskPool *prefetch_task_pool = nullptr;
+
   /* Realtime GPU Compositor.
    * NOTE: Use bare pointer instead of smart pointer because the RealtimeCompositor is a fully
    * opaque type. */
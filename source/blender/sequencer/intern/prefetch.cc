@@ -18,6 +18,7 @@
 #include "DNA_space_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
 
 #include "IMB_imbuf.hh"
@@ -457,10 +458,8 @@ static void seq_prefetch_do_suspend(PrefetchJob *pfjob)
   BLI_mutex_unlock(&pfjob->prefetch_suspend_mutex);
 }
 
-static void *seq_prefetch_frames(void *job)
+static void seq_prefetch_frames_impl(PrefetchJob *pfjob)
 {
-  PrefetchJob *pfjob = (PrefetchJob *)job;
-
   while (seq_prefetch_cfra(pfjob) <= pfjob->scene->r.efra) {
     pfjob->scene_eval->ed->prefetch_job = nullptr;
 
@@ -513,7 +512,14 @@ static void *seq_prefetch_frames(void *job)
   seq_cache_free_temp_cache(pfjob->scene, pfjob->context.task_id, seq_prefetch_cfra(pfjob));
   pfjob->running = false;
   pfjob->scene_eval->ed->prefetch_job = nullptr;
+}
 
+static void *seq_prefetch_frames(void *job)
+{
+  PrefetchJob *pfjob = (PrefetchJob *)job;
+  /* Prefetching runs ahead of playback, don't slow down the work the user is waiting for. */
+  blender::threading::execute_with_priority(blender::threading::TaskPriority::Low,
+                                            [&]() { seq_prefetch_frames_impl(pfjob); });
   return nullptr;
 }
 
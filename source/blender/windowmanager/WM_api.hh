@@ -378,6 +378,11 @@ bool WM_stereo3d_enabled(wmWindow *win, bool skip_stereo3d_check);
 
 void WM_file_autoexec_init(const char *filepath);
 bool WM_file_read(bContext *C, const char *filepath, ReportList *reports);
+/**
+ * Write a JSON report of the time spent in the different phases of reading blend-files to
+ * \a filepath for all files read by #WM_file_read, pass null to disable.
+ */
+void WM_file_read_profile_set(const char *filepath);
 void WM_file_autosave_init(wmWindowManager *wm);
 bool WM_file_recover_last_session(bContext *C, ReportList *reports);
 void WM_file_tag_modified();
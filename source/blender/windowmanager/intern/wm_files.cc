@@ -1024,6 +1024,17 @@ static void file_read_reports_finalize(BlendFileReadReport *bf_reports)
   bf_reports->resynced_lib_overrides_libraries = nullptr;
 }
 
+/** See #WM_file_read_profile_set. */
+static char wm_file_read_profile_filepath[FILE_MAX] = "";
+/** The first read replaces an existing profile file, the following ones are appended to it. */
+static bool wm_file_read_profile_append = false;
+
+void WM_file_read_profile_set(const char *filepath)
+{
+  STRNCPY(wm_file_read_profile_filepath, filepath ? filepath : "");
+  wm_file_read_profile_append = false;
+}
+
 bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
 {
   /* Assume automated tasks with background, don't write recent file list. */
@@ -1057,9 +1068,16 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
      * risk, because the excluded path list is also loaded. Further it's just confusing
      * if a user loads a file and various preferences change. */
     params.skip_flags = BLO_READ_SKIP_USERDEF;
+    if (G.f & G_FLAG_READ_PARTIAL) {
+      params.skip_flags |= BLO_READ_SKIP_INACTIVE_DATA;
+    }
 
+    BlendFileReadProfile profile;
     BlendFileReadReport bf_reports{};
     bf_reports.reports = reports;
+    if (wm_file_read_profile_filepath[0] != '\0') {
+      bf_reports.profile = &profile;
+    }
     bf_reports.duration.whole = BLI_time_now_seconds();
     BlendFileData *bfd = BKE_blendfile_read(filepath, &params, &bf_reports);
     if (bfd != nullptr) {
@@ -1110,6 +1128,20 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
       bf_reports.duration.whole = BLI_time_now_seconds() - bf_reports.duration.whole;
       file_read_reports_finalize(&bf_reports);
 
+      if (bf_reports.profile != nullptr) {
+        if (BLO_read_profile_write_json(
+                profile, filepath, wm_file_read_profile_filepath, wm_file_read_profile_append))
+        {
+          wm_file_read_profile_append = true;
+        }
+        else {
+          BKE_reportf(reports,
+                      RPT_WARNING,
+                      "Unable to write read profile \"%s\"",
+                      wm_file_read_profile_filepath);
+        }
+      }
+
       success = true;
     }
   }
@@ -1961,6 +1993,14 @@ static bool wm_file_write_check_with_report_on_failure(Main *bmain,
     return false;
   }
 
+  if (bmain->is_read_partial && BLI_path_cmp(BKE_main_blendfile_path(bmain), filepath) == 0) {
+    BKE_report(reports,
+               RPT_ERROR,
+               "Cannot overwrite a partially opened file, the data-blocks that were not read "
+               "would be lost");
+    return false;
+  }
+
   LISTBASE_FOREACH (Library *, li, &bmain->libraries) {
     if (BLI_path_cmp(li->runtime.filepath_abs, filepath) == 0) {
       BKE_reportf(reports, RPT_ERROR, "Cannot overwrite used library '%.240s'", filepath);
@@ -1971,6 +2011,12 @@ static bool wm_file_write_check_with_report_on_failure(Main *bmain,
   return true;
 }
 
+/**
+ * State of the auto-save journal (see #BLO_write_file_journal),
+ * only used with the experimental `use_autosave_journal` preference.
+ */
+static BlendFileJournal *wm_autosave_journal = nullptr;
+
 /**
  * \see #wm_homefile_write_exec wraps #BLO_write_file in a similar way.
  */
@@ -1979,6 +2025,7 @@ static bool wm_file_write(bContext *C,
                           int fileflags,
                           eBLO_WritePathRemap remap_mode,
                           bool use_save_as_copy,
+                          eBLO_WriteCompressionProfile compression_profile,
                           ReportList *reports)
 {
   Main *bmain = CTX_data_main(C);
@@ -2078,6 +2125,7 @@ static bool wm_file_write(bContext *C,
   blend_write_params.remap_mode = remap_mode;
   blend_write_params.use_save_versions = true;
   blend_write_params.use_save_as_copy = use_save_as_copy;
+  blend_write_params.compression_profile = compression_profile;
   blend_write_params.thumb = thumb;
 
   const bool success = BLO_write_file(bmain, filepath, fileflags, &blend_write_params, reports);
@@ -2086,12 +2134,25 @@ static bool wm_file_write(bContext *C,
     const bool do_history_file_update = (G.background == false) &&
                                         (CTX_wm_manager(C)->op_undo_depth == 0);
 
+    if (bmain->is_read_partial) {
+      BKE_report(reports,
+                 RPT_WARNING,
+                 "File was partially opened, only the data-blocks that were read have been saved");
+    }
+
     if (use_save_as_copy == false) {
       STRNCPY(bmain->filepath, filepath); /* Is guaranteed current file. */
+      /* The new file holds everything that is loaded, it is safe to overwrite from now on. */
+      bmain->is_read_partial = false;
     }
 
     SET_FLAG_FROM_TEST(G.fileflags, fileflags & G_FILE_COMPRESS, G_FILE_COMPRESS);
 
+    /* The auto-save journal only grows while working, use the save to shrink it again. */
+    if (wm_autosave_journal) {
+      BLO_write_journal_compact(wm_autosave_journal);
+    }
+
     /* Prevent background mode scripts from clobbering history. */
     if (do_history_file_update) {
       wm_history_file_update();
@@ -2128,6 +2189,14 @@ static bool wm_file_write(bContext *C,
 /** \name Auto-Save API
  * \{ */
 
+static void wm_autosave_journal_free()
+{
+  if (wm_autosave_journal) {
+    BLO_write_journal_free(wm_autosave_journal);
+    wm_autosave_journal = nullptr;
+  }
+}
+
 static void wm_autosave_location(char filepath[FILE_MAX])
 {
   const int pid = abs(getpid());
@@ -2180,16 +2249,37 @@ bool WM_autosave_is_scheduled(wmWindowManager *wm)
 
 void WM_autosave_write(wmWindowManager *wm, Main *bmain)
 {
+  if (bmain->is_read_partial) {
+    /* Recovering the auto-save would silently replace the full file with the partial data. */
+    if (!G.quiet) {
+      printf("Skipping auto-save of partially opened file \"%s\"\n",
+             BKE_main_blendfile_path(bmain));
+    }
+    wm_autosave_timer_end(wm);
+    wm_autosave_timer_begin(wm);
+    return;
+  }
+
   ED_editors_flush_edits(bmain);
 
   char filepath[FILE_MAX];
   wm_autosave_location(filepath);
-  /* Save as regular blend file with recovery information. */
+  /* Save as regular blend file with recovery information. Auto-save is never compressed so that
+   * it interrupts the user as briefly as possible, which is why no compression profile is used. */
   const int fileflags = (G.fileflags & ~G_FILE_COMPRESS) | G_FILE_RECOVER_WRITE;
 
   /* Error reporting into console. */
-  BlendFileWriteParams params{};
-  BLO_write_file(bmain, filepath, fileflags, &params, nullptr);
+  if (USER_EXPERIMENTAL_TEST(&U, use_autosave_journal)) {
+    if (wm_autosave_journal == nullptr) {
+      wm_autosave_journal = BLO_write_journal_new();
+    }
+    BLO_write_file_journal(bmain, filepath, fileflags, wm_autosave_journal, nullptr);
+  }
+  else {
+    wm_autosave_journal_free();
+    BlendFileWriteParams params{};
+    BLO_write_file(bmain, filepath, fileflags, &params, nullptr);
+  }
 
   /* Restart auto-save timer. */
   wm_autosave_timer_end(wm);
@@ -2253,6 +2343,8 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer * /*wt*/)
 
 void wm_autosave_delete()
 {
+  wm_autosave_journal_free();
+
   char filepath[FILE_MAX];
 
   wm_autosave_location(filepath);
@@ -3556,9 +3648,11 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
 
   /* Set compression flag. */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
+  const eBLO_WriteCompressionProfile compression_profile = eBLO_WriteCompressionProfile(
+      RNA_enum_get(op->ptr, "compression_profile"));
 
   const bool success = wm_file_write(
-      C, filepath, fileflags, remap_mode, use_save_as_copy, op->reports);
+      C, filepath, fileflags, remap_mode, use_save_as_copy, compression_profile, op->reports);
 
   if ((op->flag & OP_IS_INVOKE) == 0) {
     /* OP_IS_INVOKE is set when the operator is called from the GUI.
@@ -3627,6 +3721,37 @@ static std::string wm_save_as_mainfile_get_description(bContext * /*C*/,
   return "";
 }
 
+static const EnumPropertyItem wm_file_compression_profile_items[] = {
+    {BLO_WRITE_COMPRESSION_FAST,
+     "FAST",
+     0,
+     "Fast",
+     "Compress quickly, resulting in larger files than the default"},
+    {BLO_WRITE_COMPRESSION_BALANCED,
+     "BALANCED",
+     0,
+     "Balanced",
+     "Compress quickly with a good compression ratio"},
+    {BLO_WRITE_COMPRESSION_ARCHIVAL,
+     "ARCHIVAL",
+     0,
+     "Archival",
+     "Compress slowly into the smallest files, for storage or transfer"},
+    {0, nullptr, 0, nullptr, nullptr},
+};
+
+static void wm_file_compression_properties(wmOperatorType *ot)
+{
+  RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  PropertyRNA *prop = RNA_def_enum(ot->srna,
+                                   "compression_profile",
+                                   wm_file_compression_profile_items,
+                                   BLO_WRITE_COMPRESSION_BALANCED,
+                                   "Compression Profile",
+                                   "Trade-off between saving time and file size when compressing");
+  RNA_def_property_flag(prop, PROP_SKIP_SAVE);
+}
+
 void WM_OT_save_as_mainfile(wmOperatorType *ot)
 {
   PropertyRNA *prop;
@@ -3649,7 +3774,7 @@ void WM_OT_save_as_mainfile(wmOperatorType *ot)
                                  WM_FILESEL_FILEPATH,
                                  FILE_DEFAULTDISPLAY,
                                  FILE_SORT_DEFAULT);
-  RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  wm_file_compression_properties(ot);
   RNA_def_boolean(ot->srna,
                   "relative_remap",
                   true,
@@ -3736,7 +3861,7 @@ void WM_OT_save_mainfile(wmOperatorType *ot)
                                  WM_FILESEL_FILEPATH,
                                  FILE_DEFAULTDISPLAY,
                                  FILE_SORT_DEFAULT);
-  RNA_def_boolean(ot->srna, "compress", false, "Compress", "Write compressed .blend file");
+  wm_file_compression_properties(ot);
   RNA_def_boolean(ot->srna,
                   "relative_remap",
                   false,
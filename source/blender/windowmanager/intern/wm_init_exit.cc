@@ -26,6 +26,7 @@
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_task.h"
+#include "BLI_task_trace.hh"
 #include "BLI_threads.h"
 #include "BLI_timer.h"
 #include "BLI_utildefines.h"
@@ -470,7 +471,8 @@ void WM_exit_ex(bContext *C, const bool do_python_exit, const bool do_user_exit_
   /* Modal handlers are on window level freed, others too? */
   /* NOTE: same code copied in `wm_files.cc`. */
   if (C && wm) {
-    if (do_user_exit_actions) {
+    /* A partially opened file can't be recovered without losing the data-blocks not read. */
+    if (do_user_exit_actions && !CTX_data_main(C)->is_read_partial) {
       /* Save quit.blend. */
       Main *bmain = CTX_data_main(C);
       char filepath[FILE_MAX];
@@ -704,6 +706,20 @@ void WM_exit(bContext *C, const int exit_code)
   const bool do_user_exit_actions = G.background ? false : (exit_code == EXIT_SUCCESS);
   WM_exit_ex(C, true, do_user_exit_actions);
 
+  if (MEM_memory_tags_enabled()) {
+    MEM_print_memory_tags_report();
+  }
+
+  if (blender::threading::trace::is_enabled()) {
+    const std::string trace_filepath = blender::threading::trace::filepath();
+    if (blender::threading::trace::stop()) {
+      printf("Task trace written to '%s'\n", trace_filepath.c_str());
+    }
+    else {
+      fprintf(stderr, "Unable to write task trace to '%s'\n", trace_filepath.c_str());
+    }
+  }
+
   if (!G.quiet) {
     printf("\nBlender quit\n");
   }
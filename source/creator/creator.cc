@@ -339,20 +339,36 @@ int main(int argc,
 
   /* NOTE: Special exception for guarded allocator type switch:
    *       we need to perform switch from lock-free to fully
-   *       guarded allocator before any allocation happened.
+   *       guarded (or slab) allocator before any allocation happened.
    */
   {
     int i;
+    bool use_slab_allocator = false;
+    bool use_memory_tags = false;
     for (i = 0; i < argc; i++) {
       if (STR_ELEM(argv[i], "-d", "--debug", "--debug-memory", "--debug-all")) {
         printf("Switching to fully guarded memory allocator.\n");
         MEM_use_guarded_allocator();
+        use_slab_allocator = false;
+        use_memory_tags = false;
         break;
       }
+      if (STREQ(argv[i], "--enable-slab-allocator")) {
+        use_slab_allocator = true;
+      }
+      if (STREQ(argv[i], "--debug-memory-report")) {
+        use_memory_tags = true;
+      }
       if (STR_ELEM(argv[i], "--", "--command")) {
         break;
       }
     }
+    if (use_slab_allocator) {
+      MEM_use_slab_allocator();
+    }
+    if (use_memory_tags) {
+      MEM_enable_memory_tags();
+    }
     MEM_init_memleak_detection();
   }
 
@@ -28,6 +28,7 @@
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
+#  include "BLI_task_trace.hh"
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 #  ifndef NDEBUG
@@ -738,6 +739,7 @@ static void print_help(bArgs *ba, bool all)
     BLI_args_print_arg_doc(ba, "--debug-cycles");
   }
   BLI_args_print_arg_doc(ba, "--debug-memory");
+  BLI_args_print_arg_doc(ba, "--debug-memory-report");
   BLI_args_print_arg_doc(ba, "--debug-jobs");
   BLI_args_print_arg_doc(ba, "--debug-python");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph");
@@ -748,6 +750,7 @@ static void print_help(bArgs *ba, bool all)
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-time");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-pretty");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph-uid");
+  BLI_args_print_arg_doc(ba, "--debug-depsgraph-profile");
   BLI_args_print_arg_doc(ba, "--debug-ghost");
   BLI_args_print_arg_doc(ba, "--debug-wintab");
   BLI_args_print_arg_doc(ba, "--debug-gpu");
@@ -788,6 +791,11 @@ static void print_help(bArgs *ba, bool all)
   BLI_args_print_arg_doc(ba, "--app-template");
   BLI_args_print_arg_doc(ba, "--factory-startup");
   BLI_args_print_arg_doc(ba, "--enable-event-simulate");
+  BLI_args_print_arg_doc(ba, "--enable-file-mapping");
+  BLI_args_print_arg_doc(ba, "--enable-slab-allocator");
+  BLI_args_print_arg_doc(ba, "--open-partial");
+  BLI_args_print_arg_doc(ba, "--profile-blend-read");
+  BLI_args_print_arg_doc(ba, "--profile-tasks");
   PRINT("\n");
   BLI_args_print_arg_doc(ba, "--env-system-datafiles");
   BLI_args_print_arg_doc(ba, "--env-system-scripts");
@@ -1298,6 +1306,10 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_pretty[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_uid[] =
     "\n\t"
     "Verify validness of session-wide identifiers assigned to ID data-blocks.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_profile[] =
+    "\n\t"
+    "Record when every dependency graph operation runs and on which thread, and print the\n"
+    "\tcritical path and parallelism of every evaluation.";
 static const char arg_handle_debug_mode_generic_set_doc_gpu_force_workarounds[] =
     "\n\t"
     "Enable workarounds for typical GPU issues and disable all GPU extensions.";
@@ -1363,6 +1375,19 @@ static int arg_handle_debug_mode_memory_set(int /*argc*/, const char ** /*argv*/
   return 0;
 }
 
+static const char arg_handle_debug_mode_memory_report_set_doc[] =
+    "\n\t"
+    "Track memory usage per allocation name and print the names with the highest peak usage\n"
+    "\ton exit and with the memory statistics operator. Ignored with fully guarded memory\n"
+    "\tallocation, which always tracks names.";
+static int arg_handle_debug_mode_memory_report_set(int /*argc*/,
+                                                   const char ** /*argv*/,
+                                                   void * /*data*/)
+{
+  /* Handled in `main` before any allocation, see #MEM_enable_memory_tags. */
+  return 0;
+}
+
 static const char arg_handle_debug_value_set_doc[] =
     "<value>\n"
     "\tSet debug value of <value> on startup.";
@@ -1566,6 +1591,71 @@ static int arg_handle_enable_event_simulate(int /*argc*/, const char ** /*argv*/
   return 0;
 }
 
+static const char arg_handle_enable_file_mapping_doc[] =
+    "\n\t"
+    "Reference large arrays of uncompressed blend-files directly from the memory-mapped file\n"
+    "\tinstead of copying them, reducing load time and memory usage of read-only data.\n"
+    "\tThe files stay mapped while their data is used, which may prevent overwriting them.";
+static int arg_handle_enable_file_mapping(int /*argc*/, const char ** /*argv*/, void * /*data*/)
+{
+  G.f |= G_FLAG_READ_FILE_MAPPED;
+  return 0;
+}
+
+static const char arg_handle_enable_slab_allocator_doc[] =
+    "\n\t"
+    "Serve small memory allocations from per-thread caches of size-class slabs,\n"
+    "\tfaster for allocation heavy multi-threaded work at the cost of keeping freed memory.\n"
+    "\tIgnored when memory debugging is enabled.";
+static int arg_handle_enable_slab_allocator(int /*argc*/,
+                                            const char ** /*argv*/,
+                                            void * /*data*/)
+{
+  /* Handled in `main` before any allocation, see #MEM_use_slab_allocator. */
+  return 0;
+}
+
+static const char arg_handle_open_partial_doc[] =
+    "\n\t"
+    "Only read the active scene, the window-manager and the data they use from blend-files\n"
+    "\topened afterwards, skipping unrelated scenes and unused data-blocks.\n"
+    "\tTexts registered as Python modules and data-blocks with a fake user are always read.\n"
+    "\tPartially opened files can't be saved over the original file.";
+static int arg_handle_open_partial(int /*argc*/, const char ** /*argv*/, void * /*data*/)
+{
+  G.f |= G_FLAG_READ_PARTIAL;
+  return 0;
+}
+
+static const char arg_handle_profile_blend_read_doc[] =
+    "<filepath>\n"
+    "\tWrite a JSON report of the time spent reading blend-files opened afterwards to\n"
+    "\t<filepath>, per reading phase and data-block type.\n"
+    "\tEach read adds one line with a JSON object, keyed by the blend-file path.";
+static int arg_handle_profile_blend_read(int argc, const char **argv, void * /*data*/)
+{
+  if (argc > 1) {
+    WM_file_read_profile_set(argv[1]);
+    return 1;
+  }
+  fprintf(stderr, "\nError: File path must follow '--profile-blend-read'.\n");
+  return 0;
+}
+
+static const char arg_handle_profile_tasks_doc[] =
+    "<filepath>\n"
+    "\tRecord when tasks, depsgraph operations and geometry nodes run on which thread, and write\n"
+    "\tthe recording to <filepath> on exit, as JSON for 'chrome://tracing' or Perfetto.";
+static int arg_handle_profile_tasks(int argc, const char **argv, void * /*data*/)
+{
+  if (argc > 1) {
+    blender::threading::trace::start(argv[1]);
+    return 1;
+  }
+  fprintf(stderr, "\nError: File path must follow '--profile-tasks'.\n");
+  return 0;
+}
+
 static const char arg_handle_env_system_set_doc_datafiles[] =
     "\n\t"
     "Set the " STRINGIFY_ARG(BLENDER_SYSTEM_DATAFILES) " environment variable.";
@@ -2153,6 +2243,12 @@ static int arg_handle_scene_set(int argc, const char **argv, void *data)
         WM_window_set_active_scene(CTX_data_main(C), C, win, scene);
       }
     }
+    else if (CTX_data_main(C)->is_read_partial) {
+      fprintf(stderr,
+              "\nError: Scene '%s' was not read, only the active scene is read with "
+              "'--open-partial'.\n",
+              argv[1]);
+    }
     return 1;
   }
   fprintf(stderr, "\nError: Scene name must follow '-S / --scene'.\n");
@@ -2712,6 +2808,11 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
     BLI_args_add(ba, nullptr, "--debug-cycles", CB(arg_handle_debug_mode_cycles), nullptr);
   }
   BLI_args_add(ba, nullptr, "--debug-memory", CB(arg_handle_debug_mode_memory_set), nullptr);
+  BLI_args_add(ba,
+               nullptr,
+               "--debug-memory-report",
+               CB(arg_handle_debug_mode_memory_report_set),
+               nullptr);
 
   BLI_args_add(ba, nullptr, "--debug-value", CB(arg_handle_debug_value_set), nullptr);
   BLI_args_add(ba,
@@ -2771,6 +2872,11 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
                "--debug-depsgraph-uid",
                CB_EX(arg_handle_debug_mode_generic_set, depsgraph_uid),
                (void *)G_DEBUG_DEPSGRAPH_UID);
+  BLI_args_add(ba,
+               nullptr,
+               "--debug-depsgraph-profile",
+               CB_EX(arg_handle_debug_mode_generic_set, depsgraph_profile),
+               (void *)G_DEBUG_DEPSGRAPH_PROFILE);
   BLI_args_add(ba,
                nullptr,
                "--debug-gpu-force-workarounds",
@@ -2784,6 +2890,14 @@ void main_args_setup(bContext *C, bArgs *ba, bool all)
   BLI_args_add(ba, nullptr, "--factory-startup", CB(arg_handle_factory_startup_set), nullptr);
   BLI_args_add(
       ba, nullptr, "--enable-event-simulate", CB(arg_handle_enable_event_simulate), nullptr);
+  BLI_args_add(
+      ba, nullptr, "--enable-file-mapping", CB(arg_handle_enable_file_mapping), nullptr);
+  BLI_args_add(
+      ba, nullptr, "--enable-slab-allocator", CB(arg_handle_enable_slab_allocator), nullptr);
+  BLI_args_add(ba, nullptr, "--open-partial", CB(arg_handle_open_partial), nullptr);
+  BLI_args_add(
+      ba, nullptr, "--profile-blend-read", CB(arg_handle_profile_blend_read), nullptr);
+  BLI_args_add(ba, nullptr, "--profile-tasks", CB(arg_handle_profile_tasks), nullptr);
 
   /* Pass: Custom Window Stuff. */
   BLI_args_pass_set(ba, ARG_PASS_SETTINGS_GUI);
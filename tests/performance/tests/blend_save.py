@@ -0,0 +1,62 @@
+# SPDX-FileCopyrightText: 2024 Blender Authors
+#
+# SPDX-License-Identifier: Apache-2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import os
+    import tempfile
+    import time
+
+    bpy.ops.wm.open_mainfile(filepath=args['filepath'])
+
+    with tempfile.TemporaryDirectory() as tempdir:
+        filepath = os.path.join(tempdir, "blend_save.blend")
+        compress = args['compression_profile'] != 'NONE'
+        save_args = {'filepath': filepath, 'copy': True, 'compress': compress}
+        if compress:
+            save_args['compression_profile'] = args['compression_profile']
+
+        # Save once to ensure all data is initialized and the file exists.
+        bpy.ops.wm.save_as_mainfile(**save_args)
+
+        # Measure saving the second time.
+        start_time = time.time()
+        bpy.ops.wm.save_as_mainfile(**save_args)
+        elapsed_time = time.time() - start_time
+
+        file_size = os.path.getsize(filepath)
+
+    result = {'time': elapsed_time, 'file_size': file_size}
+    return result
+
+
+class BlendSaveTest(api.Test):
+    def __init__(self, filepath, compression_profile):
+        self.filepath = filepath
+        self.compression_profile = compression_profile
+
+    def name(self):
+        return f"{self.filepath.stem}_{self.compression_profile.lower()}"
+
+    def category(self):
+        return "blend_save"
+
+    def run(self, env, device_id):
+        args = {
+            'filepath': str(self.filepath),
+            'compression_profile': self.compression_profile,
+        }
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    filepaths = env.find_blend_files('*/*')
+    compression_profiles = ('NONE', 'FAST', 'BALANCED', 'ARCHIVAL')
+    return [BlendSaveTest(filepath, compression_profile)
+            for filepath in filepaths
+            for compression_profile in compression_profiles]
@@ -0,0 +1,128 @@
+# SPDX-FileCopyrightText: 2024 Blender Authors
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+Compare animation renders with and without pipelined evaluation, which evaluates the next frame
+while the current one is rendered. Both must give exactly the same images.
+
+blender -b --factory-startup --python tests/python/bl_render_pipelined_evaluation.py -- \
+    --output-dir /tmp/render_pipelined_evaluation
+"""
+
+import pathlib
+import sys
+import unittest
+
+import bpy
+
+args = None
+
+FRAME_START = 1
+FRAME_END = 6
+
+
+def _setup_scene():
+    bpy.ops.wm.read_homefile(use_factory_startup=True)
+    scene = bpy.context.scene
+    scene.render.engine = 'CYCLES'
+    scene.cycles.device = 'CPU'
+    scene.cycles.samples = 4
+    scene.cycles.use_adaptive_sampling = False
+    scene.cycles.use_denoising = False
+    scene.cycles.seed = 0
+    scene.render.resolution_x = 32
+    scene.render.resolution_y = 32
+    scene.render.resolution_percentage = 100
+    scene.render.image_settings.file_format = 'OPEN_EXR'
+    scene.render.image_settings.color_depth = '32'
+    scene.frame_start = FRAME_START
+    scene.frame_end = FRAME_END
+    return scene
+
+
+class PipelinedEvaluationTest(unittest.TestCase):
+    def setUp(self):
+        self.handlers = []
+
+    def tearDown(self):
+        for handler_list, handler in self.handlers:
+            if handler in handler_list:
+                handler_list.remove(handler)
+        bpy.app.driver_namespace.pop("pipelined_evaluation_offset", None)
+
+    def _add_handler(self, handler_list, handler):
+        handler_list.append(handler)
+        self.handlers.append((handler_list, handler))
+
+    def _render(self, name, build_scene, use_pipelined_evaluation):
+        # Start from a new file for every render, so that no simulation cache is shared.
+        scene = _setup_scene()
+        build_scene(scene)
+
+        output_dir = pathlib.Path(args.output_dir) / self.id().rsplit(".", 1)[-1]
+        scene.render.use_pipelined_evaluation = use_pipelined_evaluation
+        scene.render.filepath = str(output_dir / (name + "_####"))
+        bpy.ops.render.render(animation=True)
+
+        pixels = []
+        for frame in range(FRAME_START, FRAME_END + 1):
+            image = bpy.data.images.load(scene.render.frame_path(frame=frame))
+            pixels.append(image.pixels[:])
+            bpy.data.images.remove(image)
+        return pixels
+
+    def _assertSameRender(self, build_scene):
+        pixels_expected = self._render("reference", build_scene, False)
+        pixels_pipelined = self._render("pipelined", build_scene, True)
+        for frame, (expected, pipelined) in enumerate(zip(pixels_expected, pixels_pipelined),
+                                                      start=FRAME_START):
+            self.assertEqual(expected, pipelined, "Frame {:d} differs".format(frame))
+
+    def test_physics(self):
+        def build_scene(scene):
+            bpy.ops.mesh.primitive_plane_add(size=10.0)
+            bpy.ops.rigidbody.object_add(type='PASSIVE')
+            bpy.ops.mesh.primitive_cube_add(location=(0.0, 0.0, 3.0), rotation=(0.3, 0.2, 0.1))
+            bpy.ops.rigidbody.object_add(type='ACTIVE')
+            scene.rigidbody_world.point_cache.frame_end = FRAME_END
+
+        self._assertSameRender(build_scene)
+
+    def test_frame_change_handler(self):
+        # Drivers reading values which handlers set without tagging anything for an update are a
+        # common way to pass per-frame data into a render.
+        def frame_change_pre(scene, _depsgraph):
+            bpy.app.driver_namespace["pipelined_evaluation_offset"] = scene.frame_current * 0.25
+
+        def build_scene(scene):
+            bpy.context.preferences.filepaths.use_scripts_auto_execute = True
+            # Loading the file removed the handler of the previous render.
+            self._add_handler(bpy.app.handlers.frame_change_pre, frame_change_pre)
+            frame_change_pre(scene, None)
+
+            cube = bpy.data.objects["Cube"]
+            driver = cube.driver_add("location", 0).driver
+            driver.type = 'SCRIPTED'
+            driver.expression = "pipelined_evaluation_offset"
+
+        self._assertSameRender(build_scene)
+
+
+def main():
+    global args
+    import argparse
+
+    argv = [sys.argv[0]]
+    if '--' in sys.argv:
+        argv += sys.argv[sys.argv.index('--') + 1:]
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--output-dir', dest='output_dir', type=str, required=True)
+    args, remaining = parser.parse_known_args(argv)
+
+    unittest.main(argv=remaining)
+
+
+if __name__ == "__main__":
+    main()